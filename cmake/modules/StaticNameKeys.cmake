@@ -0,0 +1,87 @@
+# Collect the literal names passed to Name_To_Key and StaticNameKey so they can be hashed at compile time and seeded
+# into the NameKeyGenerator before anything else. The list is written at configure time so it always exists, then
+# rescanned by the custom target whenever one of the sources changes. A name missing from the list is simply hashed at
+# run time like any other.
+function(_scan_static_name_keys outfile)
+    set(_names)
+
+    foreach(_source IN ITEMS ${ARGN})
+        if(NOT _source MATCHES "\\.cpp$")
+            continue()
+        endif()
+
+        file(STRINGS "${_source}" _lines REGEX "(Name_To_Key|StaticNameKey [A-Za-z0-9_]+)\\(\"[^\"]+\"\\)")
+
+        foreach(_line IN ITEMS ${_lines})
+            string(REGEX MATCHALL "(Name_To_Key|StaticNameKey [A-Za-z0-9_]+)\\(\"[^\"]+\"\\)" _calls "${_line}")
+
+            foreach(_call IN ITEMS ${_calls})
+                string(REGEX REPLACE ".*\\(\"([^\"]+)\"\\)" "\\1" _name "${_call}")
+                list(APPEND _names "${_name}")
+            endforeach()
+        endforeach()
+    endforeach()
+
+    list(REMOVE_DUPLICATES _names)
+    list(SORT _names)
+
+    set(_contents "// Generated by StaticNameKeys.cmake, do not edit.\n")
+
+    foreach(_name IN ITEMS ${_names})
+        string(APPEND _contents "STATIC_NAME_KEY(\"${_name}\")\n")
+    endforeach()
+
+    # Only touch the file when the list changes so rescanning doesn't rebuild anything.
+    if(EXISTS "${outfile}")
+        file(READ "${outfile}" _old_contents)
+    endif()
+
+    if(NOT "${_contents}" STREQUAL "${_old_contents}")
+        file(WRITE "${outfile}" "${_contents}")
+    endif()
+endfunction()
+
+# Adds a target that keeps outfile up to date with the sources, targets compiling staticnamekey.cpp depend on it.
+function(generate_static_name_keys target outfile)
+    set(_sources)
+
+    foreach(_source IN ITEMS ${ARGN})
+        if(_source MATCHES "\\.cpp$")
+            get_filename_component(_source "${_source}" ABSOLUTE)
+            list(APPEND _sources "${_source}")
+        endif()
+    endforeach()
+
+    _scan_static_name_keys("${outfile}" ${_sources})
+
+    # The source list goes in a file rather than on the command line which would be too long for some platforms.
+    set(_list_file "${outfile}.sources")
+    string(REPLACE ";" "\n" _list_contents "${_sources}")
+
+    if(EXISTS "${_list_file}")
+        file(READ "${_list_file}" _old_list_contents)
+    endif()
+
+    if(NOT "${_list_contents}" STREQUAL "${_old_list_contents}")
+        file(WRITE "${_list_file}" "${_list_contents}")
+    endif()
+
+    add_custom_command(
+        OUTPUT "${outfile}.stamp"
+        BYPRODUCTS "${outfile}"
+        COMMAND ${CMAKE_COMMAND} -DSTATIC_NAME_KEYS_OUTFILE=${outfile} -DSTATIC_NAME_KEYS_SOURCES=${_list_file}
+            -P ${CMAKE_CURRENT_FUNCTION_LIST_FILE}
+        COMMAND ${CMAKE_COMMAND} -E touch "${outfile}.stamp"
+        DEPENDS ${_sources} "${_list_file}" ${CMAKE_CURRENT_FUNCTION_LIST_FILE}
+        COMMENT "Scanning for static name keys"
+        VERBATIM
+    )
+
+    add_custom_target(${target} DEPENDS "${outfile}.stamp")
+endfunction()
+
+# Rescan when run as a script by the custom command above.
+if(CMAKE_SCRIPT_MODE_FILE AND DEFINED STATIC_NAME_KEYS_OUTFILE)
+    file(STRINGS "${STATIC_NAME_KEYS_SOURCES}" _static_name_key_sources)
+    _scan_static_name_keys("${STATIC_NAME_KEYS_OUTFILE}" ${_static_name_key_sources})
+endif()
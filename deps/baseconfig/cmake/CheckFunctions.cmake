@@ -16,6 +16,7 @@ check_include_file(sys/time.h HAVE_SYS_TIME_H)
 check_include_file(sys/statvfs.h HAVE_SYS_STATVFS_H)
 check_include_file(sys/sysinfo.h HAVE_SYS_SYSINFO_H)
 check_include_file(sys/select.h HAVE_SYS_SELECT_H)
+check_include_file(sys/inotify.h HAVE_SYS_INOTIFY_H)
 check_include_file(dispatch/dispatch.h HAVE_MACOS_GCD)
 
 if(HAVE_STRINGS_H)
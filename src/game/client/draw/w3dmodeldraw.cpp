@@ -198,6 +198,12 @@ bool Find_Single_Sub_Obj(RenderObjClass *r, Utf8String const &sub_obj_name, Matr
     return true;
 }
 
+// Numbered bones are the base name followed by the number, the hash carries on from the one of the base name.
+NameKeyType Numbered_Bone_Key(const char *bone_id, int name_length, unsigned int name_hash)
+{
+    return g_theNameKeyGenerator->Hashed_Name_To_Key(bone_id, Name_Key_Hash(bone_id + name_length, name_hash));
+}
+
 bool Do_Single_Bone_Name(RenderObjClass *robj, Utf8String const &bone, std::map<NameKeyType, PristineBoneInfo> &map)
 {
     bool bone_found = false;
@@ -206,10 +212,11 @@ bool Do_Single_Bone_Name(RenderObjClass *robj, Utf8String const &bone, std::map<
     Utf8String bone_id;
     Utf8String bone_lower(bone);
     bone_lower.To_Lower();
+    unsigned int bone_hash = Name_Key_Hash(bone_lower.Str());
     Set_FP_Mode();
 
     if (Find_Single_Bone(robj, bone_lower, info.transform, info.index)) {
-        map[g_theNameKeyGenerator->Name_To_Key(bone_lower.Str())] = info;
+        map[g_theNameKeyGenerator->Hashed_Name_To_Key(bone_lower.Str(), bone_hash)] = info;
         bone_found = true;
     }
 
@@ -220,13 +227,13 @@ bool Do_Single_Bone_Name(RenderObjClass *robj, Utf8String const &bone, std::map<
             break;
         }
 
-        map[g_theNameKeyGenerator->Name_To_Key(bone_id.Str())] = info;
+        map[Numbered_Bone_Key(bone_id.Str(), bone_lower.Get_Length(), bone_hash)] = info;
         bone_found = true;
     }
 
     if (!bone_found) {
         if (Find_Single_Sub_Obj(robj, bone_lower, info.transform, info.index)) {
-            map[g_theNameKeyGenerator->Name_To_Key(bone_lower.Str())] = info;
+            map[g_theNameKeyGenerator->Hashed_Name_To_Key(bone_lower.Str(), bone_hash)] = info;
             sub_obj_found = true;
         }
 
@@ -237,7 +244,7 @@ bool Do_Single_Bone_Name(RenderObjClass *robj, Utf8String const &bone, std::map<
                 break;
             }
 
-            map[g_theNameKeyGenerator->Name_To_Key(bone_id.Str())] = info;
+            map[Numbered_Bone_Key(bone_id.Str(), bone_lower.Get_Length(), bone_hash)] = info;
             sub_obj_found = true;
         }
     }
@@ -359,6 +366,10 @@ void ModelConditionInfo::Validate_Weapon_Barrel_Info() const
             if (weaponfirefxbonename.Is_Not_Empty() || weaponrecoilbonename.Is_Not_Empty()
                 || weaponmuzzleflashbonename.Is_Not_Empty() || weaponlaunchbonename.Is_Not_Empty()) {
                 int weaponfirefxbone = 0;
+                unsigned int firefxhash = Name_Key_Hash(weaponfirefxbonename.Str());
+                unsigned int recoilhash = Name_Key_Hash(weaponrecoilbonename.Str());
+                unsigned int muzzleflashhash = Name_Key_Hash(weaponmuzzleflashbonename.Str());
+                unsigned int launchhash = Name_Key_Hash(weaponlaunchbonename.Str());
 
                 for (int j = 1; j <= 99; j++) {
                     ModelConditionInfo::WeaponBarrelInfo info;
@@ -367,13 +378,17 @@ void ModelConditionInfo::Validate_Weapon_Barrel_Info() const
                     if (!weaponrecoilbonename.Is_Empty()) {
                         char bone_id[256];
                         sprintf(bone_id, "%s%02d", weaponrecoilbonename.Str(), j);
-                        Find_Pristine_Bone(g_theNameKeyGenerator->Name_To_Key(bone_id), &info.m_weaponRecoilBone);
+                        Find_Pristine_Bone(
+                            Numbered_Bone_Key(bone_id, weaponrecoilbonename.Get_Length(), recoilhash),
+                            &info.m_weaponRecoilBone);
                     }
 
                     if (!weaponmuzzleflashbonename.Is_Empty()) {
                         char bone_id[256];
                         sprintf(bone_id, "%s%02d", weaponmuzzleflashbonename.Str(), j);
-                        Find_Pristine_Bone(g_theNameKeyGenerator->Name_To_Key(bone_id), &info.m_weaponMuzzleFlashBone);
+                        Find_Pristine_Bone(
+                            Numbered_Bone_Key(bone_id, weaponmuzzleflashbonename.Get_Length(), muzzleflashhash),
+                            &info.m_weaponMuzzleFlashBone);
 
 #ifdef GAME_DEBUG_STRUCTS
                         if (info.m_weaponMuzzleFlashBone) {
@@ -385,7 +400,9 @@ void ModelConditionInfo::Validate_Weapon_Barrel_Info() const
                     if (!weaponfirefxbonename.Is_Empty()) {
                         char bone_id[256];
                         sprintf(bone_id, "%s%02d", weaponfirefxbonename.Str(), j);
-                        Find_Pristine_Bone(g_theNameKeyGenerator->Name_To_Key(bone_id), &info.m_weaponFireFXBone);
+                        Find_Pristine_Bone(
+                            Numbered_Bone_Key(bone_id, weaponfirefxbonename.Get_Length(), firefxhash),
+                            &info.m_weaponFireFXBone);
 
                         if (!info.m_weaponFireFXBone) {
                             if (info.m_weaponMuzzleFlashBone) {
@@ -399,8 +416,9 @@ void ModelConditionInfo::Validate_Weapon_Barrel_Info() const
                     if (!weaponlaunchbonename.Is_Empty()) {
                         char bone_id[256];
                         sprintf(bone_id, "%s%02d", weaponlaunchbonename.Str(), j);
-                        const Matrix3D *m =
-                            Find_Pristine_Bone(g_theNameKeyGenerator->Name_To_Key(bone_id), &weaponlaunchbone);
+                        const Matrix3D *m = Find_Pristine_Bone(
+                            Numbered_Bone_Key(bone_id, weaponlaunchbonename.Get_Length(), launchhash),
+                            &weaponlaunchbone);
 
                         if (m != nullptr) {
                             info.m_weaponLaunchBoneTransform = *m;
@@ -426,11 +444,13 @@ void ModelConditionInfo::Validate_Weapon_Barrel_Info() const
 
                     if (!weaponrecoilbonename.Is_Empty()) {
                         Find_Pristine_Bone(
-                            g_theNameKeyGenerator->Name_To_Key(weaponrecoilbonename.Str()), &info.m_weaponRecoilBone);
+                            g_theNameKeyGenerator->Hashed_Name_To_Key(weaponrecoilbonename.Str(), recoilhash),
+                            &info.m_weaponRecoilBone);
                     }
 
                     if (!weaponmuzzleflashbonename.Is_Empty()) {
-                        Find_Pristine_Bone(g_theNameKeyGenerator->Name_To_Key(weaponmuzzleflashbonename.Str()),
+                        Find_Pristine_Bone(
+                            g_theNameKeyGenerator->Hashed_Name_To_Key(weaponmuzzleflashbonename.Str(), muzzleflashhash),
                             &info.m_weaponMuzzleFlashBone);
                     }
 
@@ -445,7 +465,9 @@ void ModelConditionInfo::Validate_Weapon_Barrel_Info() const
                     if (weaponlaunchbonename.Is_Empty()) {
                         m = nullptr;
                     } else {
-                        m = Find_Pristine_Bone(g_theNameKeyGenerator->Name_To_Key(weaponlaunchbonename.Str()), nullptr);
+                        m = Find_Pristine_Bone(
+                            g_theNameKeyGenerator->Hashed_Name_To_Key(weaponlaunchbonename.Str(), launchhash),
+                            nullptr);
                     }
 
                     if (m != nullptr) {
@@ -456,7 +478,8 @@ void ModelConditionInfo::Validate_Weapon_Barrel_Info() const
 
                     if (!weaponfirefxbonename.Is_Empty()) {
                         Find_Pristine_Bone(
-                            g_theNameKeyGenerator->Name_To_Key(weaponfirefxbonename.Str()), &info.m_weaponFireFXBone);
+                            g_theNameKeyGenerator->Hashed_Name_To_Key(weaponfirefxbonename.Str(), firefxhash),
+                            &info.m_weaponFireFXBone);
                     }
 
                     if (info.m_weaponFireFXBone || info.m_weaponRecoilBone || info.m_weaponMuzzleFlashBone || m != nullptr) {
@@ -2445,6 +2468,9 @@ int W3DModelDraw::Get_Pristine_Bone_Positions_For_Condition_State(BitFlags<MODEL
 
     int current = 0;
     int count = start_index != 0 ? 99 : 0;
+    // The numbers on the end aren't changed by lower casing, only the name needs hashing.
+    unsigned int bone_hash = Lower_Case_Name_Key_Hash(bone_name);
+    int name_length = int(strlen(bone_name));
 
     for (int i = start_index; i <= count; i++) {
         char bone_id[256];
@@ -2459,7 +2485,7 @@ int W3DModelDraw::Get_Pristine_Bone_Positions_For_Condition_State(BitFlags<MODEL
             *j = tolower(*j);
         }
 
-        const Matrix3D *bone = info->Find_Pristine_Bone(g_theNameKeyGenerator->Name_To_Key(bone_id), nullptr);
+        const Matrix3D *bone = info->Find_Pristine_Bone(Numbered_Bone_Key(bone_id, name_length, bone_hash), nullptr);
 
         if (bone == nullptr) {
             const Object *object = Get_Drawable()->Get_Object();
@@ -14,8 +14,12 @@
  */
 #include "commandline.h"
 #include "archivefilesystem.h"
+#include "filesystem.h"
 #include "globaldata.h"
+#include "iniprofiler.h"
 #include "localfilesystem.h"
+#include "memdynalloc.h"
+#include "mempooltelemetry.h"
 #include "version.h"
 #include <captainslog.h>
 #include <cstdio>
@@ -933,6 +937,58 @@ int Parse_Dump_Asset_Usage(char **argv, int argc)
     return 1;
 }
 
+// Thyme specific, files in first open order with open timings, see bigpack for laying archives out from the trace.
+int Parse_Trace_File_Access(char **argv, int argc)
+{
+    if (argc > 1) {
+        FileSystem::Begin_Access_Trace(argv[1]);
+    }
+
+    return 2;
+}
+
+// Thyme specific, memory pool usage on the debug display and written to MemoryPoolStats.csv at exit.
+int Parse_Memory_Pool_Stats(char **argv, int argc)
+{
+    Thyme::MemoryPoolTelemetry::Enable();
+
+    return 1;
+}
+
+// Thyme specific, as -memoryPoolStats but also writes pool sizes that would have covered the session at exit.
+int Parse_Record_Memory_Pools(char **argv, int argc)
+{
+    Thyme::MemoryPoolTelemetry::Enable(true);
+
+    return 1;
+}
+
+// Thyme specific, allocations too big for the memory pools come from a huge page backed arena.
+int Parse_Huge_Page_Arena(char **argv, int argc)
+{
+#ifndef GAME_DLL
+    DynamicMemoryAllocator::Set_Huge_Page_Arena(true);
+#endif
+
+    return 1;
+}
+
+// Thyme specific, times INI loading by file and block type and writes INIProfile.txt once the engine is initialised.
+int Parse_Profile_INI(char **argv, int argc)
+{
+    INIProfiler::Enable();
+
+    return 1;
+}
+
+// Thyme specific, RefPack compressed archive entries are decoded as they are opened and kept in the archive blob cache.
+int Parse_Decompress_Archives(char **argv, int argc)
+{
+    ArchiveFileSystem::Set_Decompress_Entries(true);
+
+    return 1;
+}
+
 int Parse_Jump_To_Frame(char **argv, int argc)
 {
     if (g_theWriteableGlobalData != nullptr) {
@@ -957,6 +1013,40 @@ int Parse_Update_Images(char **argv, int argc)
     return 1;
 }
 
+// Compares the arguments against the list of argument handlers and calls the handler for any that match.
+void Parse_Arguments(CmdParseStruct const *params, int param_count, int argc, char *argv[])
+{
+    // Starting with argument 1 (0 being the name of the binary in most cases)
+    // compare the argument against the list of argument handlers and call
+    // it if a match is found.
+    int arg = 1;
+
+    while (arg < argc) {
+        bool parsed = false;
+
+        for (int i = 0; i < param_count; ++i) {
+            if (strlen(params[i].argument) == strlen(argv[arg])
+                && strncasecmp(argv[arg], params[i].argument, strlen(params[i].argument)) == 0) {
+                arg += params[i].handler(&argv[arg], argc - arg);
+                parsed = true;
+                break;
+            }
+        }
+
+        if (!parsed) {
+            ++arg;
+        }
+    }
+}
+
+// Thyme specific, parses the arguments that have to take effect before the file systems are created.
+void Parse_Startup_Command_Line(int argc, char *argv[])
+{
+    CmdParseStruct _params[] = { { "-decompressArchives", &Parse_Decompress_Archives } };
+
+    Parse_Arguments(_params, ARRAY_SIZE(_params), argc, argv);
+}
+
 // Parses the command line passed to the executable via argc and argv.
 void Parse_Command_Line(int argc, char *argv[])
 {
@@ -1006,6 +1096,11 @@ void Parse_Command_Line(int argc, char *argv[])
         { "-noFPSLimit", &Parse_No_FPS_Limit },
         { "-fps", &Parse_FPS },
         { "-dumpAssetUsage", &Parse_Dump_Asset_Usage },
+        { "-traceFileAccess", &Parse_Trace_File_Access },
+        { "-memoryPoolStats", &Parse_Memory_Pool_Stats },
+        { "-recordMemoryPools", &Parse_Record_Memory_Pools },
+        { "-hugePageArena", &Parse_Huge_Page_Arena },
+        { "-profileINI", &Parse_Profile_INI },
         { "-jumpToFrame", &Parse_Jump_To_Frame },
         { "-updateImages", &Parse_Update_Images },
         { "-noDraw", &Parse_No_Draw },
@@ -1052,27 +1147,7 @@ void Parse_Command_Line(int argc, char *argv[])
         { "-showTeamDot", &Parse_Do_Team_Dot },
         { "-extraLogging", &Parse_Extra_Logging } };
 
-    // Starting with argument 1 (0 being the name of the binary in most cases)
-    // compare the argument against the list of argument handlers and call
-    // it if a match is found.
-    int arg = 1;
-
-    while (arg < argc) {
-        bool parsed = false;
-
-        for (unsigned int i = 0; i < ARRAY_SIZE(_params); ++i) {
-            if (strlen(_params[i].argument) == strlen(argv[arg])
-                && strncasecmp(argv[arg], _params[i].argument, strlen(_params[i].argument)) == 0) {
-                arg += _params[i].handler(&argv[arg], argc - arg);
-                parsed = true;
-                break;
-            }
-        }
-
-        if (!parsed) {
-            ++arg;
-        }
-    }
+    Parse_Arguments(_params, ARRAY_SIZE(_params), argc, argv);
 
     // Loads any mod big files that were specified on the command line.
     g_theArchiveFileSystem->Load_Mods();
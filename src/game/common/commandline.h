@@ -16,4 +16,5 @@
 
 #include "always.h"
 
+void Parse_Startup_Command_Line(int argc, char *argv[]);
 void Parse_Command_Line(int argc, char *argv[]);
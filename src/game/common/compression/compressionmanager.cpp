@@ -14,11 +14,13 @@
  */
 #include "compressionmanager.h"
 #include "endiantype.h"
+#include "lz4block.h"
 #include "refpack.h"
 #include <captainslog.h>
 #include <cstring>
 
 using std::memcmp;
+using std::memcpy;
 
 const char *CompressionManager::s_compressionNames[COMPRESSION_COUNT] = { "No compression",
     "RefPack",
@@ -33,7 +35,21 @@ const char *CompressionManager::s_compressionNames[COMPRESSION_COUNT] = { "No co
     "zlib compress",
     "zlib compress",
     "B-Tree compression",
-    "Huffman Tree compression" };
+    "Huffman Tree compression",
+    "LZ4 block" };
+
+namespace
+{
+// Every format shares an 8 byte header, a 4 byte tag followed by the little endian uncompressed size.
+const int COMPRESSION_HEADER_SIZE = 8;
+
+void Write_Header(void *dst, const char *tag, int uncompressed_size)
+{
+    int32_t size = htole32(uncompressed_size);
+    memcpy(dst, tag, 4);
+    memcpy(static_cast<char *>(dst) + 4, &size, sizeof(size));
+}
+} // namespace
 
 /**
  * @brief Detect if the data is compressed.
@@ -106,6 +122,10 @@ CompressionType CompressionManager::Get_Compression_Type(const void *data, int s
         type = COMPRESSION_EAR;
     }
 
+    if (!memcmp(data, "LZ4", 4)) {
+        type = COMPRESSION_LZ4;
+    }
+
     return type;
 }
 
@@ -128,7 +148,7 @@ int CompressionManager::Get_Uncompressed_Size(const void *data, int size)
 }
 
 /**
- * @brief Decompress possibly compressed data. Only handles RefPack compression.
+ * @brief Decompress possibly compressed data. Only handles RefPack and LZ4 compression.
  */
 int CompressionManager::Decompress_Data(void *src, int src_size, void *dst, int dst_size)
 {
@@ -141,6 +161,17 @@ int CompressionManager::Decompress_Data(void *src, int src_size, void *dst, int
             src_size -= 8;
             return RefPack_Uncompress(dst, static_cast<const uint8_t *>(src) + 8, &src_size);
 
+        case COMPRESSION_LZ4: {
+            int size = LZ4_Block_Uncompress(dst, static_cast<const uint8_t *>(src) + 8, src_size - 8, dst_size);
+
+            if (size < 0) {
+                captainslog_error("LZ4 compressed data is corrupt or larger than the destination buffer.\n");
+                return 0;
+            }
+
+            return size;
+        }
+
         // Original game handles all these formats, ZH only appears to use RefPack however.
         case COMPRESSION_NONE:
         case COMPRESSION_NOX:
@@ -163,3 +194,55 @@ int CompressionManager::Decompress_Data(void *src, int src_size, void *dst, int
 
     return 0;
 }
+
+/**
+ * @brief Get the buffer size Compress_Data needs to be sure the compressed data fits, header included. Thyme specific.
+ */
+int CompressionManager::Get_Max_Compressed_Size(int uncompressed_size, CompressionType type)
+{
+    switch (type) {
+        case COMPRESSION_EAR:
+            return RefPack_Compress_Bound(uncompressed_size) + COMPRESSION_HEADER_SIZE;
+        case COMPRESSION_LZ4:
+            return LZ4_Block_Compress_Bound(uncompressed_size) + COMPRESSION_HEADER_SIZE;
+        case COMPRESSION_NONE:
+            return uncompressed_size;
+        default:
+            return 0;
+    }
+}
+
+/**
+ * @brief Compress data with the chosen format, returns the size written including the header or 0 on failure. Only
+ * handles RefPack and LZ4 compression. Thyme specific.
+ */
+int CompressionManager::Compress_Data(CompressionType type, const void *src, int src_size, void *dst, int dst_size)
+{
+    if (src_size < 0 || dst_size < Get_Max_Compressed_Size(src_size, type)) {
+        return 0;
+    }
+
+    uint8_t *data = static_cast<uint8_t *>(dst) + COMPRESSION_HEADER_SIZE;
+
+    switch (type) {
+        case COMPRESSION_NONE:
+            memcpy(dst, src, src_size);
+            return src_size;
+
+        case COMPRESSION_EAR:
+            Write_Header(dst, "EAR", src_size);
+            return RefPack_Compress_Level(data, src, src_size, 0) + COMPRESSION_HEADER_SIZE;
+
+        case COMPRESSION_LZ4: {
+            Write_Header(dst, "LZ4", src_size);
+            int size = LZ4_Block_Compress(data, src, src_size, dst_size - COMPRESSION_HEADER_SIZE);
+            return size > 0 ? size + COMPRESSION_HEADER_SIZE : 0;
+        }
+
+        default:
+            captainslog_error("Compression format '%s' unhandled, file a bug report.\n", Get_Compression_Name(type));
+            break;
+    }
+
+    return 0;
+}
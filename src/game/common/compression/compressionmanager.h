@@ -32,6 +32,7 @@ enum CompressionType : int32_t
     COMPRESSION_ZL9,
     COMPRESSION_EAB, // BTree
     COMPRESSION_EAH, // Huffman
+    COMPRESSION_LZ4, // LZ4 block, Thyme specific
     COMPRESSION_COUNT,
 };
 
@@ -42,6 +43,8 @@ public:
     static CompressionType Get_Compression_Type(const void *data, int size);
     static int Get_Uncompressed_Size(const void *data, int size);
     static int Decompress_Data(void *src, int src_size, void *dst, int dst_size);
+    static int Get_Max_Compressed_Size(int uncompressed_size, CompressionType type);
+    static int Compress_Data(CompressionType type, const void *src, int src_size, void *dst, int dst_size);
     static const char *Get_Compression_Name(CompressionType type) { return s_compressionNames[type]; }
 
 private:
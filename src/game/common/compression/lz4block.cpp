@@ -0,0 +1,457 @@
+/**
+ * @file
+ *
+ * @author OmniBlade
+ *
+ * @brief LZ4 block format encoder and decoder. (Thyme Feature)
+ *
+ * @copyright Thyme is free software: you can redistribute it and/or
+ *            modify it under the terms of the GNU General Public License
+ *            as published by the Free Software Foundation, either version
+ *            2 of the License, or (at your option) any later version.
+ *            A full copy of the GNU General Public License can be found in
+ *            LICENSE
+ */
+#include "lz4block.h"
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+
+using std::free;
+using std::malloc;
+using std::max;
+using std::memcpy;
+using std::memset;
+using std::min;
+
+namespace
+{
+enum
+{
+    // Limits set by the block format, the last five bytes are always literals and no match starts in the last twelve.
+    LZ4_MIN_MATCH = 4,
+    LZ4_LAST_LITERALS = 5,
+    LZ4_MF_LIMIT = 12,
+    LZ4_MAX_DISTANCE = 65535,
+    LZ4_RUN_MASK = 15,
+
+    LZ4_HASH_LOG = 16,
+    LZ4_HASH_SIZE = 1 << LZ4_HASH_LOG,
+    LZ4_CHAIN_SIZE = 65536,
+    LZ4_CHAIN_MASK = LZ4_CHAIN_SIZE - 1,
+
+    // Matches at least this long end the search early, long repeats would otherwise walk the whole chain every byte.
+    LZ4_GOOD_LENGTH = 256,
+
+    // Misses before the fast level starts skipping ahead through incompressible data.
+    LZ4_SKIP_TRIGGER = 6,
+};
+
+struct LZ4SearchState
+{
+    const uint8_t *base;
+    int32_t *head;
+    uint16_t *chain; // Distance back to the previous position with the same hash, only used above the fast level.
+    int next_insert;
+    int match_limit;
+    int depth;
+};
+
+uint32_t Read32(const uint8_t *p)
+{
+    uint32_t value;
+    memcpy(&value, p, sizeof(value));
+
+    return value;
+}
+
+uint32_t Hash32(uint32_t value)
+{
+    return (value * 2654435761u) >> (32 - LZ4_HASH_LOG);
+}
+
+int Count_Match(const uint8_t *p, const uint8_t *match, const uint8_t *limit)
+{
+    const uint8_t *start = p;
+
+    while (p + 8 <= limit) {
+        uint64_t a;
+        uint64_t b;
+        memcpy(&a, p, sizeof(a));
+        memcpy(&b, match, sizeof(b));
+
+        if (a != b) {
+            break;
+        }
+
+        p += 8;
+        match += 8;
+    }
+
+    while (p < limit && *p == *match) {
+        ++p;
+        ++match;
+    }
+
+    return int(p - start);
+}
+
+void Insert_Position(LZ4SearchState &state, int pos)
+{
+    uint32_t hash = Hash32(Read32(state.base + pos));
+    int32_t prev = state.head[hash];
+
+    if (state.chain != nullptr) {
+        int delta = pos - prev;
+        state.chain[pos & LZ4_CHAIN_MASK] = uint16_t(prev >= 0 && delta <= LZ4_MAX_DISTANCE ? delta : 0);
+    }
+
+    state.head[hash] = pos;
+}
+
+// Finds the longest match for pos among earlier positions, pos and everything before it is in the tables afterwards.
+int Find_Match(LZ4SearchState &state, int pos, int &match_pos)
+{
+    const uint8_t *base = state.base;
+    uint32_t sequence = Read32(base + pos);
+    int best_length = 0;
+    int tries = state.depth;
+
+    // Deeper levels chain every position, including the ones covered by earlier matches.
+    while (state.chain != nullptr && state.next_insert < pos) {
+        Insert_Position(state, state.next_insert++);
+    }
+
+    int32_t candidate = state.head[Hash32(sequence)];
+    Insert_Position(state, pos);
+    state.next_insert = pos + 1;
+
+    while (candidate >= 0 && pos - candidate <= LZ4_MAX_DISTANCE && tries-- > 0) {
+        if (Read32(base + candidate) == sequence) {
+            int length = LZ4_MIN_MATCH
+                + Count_Match(base + pos + LZ4_MIN_MATCH, base + candidate + LZ4_MIN_MATCH, base + state.match_limit);
+
+            if (length > best_length) {
+                best_length = length;
+                match_pos = candidate;
+
+                if (length >= LZ4_GOOD_LENGTH || pos + length >= state.match_limit) {
+                    break;
+                }
+            }
+        }
+
+        if (state.chain == nullptr || state.chain[candidate & LZ4_CHAIN_MASK] == 0) {
+            break;
+        }
+
+        candidate -= state.chain[candidate & LZ4_CHAIN_MASK];
+    }
+
+    return best_length;
+}
+
+// Lengths that don't fit in their token nibble continue as a run of 255 bytes and a remainder.
+uint8_t *Write_Length(uint8_t *op, size_t length)
+{
+    while (length >= 255) {
+        *op++ = 255;
+        length -= 255;
+    }
+
+    *op++ = uint8_t(length);
+
+    return op;
+}
+
+uint8_t *Write_Literals(uint8_t *op, const uint8_t *oend, const uint8_t *literals, size_t count, uint8_t *&token)
+{
+    if (size_t(oend - op) < 2 + count / 255 + count) {
+        return nullptr;
+    }
+
+    token = op++;
+
+    if (count >= LZ4_RUN_MASK) {
+        *token = LZ4_RUN_MASK << 4;
+        op = Write_Length(op, count - LZ4_RUN_MASK);
+    } else {
+        *token = uint8_t(count << 4);
+    }
+
+    memcpy(op, literals, count);
+
+    return op + count;
+}
+
+uint8_t *Write_Sequence(
+    uint8_t *op, const uint8_t *oend, const uint8_t *literals, size_t count, int offset, size_t length)
+{
+    uint8_t *token;
+    op = Write_Literals(op, oend, literals, count, token);
+
+    if (op == nullptr || size_t(oend - op) < 3 + (length - LZ4_MIN_MATCH) / 255) {
+        return nullptr;
+    }
+
+    *op++ = uint8_t(offset & 0xFF);
+    *op++ = uint8_t(offset >> 8);
+    length -= LZ4_MIN_MATCH;
+
+    if (length >= LZ4_RUN_MASK) {
+        *token |= LZ4_RUN_MASK;
+        op = Write_Length(op, length - LZ4_RUN_MASK);
+    } else {
+        *token |= uint8_t(length);
+    }
+
+    return op;
+}
+
+bool Read_Length(const uint8_t *&ip, const uint8_t *iend, size_t &length)
+{
+    unsigned value;
+
+    do {
+        if (ip >= iend || length > LZ4_BLOCK_MAX_INPUT_SIZE) {
+            return false;
+        }
+
+        value = *ip++;
+        length += value;
+    } while (value == 255);
+
+    return true;
+}
+
+uint8_t *Copy_Match(uint8_t *op, const uint8_t *oend, size_t offset, size_t length)
+{
+    uint8_t *end = op + length;
+    const uint8_t *match = op - offset;
+
+    // Chunks can overshoot by up to seven bytes which the following sequences overwrite again.
+    if (size_t(oend - end) >= 8) {
+        if (offset < 8) {
+            // Short repeating patterns are written out once, then copied from a whole number of periods back.
+            for (int i = 0; i < 8; ++i) {
+                op[i] = match[i];
+            }
+
+            op += 8;
+            match = op - offset * ((8 + offset - 1) / offset);
+        }
+
+        if (op - match >= 8) {
+            while (op < end) {
+                memcpy(op, match, 8);
+                op += 8;
+                match += 8;
+            }
+
+            return end;
+        }
+    }
+
+    while (op < end) {
+        *op++ = *match++;
+    }
+
+    return end;
+}
+} // namespace
+
+int LZ4_Block_Compress_Bound(int size)
+{
+    if (size < 0 || size > LZ4_BLOCK_MAX_INPUT_SIZE) {
+        return 0;
+    }
+
+    return size + size / 255 + 16;
+}
+
+/**
+ * Compresses size bytes from src into a raw LZ4 block. Higher levels search more earlier positions for each match,
+ * giving smaller output for slower compression, decompression speed is the same for every level.
+ */
+int LZ4_Block_Compress(void *dst, const void *src, int size, int capacity, int level)
+{
+    uint8_t *op = static_cast<uint8_t *>(dst);
+    const uint8_t *oend = op + capacity;
+    const uint8_t *base = static_cast<const uint8_t *>(src);
+    uint8_t *token;
+    int anchor = 0;
+
+    if (size < 0 || size > LZ4_BLOCK_MAX_INPUT_SIZE || capacity <= 0) {
+        return 0;
+    }
+
+    if (size > LZ4_MF_LIMIT) {
+        LZ4SearchState state;
+        int start_limit = size - LZ4_MF_LIMIT;
+        int pos = 0;
+        int misses = 0;
+
+        level = min(max(level, int(LZ4_BLOCK_LEVEL_FAST)), int(LZ4_BLOCK_LEVEL_MAX));
+        state.base = base;
+        state.head = static_cast<int32_t *>(malloc(LZ4_HASH_SIZE * sizeof(int32_t)));
+        state.chain = nullptr;
+        state.next_insert = 0;
+        state.match_limit = size - LZ4_LAST_LITERALS;
+        state.depth = 1 << (level - 1);
+
+        if (state.head == nullptr) {
+            return 0;
+        }
+
+        if (state.depth > 1) {
+            state.chain = static_cast<uint16_t *>(malloc(LZ4_CHAIN_SIZE * sizeof(uint16_t)));
+
+            if (state.chain == nullptr) {
+                free(state.head);
+
+                return 0;
+            }
+        }
+
+        memset(state.head, 0xFF, LZ4_HASH_SIZE * sizeof(int32_t));
+
+        while (pos <= start_limit) {
+            int match_pos = 0;
+            int length = Find_Match(state, pos, match_pos);
+
+            if (length == 0) {
+                // The fast level steps further the longer it goes without a match.
+                pos += state.chain == nullptr ? 1 + (misses++ >> LZ4_SKIP_TRIGGER) : 1;
+                continue;
+            }
+
+            // Deeper levels take the next position's match instead if it is longer.
+            while (state.chain != nullptr && length < LZ4_GOOD_LENGTH && pos < start_limit
+                && pos + length < state.match_limit) {
+                int next_pos = 0;
+                int next_length = Find_Match(state, pos + 1, next_pos);
+
+                if (next_length <= length) {
+                    break;
+                }
+
+                ++pos;
+                length = next_length;
+                match_pos = next_pos;
+            }
+
+            while (pos > anchor && match_pos > 0 && base[pos - 1] == base[match_pos - 1]) {
+                --pos;
+                --match_pos;
+                ++length;
+            }
+
+            op = Write_Sequence(op, oend, base + anchor, pos - anchor, pos - match_pos, length);
+
+            if (op == nullptr) {
+                break;
+            }
+
+            pos += length;
+            anchor = pos;
+            misses = 0;
+
+            if (state.chain == nullptr && pos - 2 <= start_limit) {
+                Insert_Position(state, pos - 2);
+            }
+        }
+
+        free(state.chain);
+        free(state.head);
+
+        if (op == nullptr) {
+            return 0;
+        }
+    }
+
+    op = Write_Literals(op, oend, base + anchor, size - anchor, token);
+
+    return op != nullptr ? int(op - static_cast<uint8_t *>(dst)) : 0;
+}
+
+int LZ4_Block_Uncompress(void *dst, const void *src, int size, int capacity)
+{
+    const uint8_t *ip = static_cast<const uint8_t *>(src);
+    const uint8_t *iend = ip + size;
+    uint8_t *op = static_cast<uint8_t *>(dst);
+    const uint8_t *oend = op + capacity;
+
+    if (size <= 0 || capacity < 0) {
+        return -1;
+    }
+
+    for (;;) {
+        if (ip >= iend) {
+            return -1;
+        }
+
+        unsigned token = *ip++;
+        size_t length = token >> 4;
+
+        // Most sequences are short, with room in both buffers they are copied in fixed sized chunks that may overshoot
+        // into space the following sequences overwrite again.
+        if (length != LZ4_RUN_MASK && iend - ip >= 32 && oend - op >= 32) {
+            memcpy(op, ip, 16);
+        } else {
+            if (length == LZ4_RUN_MASK && !Read_Length(ip, iend, length)) {
+                return -1;
+            }
+
+            if (length > size_t(iend - ip) || length > size_t(oend - op)) {
+                return -1;
+            }
+
+            memcpy(op, ip, length);
+
+            // The last sequence is literals only.
+            if (ip + length == iend) {
+                op += length;
+                break;
+            }
+        }
+
+        op += length;
+        ip += length;
+
+        if (iend - ip < 2) {
+            return -1;
+        }
+
+        size_t offset = ip[0] | (ip[1] << 8);
+        ip += 2;
+        const uint8_t *match = op - offset;
+
+        if (offset == 0 || offset > size_t(op - static_cast<uint8_t *>(dst))) {
+            return -1;
+        }
+
+        length = token & LZ4_RUN_MASK;
+
+        if (length != LZ4_RUN_MASK && offset >= 8 && oend - op >= 32) {
+            memcpy(op, match, 8);
+            memcpy(op + 8, match + 8, 8);
+            memcpy(op + 16, match + 16, 2);
+            op += length + LZ4_MIN_MATCH;
+            continue;
+        }
+
+        if (length == LZ4_RUN_MASK && !Read_Length(ip, iend, length)) {
+            return -1;
+        }
+
+        length += LZ4_MIN_MATCH;
+
+        if (length > size_t(oend - op)) {
+            return -1;
+        }
+
+        op = Copy_Match(op, oend, offset, length);
+    }
+
+    return int(op - static_cast<uint8_t *>(dst));
+}
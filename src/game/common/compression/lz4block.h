@@ -0,0 +1,39 @@
+/**
+ * @file
+ *
+ * @author OmniBlade
+ *
+ * @brief LZ4 block format encoder and decoder. (Thyme Feature)
+ *
+ * @copyright Thyme is free software: you can redistribute it and/or
+ *            modify it under the terms of the GNU General Public License
+ *            as published by the Free Software Foundation, either version
+ *            2 of the License, or (at your option) any later version.
+ *            A full copy of the GNU General Public License can be found in
+ *            LICENSE
+ */
+#pragma once
+
+#include "always.h"
+
+// Thyme's own implementation of the raw LZ4 block format, written from the format description rather than taken from
+// the reference library. Blocks are interchangeable with the reference LZ4_compress_default and LZ4_decompress_safe but
+// there is no LZ4 frame format, so it can't read or write .lz4 files. There are no dictionaries or streaming either.
+enum
+{
+    LZ4_BLOCK_MAX_INPUT_SIZE = 0x7E000000,
+    // Level 1 is a greedy single probe search, each level above doubles the number of earlier positions tried.
+    LZ4_BLOCK_LEVEL_FAST = 1,
+    LZ4_BLOCK_LEVEL_DEFAULT = 8,
+    LZ4_BLOCK_LEVEL_MAX = 12,
+};
+
+// Worst case compressed size for an input of size bytes, 0 if the input is too large.
+int LZ4_Block_Compress_Bound(int size);
+
+// Returns the block size or 0 if it didn't fit in capacity.
+int LZ4_Block_Compress(void *dst, const void *src, int size, int capacity, int level = LZ4_BLOCK_LEVEL_DEFAULT);
+
+// Returns the decompressed size or a negative value if the block is malformed or doesn't fit in capacity. Every read and
+// write is checked so it is safe on untrusted data.
+int LZ4_Block_Uncompress(void *dst, const void *src, int size, int capacity);
@@ -13,15 +13,65 @@
  *            LICENSE
  */
 #include "refpack.h"
+#include "workerpool.h"
 #include <algorithm>
 #include <cstdlib>
 #include <cstring>
 
+using std::free;
 using std::malloc;
 using std::max;
 using std::memcpy;
 using std::memset;
 using std::min;
+using std::realloc;
+
+namespace
+{
+enum
+{
+    REFPACK_HASH_SIZE = 65536,
+    REFPACK_WINDOW_SIZE = 131072,
+    REFPACK_MAX_MATCH = 1028,
+    REFPACK_BLOCK_SIZE = 1024 * 1024,
+};
+
+// A match along with the literals that come before it, a zero length marks literals left at the end of the input.
+struct RefPackToken
+{
+    uint32_t literals;
+    uint32_t length;
+    uint32_t offset;
+};
+
+// Writes tokens out as RefPack commands. Literals not yet written are carried from one token to the next which lets
+// the tokens from several blocks be written as one stream.
+struct RefPackEmitter
+{
+    uint8_t *putp;
+    const uint8_t *runp;
+    uint32_t run;
+};
+
+// Matches found for one block, written straight to an emitter if there is one, otherwise stored to be written later.
+struct RefPackTokenList
+{
+    RefPackToken *tokens;
+    int count;
+    int capacity;
+    RefPackEmitter *emitter;
+};
+
+struct RefPackSearch
+{
+    const uint8_t *src;
+    int size;
+    int start;
+    int end;
+    int search_depth;
+    bool quick;
+};
+} // namespace
 
 /**
  * Utility function for compression for checking length of matching data.
@@ -36,12 +86,100 @@ static uint32_t RefPack_Matchlen(const uint8_t *s, const uint8_t *d, uint32_t ma
     return current;
 }
 
+static void RefPack_Emit_Literals(RefPackEmitter &emitter)
+{
+    while (emitter.run > 3) { // literal block of data
+        uint32_t tlen = min((uint32_t)112, emitter.run & ~3);
+        emitter.run -= tlen;
+        *emitter.putp++ = (unsigned char)(0xe0 + (tlen >> 2) - 1);
+        memcpy(emitter.putp, emitter.runp, tlen);
+        emitter.runp += tlen;
+        emitter.putp += tlen;
+    }
+}
+
+static void RefPack_Emit_Token(RefPackEmitter &emitter, RefPackToken const &token)
+{
+    uint8_t *&putp = emitter.putp;
+    uint32_t &run = emitter.run;
+    uint32_t blen = token.length;
+    uint32_t boffset = token.offset;
+
+    run += token.literals;
+
+    if (blen == 0) {
+        return;
+    }
+
+    RefPack_Emit_Literals(emitter);
+
+    if (boffset < 1024 && blen <= 10) { // two byte long form
+        *putp++ = (unsigned char)(((boffset >> 8) << 5) + ((blen - 3) << 2) + run);
+        *putp++ = (unsigned char)boffset;
+    } else if (boffset < 16384 && blen <= 67) { // three byte long form
+        *putp++ = (unsigned char)(0x80 + (blen - 4));
+        *putp++ = (unsigned char)((run << 6) + (boffset >> 8));
+        *putp++ = (unsigned char)boffset;
+    } else { // four byte very long form
+        *putp++ = (unsigned char)(0xc0 + ((boffset >> 16) << 4) + (((blen - 5) >> 8) << 2) + run);
+        *putp++ = (unsigned char)(boffset >> 8);
+        *putp++ = (unsigned char)(boffset);
+        *putp++ = (unsigned char)(blen - 5);
+    }
+
+    if (run) {
+        memcpy(putp, emitter.runp, run);
+        putp += run;
+        emitter.runp += run;
+        run = 0;
+    }
+
+    emitter.runp += blen;
+}
+
+static void RefPack_Emit_End(RefPackEmitter &emitter)
+{
+    RefPack_Emit_Literals(emitter); // no match at end, use literal
+
+    *emitter.putp++ = (unsigned char)(0xFC + emitter.run); // end of stream command + 0..3 literal
+
+    if (emitter.run) {
+        memcpy(emitter.putp, emitter.runp, emitter.run);
+        emitter.putp += emitter.run;
+    }
+}
+
+static void RefPack_Add_Token(RefPackTokenList &list, uint32_t literals, uint32_t length, uint32_t offset)
+{
+    RefPackToken token = { literals, length, offset };
+
+    if (list.emitter != nullptr) {
+        RefPack_Emit_Token(*list.emitter, token);
+        return;
+    }
+
+    if (list.count == list.capacity) {
+        list.capacity = max(list.capacity * 2, 4096);
+        list.tokens = static_cast<RefPackToken *>(realloc(list.tokens, sizeof(RefPackToken) * list.capacity));
+    }
+
+    list.tokens[list.count++] = token;
+}
+
+static inline int32_t RefPack_Hash(const uint8_t *getp)
+{
+    return 0x10 * getp[1] ^ (uint16_t)(getp[2] | ((uint16_t)getp[0] << 8));
+}
+
 /**
- * Compresses data using refpack LZ method
+ * Finds matches for part of the input with hash chains. Positions in the window before the part are hashed first so
+ * matches can reach back into data a different search covers, the decoder has all of it by then. A search depth above 0
+ * limits how many earlier positions are tried for each match.
  */
-static int RefPack_Encode(const void *src, int src_len, void *dst, int dst_len, bool quick)
+static void RefPack_Find_Matches(RefPackSearch const &search, RefPackTokenList &list)
 {
-    int32_t len;
+    const uint8_t *src = search.src;
+    int32_t len = search.end - search.start;
     uint32_t tlen;
     uint32_t tcost;
     uint32_t run;
@@ -52,45 +190,48 @@ static int RefPack_Encode(const void *src, int src_len, void *dst, int dst_len,
     uint32_t mlen;
     const uint8_t *tptr;
     const uint8_t *getp;
-    const uint8_t *runp;
-    uint8_t *putp;
-
-    int countliterals = 0;
-    int countshort = 0;
-    int countlong = 0;
-    int countvlong = 0;
     int32_t hash;
     int32_t hoffset;
     int32_t minhoffset;
     int i;
     int32_t *link;
     int32_t *hashtbl;
-    int32_t *hashptr;
 
-    len = src_len;
-    putp = static_cast<uint8_t *>(dst);
-    run = 0;
-    getp = runp = static_cast<const uint8_t *>(src);
+    hashtbl = static_cast<int32_t *>(malloc(sizeof(int32_t) * REFPACK_HASH_SIZE));
+    link = static_cast<int32_t *>(malloc(sizeof(int32_t) * REFPACK_WINDOW_SIZE));
+    memset(hashtbl, 0xFF, sizeof(int32_t) * REFPACK_HASH_SIZE);
 
-    hashtbl = static_cast<int32_t *>(malloc(sizeof(int32_t) * 65536));
-    link = static_cast<int32_t *>(malloc(sizeof(int32_t) * 131072));
-    hashptr = hashtbl;
-    memset(hashtbl, 0xFF, sizeof(int32_t) * 65536);
+    for (hoffset = max(search.start - (REFPACK_WINDOW_SIZE - 1), 0); hoffset < search.start; ++hoffset) {
+        if (hoffset + 2 < search.size) {
+            hash = RefPack_Hash(src + hoffset);
+            link[hoffset & (REFPACK_WINDOW_SIZE - 1)] = hashtbl[hash];
+            hashtbl[hash] = hoffset;
+        }
+    }
+
+    run = 0;
+    getp = src + search.start;
 
     while (len > 0) {
+        // Too close to the end of the input to hash or match, the rest are literals.
+        if (getp + 2 >= src + search.size) {
+            run += len;
+            break;
+        }
+
+        int chain = search.search_depth;
         boffset = 0;
         blen = bcost = 2;
-        mlen = min(len, 1028);
-        tptr = getp - 1;
-        hash = 0x10 * getp[1] ^ (uint16_t)(getp[2] | ((uint16_t)getp[0] << 8));
+        mlen = min(len, (int32_t)REFPACK_MAX_MATCH);
+        hash = RefPack_Hash(getp);
         hoffset = hashtbl[hash];
-        minhoffset = max(intptr_t(getp - static_cast<const uint8_t *>(src) - 131071), intptr_t(0));
+        minhoffset = max(intptr_t(getp - src - (REFPACK_WINDOW_SIZE - 1)), intptr_t(0));
 
         if (hoffset >= minhoffset) {
             do {
-                tptr = static_cast<const uint8_t *>(src) + hoffset;
+                tptr = src + hoffset;
 
-                if (getp[blen] == tptr[blen]) {
+                if (blen < mlen && getp[blen] == tptr[blen]) {
                     tlen = RefPack_Matchlen(getp, tptr, mlen);
 
                     if (tlen > blen) {
@@ -109,98 +250,170 @@ static int RefPack_Encode(const void *src, int src_len, void *dst, int dst_len,
                             bcost = tcost;
                             boffset = toffset;
 
-                            if (blen >= 1028) {
+                            if (blen >= REFPACK_MAX_MATCH) {
                                 break;
                             }
                         }
                     }
                 }
-            } while ((hoffset = link[hoffset & 131071]) >= minhoffset);
+            } while ((hoffset = link[hoffset & (REFPACK_WINDOW_SIZE - 1)]) >= minhoffset
+                && (search.search_depth <= 0 || --chain > 0));
         }
 
         if (bcost >= blen) {
-            hoffset = (getp - static_cast<const uint8_t *>(src));
-            link[hoffset & 131071] = hashtbl[hash];
+            hoffset = (getp - src);
+            link[hoffset & (REFPACK_WINDOW_SIZE - 1)] = hashtbl[hash];
             hashtbl[hash] = hoffset;
 
             ++run;
             ++getp;
             --len;
         } else {
-            while (run > 3) { // literal block of data
-                tlen = min((uint32_t)112, run & ~3);
-                run -= tlen;
-                *putp++ = (unsigned char)(0xe0 + (tlen >> 2) - 1);
-                memcpy(putp, runp, tlen);
-                runp += tlen;
-                putp += tlen;
-                ++countliterals;
-            }
-
-            if (bcost == 2) // two byte long form
-            {
-                *putp++ = (unsigned char)(((boffset >> 8) << 5) + ((blen - 3) << 2) + run);
-                *putp++ = (unsigned char)boffset;
-                ++countshort;
-            } else if (bcost == 3) { // three byte long form
-                *putp++ = (unsigned char)(0x80 + (blen - 4));
-                *putp++ = (unsigned char)((run << 6) + (boffset >> 8));
-                *putp++ = (unsigned char)boffset;
-                ++countlong;
-            } else { // four byte very long form
-                *putp++ = (unsigned char)(0xc0 + ((boffset >> 16) << 4) + (((blen - 5) >> 8) << 2) + run);
-                *putp++ = (unsigned char)(boffset >> 8);
-                *putp++ = (unsigned char)(boffset);
-                *putp++ = (unsigned char)(blen - 5);
-                ++countvlong;
-            }
+            RefPack_Add_Token(list, run, blen, boffset);
+            run = 0;
 
-            if (run) {
-                memcpy(putp, runp, run);
-                putp += run;
-                run = 0;
-            }
-
-            if (quick) {
-                hoffset = (getp - static_cast<const uint8_t *>(src));
-                link[hoffset & 131071] = hashtbl[hash];
+            if (search.quick) {
+                hoffset = (getp - src);
+                link[hoffset & (REFPACK_WINDOW_SIZE - 1)] = hashtbl[hash];
                 hashtbl[hash] = hoffset;
                 getp += blen;
             } else {
                 for (i = 0; i < (int)blen; ++i) {
-                    hash = 0x10 * getp[1] ^ (uint16_t)(getp[2] | ((uint16_t)getp[0] << 8));
-                    hoffset = (getp - static_cast<const uint8_t *>(src));
-                    link[hoffset & 131071] = hashtbl[hash];
-                    hashtbl[hash] = hoffset;
+                    if (getp + 2 < src + search.size) {
+                        hash = RefPack_Hash(getp);
+                        hoffset = (getp - src);
+                        link[hoffset & (REFPACK_WINDOW_SIZE - 1)] = hashtbl[hash];
+                        hashtbl[hash] = hoffset;
+                    }
+
                     ++getp;
                 }
             }
 
-            runp = getp;
             len -= blen;
         }
     }
 
-    while (run > 3) // no match at end, use literal
-    {
-        tlen = min((uint32_t)112, run & ~3);
-        run -= tlen;
-        *putp++ = (unsigned char)(0xe0 + (tlen >> 2) - 1);
-        memcpy(putp, runp, tlen);
-        runp += tlen;
-        putp += tlen;
-    }
-
-    *putp++ = (unsigned char)(0xFC + run); // end of stream command + 0..3 literal
-    if (run) {
-        memcpy(putp, runp, run);
-        putp += run;
+    if (run != 0) {
+        RefPack_Add_Token(list, run, 0, 0);
     }
 
     free(link);
     free(hashtbl);
+}
 
-    return putp - static_cast<uint8_t *>(dst);
+namespace
+{
+class RefPackBlockJob : public Thyme::WorkerJob
+{
+public:
+    virtual void Execute() override { RefPack_Find_Matches(m_search, m_tokens); }
+
+    RefPackSearch m_search;
+    RefPackTokenList m_tokens;
+};
+} // namespace
+
+/**
+ * Compresses data using refpack LZ method
+ */
+static int RefPack_Encode(const void *src, int src_len, void *dst, int search_depth, bool quick, int thread_count)
+{
+    RefPackEmitter emitter;
+    emitter.putp = static_cast<uint8_t *>(dst);
+    emitter.runp = static_cast<const uint8_t *>(src);
+    emitter.run = 0;
+
+    RefPackSearch search;
+    search.src = static_cast<const uint8_t *>(src);
+    search.size = src_len;
+    search.search_depth = search_depth;
+    search.quick = quick;
+
+    int block_count = (src_len + REFPACK_BLOCK_SIZE - 1) / REFPACK_BLOCK_SIZE;
+
+    if (thread_count <= 1 || block_count < 2) {
+        RefPackTokenList list = { nullptr, 0, 0, &emitter };
+        search.start = 0;
+        search.end = src_len;
+        RefPack_Find_Matches(search, list);
+    } else {
+        // Blocks are searched in parallel but the tokens are written in order so the result is still a single stream.
+        RefPackBlockJob *jobs = new RefPackBlockJob[block_count];
+        Thyme::WorkerPool pool("RefPack", min(thread_count, block_count) - 1);
+
+        for (int i = 0; i < block_count; ++i) {
+            jobs[i].m_search = search;
+            jobs[i].m_search.start = i * REFPACK_BLOCK_SIZE;
+            jobs[i].m_search.end = min(src_len, (i + 1) * REFPACK_BLOCK_SIZE);
+            jobs[i].m_tokens.tokens = nullptr;
+            jobs[i].m_tokens.count = 0;
+            jobs[i].m_tokens.capacity = 0;
+            jobs[i].m_tokens.emitter = nullptr;
+            pool.Submit(&jobs[i]);
+        }
+
+        for (int i = 0; i < block_count; ++i) {
+            pool.Wait(&jobs[i]);
+
+            for (int j = 0; j < jobs[i].m_tokens.count; ++j) {
+                RefPack_Emit_Token(emitter, jobs[i].m_tokens.tokens[j]);
+            }
+
+            free(jobs[i].m_tokens.tokens);
+        }
+
+        delete[] jobs;
+    }
+
+    RefPack_Emit_End(emitter);
+
+    return emitter.putp - static_cast<uint8_t *>(dst);
+}
+
+/**
+ * Copies a back reference. When the reference starts at least a chunk back the copy can go a whole chunk at a time as
+ * no chunk reads bytes it writes itself. Whole chunks can write past the end of the match which is fine as long as it
+ * stays inside the output, the following commands overwrite those bytes. Anything else goes a byte at a time.
+ */
+static inline uint8_t *RefPack_Copy_Match(uint8_t *putp, const uint8_t *end, uint32_t distance, uint32_t run)
+{
+    const uint8_t *ref = putp - distance;
+    uint8_t *stop = putp + run;
+
+    if (distance >= 8 && stop + 8 <= end) {
+        do {
+            memcpy(putp, ref, 8);
+            putp += 8;
+            ref += 8;
+        } while (putp < stop);
+
+        return stop;
+    }
+
+    // Short repeating patterns, once the first chunk is written the output repeats every distance bytes so the rest
+    // can be copied from a multiple of the distance far enough back to use whole chunks.
+    if (run >= 16 && stop + 8 <= end) {
+        for (int i = 0; i < 8; ++i) {
+            *putp++ = *ref++;
+        }
+
+        ref = putp - (8 + distance - 1) / distance * distance;
+
+        do {
+            memcpy(putp, ref, 8);
+            putp += 8;
+            ref += 8;
+        } while (putp < stop);
+
+        return stop;
+    }
+
+    while (putp < stop) {
+        *putp++ = *ref++;
+    }
+
+    return stop;
 }
 
 /**
@@ -209,8 +422,8 @@ static int RefPack_Encode(const void *src, int src_len, void *dst, int dst_len,
 int RefPack_Uncompress(void *dst, const void *src, int *size)
 {
     const uint8_t *getp;
-    uint8_t *ref;
     uint8_t *putp;
+    const uint8_t *end;
     uint8_t first;
     uint8_t second;
     uint8_t third;
@@ -250,7 +463,10 @@ int RefPack_Uncompress(void *dst, const void *src, int *size)
     }
 
     putp = static_cast<uint8_t *>(dst);
+    end = putp + out_length;
 
+    // Long literal runs are copied with memcpy and references through RefPack_Copy_Match, the stream is interpreted
+    // exactly as the original byte at a time loop did so the output is identical.
     while (true) {
         first = *getp++;
 
@@ -263,12 +479,7 @@ int RefPack_Uncompress(void *dst, const void *src, int *size)
                 *putp++ = *getp++;
             }
 
-            ref = putp - 1 - (((first & 0x60) << 3) + second);
-            run = ((first & 0x1c) >> 2) + 3 - 1;
-
-            do {
-                *putp++ = *ref++;
-            } while (run--);
+            putp = RefPack_Copy_Match(putp, end, (((first & 0x60) << 3) + second) + 1, ((first & 0x1c) >> 2) + 3);
 
             continue;
         }
@@ -283,13 +494,7 @@ int RefPack_Uncompress(void *dst, const void *src, int *size)
                 *putp++ = *getp++;
             }
 
-            ref = putp - 1 - (((second & 0x3f) << 8) + third);
-
-            run = (first & 0x3f) + 4 - 1;
-
-            do {
-                *putp++ = *ref++;
-            } while (run--);
+            putp = RefPack_Copy_Match(putp, end, (((second & 0x3f) << 8) + third) + 1, (first & 0x3f) + 4);
 
             continue;
         }
@@ -305,13 +510,10 @@ int RefPack_Uncompress(void *dst, const void *src, int *size)
                 *putp++ = *getp++;
             }
 
-            ref = putp - 1 - (((first & 0x10) >> 4 << 16) + (second << 8) + third);
-
-            run = ((first & 0x0c) >> 2 << 8) + forth + 5 - 1;
-
-            do {
-                *putp++ = *ref++;
-            } while (run--);
+            putp = RefPack_Copy_Match(putp,
+                end,
+                (((first & 0x10) >> 4 << 16) + (second << 8) + third) + 1,
+                ((first & 0x0c) >> 2 << 8) + forth + 5);
 
             continue;
         }
@@ -320,9 +522,9 @@ int RefPack_Uncompress(void *dst, const void *src, int *size)
         run = ((first & 0x1f) << 2) + 4;
 
         if (run <= 112) {
-            while (run--) {
-                *putp++ = *getp++;
-            }
+            memcpy(putp, getp, run);
+            putp += run;
+            getp += run;
 
             continue;
         }
@@ -345,20 +547,17 @@ int RefPack_Uncompress(void *dst, const void *src, int *size)
 }
 
 /**
- * Compresses EA's proprietary "RefPack" format.
+ * Writes the RefPack header, returning its length.
  */
-int RefPack_Compress(void *dst, const void *src, int size, bool quick)
+static int RefPack_Write_Header(uint8_t *putp, int size)
 {
-    uint8_t *putp = static_cast<uint8_t *>(dst);
-    int header_len = 0;
-
     if (size < 0xFFFFFF) {
         putp[0] = 0x10;
         putp[1] = 0xFB;
         putp[2] = (unsigned)(size & 0xFF0000) >> 16;
         putp[3] = (unsigned)(size & 0xFF00) >> 8;
         putp[4] = (unsigned)(size & 0xFF);
-        header_len = 5;
+        return 5;
     } else {
         putp[0] = 0x90;
         putp[1] = 0xFB;
@@ -366,8 +565,37 @@ int RefPack_Compress(void *dst, const void *src, int size, bool quick)
         putp[3] = (unsigned)(size & 0xFF0000) >> 16;
         putp[4] = (unsigned)(size & 0xFF00) >> 8;
         putp[5] = (unsigned)(size & 0xFF);
-        header_len = 6;
+        return 6;
     }
+}
 
-    return header_len + RefPack_Encode(src, size, &putp[header_len], 0x20000, quick);
+/**
+ * Compresses EA's proprietary "RefPack" format.
+ */
+int RefPack_Compress(void *dst, const void *src, int size, bool quick)
+{
+    uint8_t *putp = static_cast<uint8_t *>(dst);
+    int header_len = RefPack_Write_Header(putp, size);
+
+    return header_len + RefPack_Encode(src, size, &putp[header_len], 0, quick, 1);
+}
+
+/**
+ * Compresses EA's proprietary "RefPack" format, trading ratio for speed by limiting the search depth. Inputs spanning
+ * several blocks can be searched on multiple threads.
+ */
+int RefPack_Compress_Level(void *dst, const void *src, int size, int search_depth, int thread_count)
+{
+    uint8_t *putp = static_cast<uint8_t *>(dst);
+    int header_len = RefPack_Write_Header(putp, size);
+
+    return header_len + RefPack_Encode(src, size, &putp[header_len], search_depth, false, thread_count);
+}
+
+/**
+ * Largest size compressing size bytes can produce, incompressible data costs a byte for every 112 plus the header.
+ */
+int RefPack_Compress_Bound(int size)
+{
+    return size + size / 112 + 16;
 }
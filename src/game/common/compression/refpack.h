@@ -18,3 +18,8 @@
 
 int RefPack_Uncompress(void *dst, const void *src, int *size);
 int RefPack_Compress(void *dst, const void *src, int size, bool quick);
+
+// Thyme specific, search_depth limits how many earlier positions are tried for each match with 0 meaning no limit and
+// inputs of more than one block are split across thread_count threads. The output is a normal RefPack stream.
+int RefPack_Compress_Level(void *dst, const void *src, int size, int search_depth, int thread_count = 1);
+int RefPack_Compress_Bound(int size);
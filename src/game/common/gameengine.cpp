@@ -18,13 +18,17 @@
 #include "cavesystem.h"
 #include "commandline.h"
 #include "commandlist.h"
+#include "fileiostats.h"
 #include "filesystem.h"
+#include "framearena.h"
 #include "functionlexicon.h"
+#include "gamemessage.h"
 #include "gamelod.h"
 #include "gametext.h"
 #include "globaldata.h"
 #include "globallanguage.h"
 #include "ini.h"
+#include "iniprofiler.h"
 #include "localfilesystem.h"
 #include "messagestream.h"
 #include "modulefactory.h"
@@ -59,6 +63,10 @@ GameEngine::~GameEngine()
 {
     // TODO
 
+    // Thyme specific, last so anything still holding frame memory gets to copy it out first.
+    delete g_theFrameArena;
+    g_theFrameArena = nullptr;
+
 #ifdef PLATFORM_WINDOWS
     timeEndPeriod(1);
 #endif
@@ -66,7 +74,13 @@ GameEngine::~GameEngine()
 
 void GameEngine::Reset() {}
 
-void GameEngine::Update() {}
+void GameEngine::Update()
+{
+    // Thyme specific, releases the frame temporaries allocated two frames ago.
+    if (g_theFrameArena != nullptr) {
+        g_theFrameArena->Begin_Frame();
+    }
+}
 
 void GameEngine::Init(int argc, char *argv[])
 {
@@ -75,6 +89,11 @@ void GameEngine::Init(int argc, char *argv[])
     g_theSubsystemList = new SubsystemInterfaceList;
     g_theSubsystemList->Add_Subsystem(this);
     Init_Random();
+    // Thyme specific, the engine's thread is the only one that allocates from the frame arena.
+    g_theFrameArena = new FrameArena;
+#ifndef GAME_DLL
+    g_theFrameArena->Add_Reset_Callback(GameMessage::Release_Frame_Args);
+#endif
     g_theFileSystem = Create_File_System();
     g_theNameKeyGenerator = new NameKeyGenerator;
     g_theNameKeyGenerator->Init();
@@ -84,6 +103,8 @@ void GameEngine::Init(int argc, char *argv[])
     XferCRC xfer;
     xfer.Open("lightCRC");
 
+    // Thyme specific, options for the file systems have to be set before the archives are loaded.
+    Parse_Startup_Command_Line(argc, argv);
     Init_Subsystem(g_theLocalFileSystem, "TheLocalFileSystem", Create_Local_File_System());
     Init_Subsystem(g_theArchiveFileSystem, "TheArchiveFileSystem", Create_Archive_File_System());
     Init_Subsystem(g_theWriteableGlobalData,
@@ -94,6 +115,12 @@ void GameEngine::Init(int argc, char *argv[])
         "Data/INI/GameData.ini");
     // Worldbuilder loads GameDebugData.ini at this point and has additional debug members of the class.
     Parse_Command_Line(argc, argv);
+
+    // Thyme specific, file IO stats are written alongside the asset usage dump when the file system shuts down.
+    if (g_theWriteableGlobalData->m_dumpAssetUsage && !Thyme::FileIOStats::Is_Enabled()) {
+        Thyme::FileIOStats::Enable();
+    }
+
     g_theGameLODManager = new GameLODManager;
     g_theGameLODManager->Init();
 
@@ -159,6 +186,9 @@ void GameEngine::Init(int argc, char *argv[])
         "Data/INI/Default/PlayerTemplate.ini",
         "Data/INI/PlayerTemplate.ini");
 
+    // Thyme specific, reports where INI loading spent its time if -profileINI was given.
+    INIProfiler::Dump();
+
     // TODO this is a WIP
 }
 
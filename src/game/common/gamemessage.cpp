@@ -13,9 +13,14 @@
  *            LICENSE
  */
 #include "gamemessage.h"
+#include "framearena.h"
 #include "gamemessagelist.h"
 #include "playerlist.h"
 
+#ifndef GAME_DLL
+GameMessage *GameMessage::s_firstFrameArgMessage;
+#endif
+
 GameMessage::GameMessage(MessageType type) :
     m_next(nullptr),
     m_prev(nullptr),
@@ -25,6 +30,12 @@ GameMessage::GameMessage(MessageType type) :
     m_argCount(0),
     m_argList(nullptr),
     m_argTail(nullptr)
+#ifndef GAME_DLL
+    ,
+    m_nextFrameArgMessage(nullptr),
+    m_prevFrameArgMessage(nullptr),
+    m_hasFrameArgs(false)
+#endif
 {
 }
 
@@ -35,9 +46,21 @@ GameMessage::~GameMessage()
     while (argobj != nullptr) {
         GameMessageArgument *tmp = argobj;
         argobj = argobj->m_next;
+
+#ifndef GAME_DLL
+        // Frame arena arguments go with the frame, they hold nothing that needs destroying.
+        if (m_hasFrameArgs && g_theFrameArena->Owns(tmp)) {
+            continue;
+        }
+#endif
+
         tmp->Delete_Instance();
     }
 
+#ifndef GAME_DLL
+    Unlink_Frame_Arg_Message();
+#endif
+
     if (m_list != nullptr) {
         m_list->Remove_Message(this);
     }
@@ -45,7 +68,24 @@ GameMessage::~GameMessage()
 
 GameMessageArgument *GameMessage::Allocate_Arg()
 {
+#ifndef GAME_DLL
+    // Thyme specific, most messages are destroyed within the frame that created them so their arguments come from the
+    // frame arena once the engine has started running frames. Until then nothing would reset the arena and it would only
+    // grow. Messages created off the main thread still use the pool.
+    void *mem = g_theFrameArena != nullptr && g_theFrameArena->Get_Frame() != 0 ?
+        g_theFrameArena->Allocate(sizeof(GameMessageArgument)) :
+        nullptr;
+    GameMessageArgument *arg;
+
+    if (mem != nullptr) {
+        arg = new (mem) GameMessageArgument;
+        Link_Frame_Arg_Message();
+    } else {
+        arg = NEW_POOL_OBJ(GameMessageArgument);
+    }
+#else
     GameMessageArgument *arg = NEW_POOL_OBJ(GameMessageArgument);
+#endif
 
     if (m_argTail != nullptr) {
         m_argTail->m_next = arg;
@@ -60,6 +100,89 @@ GameMessageArgument *GameMessage::Allocate_Arg()
     return arg;
 }
 
+#ifndef GAME_DLL
+/**
+ * Frame arena reset callback, copies the arguments of messages still alive out of the buffer about to be reused.
+ */
+void GameMessage::Release_Frame_Args(FrameArena &arena)
+{
+    GameMessage *next;
+
+    for (GameMessage *msg = s_firstFrameArgMessage; msg != nullptr; msg = next) {
+        next = msg->m_nextFrameArgMessage;
+        GameMessageArgument *prev = nullptr;
+        bool has_frame_args = false;
+
+        for (GameMessageArgument *argobj = msg->m_argList; argobj != nullptr; argobj = argobj->m_next) {
+            if (arena.Is_Expiring(argobj)) {
+                GameMessageArgument *copy = NEW_POOL_OBJ(GameMessageArgument);
+                copy->m_next = argobj->m_next;
+                copy->m_data = argobj->m_data;
+                copy->m_type = argobj->m_type;
+
+                if (prev != nullptr) {
+                    prev->m_next = copy;
+                } else {
+                    msg->m_argList = copy;
+                }
+
+                if (msg->m_argTail == argobj) {
+                    msg->m_argTail = copy;
+                }
+
+                argobj = copy;
+            } else if (arena.Owns(argobj)) {
+                has_frame_args = true;
+            }
+
+            prev = argobj;
+        }
+
+        if (!has_frame_args) {
+            msg->Unlink_Frame_Arg_Message();
+        }
+    }
+}
+
+void GameMessage::Link_Frame_Arg_Message()
+{
+    if (m_hasFrameArgs) {
+        return;
+    }
+
+    m_prevFrameArgMessage = nullptr;
+    m_nextFrameArgMessage = s_firstFrameArgMessage;
+
+    if (s_firstFrameArgMessage != nullptr) {
+        s_firstFrameArgMessage->m_prevFrameArgMessage = this;
+    }
+
+    s_firstFrameArgMessage = this;
+    m_hasFrameArgs = true;
+}
+
+void GameMessage::Unlink_Frame_Arg_Message()
+{
+    if (!m_hasFrameArgs) {
+        return;
+    }
+
+    if (m_prevFrameArgMessage != nullptr) {
+        m_prevFrameArgMessage->m_nextFrameArgMessage = m_nextFrameArgMessage;
+    } else {
+        s_firstFrameArgMessage = m_nextFrameArgMessage;
+    }
+
+    if (m_nextFrameArgMessage != nullptr) {
+        m_nextFrameArgMessage->m_prevFrameArgMessage = m_prevFrameArgMessage;
+    }
+
+    m_nextFrameArgMessage = nullptr;
+    m_prevFrameArgMessage = nullptr;
+    m_hasFrameArgs = false;
+}
+#endif
+
 ArgumentType *GameMessage::Get_Argument(int arg)
 {
     static ArgumentType junkconst;
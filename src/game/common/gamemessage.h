@@ -18,6 +18,7 @@
 #include "coord.h"
 #include "mempoolobj.h"
 
+class FrameArena;
 class GameMessageList;
 
 enum ArgumentDataType
@@ -379,7 +380,17 @@ public:
 
     MessageType Get_Type() const { return m_type; }
 
+#ifndef GAME_DLL
+    // Thyme specific, arguments come from the frame arena and are moved to the pool by this if the message outlives them.
+    static void Release_Frame_Args(FrameArena &arena);
+#endif
+
 private:
+#ifndef GAME_DLL
+    void Link_Frame_Arg_Message();
+    void Unlink_Frame_Arg_Message();
+#endif
+
     GameMessage *m_next;
     GameMessage *m_prev;
     GameMessageList *m_list;
@@ -389,4 +400,11 @@ private:
     // 3 bytes padding
     GameMessageArgument *m_argList;
     GameMessageArgument *m_argTail;
+#ifndef GAME_DLL
+    GameMessage *m_nextFrameArgMessage; // List of messages with arguments in the frame arena.
+    GameMessage *m_prevFrameArgMessage;
+    bool m_hasFrameArgs;
+
+    static GameMessage *s_firstFrameArgMessage;
+#endif
 };
@@ -31,7 +31,11 @@
 #include "globaldata.h"
 #include "globallanguage.h"
 #include "image.h"
+#include "iniparseindex.h"
+#include "iniprofiler.h"
 #include "locomotor.h"
+#include "memdynalloc.h"
+#include "mempool.h"
 #include "mouse.h"
 #include "objectcreationlist.h"
 #include "particlesysmanager.h"
@@ -43,10 +47,22 @@
 #include "thingfactory.h"
 #include "water.h"
 #include "weather.h"
+#include "workerpool.h"
 #include "xfer.h"
 #include <algorithm>
 #include <cctype>
 #include <cstdio>
+#include <type_traits>
+#include <vector>
+
+// GCC 7's libstdc++ has no <charconv>, integers are converted with it where it exists and floats only where the
+// library defines __cpp_lib_to_chars.
+#if defined __has_include
+#if __has_include(<charconv>)
+#include <charconv>
+#define HAVE_CHARCONV
+#endif
+#endif
 
 using GameMath::Ceil;
 
@@ -140,6 +156,12 @@ const BlockParse TheTypeTable[] = {
 // Helper function for Load
 inline iniblockparse_t Find_Block_Parse(const char *token)
 {
+#ifndef GAME_DLL
+    static const INIParseIndex &index = INIParseIndex::Get(TheTypeTable);
+    int found = index.Find(token);
+
+    return found != -1 ? TheTypeTable[found].parse_func : nullptr;
+#else
     // Iterate over the TypeTable to identify correct parsing function.
     for (const BlockParse *block = TheTypeTable; block->token != nullptr; ++block) {
         if (strcmp(block->token, token) == 0) {
@@ -148,6 +170,7 @@ inline iniblockparse_t Find_Block_Parse(const char *token)
     }
 
     return nullptr;
+#endif
 }
 
 // Helper function for Init_From_INI_Multi
@@ -178,6 +201,76 @@ inline inifieldparse_t Find_Field_Parse(const FieldParse *table, const char *tok
     return nullptr;
 }
 
+#ifndef GAME_DLL
+// Hashed version of the above, the token is interned once per line and matched by pointer in every table searched.
+inline inifieldparse_t Find_Field_Parse(const FieldParse *table,
+    INIParseIndex const &index,
+    const char *token,
+    InternedString field,
+    uint32_t hash,
+    int &offset,
+    const void *&data)
+{
+    int found = index.Find(field, hash);
+
+    if (found != -1) {
+        offset = table[found].offset;
+        data = table[found].user_data;
+
+        return table[found].parse_func;
+    }
+
+    const FieldParse *terminator = &table[index.Get_Terminator()];
+
+    if (terminator->parse_func != nullptr) {
+        offset = terminator->offset;
+        data = token;
+
+        return terminator->parse_func;
+    }
+
+    return nullptr;
+}
+#endif
+
+#ifdef HAVE_CHARCONV
+// sscanf skips white space and takes a leading plus sign, from_chars does neither.
+inline const char *Skip_To_Number(const char *token)
+{
+    while (isspace(uint8_t(*token))) {
+        ++token;
+    }
+
+    if (*token == '+' && token[1] != '+' && token[1] != '-') {
+        ++token;
+    }
+
+    return token;
+}
+
+// Converts the same way as sscanf for anything found in the retail data, returns false for the rare input the two
+// treat differently so the caller can fall back to sscanf.
+template<typename T> bool Scan_Number(const char *token, T &value)
+{
+    const char *start = Skip_To_Number(token);
+
+    if (std::is_unsigned<T>::value && *start == '-') {
+        return false;
+    }
+
+    if (std::is_floating_point<T>::value) {
+        const char *digits = start + (*start == '-');
+
+        // Hexadecimal floats are read by sscanf but from_chars stops at the x.
+        if (digits[0] == '0' && (digits[1] == 'x' || digits[1] == 'X')) {
+            return false;
+        }
+    }
+
+    return std::from_chars(start, start + strlen(start), value).ec == std::errc();
+}
+#endif
+
 INI::INI() :
     m_backingFile(nullptr),
     m_bufferReadPos(0),
@@ -191,6 +284,12 @@ INI::INI() :
     m_sepsQuote("\"\n="),
     m_endToken("END"),
     m_endOfFile(false)
+#ifndef GAME_DLL
+    ,
+    m_line(m_currentBlock),
+    m_tokenPos(nullptr),
+    m_tokenHash(0)
+#endif
 {
     m_currentBlock[0] = '\0';
 #ifdef GAME_DEBUG_STRUCTS
@@ -206,8 +305,15 @@ void INI::Load(Utf8String filename, INILoadType type, Xfer *xfer)
 {
     Set_FP_Mode(); // Ensure floating point mode is a consistent mode for loading.
     g_sXfer = xfer;
+    INIProfileTimer timer(filename.Str());
     Prep_File(filename, type);
+    Load_Blocks();
+    timer.File_Loaded(m_lineNumber);
+    Unprep_File();
+}
 
+void INI::Load_Blocks()
+{
     captainslog_dbgassert(!m_endOfFile, "INI::load, EOF at the beginning!");
 
     while (!m_endOfFile) {
@@ -217,16 +323,19 @@ void INI::Load(Utf8String filename, INILoadType type, Xfer *xfer)
         // parsed block, possible leftover from debug code?
         // Utf8String block(m_currentBlock);
 
-        char *token = strtok(m_currentBlock, m_seps);
+        char *token = Get_First_Token();
 
         if (token != nullptr) {
             iniblockparse_t parser = Find_Block_Parse(token);
 
             if (parser != nullptr) {
 #ifdef GAME_DEBUG_STRUCTS
-                strcpy(m_curBlockStart, m_currentBlock);
+                strcpy(m_curBlockStart, Get_Current_Line());
 #endif
+                INIProfileTimer timer(token);
+                int first_line = m_lineNumber;
                 parser(this);
+                timer.Block_Parsed(m_lineNumber - first_line + 1);
 #ifdef GAME_DEBUG_STRUCTS
                 strcpy(m_curBlockStart, "NO_BLOCK");
 #endif
@@ -236,8 +345,6 @@ void INI::Load(Utf8String filename, INILoadType type, Xfer *xfer)
             }
         }
     }
-
-    Unprep_File();
 }
 
 void INI::Load_Directory(Utf8String dir, bool search_subdirs, INILoadType type, Xfer *xfer)
@@ -245,6 +352,7 @@ void INI::Load_Directory(Utf8String dir, bool search_subdirs, INILoadType type,
     captainslog_relassert(!dir.Is_Empty(), 0xDEAD0006, "No directory provided to load from.");
 
     std::set<Utf8String, rts::less_than_nocase<Utf8String>> files;
+    std::vector<Utf8String> load_order;
     dir += '/';
 
     g_theFileSystem->Get_File_List_In_Directory(dir, "*.ini", files, true);
@@ -255,7 +363,7 @@ void INI::Load_Directory(Utf8String dir, bool search_subdirs, INILoadType type,
         Utf8String path_check = &it->Str()[strlen(dir.Str())];
 
         if (strchr(path_check.Str(), '\\') == nullptr && strchr(path_check.Str(), '/') == nullptr) {
-            Load(*it, type, xfer);
+            load_order.push_back(*it);
         }
     }
 
@@ -265,10 +373,101 @@ void INI::Load_Directory(Utf8String dir, bool search_subdirs, INILoadType type,
         Utf8String path_check = &it->Str()[dir.Get_Length()];
 
         if (strchr(path_check.Str(), '\\') != nullptr || strchr(path_check.Str(), '/') != nullptr) {
+            load_order.push_back(*it);
+        }
+    }
+
+    Load_Files(load_order, type, xfer);
+}
+
+#ifndef GAME_DLL
+namespace
+{
+class ReadINIJob : public Thyme::WorkerJob
+{
+public:
+    ReadINIJob() : m_seps(nullptr), m_opened(false) {}
+
+    virtual void Execute() override
+    {
+        File *file = g_theFileSystem->Open_File(m_filename.Str(), File::READ);
+
+        if (file != nullptr) {
+            m_buffer.Load(file);
+            file->Close();
+            m_buffer.Split_Lines(INI::INI_MAX_CHARS_PER_LINE, m_seps);
+            m_opened = true;
+        }
+    }
+
+    Utf8String m_filename;
+    const char *m_seps;
+    INIFileBuffer m_buffer;
+    bool m_opened;
+};
+} // namespace
+#endif
+
+// Loads each file in the list in order. Files are read and split into lines on worker threads ahead of being parsed,
+// the parsing itself stays on this thread in the same order so later files override earlier ones as before and any
+// xfer sees the same lines.
+void INI::Load_Files(std::vector<Utf8String> const &files, INILoadType type, Xfer *xfer)
+{
+    int thread_count = std::min<int>(Thyme::WorkerPool::Get_Default_Thread_Count(), int(files.size()) - 1);
+
+    // Reading files on other threads relies on the memory managers having their locks set up.
+#ifndef GAME_DLL
+    bool concurrent = thread_count > 0 && g_memoryPoolCriticalSection != nullptr && g_dmaCriticalSection != nullptr;
+#else
+    bool concurrent = false;
+#endif
+
+    if (!concurrent) {
+        for (auto it = files.begin(); it != files.end(); ++it) {
             Load(*it, type, xfer);
         }
+
+        return;
+    }
+
+#ifndef GAME_DLL
+    // The jobs are declared first so they outlive the pool, if parsing throws the pool finishes them before they go.
+    std::vector<ReadINIJob> jobs(files.size());
+    Thyme::WorkerPool pool("INI Loader", thread_count);
+
+    for (size_t i = 0; i < files.size(); ++i) {
+        jobs[i].m_filename = files[i];
+        jobs[i].m_seps = m_seps;
+        pool.Submit(&jobs[i]);
+    }
+
+    for (size_t i = 0; i < files.size(); ++i) {
+        pool.Wait(&jobs[i]);
+        captainslog_relassert(jobs[i].m_opened, 0xDEAD0006, "Could not open file %s.", files[i].Str());
+        Load_Buffer(files[i], type, xfer, jobs[i].m_buffer);
     }
+#endif
+}
+
+#ifndef GAME_DLL
+// Same as Load for a file that has already been read into a buffer, which is left empty.
+void INI::Load_Buffer(Utf8String filename, INILoadType type, Xfer *xfer, INIFileBuffer &buffer)
+{
+    Set_FP_Mode(); // Ensure floating point mode is a consistent mode for loading.
+    g_sXfer = xfer;
+
+    captainslog_relassert(!m_fileBuffer.Is_Loaded(), 0xDEAD0006, "Cannot open file %s, file already open.", filename.Str());
+
+    // The time spent reading the file on a worker isn't included.
+    INIProfileTimer timer(filename.Str());
+    m_fileBuffer.Swap(buffer);
+    m_fileName = filename;
+    m_loadType = type;
+    Load_Blocks();
+    timer.File_Loaded(m_lineNumber);
+    Unprep_File();
 }
+#endif
 
 void INI::Prep_File(Utf8String filename, INILoadType type)
 {
@@ -277,6 +476,9 @@ void INI::Prep_File(Utf8String filename, INILoadType type)
     m_backingFile = g_theFileSystem->Open_File(filename.Str(), File::READ);
 
     captainslog_relassert(m_backingFile != nullptr, 0xDEAD0006, "Could not open file %s.", filename.Str());
+#ifndef GAME_DLL
+    m_fileBuffer.Load(m_backingFile);
+#endif
 
     m_fileName = filename;
     m_loadType = type;
@@ -284,8 +486,17 @@ void INI::Prep_File(Utf8String filename, INILoadType type)
 
 void INI::Unprep_File()
 {
-    m_backingFile->Close();
-    m_backingFile = nullptr;
+    // Files read ahead by Load_Files are already closed.
+    if (m_backingFile != nullptr) {
+        m_backingFile->Close();
+        m_backingFile = nullptr;
+    }
+
+#ifndef GAME_DLL
+    m_fileBuffer.Release();
+    m_line = m_currentBlock;
+    m_tokenPos = nullptr;
+#endif
     m_bufferReadPos = 0;
     m_bufferData = 0;
     m_fileName = "None";
@@ -309,17 +520,25 @@ void INI::Init_From_INI_Multi(void *what, const MultiIniFieldParse &parse_table_
 
     captainslog_relassert(what != nullptr, 0xDEAD0006, "Init_From_INI - Invalid parameters supplied.");
 
+#ifndef GAME_DLL
+    const INIParseIndex *indices[MultiIniFieldParse::MAX_MULTI_FIELDS];
+
+    for (int i = 0; i < parse_table_list.count; ++i) {
+        indices[i] = &INIParseIndex::Get(parse_table_list.field_parsers[i]);
+    }
+#endif
+
     while (!done) {
         captainslog_relassert(!m_endOfFile,
             0xDEAD0006,
             "Error parsing block '%s', in INI file '%s'.  Missing '%s' token",
-            m_currentBlock,
+            Get_Current_Line(),
             m_fileName.Str(),
             m_endToken);
 
         Read_Line();
 
-        char *token = strtok(m_currentBlock, m_seps);
+        char *token = Get_First_Token();
 
         if (token == nullptr) {
             continue;
@@ -332,6 +551,13 @@ void INI::Init_From_INI_Multi(void *what, const MultiIniFieldParse &parse_table_
             int offset;
             const void *data;
             int exoffset = 0;
+#ifndef GAME_DLL
+            uint32_t hash = m_tokenHash;
+            InternedString field;
+
+            // Tokens are never empty, so a token that was never interned is left empty and matches no table.
+            InternedString::Find(token, hash, field);
+#endif
 
             // Find an appropriate parser function from the parse table
             for (int i = 0;; ++i) {
@@ -341,9 +567,14 @@ void INI::Init_From_INI_Multi(void *what, const MultiIniFieldParse &parse_table_
                     m_lineNumber,
                     m_fileName.Str(),
                     token,
-                    m_currentBlock);
+                    Get_Current_Line());
 
+#ifndef GAME_DLL
+                parsefunc =
+                    Find_Field_Parse(parse_table_list.field_parsers[i], *indices[i], token, field, hash, offset, data);
+#else
                 parsefunc = Find_Field_Parse(parse_table_list.field_parsers[i], token, offset, data);
+#endif
 
                 if (parsefunc != nullptr) {
                     exoffset = parse_table_list.extra_offsets[i];
@@ -367,11 +598,23 @@ void INI::Init_From_INI_Multi_Proc(void *what, void (*proc)(MultiIniFieldParse &
 
 void INI::Read_Line()
 {
+#ifndef GAME_DLL
+    captainslog_dbgassert(m_fileBuffer.Is_Loaded(), "Read_Line file pointer is nullptr.");
+#else
     captainslog_dbgassert(m_backingFile != nullptr, "Read_Line file pointer is nullptr.");
+#endif
 
     if (m_endOfFile) {
         m_currentBlock[0] = '\0';
+#ifndef GAME_DLL
+        m_line = m_currentBlock;
+#endif
     } else {
+#ifndef GAME_DLL
+        // Same lines as below but without copying each one out of the file.
+        m_line = m_fileBuffer.Read_Line(m_currentBlock, INI_MAX_CHARS_PER_LINE, m_endOfFile);
+        ++m_lineNumber;
+#else
         // Read into our current block buffer.
         char *cb;
         for (cb = m_currentBlock; cb != &m_currentBlock[INI_MAX_CHARS_PER_LINE]; ++cb) {
@@ -409,14 +652,34 @@ void INI::Read_Line()
         captainslog_dbgassert(cb != &m_currentBlock[INI_MAX_CHARS_PER_LINE],
             "Buffer too small (%d) and was truncated, increase INI_MAX_CHARS_PER_LINE",
             INI_MAX_CHARS_PER_LINE);
+#endif
     }
 
     // If we have a transfer object assigned, do the transfer.
     if (g_sXfer != nullptr) {
-        g_sXfer->xferImplementation(m_currentBlock, strlen(m_currentBlock));
+        const char *line = Get_Current_Line();
+        g_sXfer->xferImplementation(const_cast<char *>(line), strlen(line));
     }
 }
 
+char *INI::Get_First_Token()
+{
+#ifndef GAME_DLL
+    return m_fileBuffer.First_Token(m_line, m_seps, m_tokenPos, m_tokenHash);
+#else
+    return strtok(m_currentBlock, m_seps);
+#endif
+}
+
+const char *INI::Get_Current_Line() const
+{
+#ifndef GAME_DLL
+    return m_line;
+#else
+    return m_currentBlock;
+#endif
+}
+
 Utf8String INI::Get_Next_Quoted_Ascii_String() const
 {
     const char *token = Get_Next_Token_Or_Null();
@@ -465,6 +728,13 @@ ScienceType INI::Scan_Science(const char *token)
 float INI::Scan_PercentToReal(const char *token)
 {
     float value;
+
+#if defined HAVE_CHARCONV && defined __cpp_lib_to_chars
+    if (Scan_Number(token, value)) {
+        return (value / 100.0f);
+    }
+#endif
+
     int res = sscanf(token, "%f", &value);
     captainslog_relassert(res == 1, 0xDEAD0006, "Unable to parse percentage from token %s.", token);
 
@@ -474,6 +744,13 @@ float INI::Scan_PercentToReal(const char *token)
 float INI::Scan_Real(const char *token)
 {
     float value;
+
+#if defined HAVE_CHARCONV && defined __cpp_lib_to_chars
+    if (Scan_Number(token, value)) {
+        return value;
+    }
+#endif
+
     int res = sscanf(token, "%f", &value);
     captainslog_relassert(res == 1, 0xDEAD0006, "Unable to parse float from token %s.", token);
 
@@ -483,6 +760,13 @@ float INI::Scan_Real(const char *token)
 unsigned int INI::Scan_UnsignedInt(const char *token)
 {
     unsigned int value;
+
+#ifdef HAVE_CHARCONV
+    if (Scan_Number(token, value)) {
+        return value;
+    }
+#endif
+
     int res = sscanf(token, "%u", &value);
     captainslog_relassert(res == 1, 0xDEAD0006, "Unable to parse unsigned int from token %s.", token);
 
@@ -492,6 +776,13 @@ unsigned int INI::Scan_UnsignedInt(const char *token)
 int INI::Scan_Int(const char *token)
 {
     int value;
+
+#ifdef HAVE_CHARCONV
+    if (Scan_Number(token, value)) {
+        return value;
+    }
+#endif
+
     int res = sscanf(token, "%d", &value);
     captainslog_relassert(res == 1, 0xDEAD0006, "Unable to parse int from token %s.", token);
 
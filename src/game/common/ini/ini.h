@@ -17,7 +17,9 @@
 #include "always.h"
 #include "asciistring.h"
 #include "gametype.h"
+#include "inifilebuffer.h"
 #include <captainslog.h>
+#include <vector>
 
 class File;
 class Xfer;
@@ -169,6 +171,13 @@ private:
     void Read_Line();
     void Prep_File(Utf8String filename, INILoadType type);
     void Unprep_File();
+    void Load_Blocks();
+    void Load_Files(std::vector<Utf8String> const &files, INILoadType type, Xfer *xfer);
+#ifndef GAME_DLL
+    void Load_Buffer(Utf8String filename, INILoadType type, Xfer *xfer, INIFileBuffer &buffer);
+#endif
+    char *Get_First_Token();
+    const char *Get_Current_Line() const;
 
     File *m_backingFile;
     char m_buffer[INI_BUFFER_SIZE];
@@ -187,6 +196,12 @@ private:
 #ifdef GAME_DEBUG_STRUCTS
     char m_curBlockStart[INI_MAX_CHARS_PER_LINE];
 #endif
+#ifndef GAME_DLL
+    INIFileBuffer m_fileBuffer;
+    char *m_line; // Points into m_fileBuffer, or at m_currentBlock for lines that had to be copied.
+    mutable char *m_tokenPos; // Tokenizer position within m_line, replaces the hidden state of strtok.
+    uint32_t m_tokenHash; // INIParseIndex hash of the token from Get_First_Token.
+#endif
 };
 
 #ifdef GAME_DLL
@@ -199,12 +214,16 @@ extern Xfer *g_sXfer;
 // Functions for inlining, neater than including in class declaration
 inline const char *INI::Get_Next_Token_Or_Null(const char *seps) const
 {
+#ifdef GAME_DLL
     return strtok(0, seps != nullptr ? seps : m_seps);
+#else
+    return INIFileBuffer::Tokenize(nullptr, seps != nullptr ? seps : m_seps, m_tokenPos);
+#endif
 }
 
 inline const char *INI::Get_Next_Token(const char *seps) const
 {
-    char *ret = strtok(0, seps != nullptr ? seps : m_seps);
+    const char *ret = Get_Next_Token_Or_Null(seps);
     captainslog_relassert(
         ret != nullptr, 0xDEAD0006, "Expected further tokens in '%s', line %d", m_fileName.Str(), m_lineNumber);
 
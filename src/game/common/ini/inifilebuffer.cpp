@@ -0,0 +1,197 @@
+/**
+ * @file
+ *
+ * @author OmniBlade
+ *
+ * @brief Whole INI file held in memory and split into lines in place. (Thyme Feature)
+ *
+ * @copyright Thyme is free software: you can redistribute it and/or
+ *            modify it under the terms of the GNU General Public License
+ *            as published by the Free Software Foundation, either version
+ *            2 of the License, or (at your option) any later version.
+ *            A full copy of the GNU General Public License can be found in
+ *            LICENSE
+ */
+#include "inifilebuffer.h"
+#include "file.h"
+#include "iniparseindex.h"
+#include <algorithm>
+#include <captainslog.h>
+
+/**
+ * Reads the whole file, the caller still has to close it.
+ */
+void INIFileBuffer::Load(File *file)
+{
+    int size = std::max(file->Size(), 0);
+    char *data = new char[size];
+    size = std::max(file->Read(data, size), 0);
+    Set_Data(data, size);
+}
+
+/**
+ * Takes ownership of a buffer allocated with new[].
+ */
+void INIFileBuffer::Set_Data(char *data, int size)
+{
+    Release();
+    m_data = data;
+    m_size = size;
+    m_readPos = 0;
+}
+
+void INIFileBuffer::Release()
+{
+    delete[] m_data;
+    m_data = nullptr;
+    m_size = 0;
+    m_readPos = 0;
+    m_lines.clear();
+    m_copiedLines.clear();
+    m_nextLine = 0;
+    m_isSplit = false;
+}
+
+void INIFileBuffer::Swap(INIFileBuffer &other)
+{
+    std::swap(m_data, other.m_data);
+    std::swap(m_size, other.m_size);
+    std::swap(m_readPos, other.m_readPos);
+    m_lines.swap(other.m_lines);
+    m_copiedLines.swap(other.m_copiedLines);
+    std::swap(m_nextLine, other.m_nextLine);
+    std::swap(m_isSplit, other.m_isSplit);
+    std::swap(m_splitSeps, other.m_splitSeps);
+}
+
+/**
+ * Reads every line ahead of time along with the bounds and hash of its first token when split by seps. Read_Line then
+ * returns the same lines in the same order without doing any work.
+ */
+void INIFileBuffer::Split_Lines(int max_chars, const char *seps)
+{
+    std::vector<char> overflow(max_chars + 1);
+    bool end_of_file = false;
+    m_lines.clear();
+    m_copiedLines.clear();
+    m_isSplit = false;
+
+    while (!end_of_file) {
+        char *text = Read_Line(&overflow[0], max_chars, end_of_file);
+        LineInfo line;
+
+        if (text == &overflow[0]) {
+            line.offset = -1 - int(m_copiedLines.size());
+            m_copiedLines.insert(m_copiedLines.end(), text, text + strlen(text) + 1);
+        } else {
+            line.offset = int(text - m_data);
+        }
+
+        // Where Tokenize would find the first token, it gets terminated when the parser asks for it.
+        line.token_start = int(strspn(text, seps));
+
+        if (text[line.token_start] != '\0') {
+            line.token_end = line.token_start + int(strcspn(text + line.token_start, seps));
+            char end = text[line.token_end];
+            text[line.token_end] = '\0';
+            line.token_hash = INIParseIndex::Hash(text + line.token_start);
+            text[line.token_end] = end;
+        } else {
+            line.token_end = line.token_start;
+            line.token_start = -1;
+            line.token_hash = 0;
+        }
+
+        m_lines.push_back(line);
+    }
+
+    m_nextLine = 0;
+    m_isSplit = true;
+    m_splitSeps = seps;
+}
+
+/**
+ * Returns the next line. Lines that end in a newline are terminated in place, a line cut short by max_chars or by the
+ * end of the file has nowhere to put its terminator so it is copied to overflow, which must hold max_chars + 1.
+ */
+char *INIFileBuffer::Read_Line(char *overflow, int max_chars, bool &end_of_file)
+{
+    if (m_isSplit) {
+        char *text = Line_Text(m_lines[m_nextLine++]);
+        end_of_file = m_nextLine == int(m_lines.size());
+
+        return text;
+    }
+
+    char *line = m_data + m_readPos;
+    int limit = std::min(m_readPos + max_chars, m_size);
+    char *newline = static_cast<char *>(memchr(line, '\n', limit - m_readPos));
+    int length = newline != nullptr ? int(newline - line) : limit - m_readPos;
+
+    // Handle comment marker and none printing chars, written without branches so it vectorises.
+    for (int i = 0; i < length; ++i) {
+        char c = line[i];
+        line[i] = c == ';' ? '\0' : (c > '\0' && c < ' ' ? ' ' : c);
+    }
+
+    if (newline != nullptr) {
+        *newline = '\0';
+        m_readPos += length + 1;
+
+        return line;
+    }
+
+    // Running out of characters before running out of file is the truncation the original reader warned about.
+    captainslog_dbgassert(
+        length != max_chars, "Buffer too small (%d) and was truncated, increase INI_MAX_CHARS_PER_LINE", max_chars);
+
+    if (length != max_chars) {
+        end_of_file = true;
+    }
+
+    if (length != 0) {
+        memcpy(overflow, line, length);
+    }
+
+    overflow[length] = '\0';
+    m_readPos += length;
+
+    return overflow;
+}
+
+/**
+ * Tokenize for the first token of the line Read_Line just returned, also giving the INIParseIndex hash of the token.
+ * When the lines were split ahead of time with the same separators neither has to be worked out again.
+ */
+char *INIFileBuffer::First_Token(char *line, const char *seps, char *&next, uint32_t &hash)
+{
+    if (!m_isSplit || m_nextLine == 0 || line != Line_Text(m_lines[m_nextLine - 1]) || strcmp(seps, m_splitSeps) != 0) {
+        char *token = Tokenize(line, seps, next);
+        hash = token != nullptr ? INIParseIndex::Hash(token) : 0;
+
+        return token;
+    }
+
+    LineInfo const &info = m_lines[m_nextLine - 1];
+
+    if (info.token_start < 0) {
+        next = line + info.token_end;
+        hash = 0;
+
+        return nullptr;
+    }
+
+    char *token = line + info.token_start;
+    char *end = line + info.token_end;
+
+    if (*end != '\0') {
+        *end = '\0';
+        next = end + 1;
+    } else {
+        next = end;
+    }
+
+    hash = info.token_hash;
+
+    return token;
+}
@@ -0,0 +1,121 @@
+/**
+ * @file
+ *
+ * @author OmniBlade
+ *
+ * @brief Whole INI file held in memory and split into lines in place. (Thyme Feature)
+ *
+ * @copyright Thyme is free software: you can redistribute it and/or
+ *            modify it under the terms of the GNU General Public License
+ *            as published by the Free Software Foundation, either version
+ *            2 of the License, or (at your option) any later version.
+ *            A full copy of the GNU General Public License can be found in
+ *            LICENSE
+ */
+#pragma once
+
+#include "always.h"
+#include <cstring>
+#include <vector>
+
+class File;
+
+// Holds the entire file and hands out the same lines the original buffered reader produced, comments cut off and
+// control characters replaced. Lines are terminated inside the buffer so tokens point straight into the file data
+// rather than into a copy of each line.
+//
+// Split_Lines does all of that up front along with finding the first token of each line, which is the block or field
+// name the parser dispatches on. It doesn't depend on anything else in the game so it can run on a worker thread,
+// leaving only the parsing for the thread applying the file.
+class INIFileBuffer
+{
+public:
+    INIFileBuffer() : m_data(nullptr), m_size(0), m_readPos(0), m_nextLine(0), m_isSplit(false), m_splitSeps(nullptr) {}
+    ~INIFileBuffer() { Release(); }
+
+    void Load(File *file);
+    void Set_Data(char *data, int size);
+    void Release();
+    void Swap(INIFileBuffer &other);
+
+    void Split_Lines(int max_chars, const char *seps);
+    char *Read_Line(char *overflow, int max_chars, bool &end_of_file);
+    char *First_Token(char *line, const char *seps, char *&next, uint32_t &hash);
+
+    bool Is_Loaded() const { return m_data != nullptr; }
+    int Get_Size() const { return m_size; }
+
+    static char *Tokenize(char *str, const char *seps, char *&next);
+
+private:
+    struct LineInfo
+    {
+        int offset; // Into m_data, or for lines that had to be copied -1 - the offset into m_copiedLines.
+        int token_start; // Relative to the line, -1 if the line has no tokens.
+        int token_end;
+        uint32_t token_hash;
+    };
+
+    INIFileBuffer(INIFileBuffer const &);
+    INIFileBuffer &operator=(INIFileBuffer const &);
+
+    char *Line_Text(LineInfo const &line)
+    {
+        return line.offset >= 0 ? m_data + line.offset : &m_copiedLines[-1 - line.offset];
+    }
+
+    char *m_data;
+    int m_size;
+    int m_readPos;
+    std::vector<LineInfo> m_lines;
+    std::vector<char> m_copiedLines;
+    int m_nextLine;
+    bool m_isSplit;
+    const char *m_splitSeps;
+};
+
+/**
+ * Reentrant strtok, next holds the position strtok would keep in its hidden state.
+ */
+inline char *INIFileBuffer::Tokenize(char *str, const char *seps, char *&next)
+{
+    char *token = str != nullptr ? str : next;
+
+    if (token == nullptr) {
+        return nullptr;
+    }
+
+    // One bit per character, far cheaper to set up than the tables strspn and strcspn build on every call.
+    uint32_t sep_bits[8] = {};
+
+    for (; *seps != '\0'; ++seps) {
+        sep_bits[uint8_t(*seps) >> 5] |= 1u << (uint8_t(*seps) & 31);
+    }
+
+    while (*token != '\0' && (sep_bits[uint8_t(*token) >> 5] & (1u << (uint8_t(*token) & 31))) != 0) {
+        ++token;
+    }
+
+    if (*token == '\0') {
+        next = token;
+
+        return nullptr;
+    }
+
+    // The null terminator counts as a separator for finding the end of the token.
+    sep_bits[0] |= 1;
+    char *end = token + 1;
+
+    while ((sep_bits[uint8_t(*end) >> 5] & (1u << (uint8_t(*end) & 31))) == 0) {
+        ++end;
+    }
+
+    if (*end != '\0') {
+        *end = '\0';
+        next = end + 1;
+    } else {
+        next = end;
+    }
+
+    return token;
+}
@@ -0,0 +1,138 @@
+/**
+ * @file
+ *
+ * @author OmniBlade
+ *
+ * @brief Hashed lookup of block and field names in INI parse tables. (Thyme Feature)
+ *
+ * @copyright Thyme is free software: you can redistribute it and/or
+ *            modify it under the terms of the GNU General Public License
+ *            as published by the Free Software Foundation, either version
+ *            2 of the License, or (at your option) any later version.
+ *            A full copy of the GNU General Public License can be found in
+ *            LICENSE
+ */
+#include "iniparseindex.h"
+#include "critsection.h"
+#include "ini.h"
+#include <cstring>
+#include <unordered_map>
+
+namespace
+{
+SimpleCriticalSectionClass &Get_Index_Lock()
+{
+    static SimpleCriticalSectionClass s_indexLock;
+    return s_indexLock;
+}
+
+// Function local so tables can be indexed during static initialisation.
+std::unordered_map<const void *, INIParseIndex *> &Get_Indices()
+{
+    static std::unordered_map<const void *, INIParseIndex *> s_indices;
+    return s_indices;
+}
+} // namespace
+
+const INIParseIndex &INIParseIndex::Get(const BlockParse *table)
+{
+    ScopedCriticalSectionClass cs(&Get_Index_Lock());
+    INIParseIndex *&index = Get_Indices()[table];
+
+    if (index == nullptr) {
+        index = new INIParseIndex;
+        index->Build(table);
+    }
+
+    return *index;
+}
+
+const INIParseIndex &INIParseIndex::Get(const FieldParse *table)
+{
+    ScopedCriticalSectionClass cs(&Get_Index_Lock());
+    INIParseIndex *&index = Get_Indices()[table];
+
+    if (index == nullptr) {
+        index = new INIParseIndex;
+        index->Build(table);
+    }
+
+    return *index;
+}
+
+/**
+ * Returns the index of the entry matching the interned token, or -1 if there is none. The hash is Hash() of the token.
+ */
+int INIParseIndex::Find(InternedString token, uint32_t hash) const
+{
+    if (m_slots.empty()) {
+        return -1;
+    }
+
+    for (uint32_t i = hash & m_mask;; i = (i + 1) & m_mask) {
+        Slot const &slot = m_slots[i];
+
+        if (slot.index == -1) {
+            return -1;
+        }
+
+        if (slot.token == token) {
+            return slot.index;
+        }
+    }
+}
+
+/**
+ * Returns the index of the entry matching the token exactly, or -1 if there is none.
+ */
+int INIParseIndex::Find(const char *token, uint32_t hash) const
+{
+    InternedString interned;
+
+    // Every table token is interned when its index is built, so a token that isn't interned can't match.
+    if (!InternedString::Find(token, hash, interned)) {
+        return -1;
+    }
+
+    return Find(interned, hash);
+}
+
+template<typename T> void INIParseIndex::Build(const T *table)
+{
+    for (m_terminator = 0; table[m_terminator].token != nullptr;) {
+        ++m_terminator;
+    }
+
+    if (m_terminator == 0) {
+        return;
+    }
+
+    uint32_t slot_count = 8;
+
+    while (slot_count < uint32_t(m_terminator) * 2) {
+        slot_count *= 2;
+    }
+
+    Slot empty = { -1, InternedString() };
+    m_slots.assign(slot_count, empty);
+    m_mask = slot_count - 1;
+
+    for (int i = 0; i < m_terminator; ++i) {
+        InternedString token(table[i].token);
+        uint32_t hash = Hash(table[i].token);
+
+        // The linear search always found the first of any repeated token, so later copies are left out.
+        if (Find(token, hash) != -1) {
+            continue;
+        }
+
+        uint32_t pos = hash & m_mask;
+
+        while (m_slots[pos].index != -1) {
+            pos = (pos + 1) & m_mask;
+        }
+
+        m_slots[pos].index = i;
+        m_slots[pos].token = token;
+    }
+}
@@ -0,0 +1,58 @@
+/**
+ * @file
+ *
+ * @author OmniBlade
+ *
+ * @brief Hashed lookup of block and field names in INI parse tables. (Thyme Feature)
+ *
+ * @copyright Thyme is free software: you can redistribute it and/or
+ *            modify it under the terms of the GNU General Public License
+ *            as published by the Free Software Foundation, either version
+ *            2 of the License, or (at your option) any later version.
+ *            A full copy of the GNU General Public License can be found in
+ *            LICENSE
+ */
+#pragma once
+
+#include "always.h"
+#include "internedstring.h"
+#include <vector>
+
+struct BlockParse;
+struct FieldParse;
+
+// Open addressed hash of the tokens in one null terminated parse table, built the first time the table is looked up
+// and kept for the life of the program as the tables are all static. The table is kept at most half full so a lookup
+// is one hash and usually a single string compare. The token hash doesn't depend on the table so it can be computed
+// once and used to search several tables. The tokens are interned so a token that has been looked up once is matched by
+// pointer against every table.
+class INIParseIndex
+{
+public:
+    static const INIParseIndex &Get(const BlockParse *table);
+    static const INIParseIndex &Get(const FieldParse *table);
+
+    int Find(InternedString token, uint32_t hash) const;
+    int Find(const char *token, uint32_t hash) const;
+    int Find(const char *token) const { return Find(token, Hash(token)); }
+
+    // Index of the terminating entry, equal to the number of entries before it.
+    int Get_Terminator() const { return m_terminator; }
+
+    static uint32_t Hash(const char *token) { return InternedString::Hash(token); }
+
+private:
+    struct Slot
+    {
+        int index;
+        InternedString token;
+    };
+
+    INIParseIndex() : m_mask(0), m_terminator(0) {}
+
+    template<typename T> void Build(const T *table);
+
+    std::vector<Slot> m_slots;
+    uint32_t m_mask;
+    int m_terminator;
+};
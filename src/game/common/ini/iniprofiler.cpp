@@ -0,0 +1,180 @@
+/**
+ * @file
+ *
+ * @author OmniBlade
+ *
+ * @brief Timing of INI loading by file and by block type. (Thyme Feature)
+ *
+ * @copyright Thyme is free software: you can redistribute it and/or
+ *            modify it under the terms of the GNU General Public License
+ *            as published by the Free Software Foundation, either version
+ *            2 of the License, or (at your option) any later version.
+ *            A full copy of the GNU General Public License can be found in
+ *            LICENSE
+ */
+#include "iniprofiler.h"
+#include "mempool.h"
+#include "statsmap.h"
+#include <chrono>
+#include <cinttypes>
+#include <cstdio>
+
+namespace
+{
+const char PROFILE_REPORT_FILE[] = "INIProfile.txt";
+
+Thyme::StatsMap<INIProfiler::Record> s_fileRecords;
+Thyme::StatsMap<INIProfiler::Record> s_blockRecords;
+
+void Add_To_Record(
+    Thyme::StatsMap<INIProfiler::Record> &records, const char *name, int lines, uint64_t micros, uint64_t allocations)
+{
+    ScopedCriticalSectionClass cs(records.Get_Lock());
+    bool added;
+    INIProfiler::Record &record = records.Find_Or_Add(name, added);
+
+    if (added) {
+        record.name = name;
+    }
+
+    ++record.count;
+    record.lines += lines;
+    record.micros += micros;
+    record.allocations += allocations;
+}
+
+// Slowest first so the interesting end of the report is at the top.
+bool Record_Slower(INIProfiler::Record const &a, INIProfiler::Record const &b)
+{
+    return a.micros != b.micros ? a.micros > b.micros : a.name < b.name;
+}
+
+void Write_Section(FILE *fp, const char *title, const char *count_name, std::vector<INIProfiler::Record> const &records)
+{
+    INIProfiler::Record total = {};
+
+    for (auto it = records.begin(); it != records.end(); ++it) {
+        total.count += it->count;
+        total.lines += it->lines;
+        total.micros += it->micros;
+        total.allocations += it->allocations;
+    }
+
+    fprintf(fp, "%-48s %8s %8s %10s %6s %10s\n", title, count_name, "Lines", "ms", "%", "Allocs");
+
+    for (auto it = records.begin(); it != records.end(); ++it) {
+        fprintf(fp,
+            "%-48s %8u %8u %10.2f %6.1f %10" PRIu64 "\n",
+            it->name.c_str(),
+            it->count,
+            it->lines,
+            it->micros / 1000.0,
+            total.micros != 0 ? it->micros * 100.0 / total.micros : 0.0,
+            it->allocations);
+    }
+
+    fprintf(fp,
+        "%-48s %8u %8u %10.2f %6.1f %10" PRIu64 "\n\n",
+        "Total",
+        total.count,
+        total.lines,
+        total.micros / 1000.0,
+        100.0,
+        total.allocations);
+}
+} // namespace
+
+bool INIProfiler::s_enabled;
+
+/**
+ * Also turns on the memory pools' per thread allocation counts, they cost every allocation a little so are off otherwise.
+ */
+void INIProfiler::Enable()
+{
+#ifndef GAME_DLL
+    MemoryPool::Set_Thread_Allocation_Counting(true);
+#endif
+    s_enabled = true;
+}
+
+void INIProfiler::Disable()
+{
+    s_enabled = false;
+#ifndef GAME_DLL
+    MemoryPool::Set_Thread_Allocation_Counting(false);
+#endif
+}
+
+void INIProfiler::Reset()
+{
+    s_fileRecords.Clear();
+    s_blockRecords.Clear();
+}
+
+void INIProfiler::Record_File(const char *filename, int lines, uint64_t micros, uint64_t allocations)
+{
+    Add_To_Record(s_fileRecords, filename, lines, micros, allocations);
+}
+
+void INIProfiler::Record_Block(const char *block, int lines, uint64_t micros, uint64_t allocations)
+{
+    Add_To_Record(s_blockRecords, block, lines, micros, allocations);
+}
+
+void INIProfiler::Get_File_Records(std::vector<Record> &records)
+{
+    s_fileRecords.Get_Sorted(records, Record_Slower);
+}
+
+void INIProfiler::Get_Block_Records(std::vector<Record> &records)
+{
+    s_blockRecords.Get_Sorted(records, Record_Slower);
+}
+
+/**
+ * Files then block types, each slowest first. File times include reading the file and every block in it.
+ */
+bool INIProfiler::Write_Report(const char *filename)
+{
+    FILE *fp = Thyme::Open_Stats_File(filename, "INI profile");
+
+    if (fp == nullptr) {
+        return false;
+    }
+
+    std::vector<Record> records;
+    Get_File_Records(records);
+    Write_Section(fp, "File", "Loads", records);
+    Get_Block_Records(records);
+    Write_Section(fp, "Block", "Blocks", records);
+    fclose(fp);
+
+    return true;
+}
+
+void INIProfiler::Dump()
+{
+    if (!s_enabled) {
+        return;
+    }
+
+    Write_Report(PROFILE_REPORT_FILE);
+}
+
+uint64_t INIProfiler::Get_Micros()
+{
+    return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+}
+
+/**
+ * Allocations made by the calling thread so far, INI is only parsed on one thread at a time.
+ */
+uint64_t INIProfiler::Get_Allocation_Count()
+{
+#ifndef GAME_DLL
+    return MemoryPool::Get_Thread_Allocation_Count();
+#else
+    return 0;
+#endif
+}
@@ -0,0 +1,94 @@
+/**
+ * @file
+ *
+ * @author OmniBlade
+ *
+ * @brief Timing of INI loading by file and by block type. (Thyme Feature)
+ *
+ * @copyright Thyme is free software: you can redistribute it and/or
+ *            modify it under the terms of the GNU General Public License
+ *            as published by the Free Software Foundation, either version
+ *            2 of the License, or (at your option) any later version.
+ *            A full copy of the GNU General Public License can be found in
+ *            LICENSE
+ */
+#pragma once
+
+#include "always.h"
+#include <string>
+#include <vector>
+
+// Totals up the time, lines and memory allocations spent loading each INI file and parsing each type of block so the
+// expensive ones stand out. Disabled by default, INI only checks a flag until enabled. Records are kept in a
+// StatsMap like FileIOStats so the game's memory manager doesn't count the profiler's own allocations.
+class INIProfiler
+{
+public:
+    struct Record
+    {
+        std::string name;
+        uint32_t count; // Times the file was loaded or blocks of the type were parsed.
+        uint32_t lines;
+        uint64_t micros;
+        uint64_t allocations;
+    };
+
+    static void Enable();
+    static void Disable();
+    static void Reset();
+    static bool Is_Enabled() { return s_enabled; }
+
+    static void Record_File(const char *filename, int lines, uint64_t micros, uint64_t allocations);
+    static void Record_Block(const char *block, int lines, uint64_t micros, uint64_t allocations);
+
+    static void Get_File_Records(std::vector<Record> &records);
+    static void Get_Block_Records(std::vector<Record> &records);
+
+    static bool Write_Report(const char *filename);
+    static void Dump();
+
+    static uint64_t Get_Micros();
+    static uint64_t Get_Allocation_Count();
+
+private:
+    static bool s_enabled;
+};
+
+// Times loading one file or parsing one block when the profiler is enabled, does nothing otherwise.
+class INIProfileTimer
+{
+public:
+    INIProfileTimer(const char *name) :
+        m_active(INIProfiler::Is_Enabled()),
+        m_start(m_active ? INIProfiler::Get_Micros() : 0),
+        m_allocations(m_active ? INIProfiler::Get_Allocation_Count() : 0)
+    {
+        // Block names point into the line being parsed which doesn't last as long as the block.
+        if (m_active) {
+            m_name = name;
+        }
+    }
+
+    void File_Loaded(int lines) const
+    {
+        if (m_active) {
+            INIProfiler::Record_File(m_name.c_str(), lines, INIProfiler::Get_Micros() - m_start, Allocations());
+        }
+    }
+
+    void Block_Parsed(int lines) const
+    {
+        if (m_active) {
+            INIProfiler::Record_Block(m_name.c_str(), lines, INIProfiler::Get_Micros() - m_start, Allocations());
+        }
+    }
+
+private:
+    uint64_t Allocations() const { return INIProfiler::Get_Allocation_Count() - m_allocations; }
+
+private:
+    bool m_active;
+    uint64_t m_start;
+    uint64_t m_allocations;
+    std::string m_name;
+};
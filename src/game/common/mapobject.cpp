@@ -167,16 +167,18 @@ void MapObject::Verify_Valid_Unique_ID()
         o = o->Get_Next();
     }
 
-    const char *str;
+    // The names are returned by value, keep the string alive while pointing into it.
+    Utf8String name;
 
     if (Get_Thing_Template()) {
-        str = Get_Thing_Template()->Get_Name().Str();
+        name = Get_Thing_Template()->Get_Name();
     } else if (Is_Waypoint()) {
-        str = Get_Waypoint_Name().Str();
+        name = Get_Waypoint_Name();
     } else {
-        str = Get_Name().Str();
+        name = Get_Name();
     }
 
+    const char *str = name.Str();
     const char *str2 = str;
 
     while (*str) {
@@ -215,16 +217,17 @@ void MapObject::Fast_Assign_All_Unique_IDs()
     while (count) {
         MapObject *m = objs.back();
 
-        const char *str;
+        Utf8String name;
 
         if (m->Get_Thing_Template()) {
-            str = m->Get_Thing_Template()->Get_Name().Str();
+            name = m->Get_Thing_Template()->Get_Name();
         } else if (m->Is_Waypoint()) {
-            str = m->Get_Waypoint_Name().Str();
+            name = m->Get_Waypoint_Name();
         } else {
-            str = m->Get_Name().Str();
+            name = m->Get_Name();
         }
 
+        const char *str = name.Str();
         const char *str2 = str;
 
         while (*str) {
@@ -13,9 +13,8 @@
  *            LICENSE
  */
 #include "namekeygenerator.h"
-#include <cctype>
-
-using std::tolower;
+#include "staticnamekey.h"
+#include <captainslog.h>
 
 #ifndef GAME_DLL
 NameKeyGenerator *g_theNameKeyGenerator = nullptr;
@@ -23,7 +22,9 @@ NameKeyGenerator *g_theNameKeyGenerator = nullptr;
 
 NameKeyGenerator::NameKeyGenerator() : m_nextID(NAMEKEY_INVALID)
 {
-    memset(m_sockets, 0, sizeof(m_sockets));
+    for (int i = 0; i < SOCKET_COUNT; ++i) {
+        m_sockets[i] = nullptr;
+    }
 }
 
 NameKeyGenerator::~NameKeyGenerator()
@@ -36,6 +37,9 @@ void NameKeyGenerator::Init()
     Free_Sockets();
 
     m_nextID = (NameKeyType)1;
+#ifndef GAME_DLL
+    StaticNameKey::Seed_Generator(*this);
+#endif
 }
 
 void NameKeyGenerator::Reset()
@@ -43,10 +47,20 @@ void NameKeyGenerator::Reset()
     Free_Sockets();
 
     m_nextID = (NameKeyType)1;
+#ifndef GAME_DLL
+    StaticNameKey::Seed_Generator(*this);
+#endif
 }
 
 Utf8String NameKeyGenerator::Key_To_Name(NameKeyType key)
 {
+#ifndef GAME_DLL
+    ScopedCriticalSectionClass cs(&m_addLock);
+
+    if (key > NAMEKEY_INVALID && key < static_cast<int>(m_keyToBucket.size())) {
+        return m_keyToBucket[key]->m_nameString;
+    }
+#else
     // Find the bucket that matches the provided key if it exists.
     Bucket *bucket;
 
@@ -61,68 +75,101 @@ Utf8String NameKeyGenerator::Key_To_Name(NameKeyType key)
             bucket = bucket->m_nextInSocket;
         }
     }
+#endif
 
     return Utf8String::s_emptyString;
 }
 
 NameKeyType NameKeyGenerator::Name_To_Lower_Case_Key(const char *name)
 {
-    // Calculate a simple hash of the name
-    unsigned int socket_hash = 0;
+    return Hashed_Name_To_Lower_Case_Key(name, Lower_Case_Name_Key_Hash(name));
+}
 
-    for (const char *c = name; *c != '\0'; ++c) {
-        socket_hash = (33 * socket_hash) + tolower(*c);
-    }
+NameKeyType NameKeyGenerator::Name_To_Key(const char *name)
+{
+    return Hashed_Name_To_Key(name, Name_Key_Hash(name));
+}
 
+/**
+ * Name_To_Key for callers that already have the Name_Key_Hash of the name, usually from the compiler.
+ */
+NameKeyType NameKeyGenerator::Hashed_Name_To_Key(const char *name, unsigned int hash)
+{
     // Make sure the hash falls within range of sockets
-    socket_hash %= SOCKET_COUNT;
+    unsigned int socket_hash = hash % SOCKET_COUNT;
 
     Bucket *bucket;
 
-    for (bucket = m_sockets[socket_hash]; bucket != nullptr; bucket = bucket->m_nextInSocket) {
-        if (strcasecmp(bucket->m_nameString.Str(), name) == 0) {
+    for (bucket = Get_Socket(socket_hash); bucket != nullptr; bucket = bucket->m_nextInSocket) {
+        if (strcmp(bucket->m_nameString.Str(), name) == 0) {
             return bucket->m_key;
         }
     }
 
-    bucket = NEW_POOL_OBJ(Bucket);
-    bucket->m_key = (NameKeyType)m_nextID++;
-    bucket->m_nameString = name;
-    bucket->m_nextInSocket = m_sockets[socket_hash];
-    m_sockets[socket_hash] = bucket;
-
-    // Debug info suggests there is some kind of count here to check the longest
-    // linked list of buckets and log if its too large and the socket count might
-    // need increasing.
-
-    return bucket->m_key;
+    return Add_Name(name, socket_hash, false);
 }
 
-NameKeyType NameKeyGenerator::Name_To_Key(const char *name)
+/**
+ * Name_To_Lower_Case_Key for callers that already have the Lower_Case_Name_Key_Hash of the name.
+ */
+NameKeyType NameKeyGenerator::Hashed_Name_To_Lower_Case_Key(const char *name, unsigned int hash)
 {
-    // Calculate a simple hash of the name
-    unsigned int socket_hash = 0;
+    // Make sure the hash falls within range of sockets
+    unsigned int socket_hash = hash % SOCKET_COUNT;
+
+    Bucket *bucket;
 
-    for (const char *c = name; *c != '\0'; ++c) {
-        socket_hash = (33 * socket_hash) + *c;
+    for (bucket = Get_Socket(socket_hash); bucket != nullptr; bucket = bucket->m_nextInSocket) {
+        if (strcasecmp(bucket->m_nameString.Str(), name) == 0) {
+            return bucket->m_key;
+        }
     }
 
-    // Make sure the hash falls within range of sockets
-    socket_hash %= SOCKET_COUNT;
+    return Add_Name(name, socket_hash, true);
+}
 
-    Bucket *bucket;
+void NameKeyGenerator::Parse_String_As_NameKeyType(INI *ini, void *formal, void *store, void const *userdata)
+{
+    *static_cast<NameKeyType *>(store) = g_theNameKeyGenerator->Name_To_Key(ini->Get_Next_Token());
+}
 
-    for (bucket = m_sockets[socket_hash]; bucket != nullptr; bucket = bucket->m_nextInSocket) {
-        if (strcmp(bucket->m_nameString.Str(), name) == 0) {
+Bucket *NameKeyGenerator::Get_Socket(unsigned int socket_hash) const
+{
+#ifndef GAME_DLL
+    return m_sockets[socket_hash].load(std::memory_order_acquire);
+#else
+    return m_sockets[socket_hash];
+#endif
+}
+
+/**
+ * Slow path of the lookups, safe to call from several threads at once.
+ */
+NameKeyType NameKeyGenerator::Add_Name(const char *name, unsigned int socket_hash, bool no_case)
+{
+#ifndef GAME_DLL
+    ScopedCriticalSectionClass cs(&m_addLock);
+
+    // Another thread may have added the name since the caller looked.
+    for (Bucket *bucket = Get_Socket(socket_hash); bucket != nullptr; bucket = bucket->m_nextInSocket) {
+        if ((no_case ? strcasecmp(bucket->m_nameString.Str(), name) : strcmp(bucket->m_nameString.Str(), name)) == 0) {
             return bucket->m_key;
         }
     }
+#endif
 
-    bucket = NEW_POOL_OBJ(Bucket);
+    Bucket *bucket = NEW_POOL_OBJ(Bucket);
     bucket->m_key = (NameKeyType)m_nextID++;
     bucket->m_nameString = name;
-    bucket->m_nextInSocket = m_sockets[socket_hash];
+    bucket->m_nextInSocket = Get_Socket(socket_hash);
+
+#ifndef GAME_DLL
+    captainslog_dbgassert(bucket->m_key == static_cast<int>(m_keyToBucket.size()), "Key index out of step with keys.");
+    m_keyToBucket.push_back(bucket);
+    m_sockets[socket_hash].store(bucket, std::memory_order_release);
+#else
     m_sockets[socket_hash] = bucket;
+#endif
 
     // Debug info suggests there is some kind of count here to check the longest
     // linked list of buckets and log if its too large and the socket count might
@@ -131,18 +178,16 @@ NameKeyType NameKeyGenerator::Name_To_Key(const char *name)
     return bucket->m_key;
 }
 
-void NameKeyGenerator::Parse_String_As_NameKeyType(INI *ini, void *formal, void *store, void const *userdata)
-{
-    *static_cast<NameKeyType *>(store) = g_theNameKeyGenerator->Name_To_Key(ini->Get_Next_Token());
-}
-
+/**
+ * Not safe to call while other threads are looking up names.
+ */
 void NameKeyGenerator::Free_Sockets()
 {
     // Go over sockets and free them.
     for (int i = 0; i < SOCKET_COUNT; ++i) {
         // Delete linked list of entries under given key.
-        if (m_sockets[i] != nullptr) {
-            Bucket *bucket = m_sockets[i];
+        if (Get_Socket(i) != nullptr) {
+            Bucket *bucket = Get_Socket(i);
             Bucket *next;
 
             do {
@@ -154,6 +199,11 @@ void NameKeyGenerator::Free_Sockets()
 
         m_sockets[i] = nullptr;
     }
+
+#ifndef GAME_DLL
+    // Keys start at 1, the first entry stands in for NAMEKEY_INVALID.
+    m_keyToBucket.assign(1, nullptr);
+#endif
 }
 
 NameKeyType Name_To_Key(const char *name)
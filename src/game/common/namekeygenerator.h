@@ -21,6 +21,12 @@
 #include "mempoolobj.h"
 #include "subsysteminterface.h"
 
+#ifndef GAME_DLL
+#include "critsection.h"
+#include <atomic>
+#include <vector>
+#endif
+
 enum NameKeyType : int32_t
 {
     NAMEKEY_INVALID = 0,
@@ -29,6 +35,27 @@ enum NameKeyType : int32_t
 
 DEFINE_ENUMERATION_OPERATORS(NameKeyType);
 
+// The hash Name_To_Key picks a socket with, constexpr so literal names can be hashed by the compiler. Passing the hash
+// of the start of a name carries on from it, so numbered names only need their number hashing.
+constexpr unsigned int Name_Key_Hash(const char *name, unsigned int hash = 0)
+{
+    for (const char *c = name; *c != '\0'; ++c) {
+        hash = (33 * hash) + *c;
+    }
+
+    return hash;
+}
+
+// The hash Name_To_Lower_Case_Key picks a socket with, folds letters the same way tolower does in the C locale.
+constexpr unsigned int Lower_Case_Name_Key_Hash(const char *name, unsigned int hash = 0)
+{
+    for (const char *c = name; *c != '\0'; ++c) {
+        hash = (33 * hash) + (*c >= 'A' && *c <= 'Z' ? *c - 'A' + 'a' : *c);
+    }
+
+    return hash;
+}
+
 class Bucket : public MemoryPoolObject
 {
     IMPLEMENT_NAMED_POOL(Bucket, NameKeyBucketPool);
@@ -65,15 +92,28 @@ public:
     Utf8String Key_To_Name(NameKeyType key);
     NameKeyType Name_To_Lower_Case_Key(const char *name);
     NameKeyType Name_To_Key(const char *name);
+    NameKeyType Hashed_Name_To_Key(const char *name, unsigned int hash);
+    NameKeyType Hashed_Name_To_Lower_Case_Key(const char *name, unsigned int hash);
 
     static void Parse_String_As_NameKeyType(INI *ini, void *formal, void *store, void const *userdata);
 
 private:
     void Free_Sockets();
+    Bucket *Get_Socket(unsigned int socket_hash) const;
+    NameKeyType Add_Name(const char *name, unsigned int socket_hash, bool no_case);
 
 private:
+#ifndef GAME_DLL
+    // Lookups walk the sockets without locking, new buckets are only published once fully built.
+    std::atomic<Bucket *> m_sockets[SOCKET_COUNT];
+#else
     Bucket *m_sockets[SOCKET_COUNT];
+#endif
     NameKeyType m_nextID;
+#ifndef GAME_DLL
+    std::vector<Bucket *> m_keyToBucket; // Indexed by key for Key_To_Name.
+    mutable SimpleCriticalSectionClass m_addLock;
+#endif
 };
 
 NameKeyType Name_To_Key(const char *name);
@@ -95,8 +95,41 @@ StaticNameKey g_teamVeterancyKey("teamVeterancy");
 NameKeyType StaticNameKey::Key()
 {
     if (m_key == NAMEKEY_INVALID && g_theNameKeyGenerator != nullptr) {
+#ifndef GAME_DLL
+        m_key = g_theNameKeyGenerator->Hashed_Name_To_Key(m_name, m_hash);
+#else
         m_key = g_theNameKeyGenerator->Name_To_Key(m_name);
+#endif
     }
 
     return m_key;
 }
+
+#ifndef GAME_DLL
+namespace
+{
+struct SeedName
+{
+    const char *name;
+    unsigned int hash;
+};
+
+// Every literal name the source passes to Name_To_Key or a StaticNameKey, collected by StaticNameKeys.cmake.
+#define STATIC_NAME_KEY(name) { name, Name_Key_Hash(name) },
+constexpr SeedName s_seedNames[] = {
+#include "staticnamekeys.inl"
+};
+#undef STATIC_NAME_KEY
+} // namespace
+
+/**
+ * Adds the literal names first after every reset so they always get the same keys, keys cached in a StaticNameKey or a
+ * function static then stay valid for the life of the program.
+ */
+void StaticNameKey::Seed_Generator(NameKeyGenerator &generator)
+{
+    for (size_t i = 0; i < ARRAY_SIZE(s_seedNames); ++i) {
+        generator.Hashed_Name_To_Key(s_seedNames[i].name, s_seedNames[i].hash);
+    }
+}
+#endif
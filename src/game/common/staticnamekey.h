@@ -20,16 +20,27 @@
 class StaticNameKey
 {
 public:
+#ifndef GAME_DLL
+    constexpr StaticNameKey(const char *name) : m_key(NAMEKEY_INVALID), m_name(name), m_hash(Name_Key_Hash(name)) {}
+#else
     StaticNameKey(const char *name) : m_key(NAMEKEY_INVALID), m_name(name) {}
+#endif
 
     operator NameKeyType() { return Key(); }
 
     NameKeyType Key();
     const char *Name() { return m_name; }
 
+#ifndef GAME_DLL
+    static void Seed_Generator(NameKeyGenerator &generator);
+#endif
+
 private:
     NameKeyType m_key;
     const char *m_name;
+#ifndef GAME_DLL
+    unsigned int m_hash; // Worked out by the compiler for the global keys.
+#endif
 };
 
 #ifdef GAME_DLL
@@ -0,0 +1,95 @@
+/**
+ * @file
+ *
+ * @author OmniBlade
+ *
+ * @brief Bounded cache of decompressed archive entries. (Thyme Feature)
+ *
+ * @copyright Thyme is free software: you can redistribute it and/or
+ *            modify it under the terms of the GNU General Public License
+ *            as published by the Free Software Foundation, either version
+ *            2 of the License, or (at your option) any later version.
+ *            A full copy of the GNU General Public License can be found in
+ *            LICENSE
+ */
+#include "archiveblobcache.h"
+#include <cstring>
+
+namespace Thyme
+{
+
+/**
+ * Copies a cached blob into dst, the size must match what was cached for the blob to be used.
+ */
+bool ArchiveBlobCache::Find(Utf8String const &archive, int offset, char *dst, int size)
+{
+    ScopedCriticalSectionClass cs(&m_lock);
+    auto it = m_lookup.find(BlobKey(archive, offset));
+
+    if (it == m_lookup.end() || it->second->size != size) {
+        ++m_misses;
+        return false;
+    }
+
+    // Move to the front so it is the last to be evicted.
+    m_blobs.splice(m_blobs.begin(), m_blobs, it->second);
+    memcpy(dst, it->second->data, size);
+    ++m_hits;
+
+    return true;
+}
+
+void ArchiveBlobCache::Insert(Utf8String const &archive, int offset, const char *data, int size)
+{
+    ScopedCriticalSectionClass cs(&m_lock);
+
+    // Blobs that could never fit would just flush everything else out.
+    if (size <= 0 || size_t(size) > m_budget) {
+        return;
+    }
+
+    BlobKey key(archive, offset);
+
+    if (m_lookup.find(key) != m_lookup.end()) {
+        return;
+    }
+
+    Trim(m_budget - size);
+
+    m_blobs.push_front(Blob(key));
+    Blob &blob = m_blobs.front();
+    blob.data = new char[size];
+    blob.size = size;
+    memcpy(blob.data, data, size);
+    m_lookup[key] = m_blobs.begin();
+    m_used += size;
+}
+
+void ArchiveBlobCache::Clear()
+{
+    ScopedCriticalSectionClass cs(&m_lock);
+    Trim(0);
+}
+
+void ArchiveBlobCache::Set_Budget(size_t budget)
+{
+    ScopedCriticalSectionClass cs(&m_lock);
+    m_budget = budget;
+    Trim(m_budget);
+}
+
+/**
+ * Evicts the least recently used blobs until no more than budget bytes are held.
+ */
+void ArchiveBlobCache::Trim(size_t budget)
+{
+    while (m_used > budget && !m_blobs.empty()) {
+        Blob &blob = m_blobs.back();
+        m_used -= blob.size;
+        delete[] blob.data;
+        m_lookup.erase(blob.key);
+        m_blobs.pop_back();
+    }
+}
+
+} // namespace Thyme
@@ -0,0 +1,87 @@
+/**
+ * @file
+ *
+ * @author OmniBlade
+ *
+ * @brief Bounded cache of decompressed archive entries. (Thyme Feature)
+ *
+ * @copyright Thyme is free software: you can redistribute it and/or
+ *            modify it under the terms of the GNU General Public License
+ *            as published by the Free Software Foundation, either version
+ *            2 of the License, or (at your option) any later version.
+ *            A full copy of the GNU General Public License can be found in
+ *            LICENSE
+ */
+#pragma once
+
+#include "always.h"
+#include "asciistring.h"
+#include "critsection.h"
+#include <list>
+#include <map>
+
+namespace Thyme
+{
+
+// Holds the decompressed contents of archive entries keyed by archive and offset so opening the same compressed entry
+// again costs a copy rather than another decode. The least recently used blobs are dropped once the total size goes
+// over the budget. Safe to use from several threads.
+class ArchiveBlobCache
+{
+    struct BlobKey
+    {
+        BlobKey(Utf8String const &archive_name, int pos) : archive(archive_name), offset(pos) {}
+
+        bool operator<(BlobKey const &that) const
+        {
+            return offset != that.offset ? offset < that.offset : archive.Compare(that.archive) < 0;
+        }
+
+        Utf8String archive;
+        int offset;
+    };
+
+    struct Blob
+    {
+        Blob(BlobKey const &blob_key) : key(blob_key), data(nullptr), size(0) {}
+
+        BlobKey key;
+        char *data;
+        int size;
+    };
+
+    typedef std::list<Blob> BlobList;
+
+public:
+    ArchiveBlobCache(size_t budget = 0) : m_budget(budget), m_used(0), m_hits(0), m_misses(0) {}
+    ~ArchiveBlobCache() { Clear(); }
+
+    bool Find(Utf8String const &archive, int offset, char *dst, int size);
+    void Insert(Utf8String const &archive, int offset, const char *data, int size);
+    void Clear();
+
+    void Set_Budget(size_t budget);
+    size_t Get_Budget() const { return m_budget; }
+    size_t Get_Used() const { return m_used; }
+    int Get_Count() const { return int(m_lookup.size()); }
+    uint32_t Get_Hits() const { return m_hits; }
+    uint32_t Get_Misses() const { return m_misses; }
+
+private:
+    void Trim(size_t budget);
+
+    // Not copyable, owns the blob buffers.
+    ArchiveBlobCache(const ArchiveBlobCache &that) = delete;
+    ArchiveBlobCache &operator=(const ArchiveBlobCache &that) = delete;
+
+private:
+    SimpleCriticalSectionClass m_lock;
+    BlobList m_blobs; // Most recently used first.
+    std::map<BlobKey, BlobList::iterator> m_lookup;
+    size_t m_budget;
+    size_t m_used;
+    uint32_t m_hits;
+    uint32_t m_misses;
+};
+
+} // namespace Thyme
@@ -13,42 +13,16 @@
  *            LICENSE
  */
 #include "archivefile.h"
+#include "archiveindexcache.h"
 #include "file.h"
 bool Search_String_Matches(Utf8String string, Utf8String search);
 
 const ArchivedFileInfo *ArchiveFile::Get_Archived_File_Info(Utf8String const &filename) const
 {
-    Utf8String path = filename;
-    Utf8String token;
-    const DetailedArchivedDirectoryInfo *dirp = &m_archiveInfo;
-
-    // Lower case for matching and get first item of the path.
-    path.To_Lower();
-    path.Next_Token(&token, "\\/");
-
-    // Consider existence of '.' to indicate file as all should have .ext format
-    // checks the remaining path does not contain one to catch directories in path
-    // that do.
-    while (token.Find('.') == nullptr || path.Find('.') != nullptr) {
-        auto it = dirp->directories.find(token);
-
-        if (!(it != dirp->directories.end())) {
-            return nullptr;
-        }
-
-        dirp = &it->second;
-        path.Next_Token(&token, "\\/");
-    }
+    // The flat index resolves the path the same way walking m_archiveInfo one directory at a time would.
+    const ArchivedFileInfo *const *info = m_fileIndex.Find(filename.Str());
 
-    // Assuming we didn't run out of directories to try, find the file
-    // in the reached directory.
-    auto file_it = dirp->files.find(token);
-
-    if (file_it != dirp->files.end()) {
-        return &file_it->second;
-    }
-
-    return nullptr;
+    return info != nullptr ? *info : nullptr;
 }
 
 void ArchiveFile::Add_File(Utf8String const &filepath, ArchivedFileInfo const *info)
@@ -69,7 +43,9 @@ void ArchiveFile::Add_File(Utf8String const &filepath, ArchivedFileInfo const *i
         path.Next_Token(&token, "\\/");
     }
 
-    dirp->files[info->file_name] = *info;
+    ArchivedFileInfo &file_info = dirp->files[info->file_name];
+    file_info = *info;
+    m_fileIndex.Insert(filepath, info->file_name, &file_info, true);
 }
 
 void ArchiveFile::Attach_File(File *file)
@@ -82,6 +58,93 @@ void ArchiveFile::Attach_File(File *file)
     m_attachedFile = file;
 }
 
+namespace
+{
+// The directory name is written by the caller so the reader knows the map key before reading the contents.
+void Write_Directory(Thyme::ArchiveIndexWriter &writer, DetailedArchivedDirectoryInfo const &dir)
+{
+    writer.Write_Int(uint32_t(dir.files.size()));
+
+    for (auto it = dir.files.begin(); it != dir.files.end(); ++it) {
+        writer.Write_String(it->second.file_name);
+        writer.Write_Int(uint32_t(it->second.position));
+        writer.Write_Int(uint32_t(it->second.size));
+        writer.Write_Int(uint32_t(it->second.decoded_size));
+    }
+
+    writer.Write_Int(uint32_t(dir.directories.size()));
+
+    for (auto it = dir.directories.begin(); it != dir.directories.end(); ++it) {
+        writer.Write_String(it->second.name);
+        Write_Directory(writer, it->second);
+    }
+}
+
+// Entries were written in map order so each insert can be hinted at the end of the map.
+bool Read_Directory(Thyme::ArchiveIndexReader &reader,
+    DetailedArchivedDirectoryInfo &dir,
+    Utf8String const &dir_path,
+    Utf8String const &archive_name,
+    Thyme::ArchivePathIndex<const ArchivedFileInfo *> &index)
+{
+    uint32_t file_count = reader.Read_Int();
+
+    for (uint32_t i = 0; i < file_count && !reader.Failed(); ++i) {
+        ArchivedFileInfo info;
+        info.file_name = reader.Read_String();
+        info.archive_name = archive_name;
+        info.position = int(reader.Read_Int());
+        info.size = int(reader.Read_Int());
+        info.decoded_size = int(reader.Read_Int());
+        auto it = dir.files.insert(dir.files.end(), std::pair<const Utf8String, ArchivedFileInfo>(info.file_name, info));
+        index.Insert(dir_path, it->first, &it->second, true);
+    }
+
+    uint32_t dir_count = reader.Read_Int();
+
+    for (uint32_t i = 0; i < dir_count && !reader.Failed(); ++i) {
+        Utf8String name = reader.Read_String();
+
+        // Read straight into the inserted node rather than copying a populated subtree into the map.
+        auto it = dir.directories.insert(dir.directories.end(),
+            std::pair<const Utf8String, DetailedArchivedDirectoryInfo>(name, DetailedArchivedDirectoryInfo()));
+        it->second.name = name;
+
+        if (!Read_Directory(reader, it->second, dir_path + name + "\\", archive_name, index)) {
+            return false;
+        }
+    }
+
+    return !reader.Failed();
+}
+} // namespace
+
+/**
+ * Writes the archive's directory tree to an index cache so it can be restored without parsing the archive header.
+ */
+void ArchiveFile::Write_Index(Thyme::ArchiveIndexWriter &writer) const
+{
+    writer.Write_String(m_archiveInfo.name);
+    Write_Directory(writer, m_archiveInfo);
+}
+
+/**
+ * Restores a directory tree written by Write_Index, entries are associated with the archive file name passed in.
+ */
+bool ArchiveFile::Read_Index(Thyme::ArchiveIndexReader &reader, Utf8String const &archive_name)
+{
+    Clear_Files();
+    m_archiveInfo.name = reader.Read_String();
+
+    if (!Read_Directory(reader, m_archiveInfo, Utf8String(), archive_name, m_fileIndex)) {
+        Clear_Files();
+
+        return false;
+    }
+
+    return true;
+}
+
 void ArchiveFile::Get_File_List_In_Directory(Utf8String const &subdir,
     Utf8String const &dirpath,
     Utf8String const &filter,
@@ -15,6 +15,7 @@
 #pragma once
 
 #include "always.h"
+#include "archivepathindex.h"
 #include "asciistring.h"
 #include "file.h"
 #include "rtsutils.h"
@@ -24,6 +25,12 @@
 struct FileInfo;
 class File;
 
+namespace Thyme
+{
+class ArchiveIndexReader;
+class ArchiveIndexWriter;
+} // namespace Thyme
+
 class ArchivedFileInfo
 {
 public:
@@ -34,12 +41,14 @@ public:
         archive_name.Clear();
         position = 0;
         size = 0;
+        decoded_size = -1;
     }
 
     Utf8String file_name;
     Utf8String archive_name;
     int position;
     int size;
+    int decoded_size; // Thyme specific, size of the entry once decompressed, -1 if it is read as stored.
 };
 
 class DetailedArchivedDirectoryInfo
@@ -80,7 +89,14 @@ public:
 
     const ArchivedFileInfo *Get_Archived_File_Info(Utf8String const &filename) const;
     void Add_File(Utf8String const &filename, ArchivedFileInfo const *info);
+    void Clear_Files()
+    {
+        m_archiveInfo.Clear();
+        m_fileIndex.Clear();
+    }
     void Attach_File(File *file);
+    void Write_Index(Thyme::ArchiveIndexWriter &writer) const;
+    bool Read_Index(Thyme::ArchiveIndexReader &reader, Utf8String const &archive_name);
     void Get_File_List_In_Directory(Utf8String const &subdir,
         Utf8String const &dirpath,
         Utf8String const &filter,
@@ -96,4 +112,5 @@ protected:
 
     File *m_attachedFile;
     DetailedArchivedDirectoryInfo m_archiveInfo;
+    Thyme::ArchivePathIndex<const ArchivedFileInfo *> m_fileIndex; // Thyme specific, flat index into m_archiveInfo.
 };
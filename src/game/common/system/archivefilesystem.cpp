@@ -14,6 +14,8 @@
  */
 #include "archivefilesystem.h"
 #include "archivefile.h"
+#include "archiveindexcache.h"
+#include "fileiostats.h"
 #include "globaldata.h"
 #include <captainslog.h>
 
@@ -21,6 +23,10 @@
 ArchiveFileSystem *g_theArchiveFileSystem = nullptr;
 #endif
 
+// Decoded entries differ from the bytes the original game reads, which matters for anything checksummed such as maps, so
+// this is opt in with -decompressArchives.
+bool ArchiveFileSystem::s_decompressEntries = false;
+
 ArchiveFileSystem::~ArchiveFileSystem()
 {
     for (auto it = m_archiveFiles.begin(); it != m_archiveFiles.end(); ++it) {
@@ -36,43 +42,28 @@ File *ArchiveFileSystem::Open_File(const char *filename, int mode)
         return nullptr;
     }
 
-    ArchiveFile *file = m_archiveFiles[archive];
-    captainslog_dbgassert(file != nullptr, "Did not find matching archive file.");
-    return file->Open_File(filename, mode);
-}
-
-bool ArchiveFileSystem::Does_File_Exist(const char *filename) const
-{
-    Utf8String path = filename;
-    Utf8String token;
-    const ArchivedDirectoryInfo *dirp = &m_archiveDirInfo;
-
-    // Lower case for matching and get first item of the path.
-    path.To_Lower();
-    path.Next_Token(&token, "\\/");
-
-    // Consider existence of '.' to indicate file as all should have .ext format
-    // checks the remaining path does not contain one to catch directories in path
-    // that do.
-    while (token.Find('.') == nullptr || path.Find('.') != nullptr) {
-        // If we ran out of directories, we don't have the directory that has the file.
-        auto it = dirp->directories.find(token);
-
-        if (it == dirp->directories.end()) {
-            return false;
-        }
+    // Looked up without inserting so opens from the IO threads don't modify the map.
+    auto it = m_archiveFiles.find(archive);
+    captainslog_dbgassert(it != m_archiveFiles.end() && it->second != nullptr, "Did not find matching archive file.");
 
-        dirp = &it->second;
-        path.Next_Token(&token, "\\/");
+    if (it == m_archiveFiles.end() || it->second == nullptr) {
+        return nullptr;
     }
 
-    // Assuming we didn't run out of directories to try, find the file
-    // in the reached directory.
-    if (dirp->files.find(token) == dirp->files.end()) {
-        return false;
+    Thyme::FileIOTimer timer;
+    File *file = it->second->Open_File(filename, mode);
+
+    if (file != nullptr) {
+        timer.Opened(filename, Thyme::FileIOStats::SOURCE_ARCHIVE);
     }
 
-    return true;
+    return file;
+}
+
+bool ArchiveFileSystem::Does_File_Exist(const char *filename) const
+{
+    // The flat index resolves the path the same way walking m_archiveDirInfo one directory at a time would.
+    return m_archiveIndex.Find(filename) != nullptr;
 }
 
 // Loads an archive file into the virtual directory tree. The over write option allows it to use this archive to
@@ -87,6 +78,7 @@ void ArchiveFileSystem::Load_Into_Directory_Tree(ArchiveFile const *file, Utf8St
     for (auto it = file_list.begin(); it != file_list.end(); ++it) {
         Utf8String path = *it;
         Utf8String token;
+        Utf8String dir_path;
         ArchivedDirectoryInfo *dirp = &m_archiveDirInfo;
 
         // Lower case for matching.
@@ -103,10 +95,14 @@ void ArchiveFileSystem::Load_Into_Directory_Tree(ArchiveFile const *file, Utf8St
             }
 
             dirp = &dirp->directories[token];
+            dir_path += token;
+            dir_path += "\\";
         }
 
         if (dirp->files.find(token) == dirp->files.end() || overwrite) {
-            dirp->files[token] = archive_path;
+            Utf8String &archive = dirp->files[token];
+            archive = archive_path;
+            m_archiveIndex.Insert(dir_path, token, &archive, false);
         }
     }
 }
@@ -137,34 +133,10 @@ bool ArchiveFileSystem::Get_File_Info(Utf8String const &name, FileInfo *info) co
 // Returns the filname of the archive file containing the passed in file name.
 Utf8String ArchiveFileSystem::Get_Archive_Filename_For_File(Utf8String const &filename) const
 {
-    Utf8String path = filename;
-    Utf8String token;
-    const ArchivedDirectoryInfo *dirp = &m_archiveDirInfo;
-
-    // Lower case for matching and get first item of the path.
-    path.To_Lower();
-    path.Next_Token(&token, "\\/");
-
-    // Consider existence of '.' to indicate file as all should have .ext format
-    // checks the remaining path does not contain one to catch directories in path
-    // that do.
-    while (token.Find('.') == nullptr || path.Find('.') != nullptr) {
-        auto it = dirp->directories.find(token);
-
-        if (it == dirp->directories.end()) {
-            return Utf8String();
-        }
-
-        dirp = &it->second;
-        path.Next_Token(&token, "\\/");
-    }
-
-    // Assuming we didn't run out of directories to try, find the file
-    // in the reached directory.
-    auto it = dirp->files.find(token);
+    const Utf8String *const *archive = m_archiveIndex.Find(filename.Str());
 
-    if (it != dirp->files.end()) {
-        return it->second;
+    if (archive != nullptr) {
+        return **archive;
     }
 
     return Utf8String();
@@ -208,3 +180,92 @@ void ArchiveFileSystem::Load_Mods()
         }
     }
 }
+
+namespace
+{
+void Write_Directory(Thyme::ArchiveIndexWriter &writer,
+    ArchivedDirectoryInfo const &dir,
+    std::map<Utf8String, uint32_t> const &archive_ids)
+{
+    writer.Write_Int(uint32_t(dir.files.size()));
+
+    for (auto it = dir.files.begin(); it != dir.files.end(); ++it) {
+        auto id = archive_ids.find(it->second);
+        writer.Write_String(it->first);
+        writer.Write_Int(id != archive_ids.end() ? id->second : uint32_t(archive_ids.size()));
+    }
+
+    writer.Write_Int(uint32_t(dir.directories.size()));
+
+    for (auto it = dir.directories.begin(); it != dir.directories.end(); ++it) {
+        writer.Write_String(it->second.name);
+        Write_Directory(writer, it->second, archive_ids);
+    }
+}
+
+bool Read_Directory(Thyme::ArchiveIndexReader &reader,
+    ArchivedDirectoryInfo &dir,
+    Utf8String const &dir_path,
+    std::vector<Utf8String> const &archive_names,
+    Thyme::ArchivePathIndex<const Utf8String *> &index)
+{
+    uint32_t file_count = reader.Read_Int();
+
+    for (uint32_t i = 0; i < file_count && !reader.Failed(); ++i) {
+        Utf8String name = reader.Read_String();
+        uint32_t id = reader.Read_Int();
+
+        if (id >= archive_names.size()) {
+            return false;
+        }
+
+        // Archive names are shared reference counted strings so this doesn't allocate per file.
+        auto it = dir.files.insert(dir.files.end(), std::pair<const Utf8String, Utf8String>(name, archive_names[id]));
+        index.Insert(dir_path, it->first, &it->second, false);
+    }
+
+    uint32_t dir_count = reader.Read_Int();
+
+    for (uint32_t i = 0; i < dir_count && !reader.Failed(); ++i) {
+        Utf8String name = reader.Read_String();
+        auto it = dir.directories.insert(
+            dir.directories.end(), std::pair<const Utf8String, ArchivedDirectoryInfo>(name, ArchivedDirectoryInfo()));
+        it->second.name = name;
+
+        if (!Read_Directory(reader, it->second, dir_path + name + "\\", archive_names, index)) {
+            return false;
+        }
+    }
+
+    return !reader.Failed();
+}
+} // namespace
+
+/**
+ * Writes the merged directory tree to an index cache, files reference their archive by its id in archive_ids.
+ */
+void ArchiveFileSystem::Write_Index(
+    Thyme::ArchiveIndexWriter &writer, std::map<Utf8String, uint32_t> const &archive_ids) const
+{
+    writer.Write_String(m_archiveDirInfo.name);
+    Write_Directory(writer, m_archiveDirInfo, archive_ids);
+}
+
+/**
+ * Restores a merged directory tree written by Write_Index, archive_names maps the ids back to archive file names.
+ */
+bool ArchiveFileSystem::Read_Index(Thyme::ArchiveIndexReader &reader, std::vector<Utf8String> const &archive_names)
+{
+    m_archiveDirInfo.Clear();
+    m_archiveIndex.Clear();
+    m_archiveDirInfo.name = reader.Read_String();
+
+    if (!Read_Directory(reader, m_archiveDirInfo, Utf8String(), archive_names, m_archiveIndex)) {
+        m_archiveDirInfo.Clear();
+        m_archiveIndex.Clear();
+
+        return false;
+    }
+
+    return true;
+}
@@ -15,15 +15,23 @@
 #pragma once
 
 #include "always.h"
+#include "archivepathindex.h"
 #include "rtsutils.h"
 #include "subsysteminterface.h"
 #include <map>
 #include <set>
+#include <vector>
 
 class File;
 class ArchiveFile;
 struct FileInfo;
 
+namespace Thyme
+{
+class ArchiveIndexReader;
+class ArchiveIndexWriter;
+} // namespace Thyme
+
 class ArchivedDirectoryInfo
 {
 public:
@@ -61,9 +69,20 @@ public:
         bool search_subdirs) const;
     void Load_Mods();
 
+    // Thyme specific, controls if RefPack compressed entries in archives opened after the call are decoded when opened.
+    static void Set_Decompress_Entries(bool decompress) { s_decompressEntries = decompress; }
+    static bool Get_Decompress_Entries() { return s_decompressEntries; }
+
+protected:
+    void Write_Index(Thyme::ArchiveIndexWriter &writer, std::map<Utf8String, uint32_t> const &archive_ids) const;
+    bool Read_Index(Thyme::ArchiveIndexReader &reader, std::vector<Utf8String> const &archive_names);
+
 protected:
     std::map<Utf8String, ArchiveFile *> m_archiveFiles;
     ArchivedDirectoryInfo m_archiveDirInfo;
+    Thyme::ArchivePathIndex<const Utf8String *> m_archiveIndex; // Thyme specific, flat index into m_archiveDirInfo.
+
+    static bool s_decompressEntries;
 };
 
 #ifdef GAME_DLL
@@ -0,0 +1,171 @@
+/**
+ * @file
+ *
+ * @author OmniBlade
+ *
+ * @brief Binary streams for persisting archive directory indices between runs. (Thyme Feature)
+ *
+ * @copyright Thyme is free software: you can redistribute it and/or
+ *            modify it under the terms of the GNU General Public License
+ *            as published by the Free Software Foundation, either version
+ *            2 of the License, or (at your option) any later version.
+ *            A full copy of the GNU General Public License can be found in
+ *            LICENSE
+ */
+#include "archiveindexcache.h"
+#include "endiantype.h"
+#include "file.h"
+#include "localfilesystem.h"
+#include <climits>
+#include <cstring>
+
+#ifdef PLATFORM_WINDOWS
+#include <windows.h>
+#elif defined PLATFORM_OSX
+#include <mach-o/dyld.h>
+#elif defined HAVE_UNISTD_H
+#include <unistd.h>
+#endif
+
+namespace Thyme
+{
+
+void ArchiveIndexWriter::Write_Int(uint32_t value)
+{
+    value = htole32(value);
+    Write(&value, sizeof(value));
+}
+
+void ArchiveIndexWriter::Write_Int64(uint64_t value)
+{
+    value = htole64(value);
+    Write(&value, sizeof(value));
+}
+
+// Strings are stored with their length and null terminator so they can be used in place when read back.
+void ArchiveIndexWriter::Write_String(Utf8String const &string)
+{
+    uint16_t length = uint16_t(string.Get_Length());
+    uint16_t stored_length = htole16(length);
+    Write(&stored_length, sizeof(stored_length));
+    Write(string.Str(), length + 1);
+}
+
+bool ArchiveIndexWriter::Save(const char *filename) const
+{
+    if (g_theLocalFileSystem == nullptr || m_buffer.empty()) {
+        return false;
+    }
+
+    File *file = g_theLocalFileSystem->Open_File(filename, File::WRITE | File::BINARY | File::CREATE | File::TRUNCATE);
+
+    if (file == nullptr) {
+        return false;
+    }
+
+    bool saved = file->Write(&m_buffer[0], int(m_buffer.size())) == int(m_buffer.size());
+    file->Close();
+
+    return saved;
+}
+
+void ArchiveIndexWriter::Write(const void *data, size_t size)
+{
+    const char *bytes = static_cast<const char *>(data);
+    m_buffer.insert(m_buffer.end(), bytes, bytes + size);
+}
+
+uint32_t ArchiveIndexReader::Read_Int()
+{
+    uint32_t value = 0;
+    Read(&value, sizeof(value));
+
+    return le32toh(value);
+}
+
+uint64_t ArchiveIndexReader::Read_Int64()
+{
+    uint64_t value = 0;
+    Read(&value, sizeof(value));
+
+    return le64toh(value);
+}
+
+const char *ArchiveIndexReader::Read_String()
+{
+    uint16_t length = 0;
+
+    bool read = Read(&length, sizeof(length));
+    length = le16toh(length);
+
+    if (!read || size_t(m_end - m_pos) < size_t(length) + 1 || m_pos[length] != '\0') {
+        m_failed = true;
+
+        return "";
+    }
+
+    const char *string = m_pos;
+    m_pos += length + 1;
+
+    return string;
+}
+
+bool ArchiveIndexReader::Read(void *data, size_t size)
+{
+    if (m_failed || size_t(m_end - m_pos) < size) {
+        m_failed = true;
+
+        return false;
+    }
+
+    memcpy(data, m_pos, size);
+    m_pos += size;
+
+    return true;
+}
+
+/**
+ * Resolves a cache file name against the directory the executable is in so the cache is found again whatever the
+ * working directory is. Absolute paths are returned unchanged.
+ */
+Utf8String Get_Cache_Path(const char *filename)
+{
+    if (filename[0] == '/' || filename[0] == '\\' || (filename[0] != '\0' && filename[1] == ':')) {
+        return filename;
+    }
+
+    char path[PATH_MAX] = { 0 };
+#ifdef PLATFORM_WINDOWS
+    GetModuleFileNameA(nullptr, path, PATH_MAX - 1);
+#elif defined PLATFORM_OSX
+    uint32_t size = PATH_MAX;
+
+    if (_NSGetExecutablePath(path, &size) != 0) {
+        path[0] = '\0';
+    }
+#elif defined HAVE_UNISTD_H
+    // readlink doesn't terminate the string.
+    ssize_t length = readlink("/proc/self/exe", path, PATH_MAX - 1);
+    path[length > 0 ? length : 0] = '\0';
+#endif
+
+    char *path_end = strrchr(path, '/');
+    char *win_end = strrchr(path, '\\');
+
+    if (win_end != nullptr && (path_end == nullptr || win_end > path_end)) {
+        path_end = win_end;
+    }
+
+    // Fall back to the working directory if the executable's location isn't known.
+    if (path_end == nullptr) {
+        return filename;
+    }
+
+    path_end[1] = '\0';
+    Utf8String resolved = path;
+    resolved += filename;
+
+    return resolved;
+}
+
+} // namespace Thyme
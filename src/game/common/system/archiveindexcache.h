@@ -0,0 +1,65 @@
+/**
+ * @file
+ *
+ * @author OmniBlade
+ *
+ * @brief Binary streams for persisting archive directory indices between runs. (Thyme Feature)
+ *
+ * @copyright Thyme is free software: you can redistribute it and/or
+ *            modify it under the terms of the GNU General Public License
+ *            as published by the Free Software Foundation, either version
+ *            2 of the License, or (at your option) any later version.
+ *            A full copy of the GNU General Public License can be found in
+ *            LICENSE
+ */
+#pragma once
+
+#include "always.h"
+#include "asciistring.h"
+#include <vector>
+
+namespace Thyme
+{
+
+// Integers are always stored little endian so a cache reads back the same whatever wrote it.
+class ArchiveIndexWriter
+{
+public:
+    void Write_Int(uint32_t value);
+    void Write_Int64(uint64_t value);
+    void Write_String(Utf8String const &string);
+    bool Save(const char *filename) const;
+    std::vector<char> const &Get_Buffer() const { return m_buffer; }
+
+private:
+    void Write(const void *data, size_t size);
+
+private:
+    std::vector<char> m_buffer;
+};
+
+// Reads values back from a cache held in memory. Reads past the end or of malformed strings flag the reader as
+// failed and return empty values so callers can check Failed once they are done.
+class ArchiveIndexReader
+{
+public:
+    ArchiveIndexReader(const char *data, size_t size) : m_pos(data), m_end(data + size), m_failed(false) {}
+
+    uint32_t Read_Int();
+    uint64_t Read_Int64();
+    const char *Read_String();
+    bool Failed() const { return m_failed; }
+    bool At_End() const { return m_pos == m_end; }
+
+private:
+    bool Read(void *data, size_t size);
+
+private:
+    const char *m_pos;
+    const char *m_end;
+    bool m_failed;
+};
+
+Utf8String Get_Cache_Path(const char *filename);
+
+} // namespace Thyme
@@ -0,0 +1,89 @@
+/**
+ * @file
+ *
+ * @author OmniBlade
+ *
+ * @brief Flat hash table for resolving archived file paths in a single probe. (Thyme Feature)
+ *
+ * @copyright Thyme is free software: you can redistribute it and/or
+ *            modify it under the terms of the GNU General Public License
+ *            as published by the Free Software Foundation, either version
+ *            2 of the License, or (at your option) any later version.
+ *            A full copy of the GNU General Public License can be found in
+ *            LICENSE
+ */
+#include "archivepathindex.h"
+#include <cctype>
+
+namespace Thyme
+{
+
+int ArchivePathIndexBase::Normalize_Path(const char *path, char *buffer, int size, bool fold_case)
+{
+    // The tree walk treats the first component that contains a '.' with none following it as the file, anything after
+    // that is ignored. That is the component holding the last '.' in the path.
+    const char *dot = strrchr(path, '.');
+
+    if (dot == nullptr) {
+        return -1;
+    }
+
+    const char *end = dot;
+
+    while (*end != '\0' && *end != '\\' && *end != '/') {
+        ++end;
+    }
+
+    int length = 0;
+    bool separator = false;
+
+    for (const char *getp = path; getp != end; ++getp) {
+        if (*getp == '\\' || *getp == '/') {
+            // Separators are only emitted once something follows them, this skips leading and repeated ones.
+            separator = length != 0;
+            continue;
+        }
+
+        if (separator) {
+            if (length < size) {
+                buffer[length] = '\\';
+            }
+
+            ++length;
+            separator = false;
+        }
+
+        if (length < size) {
+            buffer[length] = fold_case ? char(tolower(static_cast<unsigned char>(*getp))) : *getp;
+        }
+
+        ++length;
+    }
+
+    if (length < size) {
+        buffer[length] = '\0';
+    } else if (size > 0) {
+        buffer[size - 1] = '\0';
+    }
+
+    return length;
+}
+
+uint32_t ArchivePathIndexBase::Hash_Key(const char *key, int length)
+{
+    // Same simple hash the name key generator uses, keys are already in the case they are compared in.
+    uint32_t hash = 0;
+
+    for (int i = 0; i < length; ++i) {
+        hash = (33 * hash) + static_cast<unsigned char>(key[i]);
+    }
+
+    // Mix the high bits down as the table only uses the low bits to pick a slot.
+    hash ^= hash >> 16;
+    hash *= 0x45D9F3B;
+    hash ^= hash >> 16;
+
+    return hash;
+}
+
+} // namespace Thyme
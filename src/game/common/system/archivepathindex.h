@@ -0,0 +1,210 @@
+/**
+ * @file
+ *
+ * @author OmniBlade
+ *
+ * @brief Flat hash table for resolving archived file paths in a single probe. (Thyme Feature)
+ *
+ * @copyright Thyme is free software: you can redistribute it and/or
+ *            modify it under the terms of the GNU General Public License
+ *            as published by the Free Software Foundation, either version
+ *            2 of the License, or (at your option) any later version.
+ *            A full copy of the GNU General Public License can be found in
+ *            LICENSE
+ */
+#pragma once
+
+#include "always.h"
+#include "asciistring.h"
+#include <cstring>
+
+namespace Thyme
+{
+
+class ArchivePathIndexBase
+{
+public:
+    enum
+    {
+        PATH_BUFFER_SIZE = 512,
+    };
+
+    // Produces the lookup key for a path using the same rules as the directory tree walk, lower case with each run of
+    // separators collapsed to a single '\' and the component containing the last '.' treated as the file name.
+    // Returns the length of the key, which may be larger than size in which case only part of it was written, or -1
+    // if the path has no file component. Case is kept if fold_case is false, for paths on case sensitive disks.
+    static int Normalize_Path(const char *path, char *buffer, int size, bool fold_case = true);
+    static uint32_t Hash_Key(const char *key, int length);
+};
+
+// Open addressing hash table mapping the normalized full path of every archived file to a value, in practice a pointer
+// into one of the directory trees so the trees remain the owners of the data. Entries are only ever added or the whole
+// table cleared which keeps probing simple.
+template<typename T> class ArchivePathIndex : public ArchivePathIndexBase
+{
+    struct Entry
+    {
+        Entry() : hash(0), used(false), value() {}
+
+        uint32_t hash;
+        bool used;
+        Utf8String key;
+        T value;
+    };
+
+public:
+    ArchivePathIndex() : m_entries(nullptr), m_capacity(0), m_count(0), m_foldCase(true) {}
+    ~ArchivePathIndex() { delete[] m_entries; }
+
+    void Clear()
+    {
+        delete[] m_entries;
+        m_entries = nullptr;
+        m_capacity = 0;
+        m_count = 0;
+    }
+
+    int Get_Count() const { return m_count; }
+
+    // Only takes effect on an empty index.
+    void Set_Case_Sensitive(bool sensitive)
+    {
+        if (m_count == 0) {
+            m_foldCase = !sensitive;
+        }
+    }
+
+    // Calls func(key, value) for every entry, the value can be changed in place.
+    template<typename Func> void For_Each(Func func)
+    {
+        for (int i = 0; i < m_capacity; ++i) {
+            if (m_entries[i].used) {
+                func(m_entries[i].key, m_entries[i].value);
+            }
+        }
+    }
+
+    // Adds a file found in dir, an existing entry for the same path is only replaced if overwrite is set. Files without
+    // a '.' in their name can't be reached by a lookup and are skipped.
+    void Insert(Utf8String const &dir, Utf8String const &file, T value, bool overwrite)
+    {
+        if (file.Find('.') == nullptr) {
+            return;
+        }
+
+        Utf8String path = dir;
+        path += "\\";
+        path += file;
+
+        char buffer[PATH_BUFFER_SIZE];
+        int length = Normalize_Path(path.Str(), buffer, sizeof(buffer), m_foldCase);
+
+        if (length < 0) {
+            return;
+        }
+
+        Utf8String key;
+
+        if (length < int(sizeof(buffer))) {
+            key = buffer;
+        } else {
+            Normalize_Path(path.Str(), key.Get_Buffer_For_Read(length), length + 1, m_foldCase);
+        }
+
+        if ((m_count + 1) * 2 > m_capacity) {
+            Grow();
+        }
+
+        uint32_t hash = Hash_Key(key.Str(), length);
+        Entry *entry = Find_Entry(hash, key.Str());
+
+        if (!entry->used) {
+            entry->used = true;
+            entry->hash = hash;
+            entry->key = key;
+            entry->value = value;
+            ++m_count;
+        } else if (overwrite) {
+            entry->value = value;
+        }
+    }
+
+    // Looks up a path as passed to the file system, returns nullptr if no archived file matches it.
+    const T *Find(const char *path) const
+    {
+        if (m_count == 0) {
+            return nullptr;
+        }
+
+        char buffer[PATH_BUFFER_SIZE];
+        int length = Normalize_Path(path, buffer, sizeof(buffer), m_foldCase);
+
+        if (length < 0) {
+            return nullptr;
+        }
+
+        if (length < int(sizeof(buffer))) {
+            return Find_Key(buffer, length);
+        }
+
+        // Rare, but don't fail paths longer than the stack buffer.
+        char *long_buffer = new char[length + 1];
+        Normalize_Path(path, long_buffer, length + 1, m_foldCase);
+        const T *value = Find_Key(long_buffer, length);
+        delete[] long_buffer;
+
+        return value;
+    }
+
+private:
+    // Not copyable, the tables are large and owned by a single archive or file system.
+    ArchivePathIndex(const ArchivePathIndex &that) = delete;
+    ArchivePathIndex &operator=(const ArchivePathIndex &that) = delete;
+
+    const T *Find_Key(const char *key, int length) const
+    {
+        const Entry *entry = Find_Entry(Hash_Key(key, length), key);
+
+        return entry->used ? &entry->value : nullptr;
+    }
+
+    // Returns the entry holding key or the empty entry where it would be inserted. The table always has free entries.
+    Entry *Find_Entry(uint32_t hash, const char *key) const
+    {
+        uint32_t mask = m_capacity - 1;
+
+        for (uint32_t i = hash & mask;; i = (i + 1) & mask) {
+            Entry *entry = &m_entries[i];
+
+            if (!entry->used || (entry->hash == hash && strcmp(entry->key.Str(), key) == 0)) {
+                return entry;
+            }
+        }
+    }
+
+    void Grow()
+    {
+        Entry *old_entries = m_entries;
+        int old_capacity = m_capacity;
+
+        m_capacity = m_capacity != 0 ? m_capacity * 2 : 256;
+        m_entries = new Entry[m_capacity];
+
+        for (int i = 0; i < old_capacity; ++i) {
+            if (old_entries[i].used) {
+                Entry *entry = Find_Entry(old_entries[i].hash, old_entries[i].key.Str());
+                *entry = old_entries[i];
+            }
+        }
+
+        delete[] old_entries;
+    }
+
+private:
+    Entry *m_entries;
+    int m_capacity;
+    int m_count;
+    bool m_foldCase;
+};
+
+} // namespace Thyme
@@ -26,16 +26,18 @@ Utf8String const Utf8String::s_emptyString(nullptr);
 /**
  * Default constructor added for convenience
  */
-Utf8String::Utf8String() : m_data(nullptr) {}
+Utf8String::Utf8String() : m_data(nullptr)
+{
+    Init_Inline();
+}
 
 /**
  * Initializes this string with an existing string (copy) and increments reference count.
  */
-Utf8String::Utf8String(Utf8String const &string) : m_data(string.m_data)
+Utf8String::Utf8String(Utf8String const &string) : m_data(nullptr)
 {
-    if (m_data != nullptr) {
-        m_data->Inc_Ref_Count();
-    }
+    Init_Inline();
+    Set(string);
 }
 
 /**
@@ -43,6 +45,7 @@ Utf8String::Utf8String(Utf8String const &string) : m_data(string.m_data)
  */
 Utf8String::Utf8String(const char *s) : m_data(nullptr)
 {
+    Init_Inline();
     if (s != nullptr) {
         // Get length of the string that was passed
         const size_type len = static_cast<size_type>(strlen(s));
@@ -60,7 +63,7 @@ const char *Utf8String::Peek() const
 {
     captainslog_dbgassert(m_data != nullptr, "null string ptr");
 
-    return m_data->Peek();
+    return Get_Data()->Peek();
 }
 
 /**
@@ -70,7 +73,7 @@ char *Utf8String::Peek()
 {
     captainslog_dbgassert(m_data != nullptr, "null string ptr");
 
-    return m_data->Peek();
+    return Get_Data()->Peek();
 }
 
 /**
@@ -81,9 +84,16 @@ void Utf8String::Release_Buffer()
     Validate();
 
     if (m_data != nullptr) {
-        m_data->Dec_Ref_Count();
-        if (m_data->ref_count == 0) {
-            Free_Bytes();
+        // Inline data is never shared, only heap blocks are reference counted.
+        if (Is_Inline()) {
+#ifndef GAME_DLL
+            m_inline.header.num_chars_allocated = 0;
+#endif
+        } else {
+            m_data->Dec_Ref_Count();
+            if (m_data->ref_count == 0) {
+                Free_Bytes();
+            }
         }
         m_data = nullptr;
     }
@@ -107,7 +117,7 @@ void Utf8String::Ensure_Unique_Buffer_Of_Size(
 {
     Validate();
 
-    if (m_data != nullptr && m_data->ref_count == 1 && m_data->num_chars_allocated >= chars_needed) {
+    if (m_data != nullptr && Get_Data()->ref_count == 1 && Get_Data()->num_chars_allocated >= chars_needed) {
         if (str_to_cpy != nullptr) {
             // #BUGFIX Originally uses strcpy here. Use memmove to support overlaps gracefully.
             captainslog_dbgassert(strlen(str_to_cpy) == chars_needed - 1, "Length does not match");
@@ -123,12 +133,26 @@ void Utf8String::Ensure_Unique_Buffer_Of_Size(
 
         captainslog_relassert(required_size <= MAX_LEN, CODE_02, "Size exceeds max len");
 
-        const int alloc_size = g_dynamicMemoryAllocator->Get_Actual_Allocation_Size(required_size);
-        AsciiStringData *new_data =
-            reinterpret_cast<AsciiStringData *>(g_dynamicMemoryAllocator->Allocate_Bytes_No_Zero(alloc_size));
+        AsciiStringData *new_data;
+
+#ifndef GAME_DLL
+        bool to_inline = false;
+
+        // If the inline buffer were already in use it would have been big enough above. It isn't flagged as in use
+        // until the old buffer is released so Peek() still reaches the old contents while they are copied.
+        if (chars_needed <= INLINE_BUFFER_LEN && !Is_Inline()) {
+            to_inline = true;
+            new_data = &m_inline.header;
+            new_data->ref_count = 1;
+        } else
+#endif
+        {
+            const int alloc_size = g_dynamicMemoryAllocator->Get_Actual_Allocation_Size(required_size);
+            new_data = reinterpret_cast<AsciiStringData *>(g_dynamicMemoryAllocator->Allocate_Bytes_No_Zero(alloc_size));
+            new_data->ref_count = 1;
+            new_data->num_chars_allocated = alloc_size - sizeof(AsciiStringData);
+        }
 
-        new_data->ref_count = 1;
-        new_data->num_chars_allocated = alloc_size - sizeof(AsciiStringData);
 #ifdef GAME_DEBUG_STRUCTS
         new_data->debug_ptr = new_data->Peek();
 #endif
@@ -148,6 +172,11 @@ void Utf8String::Ensure_Unique_Buffer_Of_Size(
         }
 
         Release_Buffer();
+#ifndef GAME_DLL
+        if (to_inline) {
+            m_inline.header.num_chars_allocated = INLINE_BUFFER_LEN;
+        }
+#endif
         m_data = new_data;
         Validate();
     }
@@ -204,7 +233,7 @@ char *Utf8String::Get_Buffer_For_Read(size_type len)
  */
 void Utf8String::Set(const char *str)
 {
-    if (m_data == nullptr || str != m_data->Peek()) {
+    if (m_data == nullptr || str != Peek()) {
         const size_type len = str ? static_cast<size_type>(strlen(str)) : 0;
 
         if (len != 0) {
@@ -221,6 +250,12 @@ void Utf8String::Set(const char *str)
 void Utf8String::Set(Utf8String const &string)
 {
     if (&string != this) {
+        // Inline data belongs to the other string so it has to be copied rather than shared.
+        if (string.Is_Inline()) {
+            Set(string.Peek());
+            return;
+        }
+
         Release_Buffer();
         m_data = string.m_data;
 
@@ -47,6 +47,12 @@ public:
         MAX_FORMAT_BUF_LEN = 2048,
         MAX_LEN = 0x7FFF,
         MAX_TO_LOWER_BUF_LEN = 2060,
+#ifndef GAME_DLL
+        // Makes the object 32 bytes on 64 bit rather than 8. A heap string costs the pointer plus at least a 16 byte
+        // allocator block and its 24 byte block header, 48 bytes or more, so strings of up to 19 characters are smaller
+        // inline as well as avoiding the allocator. Empty strings pay the extra 24 bytes.
+        INLINE_BUFFER_LEN = 20,
+#endif
     };
 
     struct AsciiStringData
@@ -151,7 +157,7 @@ public:
     bool Next_Token(Utf8String *tok, const char *seps = nullptr);
 
     bool Is_None() const { return m_data != nullptr && strcasecmp(Peek(), "None") == 0; }
-    bool Is_Empty() const { return m_data == nullptr || *m_data->Peek() == '\0'; }
+    bool Is_Empty() const { return m_data == nullptr || *Peek() == '\0'; }
     bool Is_Not_Empty() const { return !Is_Empty(); }
     bool Is_Not_None() const { return !Is_None(); }
 
@@ -203,9 +209,40 @@ private:
     void Format_VA(const char *format, va_list args);
     void Format_VA(Utf8String &format, va_list args);
 
+#ifndef GAME_DLL
+    // Short strings are kept in the object itself, laid out like a heap block so Peek() works on either. The inline
+    // header's num_chars_allocated is non zero while it is in use and m_data is then only a non null marker. Nothing
+    // points back into the object so strings can still be moved as raw bytes, as Dict does when it sorts its pairs.
+    struct InlineData
+    {
+        AsciiStringData header;
+        char chars[INLINE_BUFFER_LEN];
+    };
+
+    static_assert(offsetof(InlineData, chars) == sizeof(AsciiStringData), "Inline chars must follow header.");
+
+    void Init_Inline() { m_inline.header.num_chars_allocated = 0; }
+    bool Is_Inline() const { return m_inline.header.num_chars_allocated != 0; }
+    AsciiStringData *Get_Data() const
+    {
+        return Is_Inline() ? const_cast<AsciiStringData *>(&m_inline.header) : m_data;
+    }
+#else
+    void Init_Inline() {}
+    bool Is_Inline() const { return false; }
+    AsciiStringData *Get_Data() const { return m_data; }
+#endif
+
     AsciiStringData *m_data;
+#ifndef GAME_DLL
+    InlineData m_inline;
+#endif
 };
 
+#if !defined GAME_DLL && !defined GAME_DEBUG_STRUCTS
+static_assert(sizeof(Utf8String) <= 32, "Utf8String has grown past the size its inline buffer was chosen for.");
+#endif
+
 inline Utf8String &Utf8String::operator=(const char *s)
 {
     Set(s);
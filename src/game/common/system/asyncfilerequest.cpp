@@ -0,0 +1,150 @@
+/**
+ * @file
+ *
+ * @author OmniBlade
+ *
+ * @brief Request to open or read a file on the file system's IO threads. (Thyme Feature)
+ *
+ * @copyright Thyme is free software: you can redistribute it and/or
+ *            modify it under the terms of the GNU General Public License
+ *            as published by the Free Software Foundation, either version
+ *            2 of the License, or (at your option) any later version.
+ *            A full copy of the GNU General Public License can be found in
+ *            LICENSE
+ */
+#include "asyncfilerequest.h"
+#include "file.h"
+#include "filesystem.h"
+
+namespace Thyme
+{
+
+AsyncFileRequest::AsyncFileRequest(FileSystem *file_system,
+    RequestType type,
+    const char *filename,
+    int mode,
+    AsyncFileCallback callback,
+    void *user_data) :
+    m_fileSystem(file_system),
+    m_type(type),
+    m_filename(filename),
+    m_mode(mode),
+    m_callback(callback),
+    m_userData(user_data),
+    m_succeeded(false),
+    m_file(nullptr),
+    m_data(nullptr),
+    m_size(0),
+    m_hasResult(false)
+{
+}
+
+AsyncFileRequest::~AsyncFileRequest()
+{
+    Wait();
+
+    if (m_file != nullptr) {
+        m_file->Close();
+    }
+
+    delete[] m_data;
+}
+
+void AsyncFileRequest::Execute()
+{
+    if (m_type == REQUEST_READ) {
+        File *file = m_fileSystem->Open_File(m_filename.Str(), File::READ | File::BINARY);
+
+        if (file != nullptr) {
+            m_size = file->Size();
+            m_data = static_cast<char *>(file->Read_Entire_And_Close());
+            m_succeeded = m_data != nullptr;
+        }
+    } else {
+        File *file = m_fileSystem->Open_File(m_filename.Str(), m_mode);
+
+        // Loose files get pulled into memory here so the caller never touches the disk, archive files already are.
+        if (file != nullptr && (m_mode & (File::WRITE | File::STREAMING)) == 0) {
+            file = file->Convert_To_RAM_File();
+        }
+
+        m_file = file;
+        m_succeeded = m_file != nullptr;
+    }
+
+    m_hasResult.store(true, std::memory_order_release);
+
+    if (m_callback != nullptr) {
+        m_callback(this, m_userData);
+    }
+}
+
+/**
+ * Queues the request on the file system's IO threads, if they aren't available the request is serviced on the calling
+ * thread.
+ */
+void AsyncFileRequest::Submit()
+{
+    if (!FileSystem::Submit_IO(this)) {
+        WorkerPool::Run_Inline(this);
+    }
+}
+
+void AsyncFileRequest::Wait()
+{
+    if (!Is_Complete()) {
+        FileSystem::Wait_For_IO(this);
+    }
+}
+
+/**
+ * Waits until the result fields are written and visible to the calling thread. Returns straight away from inside the
+ * callback, where waiting for the job itself would never finish.
+ */
+void AsyncFileRequest::Wait_For_Result()
+{
+    while (!m_hasResult.load(std::memory_order_acquire)) {
+        Wait();
+    }
+}
+
+bool AsyncFileRequest::Succeeded()
+{
+    Wait_For_Result();
+
+    return m_succeeded;
+}
+
+const char *AsyncFileRequest::Get_Data()
+{
+    Wait_For_Result();
+
+    return m_data;
+}
+
+int AsyncFileRequest::Get_Size()
+{
+    Wait_For_Result();
+
+    return m_size;
+}
+
+File *AsyncFileRequest::Release_File()
+{
+    Wait_For_Result();
+    File *file = m_file;
+    m_file = nullptr;
+
+    return file;
+}
+
+char *AsyncFileRequest::Release_Data()
+{
+    Wait_For_Result();
+    char *data = m_data;
+    m_data = nullptr;
+
+    return data;
+}
+
+} // namespace Thyme
@@ -0,0 +1,92 @@
+/**
+ * @file
+ *
+ * @author OmniBlade
+ *
+ * @brief Request to open or read a file on the file system's IO threads. (Thyme Feature)
+ *
+ * @copyright Thyme is free software: you can redistribute it and/or
+ *            modify it under the terms of the GNU General Public License
+ *            as published by the Free Software Foundation, either version
+ *            2 of the License, or (at your option) any later version.
+ *            A full copy of the GNU General Public License can be found in
+ *            LICENSE
+ */
+#pragma once
+
+#include "always.h"
+#include "asciistring.h"
+#include "workerpool.h"
+#include <atomic>
+
+class File;
+class FileSystem;
+
+namespace Thyme
+{
+
+class AsyncFileRequest;
+
+// Called on the thread that serviced the request once it has finished, successful or not. The request must not be
+// deleted from inside the callback.
+typedef void (*AsyncFileCallback)(AsyncFileRequest *request, void *user_data);
+
+// Handle to an outstanding request, acts as a future for the result. The result accessors block until it is ready,
+// they can also be used from the callback. The owner deletes it once done with it, deleting an unfinished request
+// blocks until it is complete.
+class AsyncFileRequest : public WorkerJob
+{
+public:
+    enum RequestType
+    {
+        REQUEST_OPEN,
+        REQUEST_READ,
+    };
+
+    AsyncFileRequest(FileSystem *file_system,
+        RequestType type,
+        const char *filename,
+        int mode,
+        AsyncFileCallback callback,
+        void *user_data);
+    virtual ~AsyncFileRequest() override;
+
+    virtual void Execute() override;
+
+    void Submit();
+    void Wait();
+
+    bool Succeeded();
+    RequestType Get_Type() const { return m_type; }
+    Utf8String const &Get_Filename() const { return m_filename; }
+    void *Get_User_Data() const { return m_userData; }
+
+    // Results of REQUEST_OPEN, ownership of the file passes to the caller.
+    File *Release_File();
+
+    // Results of REQUEST_READ, ownership of the buffer passes to the caller who frees it with delete[].
+    const char *Get_Data();
+    int Get_Size();
+    char *Release_Data();
+
+private:
+    AsyncFileRequest(const AsyncFileRequest &that) = delete;
+    AsyncFileRequest &operator=(const AsyncFileRequest &that) = delete;
+
+    void Wait_For_Result();
+
+private:
+    FileSystem *m_fileSystem;
+    RequestType m_type;
+    Utf8String m_filename;
+    int m_mode;
+    AsyncFileCallback m_callback;
+    void *m_userData;
+    bool m_succeeded;
+    File *m_file;
+    char *m_data;
+    int m_size;
+    std::atomic<bool> m_hasResult; // Set before the callback runs, the job only completes after it returns.
+};
+
+} // namespace Thyme
@@ -0,0 +1,419 @@
+/**
+ * @file
+ *
+ * @author OmniBlade
+ *
+ * @brief Writer for BIG archives that can lay entries out in the order the game reads them. (Thyme Feature)
+ *
+ * @copyright Thyme is free software: you can redistribute it and/or
+ *            modify it under the terms of the GNU General Public License
+ *            as published by the Free Software Foundation, either version
+ *            2 of the License, or (at your option) any later version.
+ *            A full copy of the GNU General Public License can be found in
+ *            LICENSE
+ */
+#include "bigarchivewriter.h"
+#include "endiantype.h"
+#include "file.h"
+#include "localfilesystem.h"
+#include <algorithm>
+#include <captainslog.h>
+#include <cstring>
+#include <set>
+#include <string>
+
+using std::memcpy;
+
+namespace
+{
+const int BIG_HEADER_SIZE = 16;
+const int BIG_NAME_MAX = 260;
+const int COPY_BUFFER_SIZE = 1024 * 1024;
+
+void Write_Be32(std::vector<char> &data, uint32_t value)
+{
+    value = htobe32(value);
+    data.insert(data.end(), reinterpret_cast<char *>(&value), reinterpret_cast<char *>(&value) + sizeof(value));
+}
+
+uint32_t Align(uint32_t value, uint32_t alignment)
+{
+    return (value + alignment - 1) / alignment * alignment;
+}
+} // namespace
+
+namespace Thyme
+{
+
+BIGArchiveWriter::BIGArchiveWriter() : m_alignment(1) {}
+
+/**
+ * Names are matched ignoring case and path separator style the way the archive file system looks them up.
+ */
+Utf8String BIGArchiveWriter::Normalize_Name(Utf8String const &name)
+{
+    Utf8String normalized = name.Windows_Path();
+    normalized.To_Lower();
+
+    return normalized;
+}
+
+bool BIGArchiveWriter::Add_File(Utf8String const &name, Utf8String const &path)
+{
+    FileInfo info;
+
+    if (!g_theLocalFileSystem->Get_File_Info(path, &info) || info.file_size_high != 0 || info.file_size_low > INT32_MAX) {
+        captainslog_warn("Could not add '%s' to the archive, it is missing or too large.", path.Str());
+        return false;
+    }
+
+    Entry entry;
+    entry.name = name;
+    entry.source = path;
+    entry.source_offset = 0;
+    entry.size = info.file_size_low;
+    entry.position = 0;
+    Add_Entry(entry);
+
+    return true;
+}
+
+/**
+ * Adds every file below the directory, named by their path relative to it.
+ */
+int BIGArchiveWriter::Add_Directory(Utf8String const &path)
+{
+    Utf8String dir = path;
+
+    // The local file system expects directories to end with a separator.
+    if (dir.Is_Not_Empty() && !dir.Ends_With("/") && !dir.Ends_With("\\")) {
+        dir += "/";
+    }
+
+    std::set<Utf8String, rts::less_than_nocase<Utf8String>> file_list;
+    g_theLocalFileSystem->Get_File_List_In_Directory(dir, "", "*", file_list, true);
+    int added = 0;
+
+    for (auto it = file_list.begin(); it != file_list.end(); ++it) {
+        if (it->Get_Length() <= dir.Get_Length()) {
+            continue;
+        }
+
+        Utf8String name = it->Str() + dir.Get_Length();
+
+        if (Add_File(name.Windows_Path(), *it)) {
+            ++added;
+        }
+    }
+
+    return added;
+}
+
+/**
+ * Adds the entries of an existing BIGF or BIG4 archive, their data is copied straight out of it when writing.
+ */
+int BIGArchiveWriter::Add_Archive(Utf8String const &path)
+{
+    File *file = g_theLocalFileSystem->Open_File(path.Str(), File::READ | File::BINARY);
+
+    if (file == nullptr) {
+        captainslog_warn("Could not open archive '%s'.", path.Str());
+        return 0;
+    }
+
+    int file_size = file->Size();
+    uint32_t header[4];
+
+    if (file->Read(header, sizeof(header)) != sizeof(header)
+        || (memcmp(header, "BIGF", 4) != 0 && memcmp(header, "BIG4", 4) != 0)) {
+        captainslog_warn("'%s' is not a BIG archive.", path.Str());
+        file->Close();
+        return 0;
+    }
+
+    uint32_t file_count = be32toh(header[2]);
+    uint32_t header_end = be32toh(header[3]);
+    int dir_size = int(std::min<int64_t>(int64_t(file_count) * (8 + BIG_NAME_MAX), file_size - BIG_HEADER_SIZE));
+
+    // Prefer the header end offset when it is sane, it saves reading data along with the directory.
+    if (header_end > uint32_t(BIG_HEADER_SIZE) && header_end <= uint32_t(file_size)) {
+        dir_size = std::min<int>(dir_size, header_end - BIG_HEADER_SIZE);
+    }
+
+    std::vector<char> dir(std::max(dir_size, 1));
+    dir_size = std::max(file->Read(&dir[0], dir_size), 0);
+    file->Close();
+
+    const char *getp = &dir[0];
+    const char *endp = getp + dir_size;
+    int added = 0;
+
+    for (uint32_t i = 0; i < file_count; ++i) {
+        uint32_t values[2];
+
+        if (endp - getp < int(sizeof(values))) {
+            break;
+        }
+
+        memcpy(values, getp, sizeof(values));
+        getp += sizeof(values);
+        const char *name_end = static_cast<const char *>(memchr(getp, '\0', endp - getp));
+
+        if (name_end == nullptr) {
+            break;
+        }
+
+        Entry entry;
+        entry.name = getp;
+        entry.source = path;
+        entry.source_offset = be32toh(values[0]);
+        entry.size = be32toh(values[1]);
+        entry.position = 0;
+        getp = name_end + 1;
+
+        if (int64_t(entry.source_offset) + entry.size > file_size) {
+            captainslog_warn("Skipping '%s' in '%s', it extends past the end of the archive.", entry.name.Str(), path.Str());
+            continue;
+        }
+
+        Add_Entry(entry);
+        ++added;
+    }
+
+    if (added != int(file_count)) {
+        captainslog_warn("Only %d of %u entries could be read from '%s'.", added, file_count, path.Str());
+    }
+
+    return added;
+}
+
+/**
+ * Reads a trace of file names one per line, as written by FileSystem::End_Access_Trace. Anything after a tab on a line
+ * is ignored, as are blank lines and lines starting with '#'.
+ */
+int BIGArchiveWriter::Load_Access_Trace(Utf8String const &path)
+{
+    File *file = g_theLocalFileSystem->Open_File(path.Str(), File::READ | File::BINARY);
+
+    if (file == nullptr) {
+        captainslog_warn("Could not open access trace '%s'.", path.Str());
+        return 0;
+    }
+
+    int size = file->Size();
+    char *data = static_cast<char *>(file->Read_Entire_And_Close());
+    std::vector<Utf8String> names;
+    const char *line = data;
+    const char *endp = data + std::max(size, 0);
+
+    while (line < endp) {
+        const char *line_end = std::find(line, endp, '\n');
+        const char *name_end = std::find(line, line_end, '\t');
+
+        while (name_end > line && (name_end[-1] == '\r' || name_end[-1] == ' ' || name_end[-1] == '\t')) {
+            --name_end;
+        }
+
+        if (name_end > line && *line != '#') {
+            names.push_back(std::string(line, name_end).c_str());
+        }
+
+        line = line_end + 1;
+    }
+
+    delete[] data;
+    Set_Access_Order(names);
+
+    return int(names.size());
+}
+
+/**
+ * Sets the order entries are written in, only the first appearance of a name counts.
+ */
+void BIGArchiveWriter::Set_Access_Order(std::vector<Utf8String> const &names)
+{
+    m_accessOrder.clear();
+
+    for (auto it = names.begin(); it != names.end(); ++it) {
+        m_accessOrder.insert(std::make_pair(Normalize_Name(*it), int(m_accessOrder.size())));
+    }
+}
+
+int BIGArchiveWriter::Get_Traced_Entry_Count() const
+{
+    int count = 0;
+
+    for (auto it = m_entryIndex.begin(); it != m_entryIndex.end(); ++it) {
+        if (m_accessOrder.find(it->first) != m_accessOrder.end()) {
+            ++count;
+        }
+    }
+
+    return count;
+}
+
+/**
+ * Writes the archive. Entry data starts on a multiple of the alignment so each file begins on its own page and the
+ * first access order makes a cold load read the archive mostly sequentially.
+ */
+bool BIGArchiveWriter::Write(Utf8String const &path)
+{
+    std::vector<Entry *> order;
+    Sort_Entries(order);
+
+    // Directory first, entries store their final position so it has to be laid out before any data is written.
+    uint64_t header_size = BIG_HEADER_SIZE;
+
+    for (auto it = order.begin(); it != order.end(); ++it) {
+        header_size += 8 + (*it)->name.Get_Length() + 1;
+    }
+
+    uint64_t position = Align(uint32_t(header_size), m_alignment);
+    uint32_t first_position = uint32_t(position);
+
+    for (auto it = order.begin(); it != order.end(); ++it) {
+        position = Align(uint32_t(position), m_alignment);
+        (*it)->position = uint32_t(position);
+        position += (*it)->size;
+
+        if (position > UINT32_MAX - m_alignment) {
+            captainslog_warn("Archive '%s' would be larger than the 4GB a BIG archive can address.", path.Str());
+            return false;
+        }
+    }
+
+    std::vector<char> header;
+    header.insert(header.end(), "BIGF", "BIGF" + 4);
+    uint32_t archive_size = htole32(uint32_t(position));
+    header.insert(header.end(), reinterpret_cast<char *>(&archive_size), reinterpret_cast<char *>(&archive_size) + 4);
+    Write_Be32(header, uint32_t(order.size()));
+    Write_Be32(header, first_position);
+
+    for (auto it = order.begin(); it != order.end(); ++it) {
+        Write_Be32(header, (*it)->position);
+        Write_Be32(header, (*it)->size);
+        header.insert(header.end(), (*it)->name.Str(), (*it)->name.Str() + (*it)->name.Get_Length() + 1);
+    }
+
+    header.resize(first_position, '\0');
+    File *dst = g_theLocalFileSystem->Open_File(path.Str(), File::WRITE | File::CREATE | File::TRUNCATE | File::BINARY);
+
+    if (dst == nullptr) {
+        captainslog_warn("Could not open '%s' for writing.", path.Str());
+        return false;
+    }
+
+    bool written = dst->Write(&header[0], int(header.size())) == int(header.size());
+    uint32_t written_size = first_position;
+    std::vector<char> buffer(COPY_BUFFER_SIZE);
+    File *source = nullptr;
+    Utf8String source_name;
+
+    for (auto it = order.begin(); written && it != order.end(); ++it) {
+        // Pad up to the aligned start of the entry.
+        uint32_t padding = (*it)->position - written_size;
+
+        while (written && padding > 0) {
+            int chunk = int(std::min<uint32_t>(padding, uint32_t(buffer.size())));
+            std::fill(buffer.begin(), buffer.begin() + chunk, '\0');
+            written = dst->Write(&buffer[0], chunk) == chunk;
+            padding -= chunk;
+        }
+
+        written = written && Copy_Entry(dst, **it, source, source_name, buffer);
+        written_size = (*it)->position + (*it)->size;
+    }
+
+    if (source != nullptr) {
+        source->Close();
+    }
+
+    dst->Close();
+
+    if (!written) {
+        captainslog_warn("Failed to write archive '%s'.", path.Str());
+    }
+
+    return written;
+}
+
+void BIGArchiveWriter::Add_Entry(Entry const &entry)
+{
+    Utf8String key = Normalize_Name(entry.name);
+    auto it = m_entryIndex.find(key);
+
+    if (it != m_entryIndex.end()) {
+        m_entries[it->second] = entry;
+    } else {
+        m_entryIndex[key] = int(m_entries.size());
+        m_entries.push_back(entry);
+    }
+}
+
+void BIGArchiveWriter::Sort_Entries(std::vector<Entry *> &order)
+{
+    // Traced entries come first in trace order, the rest in name order so the output doesn't depend on input order.
+    std::vector<std::pair<int, Entry *>> traced;
+
+    for (auto it = m_entryIndex.begin(); it != m_entryIndex.end(); ++it) {
+        auto trace_it = m_accessOrder.find(it->first);
+
+        if (trace_it != m_accessOrder.end()) {
+            traced.push_back(std::make_pair(trace_it->second, &m_entries[it->second]));
+        }
+    }
+
+    std::sort(traced.begin(), traced.end());
+    order.clear();
+
+    for (auto it = traced.begin(); it != traced.end(); ++it) {
+        order.push_back(it->second);
+    }
+
+    for (auto it = m_entryIndex.begin(); it != m_entryIndex.end(); ++it) {
+        if (m_accessOrder.find(it->first) == m_accessOrder.end()) {
+            order.push_back(&m_entries[it->second]);
+        }
+    }
+}
+
+bool BIGArchiveWriter::Copy_Entry(
+    File *dst, Entry const &entry, File *&source, Utf8String &source_name, std::vector<char> &buffer)
+{
+    // Consecutive entries often come from the same archive, keep it open rather than reopening it for each one.
+    if (source == nullptr || source_name != entry.source) {
+        if (source != nullptr) {
+            source->Close();
+        }
+
+        source_name = entry.source;
+        source = g_theLocalFileSystem->Open_File(source_name.Str(), File::READ | File::BINARY);
+
+        if (source == nullptr) {
+            captainslog_warn("Could not open '%s' to copy '%s' from.", source_name.Str(), entry.name.Str());
+            return false;
+        }
+    }
+
+    if (entry.source_offset > INT32_MAX || source->Seek(int(entry.source_offset), File::START) != int(entry.source_offset)) {
+        captainslog_warn("Could not seek to '%s' in '%s'.", entry.name.Str(), source_name.Str());
+        return false;
+    }
+
+    uint32_t remaining = entry.size;
+
+    while (remaining > 0) {
+        int chunk = int(std::min<uint32_t>(remaining, uint32_t(buffer.size())));
+
+        if (source->Read(&buffer[0], chunk) != chunk || dst->Write(&buffer[0], chunk) != chunk) {
+            captainslog_warn("Failed to copy '%s' from '%s'.", entry.name.Str(), source_name.Str());
+            return false;
+        }
+
+        remaining -= chunk;
+    }
+
+    return true;
+}
+
+} // namespace Thyme
@@ -0,0 +1,72 @@
+/**
+ * @file
+ *
+ * @author OmniBlade
+ *
+ * @brief Writer for BIG archives that can lay entries out in the order the game reads them. (Thyme Feature)
+ *
+ * @copyright Thyme is free software: you can redistribute it and/or
+ *            modify it under the terms of the GNU General Public License
+ *            as published by the Free Software Foundation, either version
+ *            2 of the License, or (at your option) any later version.
+ *            A full copy of the GNU General Public License can be found in
+ *            LICENSE
+ */
+#pragma once
+
+#include "always.h"
+#include "asciistring.h"
+#include <map>
+#include <vector>
+
+class File;
+
+namespace Thyme
+{
+
+// Collects entries from loose files and existing archives and writes them out as a BIGF archive. All file access goes
+// through g_theLocalFileSystem. Entries with the same name replace the ones added before them.
+class BIGArchiveWriter
+{
+public:
+    BIGArchiveWriter();
+
+    bool Add_File(Utf8String const &name, Utf8String const &path);
+    int Add_Directory(Utf8String const &path);
+    int Add_Archive(Utf8String const &path);
+
+    // Entries named in the trace are written first in the order they appear, everything else follows sorted by name.
+    int Load_Access_Trace(Utf8String const &path);
+    void Set_Access_Order(std::vector<Utf8String> const &names);
+
+    void Set_Alignment(int alignment) { m_alignment = alignment > 0 ? alignment : 1; }
+    int Get_Alignment() const { return m_alignment; }
+    int Get_Entry_Count() const { return int(m_entries.size()); }
+    int Get_Traced_Entry_Count() const;
+
+    bool Write(Utf8String const &path);
+
+    static Utf8String Normalize_Name(Utf8String const &name);
+
+private:
+    struct Entry
+    {
+        Utf8String name; // Name as stored in the archive.
+        Utf8String source; // Loose file or archive holding the data.
+        uint32_t source_offset;
+        uint32_t size;
+        uint32_t position; // Where the entry ends up in the written archive.
+    };
+
+    void Add_Entry(Entry const &entry);
+    void Sort_Entries(std::vector<Entry *> &order);
+    bool Copy_Entry(File *dst, Entry const &entry, File *&source, Utf8String &source_name, std::vector<char> &buffer);
+
+private:
+    std::vector<Entry> m_entries;
+    std::map<Utf8String, int> m_entryIndex;
+    std::map<Utf8String, int> m_accessOrder;
+    int m_alignment;
+};
+
+} // namespace Thyme
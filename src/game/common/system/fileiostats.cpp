@@ -0,0 +1,303 @@
+/**
+ * @file
+ *
+ * @author OmniBlade
+ *
+ * @brief Per file counters for opens and reads through the file systems. (Thyme Feature)
+ *
+ * @copyright Thyme is free software: you can redistribute it and/or
+ *            modify it under the terms of the GNU General Public License
+ *            as published by the Free Software Foundation, either version
+ *            2 of the License, or (at your option) any later version.
+ *            A full copy of the GNU General Public License can be found in
+ *            LICENSE
+ */
+#include "fileiostats.h"
+#include "statsmap.h"
+#include <cctype>
+#include <chrono>
+#include <cinttypes>
+#include <cstdio>
+
+namespace
+{
+const char STATS_CSV_FILE[] = "FileIOStats.csv";
+const char STATS_JSON_FILE[] = "FileIOStats.json";
+
+Thyme::StatsMap<Thyme::FileIOStats::FileRecord> s_records;
+
+// Caller holds the records' lock.
+Thyme::FileIOStats::FileRecord &Get_Or_Add_Record(const char *filename)
+{
+    bool added;
+    Thyme::FileIOStats::FileRecord &record = s_records.Find_Or_Add(Thyme::FileIOStats::Make_Key(filename), added);
+
+    if (added) {
+        record.name = filename;
+        record.source = Thyme::FileIOStats::SOURCE_UNKNOWN;
+    }
+
+    return record;
+}
+
+// Busiest files first so the interesting end of the dump is at the top.
+bool Record_Cost_Greater(Thyme::FileIOStats::FileRecord const &a, Thyme::FileIOStats::FileRecord const &b)
+{
+    uint64_t a_cost = a.open_micros + a.read_micros;
+    uint64_t b_cost = b.open_micros + b.read_micros;
+
+    if (a_cost != b_cost) {
+        return a_cost > b_cost;
+    }
+
+    return a.name < b.name;
+}
+
+void Write_Quoted(FILE *fp, std::string const &str, char escape)
+{
+    fputc('"', fp);
+
+    for (auto it = str.begin(); it != str.end(); ++it) {
+        // CSV doubles quotes, JSON escapes them along with the backslashes in game paths.
+        if (*it == '"' || (escape == '\\' && *it == '\\')) {
+            fputc(escape, fp);
+        }
+
+        fputc(*it, fp);
+    }
+
+    fputc('"', fp);
+}
+
+void Add_To_Totals(Thyme::FileIOStats::FileRecord &totals, Thyme::FileIOStats::FileRecord const &record)
+{
+    totals.opens += record.opens;
+    totals.misses += record.misses;
+    totals.reads += record.reads;
+    totals.bytes_read += record.bytes_read;
+    totals.open_micros += record.open_micros;
+    totals.read_micros += record.read_micros;
+}
+
+void Write_JSON_Totals(FILE *fp, Thyme::FileIOStats::FileRecord const &totals)
+{
+    fprintf(fp,
+        "{ \"opens\": %u, \"misses\": %u, \"reads\": %u, \"bytes_read\": %" PRIu64 ", \"open_us\": %" PRIu64
+        ", \"read_us\": %" PRIu64 " }",
+        totals.opens,
+        totals.misses,
+        totals.reads,
+        totals.bytes_read,
+        totals.open_micros,
+        totals.read_micros);
+}
+} // namespace
+
+namespace Thyme
+{
+
+// Read by the IO threads without taking the lock.
+std::atomic<bool> FileIOStats::s_enabled;
+
+/**
+ * Starts counting, counts from an earlier run are kept until Reset. FileSystem's access trace gives the order of opens.
+ */
+void FileIOStats::Enable()
+{
+    ScopedCriticalSectionClass cs(s_records.Get_Lock());
+    s_enabled = true;
+}
+
+void FileIOStats::Disable()
+{
+    ScopedCriticalSectionClass cs(s_records.Get_Lock());
+    s_enabled = false;
+}
+
+void FileIOStats::Reset()
+{
+    s_records.Clear();
+}
+
+void FileIOStats::Record_Open(const char *filename, FileSource source, uint64_t micros)
+{
+    ScopedCriticalSectionClass cs(s_records.Get_Lock());
+
+    if (!s_enabled) {
+        return;
+    }
+
+    FileRecord &record = Get_Or_Add_Record(filename);
+    record.source = source;
+    ++record.opens;
+    record.open_micros += micros;
+}
+
+void FileIOStats::Record_Miss(const char *filename)
+{
+    ScopedCriticalSectionClass cs(s_records.Get_Lock());
+
+    if (s_enabled) {
+        ++Get_Or_Add_Record(filename).misses;
+    }
+}
+
+void FileIOStats::Record_Read(const char *filename, int bytes, uint64_t micros)
+{
+    ScopedCriticalSectionClass cs(s_records.Get_Lock());
+
+    if (!s_enabled) {
+        return;
+    }
+
+    FileRecord &record = Get_Or_Add_Record(filename);
+    ++record.reads;
+    record.bytes_read += bytes;
+    record.read_micros += micros;
+}
+
+bool FileIOStats::Get_Record(const char *filename, FileRecord &record)
+{
+    return s_records.Find(Make_Key(filename), record);
+}
+
+void FileIOStats::Get_Records(std::vector<FileRecord> &records)
+{
+    s_records.Get_Sorted(records, Record_Cost_Greater);
+}
+
+/**
+ * One line per file with its counters, times are in microseconds.
+ */
+bool FileIOStats::Write_CSV(const char *filename)
+{
+    FILE *fp = Open_Stats_File(filename, "file IO stats");
+
+    if (fp == nullptr) {
+        return false;
+    }
+
+    std::vector<FileRecord> records;
+    Get_Records(records);
+    fprintf(fp, "name,source,opens,misses,reads,bytes_read,open_us,read_us\n");
+
+    for (auto it = records.begin(); it != records.end(); ++it) {
+        Write_Quoted(fp, it->name, '"');
+        fprintf(fp,
+            ",%s,%u,%u,%u,%" PRIu64 ",%" PRIu64 ",%" PRIu64 "\n",
+            Get_Source_Name(it->source),
+            it->opens,
+            it->misses,
+            it->reads,
+            it->bytes_read,
+            it->open_micros,
+            it->read_micros);
+    }
+
+    fclose(fp);
+
+    return true;
+}
+
+/**
+ * Same counters as the CSV plus totals for everything and for each source. Archive files themselves are loose files so
+ * the bytes read to service archive entries are counted against both.
+ */
+bool FileIOStats::Write_JSON(const char *filename)
+{
+    FILE *fp = Open_Stats_File(filename, "file IO stats");
+
+    if (fp == nullptr) {
+        return false;
+    }
+
+    std::vector<FileRecord> records;
+    Get_Records(records);
+
+    FileRecord totals[SOURCE_COUNT + 1] = {};
+
+    for (auto it = records.begin(); it != records.end(); ++it) {
+        Add_To_Totals(totals[it->source], *it);
+        Add_To_Totals(totals[SOURCE_COUNT], *it);
+    }
+
+    fprintf(fp, "{\n  \"totals\": ");
+    Write_JSON_Totals(fp, totals[SOURCE_COUNT]);
+    fprintf(fp, ",\n  \"sources\": {\n");
+
+    for (int i = 0; i < SOURCE_COUNT; ++i) {
+        fprintf(fp, "    \"%s\": ", Get_Source_Name(FileSource(i)));
+        Write_JSON_Totals(fp, totals[i]);
+        fprintf(fp, i + 1 < SOURCE_COUNT ? ",\n" : "\n");
+    }
+
+    fprintf(fp, "  },\n  \"files\": [\n");
+
+    for (auto it = records.begin(); it != records.end(); ++it) {
+        fprintf(fp, "    { \"name\": ");
+        Write_Quoted(fp, it->name, '\\');
+        fprintf(fp,
+            ", \"source\": \"%s\", \"opens\": %u, \"misses\": %u, \"reads\": %u, \"bytes_read\": %" PRIu64
+            ", \"open_us\": %" PRIu64 ", \"read_us\": %" PRIu64 " }%s\n",
+            Get_Source_Name(it->source),
+            it->opens,
+            it->misses,
+            it->reads,
+            it->bytes_read,
+            it->open_micros,
+            it->read_micros,
+            it + 1 != records.end() ? "," : "");
+    }
+
+    fprintf(fp, "  ]\n}\n");
+    fclose(fp);
+
+    return true;
+}
+
+/**
+ * Writes the stats to the working directory alongside the other asset usage logs, does nothing if they weren't enabled.
+ */
+void FileIOStats::Dump()
+{
+    if (!s_enabled) {
+        return;
+    }
+
+    Write_CSV(STATS_CSV_FILE);
+    Write_JSON(STATS_JSON_FILE);
+}
+
+uint64_t FileIOStats::Get_Micros()
+{
+    return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+}
+
+const char *FileIOStats::Get_Source_Name(FileSource source)
+{
+    switch (source) {
+        case SOURCE_LOCAL:
+            return "local";
+        case SOURCE_ARCHIVE:
+            return "archive";
+        default:
+            return "unknown";
+    }
+}
+
+/**
+ * Key file names are recorded under by the stats and FileSystem's access trace, case and separator insensitive.
+ */
+std::string FileIOStats::Make_Key(const char *filename)
+{
+    std::string key = filename;
+
+    for (auto it = key.begin(); it != key.end(); ++it) {
+        *it = *it == '/' ? '\\' : char(tolower(static_cast<unsigned char>(*it)));
+    }
+
+    return key;
+}
+
+} // namespace Thyme
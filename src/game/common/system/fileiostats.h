@@ -0,0 +1,103 @@
+/**
+ * @file
+ *
+ * @author OmniBlade
+ *
+ * @brief Per file counters for opens and reads through the file systems. (Thyme Feature)
+ *
+ * @copyright Thyme is free software: you can redistribute it and/or
+ *            modify it under the terms of the GNU General Public License
+ *            as published by the Free Software Foundation, either version
+ *            2 of the License, or (at your option) any later version.
+ *            A full copy of the GNU General Public License can be found in
+ *            LICENSE
+ */
+#pragma once
+
+#include "always.h"
+#include <atomic>
+#include <string>
+#include <vector>
+
+namespace Thyme
+{
+
+// Counts how often each file is opened and read, how many bytes that reads and how long it takes, split by whether the
+// file was loose on disk or inside an archive. Disabled by default, the file systems only check a flag until enabled.
+// Storage uses std::string as the stats can outlive the game's memory manager. Safe to use from several threads.
+class FileIOStats
+{
+public:
+    enum FileSource
+    {
+        SOURCE_UNKNOWN,
+        SOURCE_LOCAL,
+        SOURCE_ARCHIVE,
+        SOURCE_COUNT,
+    };
+
+    struct FileRecord
+    {
+        std::string name; // Name as first seen, the records are keyed case and separator insensitively.
+        FileSource source;
+        uint32_t opens;
+        uint32_t misses; // Opens that found the file in neither file system.
+        uint32_t reads;
+        uint64_t bytes_read;
+        uint64_t open_micros;
+        uint64_t read_micros;
+    };
+
+    static void Enable();
+    static void Disable();
+    static void Reset();
+    static bool Is_Enabled() { return s_enabled; }
+
+    static void Record_Open(const char *filename, FileSource source, uint64_t micros);
+    static void Record_Miss(const char *filename);
+    static void Record_Read(const char *filename, int bytes, uint64_t micros);
+
+    static bool Get_Record(const char *filename, FileRecord &record);
+    static void Get_Records(std::vector<FileRecord> &records);
+
+    static bool Write_CSV(const char *filename);
+    static bool Write_JSON(const char *filename);
+    static void Dump();
+
+    static uint64_t Get_Micros();
+    static const char *Get_Source_Name(FileSource source);
+    static std::string Make_Key(const char *filename);
+
+private:
+    static std::atomic<bool> s_enabled;
+};
+
+// Times one open or read when the stats are enabled, does nothing otherwise.
+class FileIOTimer
+{
+public:
+    FileIOTimer() : m_active(FileIOStats::Is_Enabled()), m_start(m_active ? FileIOStats::Get_Micros() : 0) {}
+
+    void Opened(const char *filename, FileIOStats::FileSource source) const
+    {
+        if (m_active) {
+            FileIOStats::Record_Open(filename, source, FileIOStats::Get_Micros() - m_start);
+        }
+    }
+
+    // Returns bytes so the result of the read can be passed straight through.
+    int Read(const char *filename, int bytes) const
+    {
+        if (m_active && bytes > 0) {
+            FileIOStats::Record_Read(filename, bytes, FileIOStats::Get_Micros() - m_start);
+        }
+
+        return bytes;
+    }
+
+private:
+    bool m_active;
+    uint64_t m_start;
+};
+
+} // namespace Thyme
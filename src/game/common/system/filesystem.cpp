@@ -14,13 +14,72 @@
  */
 #include "filesystem.h"
 #include "archivefilesystem.h"
+#include "fileiostats.h"
 #include "localfilesystem.h"
+#include "memdynalloc.h"
+#include "mempool.h"
 #include "namekeygenerator.h"
+#include <algorithm>
+#include <atomic>
+#include <captainslog.h>
+#include <cinttypes>
+#include <cstdio>
+#include <set>
+#include <string>
+#include <vector>
 
 #ifndef GAME_DLL
 FileSystem *g_theFileSystem = nullptr;
 #endif
 
+namespace
+{
+// Disk IO doesn't scale with core count the way parsing does so only a couple of threads service requests.
+const int MAX_IO_THREADS = 2;
+
+SimpleCriticalSectionClass s_ioPoolLock;
+Thyme::WorkerPool *s_ioPool;
+int s_ioWaiters; // Threads inside Wait_For_IO, the pool can't be deleted until they leave.
+
+struct AccessEvent
+{
+    std::string name;
+    uint64_t micros; // Since the trace began.
+    uint64_t open_micros;
+    Thyme::FileIOStats::FileSource source;
+};
+
+// Uses std::string as the trace can outlive the game's memory manager.
+SimpleCriticalSectionClass s_accessTraceLock;
+std::atomic<bool> s_accessTraceEnabled;
+std::string s_accessTracePath;
+uint64_t s_accessTraceStart;
+std::vector<AccessEvent> s_accessTrace;
+std::set<std::string> s_accessTraceSeen;
+
+void Record_Access(const char *filename, Thyme::FileIOStats::FileSource source, uint64_t start)
+{
+    uint64_t now = Thyme::FileIOStats::Get_Micros();
+    std::string key = Thyme::FileIOStats::Make_Key(filename);
+    ScopedCriticalSectionClass cs(&s_accessTraceLock);
+
+    if (s_accessTraceEnabled && s_accessTraceSeen.insert(key).second) {
+        AccessEvent event;
+        event.name = filename;
+        event.micros = start - s_accessTraceStart;
+        event.open_micros = now - start;
+        event.source = source;
+        s_accessTrace.push_back(event);
+    }
+}
+} // namespace
+
+FileSystem::~FileSystem()
+{
+    End_Access_Trace();
+    Thyme::FileIOStats::Dump();
+}
+
 void FileSystem::Init()
 {
     g_theLocalFileSystem->Init();
@@ -42,20 +101,228 @@ void FileSystem::Update()
 File *FileSystem::Open_File(const char *filename, int mode)
 {
     File *file = nullptr;
+    bool tracing = s_accessTraceEnabled && (mode & File::WRITE) == 0;
+    uint64_t trace_start = tracing ? Thyme::FileIOStats::Get_Micros() : 0;
 
     if (g_theLocalFileSystem != nullptr) {
+#ifndef GAME_DLL
+        // Files being written always go to disk, otherwise only look there if the index says there is a loose file.
+        if ((mode & File::WRITE) != 0) {
+            file = g_theLocalFileSystem->Open_File(filename, mode);
+
+            if (file != nullptr) {
+                m_localIndex.Add(filename);
+            }
+        } else if (m_localIndex.Find(filename) != Thyme::LocalFileIndex::FILE_MISSING) {
+            file = g_theLocalFileSystem->Open_File(filename, mode);
+        }
+#else
         file = g_theLocalFileSystem->Open_File(filename, mode);
+#endif
     }
 
+    Thyme::FileIOStats::FileSource source = Thyme::FileIOStats::SOURCE_LOCAL;
+
     if (file == nullptr && g_theArchiveFileSystem != nullptr) {
         file = g_theArchiveFileSystem->Open_File(filename, 0);
+        source = Thyme::FileIOStats::SOURCE_ARCHIVE;
+    }
+
+    if (tracing && file != nullptr) {
+        Record_Access(filename, source, trace_start);
+    }
+
+    if (file == nullptr && (mode & File::WRITE) == 0 && Thyme::FileIOStats::Is_Enabled()) {
+        Thyme::FileIOStats::Record_Miss(filename);
     }
 
     return file;
 }
 
+/**
+ * Starts recording the files opened for reading, End_Access_Trace writes them to the passed file in first open order.
+ */
+void FileSystem::Begin_Access_Trace(const char *filename)
+{
+    ScopedCriticalSectionClass cs(&s_accessTraceLock);
+    s_accessTracePath = filename;
+    s_accessTraceStart = Thyme::FileIOStats::Get_Micros();
+    s_accessTrace.clear();
+    s_accessTraceSeen.clear();
+    s_accessTraceEnabled = true;
+}
+
+/**
+ * Stops recording and writes the trace, one file per line. The name comes first so the trace can be read as a plain list
+ * of names, the tab separated columns after it give when the file was first opened and how long that took in
+ * microseconds and whether it came from disk or an archive.
+ */
+bool FileSystem::End_Access_Trace()
+{
+    ScopedCriticalSectionClass cs(&s_accessTraceLock);
+
+    if (!s_accessTraceEnabled) {
+        return false;
+    }
+
+    s_accessTraceEnabled = false;
+    FILE *fp = fopen(s_accessTracePath.c_str(), "w");
+
+    if (fp == nullptr) {
+        captainslog_warn("Could not write file access trace to '%s'.", s_accessTracePath.c_str());
+        return false;
+    }
+
+    fprintf(fp, "# File access trace, files in the order they were first opened.\n");
+    fprintf(fp, "# name\ttime_us\topen_us\tsource\n");
+
+    for (auto it = s_accessTrace.begin(); it != s_accessTrace.end(); ++it) {
+        fprintf(fp,
+            "%s\t%" PRIu64 "\t%" PRIu64 "\t%s\n",
+            it->name.c_str(),
+            it->micros,
+            it->open_micros,
+            Thyme::FileIOStats::Get_Source_Name(it->source));
+    }
+
+    fclose(fp);
+    s_accessTrace.clear();
+    s_accessTraceSeen.clear();
+
+    return true;
+}
+
+bool FileSystem::Is_Tracing_Access()
+{
+    return s_accessTraceEnabled;
+}
+
+/**
+ * Queues a job for asynchronous file requests or read ahead on the IO threads. Returns false if the game heap isn't
+ * thread safe yet, in which case the caller runs the job itself. Callers never hold on to the pool as it is deleted
+ * by Shutdown_IO.
+ */
+bool FileSystem::Submit_IO(Thyme::WorkerJob *job)
+{
+    // The IO threads allocate files and buffers from the game heap which is only safe once it has its locks.
+    if (g_memoryPoolCriticalSection == nullptr || g_dmaCriticalSection == nullptr) {
+        return false;
+    }
+
+    ScopedCriticalSectionClass cs(&s_ioPoolLock);
+
+    if (s_ioPool == nullptr) {
+        s_ioPool = new Thyme::WorkerPool(
+            "File IO", std::min(MAX_IO_THREADS, Thyme::WorkerPool::Get_Default_Thread_Count()));
+    }
+
+    s_ioPool->Submit(job);
+
+    return true;
+}
+
+/**
+ * Blocks until a job passed to Submit_IO is complete.
+ */
+void FileSystem::Wait_For_IO(Thyme::WorkerJob *job)
+{
+    Thyme::WorkerPool *pool;
+
+    {
+        ScopedCriticalSectionClass cs(&s_ioPoolLock);
+
+        if (job->Is_Complete()) {
+            return;
+        }
+
+        pool = s_ioPool;
+
+        if (pool != nullptr) {
+            ++s_ioWaiters;
+        }
+    }
+
+    if (pool != nullptr) {
+        pool->Wait(job);
+        ScopedCriticalSectionClass cs(&s_ioPoolLock);
+        --s_ioWaiters;
+
+        return;
+    }
+
+    // The pool the job was queued on has been detached by Shutdown_IO, which completes the job as it deletes the pool.
+    while (!job->Is_Complete()) {
+        ThreadClass::Switch_Thread();
+    }
+}
+
+/**
+ * Completes any outstanding IO jobs and stops the IO threads. The pool is shared by every file system so this is only
+ * called once they are done with, before the game heap goes away. Submit_IO starts a new pool if it is called again.
+ */
+void FileSystem::Shutdown_IO()
+{
+    Thyme::WorkerPool *pool;
+
+    // Let anyone already waiting on the pool finish with it, then detach it so nothing new is queued on it.
+    while (true) {
+        {
+            ScopedCriticalSectionClass cs(&s_ioPoolLock);
+
+            if (s_ioWaiters == 0) {
+                pool = s_ioPool;
+                s_ioPool = nullptr;
+                break;
+            }
+        }
+
+        ThreadClass::Switch_Thread();
+    }
+
+    delete pool;
+}
+
+/**
+ * Opens a file without blocking the caller, files not opened for writing or streaming are already in memory by the time
+ * the request completes.
+ */
+Thyme::AsyncFileRequest *FileSystem::Open_File_Async(
+    const char *filename, int mode, Thyme::AsyncFileCallback callback, void *user_data)
+{
+    Thyme::AsyncFileRequest *request =
+        new Thyme::AsyncFileRequest(this, Thyme::AsyncFileRequest::REQUEST_OPEN, filename, mode, callback, user_data);
+    request->Submit();
+
+    return request;
+}
+
+/**
+ * Reads the entire contents of a file into a buffer without blocking the caller.
+ */
+Thyme::AsyncFileRequest *FileSystem::Read_File_Async(
+    const char *filename, Thyme::AsyncFileCallback callback, void *user_data)
+{
+    Thyme::AsyncFileRequest *request =
+        new Thyme::AsyncFileRequest(this, Thyme::AsyncFileRequest::REQUEST_READ, filename, 0, callback, user_data);
+    request->Submit();
+
+    return request;
+}
+
 bool FileSystem::Does_File_Exist(const char *filename) const
 {
+#ifndef GAME_DLL
+    // The local index is kept up to date and the archive lookup is a single hash so neither needs caching.
+    switch (m_localIndex.Find(filename)) {
+        case Thyme::LocalFileIndex::FILE_PRESENT:
+            return true;
+        case Thyme::LocalFileIndex::FILE_MISSING:
+            return g_theArchiveFileSystem != nullptr && g_theArchiveFileSystem->Does_File_Exist(filename);
+        default:
+            break;
+    }
+#endif
+
     NameKeyType name_id = g_theNameKeyGenerator->Name_To_Lower_Case_Key(filename);
     auto it = m_availableFiles.find(name_id);
 
@@ -116,5 +383,11 @@ bool FileSystem::Get_File_Info(const Utf8String &filename, FileInfo *info) const
 
     memset(info, 0, sizeof(FileInfo));
 
+#ifndef GAME_DLL
+    if (m_localIndex.Find(filename.Str()) == Thyme::LocalFileIndex::FILE_MISSING) {
+        return g_theArchiveFileSystem != nullptr && g_theArchiveFileSystem->Get_File_Info(filename, info);
+    }
+#endif
+
     return g_theLocalFileSystem->Get_File_Info(filename, info) || g_theArchiveFileSystem->Get_File_Info(filename, info) != 0;
 }
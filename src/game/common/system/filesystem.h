@@ -14,8 +14,12 @@
  */
 #pragma once
 
+#include "asyncfilerequest.h"
 #include "file.h"
 #include "rtsutils.h"
+#ifndef GAME_DLL
+#include "localfileindex.h"
+#endif
 #include "subsysteminterface.h"
 #include <map>
 #include <set>
@@ -23,7 +27,7 @@
 class FileSystem : public SubsystemInterface
 {
 public:
-    virtual ~FileSystem() {}
+    virtual ~FileSystem();
 
     // SubsystemInterface implementations
     virtual void Init();
@@ -39,6 +43,20 @@ public:
         bool a5) const;
     bool Get_File_Info(const Utf8String &filename, FileInfo *info) const;
 
+    // Thyme specific, the request is serviced on the IO threads and the caller deletes it when done with the result.
+    Thyme::AsyncFileRequest *Open_File_Async(
+        const char *filename, int mode, Thyme::AsyncFileCallback callback = nullptr, void *user_data = nullptr);
+    Thyme::AsyncFileRequest *Read_File_Async(
+        const char *filename, Thyme::AsyncFileCallback callback = nullptr, void *user_data = nullptr);
+    static bool Submit_IO(Thyme::WorkerJob *job);
+    static void Wait_For_IO(Thyme::WorkerJob *job);
+    static void Shutdown_IO();
+
+    // Thyme specific, records the order files are first opened in so archives can be laid out to match.
+    static void Begin_Access_Trace(const char *filename);
+    static bool End_Access_Trace();
+    static bool Is_Tracing_Access();
+
     bool Create_Directory(Utf8String name);
     bool Are_Music_Files_On_CD();
     void Load_Music_Files_From_CD();
@@ -46,6 +64,9 @@ public:
 
 private:
     mutable std::map<unsigned int, bool> m_availableFiles;
+#ifndef GAME_DLL
+    mutable Thyme::LocalFileIndex m_localIndex; // Thyme specific, lets misses skip the disk.
+#endif
 };
 
 #ifdef GAME_DLL
@@ -20,6 +20,7 @@
 #include "memdynalloc.h"
 #include "mempool.h"
 #include "mempoolfact.h"
+#include "mempooltelemetry.h"
 
 #ifndef GAME_DLL
 bool g_thePreMainInitFlag = false;
@@ -120,6 +121,8 @@ void Init_Memory_Manager_Pre_Main()
 
 void Shutdown_Memory_Manager()
 {
+    Thyme::MemoryPoolTelemetry::Dump();
+
     if (!g_thePreMainInitFlag) {
         if (g_memoryPoolFactory != nullptr) {
             if (g_dynamicMemoryAllocator != nullptr) {
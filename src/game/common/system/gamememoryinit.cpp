@@ -650,6 +650,7 @@ static PoolSizeRec UserMemoryPools[] = {
     { "SmudgeSet", 32, 32 },
     { "Smudge", 128, 32 },
     { "StandardFile", 32, 32 }, // Thyme specific.
+    { "MappedArchiveFile", 32, 32 }, // Thyme specific.
     { nullptr, 0, 0 } // Last entry always null.
 };
 
@@ -0,0 +1,198 @@
+/**
+ * @file
+ *
+ * @author OmniBlade
+ *
+ * @brief Arena for allocations too large for the dynamic memory allocator's pools. (Thyme Feature)
+ *
+ * @copyright Thyme is free software: you can redistribute it and/or
+ *            modify it under the terms of the GNU General Public License
+ *            as published by the Free Software Foundation, either version
+ *            2 of the License, or (at your option) any later version.
+ *            A full copy of the GNU General Public License can be found in
+ *            LICENSE
+ */
+#include "hugepagearena.h"
+#include <captainslog.h>
+#include <cstring>
+
+#ifdef PLATFORM_WINDOWS
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#endif
+
+namespace
+{
+// Commit granularity and alignment of the range, the size of a huge page on x86.
+const size_t HUGE_PAGE_SIZE = 2 * 1024 * 1024;
+
+size_t Round_Up_Huge_Page(size_t bytes)
+{
+    return (bytes + HUGE_PAGE_SIZE - 1) & ~(HUGE_PAGE_SIZE - 1);
+}
+} // namespace
+
+HugePageArena::HugePageArena() :
+    m_reservation(nullptr),
+    m_reservationSize(0),
+    m_base(nullptr),
+    m_end(nullptr),
+    m_top(nullptr),
+    m_committed(nullptr)
+{
+    memset(m_freeLists, 0, sizeof(m_freeLists));
+}
+
+HugePageArena::~HugePageArena()
+{
+    if (m_reservation == nullptr) {
+        return;
+    }
+
+#ifdef PLATFORM_WINDOWS
+    VirtualFree(m_reservation, 0, MEM_RELEASE);
+#else
+    munmap(m_reservation, m_reservationSize);
+#endif
+}
+
+/**
+ * Reserves the address range without committing any of it, returns false if the OS won't give us the space.
+ */
+bool HugePageArena::Init(size_t reserve_bytes)
+{
+    captainslog_dbgassert(m_reservation == nullptr, "Arena already initialised.");
+
+    // One extra huge page so the usable range can be aligned to a huge page boundary.
+    m_reservationSize = Round_Up_Huge_Page(reserve_bytes) + HUGE_PAGE_SIZE;
+
+#ifdef PLATFORM_WINDOWS
+    // Windows large pages need a privilege most users don't have and must be committed up front, so this only gets
+    // the reduced heap traffic there.
+    m_reservation = static_cast<char *>(VirtualAlloc(nullptr, m_reservationSize, MEM_RESERVE, PAGE_NOACCESS));
+#else
+    void *reservation = mmap(nullptr, m_reservationSize, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    m_reservation = reservation != MAP_FAILED ? static_cast<char *>(reservation) : nullptr;
+#endif
+
+    if (m_reservation == nullptr) {
+        m_reservationSize = 0;
+        return false;
+    }
+
+    m_base = reinterpret_cast<char *>(Round_Up_Huge_Page(reinterpret_cast<uintptr_t>(m_reservation)));
+    m_end = m_base + Round_Up_Huge_Page(reserve_bytes);
+    m_top = m_base;
+    m_committed = m_base;
+
+    return true;
+}
+
+/**
+ * Returns nullptr when the block is bigger than the largest size class or the reserved range is used up, the caller is
+ * expected to fall back to the heap.
+ */
+void *HugePageArena::Allocate(int bytes)
+{
+    int class_size;
+    int size_class = Get_Size_Class(bytes + BLOCK_HEADER_SIZE, class_size);
+
+    if (size_class < 0 || m_base == nullptr) {
+        return nullptr;
+    }
+
+    char *block = static_cast<char *>(m_freeLists[size_class]);
+
+    if (block != nullptr) {
+        m_freeLists[size_class] = reinterpret_cast<void **>(block)[1];
+    } else {
+        if (size_t(m_end - m_top) < size_t(class_size)) {
+            return nullptr;
+        }
+
+        if (m_top + class_size > m_committed && !Commit(m_top + class_size - m_committed)) {
+            return nullptr;
+        }
+
+        block = m_top;
+        m_top += class_size;
+    }
+
+    *reinterpret_cast<intptr_t *>(block) = size_class;
+
+    return block + BLOCK_HEADER_SIZE;
+}
+
+void HugePageArena::Free(void *block)
+{
+    captainslog_dbgassert(Owns(block), "Freeing a block the arena doesn't own.");
+    char *header = static_cast<char *>(block) - BLOCK_HEADER_SIZE;
+    intptr_t size_class = *reinterpret_cast<intptr_t *>(header);
+    reinterpret_cast<void **>(header)[1] = m_freeLists[size_class];
+    m_freeLists[size_class] = header;
+}
+
+/**
+ * Smallest size class that fits, classes step by a quarter of the power of two below them. Returns -1 if too big.
+ */
+int HugePageArena::Get_Size_Class(int bytes, int &class_size)
+{
+    if (bytes <= (1 << MIN_CLASS_SHIFT)) {
+        class_size = 1 << MIN_CLASS_SHIFT;
+        return 0;
+    }
+
+    if (bytes > (1 << MAX_CLASS_SHIFT)) {
+        return -1;
+    }
+
+    int shift = MIN_CLASS_SHIFT;
+
+    // Find the power of two the size is just above.
+    while ((1 << (shift + 1)) < bytes) {
+        ++shift;
+    }
+
+    int step = (1 << shift) / STEPS_PER_SHIFT;
+    int sub_class = (bytes - (1 << shift) - 1) / step;
+    class_size = (1 << shift) + (sub_class + 1) * step;
+
+    return (shift - MIN_CLASS_SHIFT) * STEPS_PER_SHIFT + sub_class + 1;
+}
+
+/**
+ * Address space is plentiful on 64 bit, 32 bit builds need to leave most of it to the rest of the game.
+ */
+size_t HugePageArena::Get_Default_Reserve()
+{
+    return sizeof(void *) > 4 ? size_t(1024) * 1024 * 1024 : size_t(128) * 1024 * 1024;
+}
+
+bool HugePageArena::Commit(size_t bytes)
+{
+    bytes = Round_Up_Huge_Page(bytes);
+
+    if (bytes > size_t(m_end - m_committed)) {
+        return false;
+    }
+
+#ifdef PLATFORM_WINDOWS
+    if (VirtualAlloc(m_committed, bytes, MEM_COMMIT, PAGE_READWRITE) == nullptr) {
+        return false;
+    }
+#else
+    if (mprotect(m_committed, bytes, PROT_READ | PROT_WRITE) != 0) {
+        return false;
+    }
+
+#ifdef MADV_HUGEPAGE
+    // Only a hint, transparent huge pages may be disabled in which case this is ordinary memory.
+    madvise(m_committed, bytes, MADV_HUGEPAGE);
+#endif
+#endif
+
+    m_committed += bytes;
+
+    return true;
+}
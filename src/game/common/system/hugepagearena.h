@@ -0,0 +1,66 @@
+/**
+ * @file
+ *
+ * @author OmniBlade
+ *
+ * @brief Arena for allocations too large for the dynamic memory allocator's pools. (Thyme Feature)
+ *
+ * @copyright Thyme is free software: you can redistribute it and/or
+ *            modify it under the terms of the GNU General Public License
+ *            as published by the Free Software Foundation, either version
+ *            2 of the License, or (at your option) any later version.
+ *            A full copy of the GNU General Public License can be found in
+ *            LICENSE
+ */
+#pragma once
+
+#include "always.h"
+#include "rawalloc.h"
+
+// Hands out large blocks from one reserved address range that is committed in huge page sized steps, so the game's
+// big buffers share a few TLB entries instead of each going through the heap. Freed blocks go on a free list per size
+// class and are reused, nothing is given back to the OS until the arena is destroyed. Not thread safe, the owner locks.
+class HugePageArena
+{
+public:
+    enum
+    {
+        MIN_CLASS_SHIFT = 10,
+        MAX_CLASS_SHIFT = 20,
+        STEPS_PER_SHIFT = 4, // Size classes between powers of two, bounds rounding waste to a quarter.
+        CLASS_COUNT = (MAX_CLASS_SHIFT - MIN_CLASS_SHIFT) * STEPS_PER_SHIFT + 1,
+    };
+
+    HugePageArena();
+    ~HugePageArena();
+
+    bool Init(size_t reserve_bytes);
+    void *Allocate(int bytes);
+    void Free(void *block);
+    bool Owns(void *block) const { return static_cast<char *>(block) >= m_base && static_cast<char *>(block) < m_end; }
+    size_t Get_Committed_Bytes() const { return m_committed - m_base; }
+    size_t Get_Reserved_Bytes() const { return m_end - m_base; }
+
+    static int Get_Max_Block_Size() { return (1 << MAX_CLASS_SHIFT) - BLOCK_HEADER_SIZE; }
+    static int Get_Size_Class(int bytes, int &class_size);
+    static size_t Get_Default_Reserve();
+
+    void *operator new(size_t size) { return Raw_Allocate_No_Zero(size); }
+    void operator delete(void *obj) { Raw_Free(obj); }
+
+private:
+    enum
+    {
+        BLOCK_HEADER_SIZE = 2 * sizeof(void *), // Size class of the block, sized to keep the caller's data aligned.
+    };
+
+    bool Commit(size_t bytes);
+
+    char *m_reservation; // As returned by the OS, m_base is aligned up from it.
+    size_t m_reservationSize;
+    char *m_base;
+    char *m_end;
+    char *m_top; // Next unused byte, blocks are carved from here when their free list is empty.
+    char *m_committed;
+    void *m_freeLists[CLASS_COUNT];
+};
@@ -0,0 +1,213 @@
+/**
+ * @file
+ *
+ * @author OmniBlade
+ *
+ * @brief Immutable strings stored once for the life of the program so they compare by pointer. (Thyme Feature)
+ *
+ * @copyright Thyme is free software: you can redistribute it and/or
+ *            modify it under the terms of the GNU General Public License
+ *            as published by the Free Software Foundation, either version
+ *            2 of the License, or (at your option) any later version.
+ *            A full copy of the GNU General Public License can be found in
+ *            LICENSE
+ */
+#include "internedstring.h"
+#include "critsection.h"
+#include <cstring>
+
+const char InternedString::s_emptyString[1] = "";
+
+namespace
+{
+// Strings are packed into blocks of this size, longer ones get a block of their own.
+const int STORAGE_BLOCK_SIZE = 64 * 1024;
+const int INITIAL_SOCKET_COUNT = 1024;
+
+struct InternEntry
+{
+    InternEntry *next_in_socket;
+    uint32_t hash;
+    int length;
+
+    // The characters are stored immediately after the entry.
+    char *Chars() { return reinterpret_cast<char *>(&this[1]); }
+};
+
+struct InternTable
+{
+    InternEntry **sockets;
+    int socket_count;
+    int count;
+    char *block_top;
+    char *block_end;
+    int storage_bytes;
+};
+
+SimpleCriticalSectionClass &Get_Intern_Lock()
+{
+    static SimpleCriticalSectionClass s_internLock;
+    return s_internLock;
+}
+
+// Function local so strings can be interned during static initialisation.
+InternTable &Get_Intern_Table()
+{
+    static InternTable s_table = { nullptr, 0, 0, nullptr, nullptr, 0 };
+    return s_table;
+}
+
+// FNV-1a, identifiers tend to share long prefixes so every character has to count.
+uint32_t Hash_String(const char *s, int length)
+{
+    uint32_t hash = 2166136261u;
+
+    for (int i = 0; i < length; ++i) {
+        hash = (hash ^ uint8_t(s[i])) * 16777619u;
+    }
+
+    return hash;
+}
+
+InternEntry *Find_Entry(InternTable const &table, const char *s, int length, uint32_t hash)
+{
+    if (table.sockets == nullptr) {
+        return nullptr;
+    }
+
+    for (InternEntry *entry = table.sockets[hash & (table.socket_count - 1)]; entry != nullptr;
+         entry = entry->next_in_socket) {
+        if (entry->hash == hash && entry->length == length && memcmp(entry->Chars(), s, length) == 0) {
+            return entry;
+        }
+    }
+
+    return nullptr;
+}
+
+void Grow_Sockets(InternTable &table)
+{
+    int socket_count = table.socket_count != 0 ? table.socket_count * 2 : INITIAL_SOCKET_COUNT;
+    InternEntry **sockets = new InternEntry *[socket_count];
+    memset(sockets, 0, socket_count * sizeof(InternEntry *));
+
+    for (int i = 0; i < table.socket_count; ++i) {
+        InternEntry *entry = table.sockets[i];
+
+        while (entry != nullptr) {
+            InternEntry *next = entry->next_in_socket;
+            InternEntry *&socket = sockets[entry->hash & (socket_count - 1)];
+            entry->next_in_socket = socket;
+            socket = entry;
+            entry = next;
+        }
+    }
+
+    delete[] table.sockets;
+    table.sockets = sockets;
+    table.socket_count = socket_count;
+}
+
+InternEntry *Allocate_Entry(InternTable &table, int length)
+{
+    // Keep entries pointer aligned within the blocks.
+    int bytes = (sizeof(InternEntry) + length + 1 + sizeof(void *) - 1) & ~(sizeof(void *) - 1);
+
+    if (bytes > STORAGE_BLOCK_SIZE / 4) {
+        table.storage_bytes += bytes;
+        return reinterpret_cast<InternEntry *>(new char[bytes]);
+    }
+
+    if (table.block_end - table.block_top < bytes) {
+        table.block_top = new char[STORAGE_BLOCK_SIZE];
+        table.block_end = table.block_top + STORAGE_BLOCK_SIZE;
+        table.storage_bytes += STORAGE_BLOCK_SIZE;
+    }
+
+    InternEntry *entry = reinterpret_cast<InternEntry *>(table.block_top);
+    table.block_top += bytes;
+
+    return entry;
+}
+} // namespace
+
+/**
+ * Looks a string up without adding it, for checking input against known identifiers without growing the table.
+ */
+bool InternedString::Find(const char *s, InternedString &found)
+{
+    return Find(s, Hash(s), found);
+}
+
+/**
+ * Find for callers that already have the Hash() of the string, such as the INI parser which works it out per line.
+ */
+bool InternedString::Find(const char *s, uint32_t hash, InternedString &found)
+{
+    if (s == nullptr || *s == '\0') {
+        found.m_str = s_emptyString;
+        return true;
+    }
+
+    int length = static_cast<int>(strlen(s));
+    ScopedCriticalSectionClass cs(&Get_Intern_Lock());
+    InternEntry *entry = Find_Entry(Get_Intern_Table(), s, length, hash);
+
+    if (entry == nullptr) {
+        return false;
+    }
+
+    found.m_str = entry->Chars();
+
+    return true;
+}
+
+uint32_t InternedString::Hash(const char *s)
+{
+    return s != nullptr ? Hash_String(s, static_cast<int>(strlen(s))) : Hash_String("", 0);
+}
+
+int InternedString::Get_Count()
+{
+    ScopedCriticalSectionClass cs(&Get_Intern_Lock());
+    return Get_Intern_Table().count;
+}
+
+int InternedString::Get_Storage_Bytes()
+{
+    ScopedCriticalSectionClass cs(&Get_Intern_Lock());
+    return Get_Intern_Table().storage_bytes;
+}
+
+const char *InternedString::Intern(const char *s)
+{
+    if (s == nullptr || *s == '\0') {
+        return s_emptyString;
+    }
+
+    int length = static_cast<int>(strlen(s));
+    uint32_t hash = Hash_String(s, length);
+    ScopedCriticalSectionClass cs(&Get_Intern_Lock());
+    InternTable &table = Get_Intern_Table();
+    InternEntry *entry = Find_Entry(table, s, length, hash);
+
+    if (entry != nullptr) {
+        return entry->Chars();
+    }
+
+    if (table.count >= table.socket_count) {
+        Grow_Sockets(table);
+    }
+
+    entry = Allocate_Entry(table, length);
+    entry->hash = hash;
+    entry->length = length;
+    memcpy(entry->Chars(), s, length + 1);
+
+    InternEntry *&socket = table.sockets[hash & (table.socket_count - 1)];
+    entry->next_in_socket = socket;
+    socket = entry;
+    ++table.count;
+
+    return entry->Chars();
+}
@@ -0,0 +1,63 @@
+/**
+ * @file
+ *
+ * @author OmniBlade
+ *
+ * @brief Immutable strings stored once for the life of the program so they compare by pointer. (Thyme Feature)
+ *
+ * @copyright Thyme is free software: you can redistribute it and/or
+ *            modify it under the terms of the GNU General Public License
+ *            as published by the Free Software Foundation, either version
+ *            2 of the License, or (at your option) any later version.
+ *            A full copy of the GNU General Public License can be found in
+ *            LICENSE
+ */
+#pragma once
+
+#include "always.h"
+#include "asciistring.h"
+#include "rtsutils.h"
+#include <cstddef>
+
+// For identifiers such as template and label names that get compared and hashed far more often than they are created.
+// Equal strings always share the same storage, so comparing and hashing only look at the pointer. The storage is never
+// freed and is safe to intern from any thread.
+class InternedString
+{
+public:
+    InternedString() : m_str(s_emptyString) {}
+    explicit InternedString(const char *s) : m_str(Intern(s)) {}
+    explicit InternedString(Utf8String const &s) : m_str(Intern(s.Str())) {}
+
+    const char *Str() const { return m_str; }
+    int Get_Length() const { return static_cast<int>(strlen(m_str)); }
+    bool Is_Empty() const { return *m_str == '\0'; }
+    bool Is_Not_Empty() const { return !Is_Empty(); }
+    Utf8String To_Utf8String() const { return Utf8String(m_str); }
+
+    // Orders by address, fine for containers but not for anything shown to the user.
+    friend bool operator==(InternedString left, InternedString right) { return left.m_str == right.m_str; }
+    friend bool operator!=(InternedString left, InternedString right) { return left.m_str != right.m_str; }
+    friend bool operator<(InternedString left, InternedString right) { return left.m_str < right.m_str; }
+
+    static bool Find(const char *s, InternedString &found);
+    static bool Find(const char *s, uint32_t hash, InternedString &found);
+    static uint32_t Hash(const char *s);
+    static int Get_Count();
+    static int Get_Storage_Bytes();
+
+private:
+    static const char *Intern(const char *s);
+
+    const char *m_str;
+
+    static const char s_emptyString[1];
+};
+
+namespace rts
+{
+template<> struct hash<InternedString>
+{
+    size_t operator()(InternedString const &object) const { return reinterpret_cast<size_t>(object.Str()) >> 3; }
+};
+} // namespace rts
@@ -13,6 +13,7 @@
  *            LICENSE
  */
 #include "localfile.h"
+#include "fileiostats.h"
 #include "ramfile.h"
 #include <captainslog.h>
 #include <cctype>
@@ -115,7 +116,8 @@ int LocalFile::Read(void *dst, int bytes)
     }
 
     if (dst != nullptr) {
-        return read(m_fileHandle, dst, bytes);
+        Thyme::FileIOTimer timer;
+        return timer.Read(m_name.Str(), read(m_fileHandle, dst, bytes));
     }
 
     lseek(m_fileHandle, bytes, CURRENT);
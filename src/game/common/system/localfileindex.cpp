@@ -0,0 +1,517 @@
+/**
+ * @file
+ *
+ * @author OmniBlade
+ *
+ * @brief Index of the loose files below the working directory. (Thyme Feature)
+ *
+ * @copyright Thyme is free software: you can redistribute it and/or
+ *            modify it under the terms of the GNU General Public License
+ *            as published by the Free Software Foundation, either version
+ *            2 of the License, or (at your option) any later version.
+ *            A full copy of the GNU General Public License can be found in
+ *            LICENSE
+ */
+#include "localfileindex.h"
+#include "memdynalloc.h"
+#include "mempool.h"
+#include <captainslog.h>
+#include <cerrno>
+#include <cstring>
+
+#ifdef HAVE_SYS_INOTIFY_H
+#include <dirent.h>
+#include <poll.h>
+#include <sys/inotify.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace Thyme
+{
+
+namespace
+{
+enum
+{
+    // Give up on the index rather than spend startup walking something that obviously isn't a game install.
+    MAX_INDEXED_FILES = 250000,
+    MAX_SCAN_DEPTH = 32,
+};
+
+Utf8String Copy_Prefix(const char *string, int length)
+{
+    Utf8String prefix;
+
+    if (length > 0) {
+        char *buffer = prefix.Get_Buffer_For_Read(length);
+        memcpy(buffer, string, length);
+        buffer[length] = '\0';
+    }
+
+    return prefix;
+}
+} // namespace
+
+bool LocalFileIndex::s_enabled = true;
+
+LocalFileIndex::LocalFileIndex() :
+    m_started(false),
+    m_failed(false),
+    m_generation(0),
+    m_fileCount(0)
+#ifdef HAVE_SYS_INOTIFY_H
+    ,
+    m_inotify(-1),
+    m_watcher(nullptr)
+#endif
+{
+    // Keys are compared the way the disk compares names.
+#ifdef PLATFORM_WINDOWS
+    m_files.Set_Case_Sensitive(false);
+#else
+    m_files.Set_Case_Sensitive(true);
+#endif
+}
+
+LocalFileIndex::~LocalFileIndex()
+{
+#ifdef HAVE_SYS_INOTIFY_H
+    if (m_watcher != nullptr) {
+        m_watcher->Stop(1000);
+        delete m_watcher;
+    }
+
+    if (m_inotify >= 0) {
+        close(m_inotify);
+    }
+#endif
+}
+
+/**
+ * Checks if a loose file exists. The top level directory the file is in is indexed the first time it is needed, lookups
+ * in it go to the disk until that is done.
+ */
+LocalFileIndex::LookupResult LocalFileIndex::Find(const char *filename)
+{
+    if (!s_enabled || !Is_Covered(filename)) {
+        return FILE_UNINDEXED;
+    }
+
+    const char *separator = strpbrk(filename, "/\\");
+    int top_length = separator != nullptr ? int(separator - filename) : 0;
+    unsigned generation;
+
+    {
+        ScopedCriticalSectionClass cs(&m_lock);
+
+        if (!Start()) {
+            return FILE_UNINDEXED;
+        }
+
+        TopDir *top = Find_Top_Dir(filename, top_length);
+
+        if (top != nullptr) {
+            if (top->state != DIR_INDEXED) {
+                return FILE_UNINDEXED;
+            }
+
+            const bool *present = m_files.Find(filename);
+
+            return present != nullptr && *present ? FILE_PRESENT : FILE_MISSING;
+        }
+
+        TopDir dir;
+        dir.name = Copy_Prefix(filename, top_length);
+        dir.state = DIR_SCANNING;
+        m_topDirs.push_back(dir);
+        generation = m_generation;
+    }
+
+#ifdef HAVE_SYS_INOTIFY_H
+    // Walked without holding the lock so lookups elsewhere and the watcher carry on meanwhile.
+    Utf8String dir_path = Copy_Prefix(filename, top_length);
+    dir_path += "/";
+    bool scanned = Scan_Directory(dir_path, 0, true, false, generation);
+
+    ScopedCriticalSectionClass cs(&m_lock);
+    TopDir *top = Find_Top_Dir(filename, top_length);
+
+    // The index was thrown away while walking, the next lookup starts again.
+    if (top == nullptr || generation != m_generation) {
+        return FILE_UNINDEXED;
+    }
+
+    if (!scanned) {
+        captainslog_warn("Failed to index '%s', loose file lookups in it will not be indexed.", dir_path.Str());
+        top->state = DIR_FAILED;
+        return FILE_UNINDEXED;
+    }
+
+    top->state = DIR_INDEXED;
+    captainslog_debug("Indexed '%s', %d loose files in %u directories so far.",
+        dir_path.Str(),
+        m_fileCount,
+        unsigned(m_watches.size()));
+
+    const bool *present = m_files.Find(filename);
+
+    return present != nullptr && *present ? FILE_PRESENT : FILE_MISSING;
+#else
+    return FILE_UNINDEXED;
+#endif
+}
+
+/**
+ * Records a file the game has just created so lookups see it before the change notification arrives.
+ */
+void LocalFileIndex::Add(const char *filename)
+{
+    if (!Is_Covered(filename)) {
+        return;
+    }
+
+    ScopedCriticalSectionClass cs(&m_lock);
+
+    if (m_started) {
+        Set_File(filename, true, true);
+    }
+}
+
+// Sets up the watcher and indexes the files at the top of the working directory. Caller holds m_lock. Nothing is
+// recorded until it succeeds so a lookup made before the memory managers are ready doesn't disable the index.
+bool LocalFileIndex::Start()
+{
+    if (m_started || m_failed) {
+        return m_started;
+    }
+
+#ifdef HAVE_SYS_INOTIFY_H
+    // The watcher allocates from the game heap on its own thread which needs the memory manager locks.
+    if (g_memoryPoolCriticalSection == nullptr || g_dmaCriticalSection == nullptr) {
+        return false;
+    }
+
+    m_inotify = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+
+    if (m_inotify < 0) {
+        captainslog_warn("Failed to initialise inotify, loose file lookups will not be indexed.");
+        m_failed = true;
+        return false;
+    }
+
+    Reset();
+
+    if (m_topDirs.empty()) {
+        captainslog_warn("Failed to index the working directory, loose file lookups will not be indexed.");
+        close(m_inotify);
+        m_inotify = -1;
+        m_failed = true;
+        return false;
+    }
+
+    m_watcher = new WatcherThreadClass(this);
+    m_watcher->Execute();
+    m_started = true;
+
+    return true;
+#else
+    m_failed = true;
+
+    return false;
+#endif
+}
+
+// Forgets everything and indexes the files at the top of the working directory again, other directories are walked
+// again when next looked in. Caller holds m_lock.
+void LocalFileIndex::Reset()
+{
+    ++m_generation;
+    m_topDirs.clear();
+    m_files.Clear();
+    m_fileCount = 0;
+
+#ifdef HAVE_SYS_INOTIFY_H
+    Remove_Watches();
+
+    if (Scan_Directory("", 0, false, true, m_generation)) {
+        TopDir root;
+        root.state = DIR_INDEXED;
+        m_topDirs.push_back(root);
+    }
+#endif
+}
+
+// Files at the top of the working directory have an empty top level directory.
+LocalFileIndex::TopDir *LocalFileIndex::Find_Top_Dir(const char *filename, int length)
+{
+    for (auto it = m_topDirs.begin(); it != m_topDirs.end(); ++it) {
+        if (it->name.Get_Length() == length && strncmp(it->name.Str(), filename, length) == 0) {
+            return &*it;
+        }
+    }
+
+    return nullptr;
+}
+
+void LocalFileIndex::Set_File(Utf8String const &path, bool present, bool overwrite)
+{
+    const char *name = path.Reverse_Find('/');
+    const char *alt_name = path.Reverse_Find('\\');
+
+    if (alt_name != nullptr && (name == nullptr || alt_name > name)) {
+        name = alt_name;
+    }
+
+    if (name == nullptr) {
+        m_files.Insert(Utf8String(), path, present, overwrite);
+    } else {
+        m_files.Insert(Copy_Prefix(path.Str(), int(name - path.Str())), name + 1, present, overwrite);
+    }
+}
+
+// Only relative paths that stay inside the working directory can be answered by the index. The file name must also have
+// an extension as the path index resolves on the last '.' in the path.
+bool LocalFileIndex::Is_Covered(const char *filename)
+{
+    if (filename == nullptr || *filename == '\0' || *filename == '/' || *filename == '\\'
+        || strchr(filename, ':') != nullptr) {
+        return false;
+    }
+
+    const char *component = filename;
+    const char *getp = filename;
+
+    for (;; ++getp) {
+        if (*getp == '/' || *getp == '\\' || *getp == '\0') {
+            int length = int(getp - component);
+
+            if ((length == 1 && component[0] == '.') || (length == 2 && component[0] == '.' && component[1] == '.')) {
+                return false;
+            }
+
+            if (*getp == '\0') {
+                break;
+            }
+
+            component = getp + 1;
+        }
+    }
+
+    return strchr(component, '.') != nullptr;
+}
+
+#ifdef HAVE_SYS_INOTIFY_H
+// Adds the files in dir to the index and watches it for changes, then does the same for each directory below it if
+// recursive. The lock is only held while updating the index so the walk doesn't block lookups. Changes reported after
+// the watch was added are newer than what the walk saw, so unless overwrite is set entries already made by the watcher
+// are kept. Returns false if the tree is too large to index or the watch limit is reached.
+bool LocalFileIndex::Scan_Directory(Utf8String const &dir, int depth, bool recursive, bool overwrite, unsigned generation)
+{
+    if (depth > MAX_SCAN_DEPTH) {
+        return true;
+    }
+
+    const char *path = dir.Is_Empty() ? "." : dir.Str();
+
+    {
+        ScopedCriticalSectionClass cs(&m_lock);
+
+        // Abandon the walk if the index was thrown away since it started.
+        if (generation != m_generation) {
+            return true;
+        }
+
+        int watch = inotify_add_watch(
+            m_inotify, path, IN_CREATE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO | IN_DELETE_SELF | IN_ONLYDIR);
+
+        if (watch < 0) {
+            // A directory that doesn't exist is indexed as empty, its parent's watch reports it being created.
+            return errno == ENOENT;
+        }
+
+        m_watches[watch] = dir;
+    }
+
+    DIR *dp = opendir(path);
+
+    if (dp == nullptr) {
+        return true;
+    }
+
+    std::vector<Utf8String> files;
+    std::vector<Utf8String> dirs;
+
+    for (struct dirent *entry = readdir(dp); entry != nullptr; entry = readdir(dp)) {
+        if (strcmp(entry->d_name, ".") == 0 || strcmp(entry->d_name, "..") == 0) {
+            continue;
+        }
+
+        Utf8String entry_path = dir;
+        entry_path += entry->d_name;
+        bool is_dir = entry->d_type == DT_DIR;
+
+        if (entry->d_type == DT_UNKNOWN || entry->d_type == DT_LNK) {
+            struct stat st;
+            is_dir = stat(entry_path.Str(), &st) == 0 && S_ISDIR(st.st_mode);
+        }
+
+        if (is_dir) {
+            if (recursive) {
+                entry_path += "/";
+                dirs.push_back(entry_path);
+            }
+        } else {
+            files.push_back(entry_path);
+        }
+    }
+
+    closedir(dp);
+
+    {
+        ScopedCriticalSectionClass cs(&m_lock);
+
+        if (generation != m_generation) {
+            return true;
+        }
+
+        for (auto it = files.begin(); it != files.end(); ++it) {
+            Set_File(*it, true, overwrite);
+        }
+
+        m_fileCount += int(files.size());
+
+        if (m_fileCount > MAX_INDEXED_FILES) {
+            return false;
+        }
+    }
+
+    for (auto it = dirs.begin(); it != dirs.end(); ++it) {
+        if (!Scan_Directory(*it, depth + 1, true, overwrite, generation)) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+// Marks every file below dir as missing and stops watching the directories below it. Caller holds m_lock.
+void LocalFileIndex::Remove_Directory(Utf8String const &dir)
+{
+    // Keys use '\\' for separators.
+    Utf8String prefix;
+
+    for (const char *c = dir.Str(); *c != '\0'; ++c) {
+        prefix += *c == '/' ? '\\' : *c;
+    }
+
+    int length = prefix.Get_Length();
+    m_files.For_Each([&](Utf8String const &key, bool &present) {
+        if (strncmp(key.Str(), prefix.Str(), length) == 0) {
+            present = false;
+        }
+    });
+
+    for (auto it = m_watches.begin(); it != m_watches.end();) {
+        if (strncmp(it->second.Str(), dir.Str(), dir.Get_Length()) == 0) {
+            inotify_rm_watch(m_inotify, it->first);
+            it = m_watches.erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
+
+void LocalFileIndex::Remove_Watches()
+{
+    for (auto it = m_watches.begin(); it != m_watches.end(); ++it) {
+        inotify_rm_watch(m_inotify, it->first);
+    }
+
+    m_watches.clear();
+}
+
+void LocalFileIndex::Process_Events(const char *buffer, int size)
+{
+    ScopedCriticalSectionClass cs(&m_lock);
+
+    for (const char *getp = buffer; getp < buffer + size;) {
+        const inotify_event *event = reinterpret_cast<const inotify_event *>(getp);
+        getp += sizeof(inotify_event) + event->len;
+
+        // Events were dropped, the only safe thing to do is start again.
+        if ((event->mask & IN_Q_OVERFLOW) != 0) {
+            Reset();
+            break;
+        }
+
+        auto it = m_watches.find(event->wd);
+
+        if (it == m_watches.end()) {
+            continue;
+        }
+
+        if ((event->mask & IN_IGNORED) != 0) {
+            m_watches.erase(it);
+            continue;
+        }
+
+        if (event->len == 0) {
+            continue;
+        }
+
+        Utf8String path = it->second;
+        path += event->name;
+
+        if ((event->mask & IN_ISDIR) == 0) {
+            Set_File(path, (event->mask & (IN_CREATE | IN_MOVED_TO)) != 0, true);
+            continue;
+        }
+
+        path += "/";
+
+        if ((event->mask & (IN_CREATE | IN_MOVED_TO)) == 0) {
+            Remove_Directory(path);
+            continue;
+        }
+
+        // Directories at the top level are only walked if lookups have gone into them.
+        bool top_level = it->second.Is_Empty();
+        TopDir *top = Find_Top_Dir(path.Str(), int(strcspn(path.Str(), "/")));
+
+        if (top_level && (top == nullptr || top->state == DIR_FAILED)) {
+            continue;
+        }
+
+        if (!Scan_Directory(path, 0, true, true, m_generation) && top != nullptr) {
+            captainslog_warn("Failed to index '%s', loose file lookups in it will not be indexed.", path.Str());
+            top->state = DIR_FAILED;
+        }
+    }
+}
+
+void LocalFileIndex::WatcherThreadClass::Thread_Function()
+{
+    alignas(inotify_event) char buffer[4096];
+
+    while (m_isRunning) {
+        pollfd fd;
+        fd.fd = m_index->m_inotify;
+        fd.events = POLLIN;
+        fd.revents = 0;
+
+        // Wake up regularly so Stop doesn't have to wait long.
+        if (poll(&fd, 1, 100) <= 0) {
+            continue;
+        }
+
+        int size = int(read(m_index->m_inotify, buffer, sizeof(buffer)));
+
+        if (size > 0) {
+            m_index->Process_Events(buffer, size);
+        }
+    }
+}
+#endif
+
+} // namespace Thyme
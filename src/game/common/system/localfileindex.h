@@ -0,0 +1,112 @@
+/**
+ * @file
+ *
+ * @author OmniBlade
+ *
+ * @brief Index of the loose files below the working directory. (Thyme Feature)
+ *
+ * @copyright Thyme is free software: you can redistribute it and/or
+ *            modify it under the terms of the GNU General Public License
+ *            as published by the Free Software Foundation, either version
+ *            2 of the License, or (at your option) any later version.
+ *            A full copy of the GNU General Public License can be found in
+ *            LICENSE
+ */
+#pragma once
+
+#include "always.h"
+#include "archivepathindex.h"
+#include "asciistring.h"
+#include "critsection.h"
+#include "thread.h"
+#include <map>
+#include <vector>
+
+namespace Thyme
+{
+
+// Lets the file system answer lookups for loose files that don't exist without going to the disk. The index is only
+// used where the platform can report changes to the directory tree, currently inotify on Linux, so files added or
+// removed while the game runs are still picked up. Only the top level directories lookups actually go into are walked,
+// each the first time it is needed, so the index covers the game's data directories rather than everything below the
+// working directory.
+class LocalFileIndex
+{
+#ifdef HAVE_SYS_INOTIFY_H
+    class WatcherThreadClass : public ThreadClass
+    {
+    public:
+        WatcherThreadClass(LocalFileIndex *index) : ThreadClass("Local File Watcher"), m_index(index) {}
+        virtual void Thread_Function() override;
+
+    private:
+        LocalFileIndex *m_index;
+    };
+#endif
+
+    enum DirState
+    {
+        DIR_SCANNING, // Lookups go to the disk until the walk finishes.
+        DIR_INDEXED,
+        DIR_FAILED,
+    };
+
+    struct TopDir
+    {
+        Utf8String name;
+        DirState state;
+    };
+
+public:
+    enum LookupResult
+    {
+        FILE_MISSING,
+        FILE_PRESENT,
+        FILE_UNINDEXED, // The index can't answer for this path, ask the disk.
+    };
+
+    LocalFileIndex();
+    ~LocalFileIndex();
+
+    LookupResult Find(const char *filename);
+    void Add(const char *filename);
+
+    static void Set_Enabled(bool enabled) { s_enabled = enabled; }
+    static bool Is_Enabled() { return s_enabled; }
+
+private:
+    // Not copyable, owns the watcher thread.
+    LocalFileIndex(const LocalFileIndex &that) = delete;
+    LocalFileIndex &operator=(const LocalFileIndex &that) = delete;
+
+    bool Start();
+    void Reset();
+    TopDir *Find_Top_Dir(const char *filename, int length);
+    void Set_File(Utf8String const &path, bool present, bool overwrite);
+    static bool Is_Covered(const char *filename);
+
+#ifdef HAVE_SYS_INOTIFY_H
+    bool Scan_Directory(Utf8String const &dir, int depth, bool recursive, bool overwrite, unsigned generation);
+    void Remove_Directory(Utf8String const &dir);
+    void Remove_Watches();
+    void Process_Events(const char *buffer, int size);
+#endif
+
+private:
+    SimpleCriticalSectionClass m_lock;
+    ArchivePathIndex<bool> m_files;
+    std::vector<TopDir> m_topDirs;
+    bool m_started;
+    bool m_failed;
+    unsigned m_generation; // Bumped whenever the index is thrown away so walks in progress know to stop.
+    int m_fileCount;
+#ifdef HAVE_SYS_INOTIFY_H
+    int m_inotify;
+    std::map<int, Utf8String> m_watches;
+    WatcherThreadClass *m_watcher;
+#endif
+
+    static bool s_enabled;
+};
+
+} // namespace Thyme
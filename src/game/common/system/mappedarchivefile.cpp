@@ -0,0 +1,78 @@
+/**
+ * @file
+ *
+ * @author OmniBlade
+ *
+ * @brief Implements read only file IO over a memory mapped archive. (Thyme Feature)
+ *
+ * @copyright Thyme is free software: you can redistribute it and/or
+ *            modify it under the terms of the GNU General Public License
+ *            as published by the Free Software Foundation, either version
+ *            2 of the License, or (at your option) any later version.
+ *            A full copy of the GNU General Public License can be found in
+ *            LICENSE
+ */
+#include "mappedarchivefile.h"
+#include <cstring>
+
+MappedArchiveFile::MappedArchiveFile() {}
+
+MappedArchiveFile::~MappedArchiveFile()
+{
+    // The data belongs to the archive mapping, prevent RAMFile from trying to free it.
+    m_data = nullptr;
+    File::Close();
+}
+
+void MappedArchiveFile::Close()
+{
+    m_data = nullptr;
+    RAMFile::Close();
+}
+
+void *MappedArchiveFile::Read_Entire_And_Close()
+{
+    // Callers take ownership of the returned buffer and free it with delete[] so we can't hand out the mapping itself.
+    char *data = new char[m_size > 0 ? m_size : 1];
+
+    if (m_data != nullptr && m_size > 0) {
+        memcpy(data, m_data, m_size);
+    } else {
+        captainslog_dbgassert(false, "m_data is NULL in MappedArchiveFile::Read_Entire_And_Close -- should not happen!");
+    }
+
+    Close();
+
+    return data;
+}
+
+bool MappedArchiveFile::Open(File *file)
+{
+    captainslog_dbgassert(false, "MappedArchiveFile can only be opened from a mapped archive.");
+    return false;
+}
+
+bool MappedArchiveFile::Open_From_Archive(File *file, Utf8String const &name, int pos, int size)
+{
+    captainslog_dbgassert(false, "MappedArchiveFile can only be opened from a mapped archive.");
+    return false;
+}
+
+bool MappedArchiveFile::Open_From_Mapping(Utf8String const &name, const char *data, int size)
+{
+    if (data == nullptr || size < 0) {
+        return false;
+    }
+
+    if (!File::Open(name.Str(), READ | BINARY)) {
+        return false;
+    }
+
+    // RAMFile never writes through m_data so it is safe to point it at the read only view.
+    m_data = const_cast<char *>(data);
+    m_size = size;
+    m_pos = 0;
+    m_name = name;
+
+    return true;
+}
@@ -0,0 +1,39 @@
+/**
+ * @file
+ *
+ * @author OmniBlade
+ *
+ * @brief Implements read only file IO over a memory mapped archive. (Thyme Feature)
+ *
+ * @copyright Thyme is free software: you can redistribute it and/or
+ *            modify it under the terms of the GNU General Public License
+ *            as published by the Free Software Foundation, either version
+ *            2 of the License, or (at your option) any later version.
+ *            A full copy of the GNU General Public License can be found in
+ *            LICENSE
+ */
+#pragma once
+
+#include "gamememory.h"
+#include "ramfile.h"
+
+// Views a range of an archive that has been mapped into memory by its ArchiveFile. The data is not owned
+// so the archive must outlive any files opened from it.
+class MappedArchiveFile : public RAMFile
+{
+    IMPLEMENT_POOL(MappedArchiveFile);
+
+protected:
+    virtual ~MappedArchiveFile() override;
+
+public:
+    MappedArchiveFile();
+
+    virtual void Close() override;
+
+    virtual void *Read_Entire_And_Close() override;
+    virtual bool Open(File *file) override;
+    virtual bool Open_From_Archive(File *file, Utf8String const &name, int pos, int size) override;
+
+    bool Open_From_Mapping(Utf8String const &name, const char *data, int size);
+};
@@ -15,6 +15,7 @@
 #pragma once
 
 #include "memblock.h"
+#include "mempool.h"
 #include "rawalloc.h"
 
 class MemoryPool;
@@ -32,6 +33,10 @@ public:
     void Remove_Blob_From_List(MemoryPoolBlob **head, MemoryPoolBlob **tail);
     MemoryPoolSingleBlock *Allocate_Single_Block();
     void Free_Single_Block(MemoryPoolSingleBlock *block);
+#ifndef GAME_DLL
+    void Add_To_Free_List(bool at_tail);
+    void Remove_From_Free_List();
+#endif
 
     void *operator new(size_t size) throw() { return Raw_Allocate(size); }
     void operator delete(void *obj) { Raw_Free(obj); }
@@ -44,6 +49,12 @@ private:
     int m_usedBlocksInBlob;
     int m_totalBlocksInBlob;
     char *m_blockData;
+#ifndef GAME_DLL
+    // Thyme specific, links the pool's blobs that have free blocks. Partly used blobs are kept ahead of empty ones so
+    // allocations fill them first and the empty blobs can be released from the tail.
+    MemoryPoolBlob *m_nextFreeBlob;
+    MemoryPoolBlob *m_prevFreeBlob;
+#endif
 };
 
 inline MemoryPoolBlob::MemoryPoolBlob() :
@@ -54,6 +65,11 @@ inline MemoryPoolBlob::MemoryPoolBlob() :
     m_usedBlocksInBlob(0),
     m_totalBlocksInBlob(0),
     m_blockData(nullptr)
+#ifndef GAME_DLL
+    ,
+    m_nextFreeBlob(nullptr),
+    m_prevFreeBlob(nullptr)
+#endif
 {
 }
 
@@ -100,6 +116,12 @@ inline MemoryPoolSingleBlock *MemoryPoolBlob::Allocate_Single_Block()
     m_firstFreeBlock = block->Get_Next_Free();
     ++m_usedBlocksInBlob;
 
+#ifndef GAME_DLL
+    if (m_firstFreeBlock == nullptr) {
+        Remove_From_Free_List();
+    }
+#endif
+
     return block;
 }
 
@@ -107,7 +129,73 @@ inline void MemoryPoolBlob::Free_Single_Block(MemoryPoolSingleBlock *block)
 {
     captainslog_relassert(
         block->m_owningBlob == this, 0xDEAD0002, "Attempting to free a block that does not belong to this blob.");
+#ifndef GAME_DLL
+    bool was_full = m_firstFreeBlock == nullptr;
+#endif
     block->Set_Next_Free(m_firstFreeBlock);
     --m_usedBlocksInBlob;
     m_firstFreeBlock = block;
-}
\ No newline at end of file
+
+#ifndef GAME_DLL
+    // Blobs that just emptied move behind the partly used ones.
+    if (m_usedBlocksInBlob == 0) {
+        if (!was_full) {
+            Remove_From_Free_List();
+        }
+
+        Add_To_Free_List(true);
+    } else if (was_full) {
+        Add_To_Free_List(false);
+    }
+#endif
+}
+
+#ifndef GAME_DLL
+inline void MemoryPoolBlob::Add_To_Free_List(bool at_tail)
+{
+    MemoryPoolBlob **head = &m_owningPool->m_firstBlobWithFreeBlocks;
+    MemoryPoolBlob **tail = &m_owningPool->m_lastBlobWithFreeBlocks;
+
+    if (at_tail) {
+        m_nextFreeBlob = nullptr;
+        m_prevFreeBlob = *tail;
+
+        if (*tail != nullptr) {
+            (*tail)->m_nextFreeBlob = this;
+        } else {
+            *head = this;
+        }
+
+        *tail = this;
+    } else {
+        m_prevFreeBlob = nullptr;
+        m_nextFreeBlob = *head;
+
+        if (*head != nullptr) {
+            (*head)->m_prevFreeBlob = this;
+        } else {
+            *tail = this;
+        }
+
+        *head = this;
+    }
+}
+
+inline void MemoryPoolBlob::Remove_From_Free_List()
+{
+    if (m_prevFreeBlob != nullptr) {
+        m_prevFreeBlob->m_nextFreeBlob = m_nextFreeBlob;
+    } else {
+        m_owningPool->m_firstBlobWithFreeBlocks = m_nextFreeBlob;
+    }
+
+    if (m_nextFreeBlob != nullptr) {
+        m_nextFreeBlob->m_prevFreeBlob = m_prevFreeBlob;
+    } else {
+        m_owningPool->m_lastBlobWithFreeBlocks = m_prevFreeBlob;
+    }
+
+    m_nextFreeBlob = nullptr;
+    m_prevFreeBlob = nullptr;
+}
+#endif
\ No newline at end of file
@@ -15,10 +15,14 @@
 #include "memdynalloc.h"
 #include "critsection.h"
 #include "gamememoryinit.h"
+#include "hugepagearena.h"
 #include "memblob.h"
 #include "memblock.h"
 #include "mempool.h"
 #include "mempoolfact.h"
+#include <algorithm>
+#include <captainslog.h>
+#include <climits>
 #include <cstring>
 
 using std::memset;
@@ -26,12 +30,44 @@ using std::memset;
 #ifndef GAME_DLL
 SimpleCriticalSectionClass *g_dmaCriticalSection = nullptr;
 DynamicMemoryAllocator *g_dynamicMemoryAllocator = nullptr;
+
+bool DynamicMemoryAllocator::s_useHugePageArena = false;
+
+namespace
+{
+std::atomic<unsigned> s_nextStatsStripe;
+thread_local int t_statsStripe = -1;
+} // namespace
 #endif
 
 DynamicMemoryAllocator::DynamicMemoryAllocator() :
-    m_factory(nullptr), m_nextDmaInFactory(nullptr), m_poolCount(0), m_usedBlocksInDma(0), m_rawBlocks(0)
+    m_factory(nullptr),
+    m_nextDmaInFactory(nullptr),
+    m_poolCount(0),
+#ifdef GAME_DLL
+    m_usedBlocksInDma(0),
+#endif
+    m_rawBlocks(0)
+#ifndef GAME_DLL
+    ,
+    m_hugePageArena(nullptr)
+#endif
 {
     memset(m_pools, 0, sizeof(m_pools));
+#ifndef GAME_DLL
+    memset(m_sizeClassPools, 0, sizeof(m_sizeClassPools));
+
+    for (int i = 0; i < STATS_STRIPES; ++i) {
+        StatsStripe &stripe = m_stats[i];
+        stripe.used_blocks.store(0, std::memory_order_relaxed);
+        stripe.raw_allocations.store(0, std::memory_order_relaxed);
+        stripe.rounding_waste.store(0, std::memory_order_relaxed);
+
+        for (int j = 0; j < SIZE_HISTOGRAM_BUCKETS; ++j) {
+            stripe.size_histogram[j].store(0, std::memory_order_relaxed);
+        }
+    }
+#endif
 }
 
 void DynamicMemoryAllocator::Init(MemoryPoolFactory *factory, int subpools, PoolInitRec const *const params)
@@ -56,7 +92,9 @@ void DynamicMemoryAllocator::Init(MemoryPoolFactory *factory, int subpools, Pool
     }
 
     m_factory = factory;
+#ifdef GAME_DLL
     m_usedBlocksInDma = 0;
+#endif
 
     if (m_poolCount > 8) {
         m_poolCount = 8;
@@ -65,11 +103,19 @@ void DynamicMemoryAllocator::Init(MemoryPoolFactory *factory, int subpools, Pool
     for (int i = 0; i < m_poolCount; ++i) {
         m_pools[i] = m_factory->Create_Memory_Pool(&init_list[i]);
     }
+
+#ifndef GAME_DLL
+    Build_Size_Classes();
+#endif
 }
 
 DynamicMemoryAllocator::~DynamicMemoryAllocator()
 {
+#ifdef GAME_DLL
     captainslog_dbgassert(m_usedBlocksInDma, "Destroying none empty DMA.");
+#else
+    captainslog_dbgassert(Get_Used_Blocks(), "Destroying none empty DMA.");
+#endif
 
     for (int i = 0; i < m_poolCount; ++i) {
         m_factory->Destroy_Memory_Pool(m_pools[i]);
@@ -79,6 +125,10 @@ DynamicMemoryAllocator::~DynamicMemoryAllocator()
     for (MemoryPoolSingleBlock *b = m_rawBlocks; b != nullptr; b = m_rawBlocks) {
         Free_Bytes(b->Get_User_Data());
     }
+
+#ifndef GAME_DLL
+    delete m_hugePageArena;
+#endif
 }
 
 MemoryPool *DynamicMemoryAllocator::Find_Pool_For_Size(int size)
@@ -87,7 +137,13 @@ MemoryPool *DynamicMemoryAllocator::Find_Pool_For_Size(int size)
         return nullptr;
     }
 
+#ifndef GAME_DLL
+    // Thyme specific, pools before the first that fits the size's class are too small so the search starts there and
+    // almost always stops at the first pool it checks.
+    for (int i = m_sizeClassPools[Get_Size_Class(size)]; i < m_poolCount; ++i) {
+#else
     for (int i = 0; i < m_poolCount; ++i) {
+#endif
         if (size <= m_pools[i]->m_allocationSize) {
             return m_pools[i];
         }
@@ -129,7 +185,9 @@ void DynamicMemoryAllocator::Remove_From_List(DynamicMemoryAllocator **head)
 
 void *DynamicMemoryAllocator::Allocate_Bytes_No_Zero(int bytes)
 {
+#ifdef GAME_DLL
     ScopedCriticalSectionClass cs(g_dmaCriticalSection);
+#endif
 
     MemoryPool *mp = Find_Pool_For_Size(bytes);
     void *block;
@@ -137,10 +195,21 @@ void *DynamicMemoryAllocator::Allocate_Bytes_No_Zero(int bytes)
     if (mp != nullptr) {
         block = mp->Allocate_Block_No_Zero();
     } else {
+#ifndef GAME_DLL
+        // Thyme specific, only the raw blocks need the lock, the pools lock for themselves.
+        ScopedCriticalSectionClass cs(g_dmaCriticalSection);
+        block = Allocate_Large_Block(bytes);
+        MemoryPool::Count_Thread_Allocation();
+#else
         block = MemoryPoolSingleBlock::Raw_Allocate_Single_Block(&m_rawBlocks, bytes, m_factory)->Get_User_Data();
+#endif
     }
 
+#ifndef GAME_DLL
+    Count_Allocation(bytes, mp);
+#else
     ++m_usedBlocksInDma;
+#endif
 
     return block;
 }
@@ -159,18 +228,30 @@ void DynamicMemoryAllocator::Free_Bytes(void *block)
         return;
     }
 
+#ifdef GAME_DLL
     ScopedCriticalSectionClass cs(g_dmaCriticalSection);
+#endif
 
     MemoryPoolSingleBlock *sblock = MemoryPoolSingleBlock::Recover_Block_From_User_Data(block);
 
     if (sblock->m_owningBlob != nullptr) {
         sblock->m_owningBlob->m_owningPool->Free_Block(block);
     } else {
+#ifndef GAME_DLL
+        ScopedCriticalSectionClass cs(g_dmaCriticalSection);
+        sblock->Remove_Block_From_List(&m_rawBlocks);
+        Free_Large_Block(sblock);
+#else
         sblock->Remove_Block_From_List(&m_rawBlocks);
         Raw_Free(sblock);
+#endif
     }
 
+#ifndef GAME_DLL
+    Get_Stats_Stripe().used_blocks.fetch_sub(1, std::memory_order_relaxed);
+#else
     --m_usedBlocksInDma;
+#endif
 }
 
 int DynamicMemoryAllocator::Get_Actual_Allocation_Size(int bytes)
@@ -196,5 +277,190 @@ void DynamicMemoryAllocator::Reset()
         Free_Bytes(sb->Get_User_Data());
     }
 
+#ifdef GAME_DLL
     m_usedBlocksInDma = 0;
+#else
+    for (int i = 0; i < STATS_STRIPES; ++i) {
+        m_stats[i].used_blocks.store(0, std::memory_order_relaxed);
+    }
+#endif
+}
+
+#ifndef GAME_DLL
+int DynamicMemoryAllocator::Get_Used_Blocks() const
+{
+    int count = 0;
+
+    for (int i = 0; i < STATS_STRIPES; ++i) {
+        count += m_stats[i].used_blocks.load(std::memory_order_relaxed);
+    }
+
+    return count;
+}
+
+uint64_t DynamicMemoryAllocator::Get_Allocation_Count() const
+{
+    uint64_t count = 0;
+
+    for (int i = 0; i < SIZE_HISTOGRAM_BUCKETS; ++i) {
+        count += Get_Size_Histogram_Count(i);
+    }
+
+    return count;
 }
+
+uint64_t DynamicMemoryAllocator::Get_Raw_Allocation_Count() const
+{
+    uint64_t count = 0;
+
+    for (int i = 0; i < STATS_STRIPES; ++i) {
+        count += m_stats[i].raw_allocations.load(std::memory_order_relaxed);
+    }
+
+    return count;
+}
+
+uint64_t DynamicMemoryAllocator::Get_Total_Rounding_Waste() const
+{
+    uint64_t waste = 0;
+
+    for (int i = 0; i < STATS_STRIPES; ++i) {
+        waste += m_stats[i].rounding_waste.load(std::memory_order_relaxed);
+    }
+
+    return waste;
+}
+
+uint32_t DynamicMemoryAllocator::Get_Size_Histogram_Count(int bucket) const
+{
+    uint32_t count = 0;
+
+    for (int i = 0; i < STATS_STRIPES; ++i) {
+        count += m_stats[i].size_histogram[bucket].load(std::memory_order_relaxed);
+    }
+
+    return count;
+}
+
+/**
+ * Threads pick a stripe the first time they count something, spreading them over the stripes in turn.
+ */
+DynamicMemoryAllocator::StatsStripe &DynamicMemoryAllocator::Get_Stats_Stripe()
+{
+    if (t_statsStripe < 0) {
+        t_statsStripe = int(s_nextStatsStripe.fetch_add(1, std::memory_order_relaxed) % STATS_STRIPES);
+    }
+
+    return m_stats[t_statsStripe];
+}
+
+void DynamicMemoryAllocator::Count_Allocation(int bytes, MemoryPool *pool)
+{
+    StatsStripe &stripe = Get_Stats_Stripe();
+    stripe.used_blocks.fetch_add(1, std::memory_order_relaxed);
+
+    if (pool != nullptr) {
+        stripe.rounding_waste.fetch_add(pool->m_allocationSize - bytes, std::memory_order_relaxed);
+    } else {
+        stripe.raw_allocations.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    int bucket;
+
+    if (bytes <= SIZE_CLASS_LIMIT) {
+        bucket = Get_Size_Class(bytes);
+    } else {
+        bucket = SIZE_CLASS_COUNT;
+
+        while (bucket < SIZE_HISTOGRAM_BUCKETS - 1 && bytes > Get_Size_Histogram_Bucket_Size(bucket)) {
+            ++bucket;
+        }
+    }
+
+    stripe.size_histogram[bucket].fetch_add(1, std::memory_order_relaxed);
+}
+
+/**
+ * Upper bound of a histogram bucket, the granularity of the size classes up to their limit then powers of two.
+ */
+int DynamicMemoryAllocator::Get_Size_Histogram_Bucket_Size(int bucket)
+{
+    if (bucket < SIZE_CLASS_COUNT) {
+        return bucket * SIZE_CLASS_GRANULARITY;
+    }
+
+    int shift = bucket - SIZE_CLASS_COUNT + 1;
+
+    return shift < LARGE_SIZE_BUCKETS ? SIZE_CLASS_LIMIT << shift : INT_MAX;
+}
+
+/**
+ * Maps each size class to the first pool big enough for the smallest size in it. Works for any pool order and sizes,
+ * a pool size that isn't a multiple of the granularity just means the search for that class can take an extra step.
+ */
+void DynamicMemoryAllocator::Build_Size_Classes()
+{
+    for (int size_class = 0; size_class < SIZE_CLASS_COUNT; ++size_class) {
+        int smallest_size = std::max((size_class - 1) * SIZE_CLASS_GRANULARITY + 1, 0);
+        int pool = 0;
+
+        while (pool < m_poolCount && m_pools[pool]->m_allocationSize < smallest_size) {
+            ++pool;
+        }
+
+        m_sizeClassPools[size_class] = pool;
+    }
+}
+
+int DynamicMemoryAllocator::Get_Size_Class(int size)
+{
+    if (size <= 0) {
+        return 0;
+    }
+
+    // Larger sizes start from the last class, every pool before its first is too small for them too.
+    return size < SIZE_CLASS_LIMIT ? (size + SIZE_CLASS_GRANULARITY - 1) / SIZE_CLASS_GRANULARITY : SIZE_CLASS_COUNT - 1;
+}
+
+/**
+ * Raw blocks are kept on the same list whether they come from the arena or the heap, only the free differs.
+ */
+void *DynamicMemoryAllocator::Allocate_Large_Block(int bytes)
+{
+    if (s_useHugePageArena && m_hugePageArena == nullptr) {
+        m_hugePageArena = new HugePageArena;
+
+        if (!m_hugePageArena->Init(HugePageArena::Get_Default_Reserve())) {
+            captainslog_warn("Could not reserve address space for the huge page arena, using the heap instead.");
+            delete m_hugePageArena;
+            m_hugePageArena = nullptr;
+            s_useHugePageArena = false;
+        }
+    }
+
+    if (s_useHugePageArena) {
+        int block_size = Round_Up_Word_Size(bytes) + sizeof(MemoryPoolSingleBlock);
+        MemoryPoolSingleBlock *block = static_cast<MemoryPoolSingleBlock *>(m_hugePageArena->Allocate(block_size));
+
+        if (block != nullptr) {
+            block->Init_Block(bytes, nullptr, m_factory);
+            block->Add_Block_To_List(m_rawBlocks);
+            m_rawBlocks = block;
+
+            return block->Get_User_Data();
+        }
+    }
+
+    return MemoryPoolSingleBlock::Raw_Allocate_Single_Block(&m_rawBlocks, bytes, m_factory)->Get_User_Data();
+}
+
+void DynamicMemoryAllocator::Free_Large_Block(MemoryPoolSingleBlock *block)
+{
+    // The arena stays around once created even if disabled again, blocks from it may still be live.
+    if (m_hugePageArena != nullptr && m_hugePageArena->Owns(block)) {
+        m_hugePageArena->Free(block);
+    } else {
+        Raw_Free(block);
+    }
+}
+#endif
@@ -17,7 +17,12 @@
 #include "always.h"
 #include "rawalloc.h"
 
+#ifndef GAME_DLL
+#include <atomic>
+#endif
+
 struct PoolInitRec;
+class HugePageArena;
 class MemoryPool;
 class MemoryPoolFactory;
 class MemoryPoolSingleBlock;
@@ -28,6 +33,16 @@ class DynamicMemoryAllocator
     friend class MemoryPoolFactory;
 
 public:
+    enum
+    {
+        SIZE_CLASS_GRANULARITY = 8,
+        SIZE_CLASS_LIMIT = 2048, // Sizes above this search the pools from the first one big enough for the limit.
+        SIZE_CLASS_COUNT = SIZE_CLASS_LIMIT / SIZE_CLASS_GRANULARITY + 1,
+        LARGE_SIZE_BUCKETS = 20, // Powers of two above SIZE_CLASS_LIMIT in the size histogram.
+        SIZE_HISTOGRAM_BUCKETS = SIZE_CLASS_COUNT + LARGE_SIZE_BUCKETS,
+        STATS_STRIPES = 8,
+    };
+
     DynamicMemoryAllocator();
     void Init(MemoryPoolFactory *factory, int subpools, PoolInitRec const *const params);
     ~DynamicMemoryAllocator();
@@ -40,16 +55,59 @@ public:
     int Get_Actual_Allocation_Size(int bytes);
     void Reset();
 
+#ifndef GAME_DLL
+    // Thyme specific, totals since creation for telemetry.
+    int Get_Used_Blocks() const;
+    uint64_t Get_Allocation_Count() const;
+    uint64_t Get_Raw_Allocation_Count() const;
+    // Bytes every pooled allocation was rounded up by, added on allocation and never taken off on free.
+    uint64_t Get_Total_Rounding_Waste() const;
+
+    // Thyme specific, requested sizes bucketed for replaying the distribution, the bucket size is its upper bound.
+    uint32_t Get_Size_Histogram_Count(int bucket) const;
+    static int Get_Size_Histogram_Bucket_Size(int bucket);
+
+    // Thyme specific, allocations too big for the pools come from a huge page backed arena rather than the heap.
+    static void Set_Huge_Page_Arena(bool enabled) { s_useHugePageArena = enabled; }
+    static bool Is_Using_Huge_Page_Arena() { return s_useHugePageArena; }
+#endif
+
     void *operator new(size_t size) { return Raw_Allocate_No_Zero(size); }
     void operator delete(void *obj) { Raw_Free(obj); }
 
 private:
+#ifndef GAME_DLL
+    // Counters for the threads that picked this stripe, threads allocating at once mostly update different stripes.
+    struct StatsStripe
+    {
+        std::atomic<int> used_blocks;
+        std::atomic<uint64_t> raw_allocations; // Too big for any sub pool.
+        std::atomic<uint64_t> rounding_waste; // Bytes requests were rounded up by, only ever grows.
+        std::atomic<uint32_t> size_histogram[SIZE_HISTOGRAM_BUCKETS]; // Every allocation is counted in one bucket.
+    };
+
+    StatsStripe &Get_Stats_Stripe();
+    void Count_Allocation(int bytes, MemoryPool *pool);
+    void Build_Size_Classes();
+    void *Allocate_Large_Block(int bytes);
+    void Free_Large_Block(MemoryPoolSingleBlock *block);
+    static int Get_Size_Class(int size);
+#endif
+
     MemoryPoolFactory *m_factory;
     DynamicMemoryAllocator *m_nextDmaInFactory;
     int m_poolCount;
-    int m_usedBlocksInDma;
+#ifdef GAME_DLL
+    int m_usedBlocksInDma; // Counted in the stats stripes otherwise.
+#endif
     MemoryPool *m_pools[8];
-    MemoryPoolSingleBlock *m_rawBlocks;
+    MemoryPoolSingleBlock *m_rawBlocks; // Guarded by g_dmaCriticalSection, the pools lock for themselves.
+#ifndef GAME_DLL
+    uint8_t m_sizeClassPools[SIZE_CLASS_COUNT]; // First pool big enough for the smallest size in each class.
+    StatsStripe m_stats[STATS_STRIPES];
+    HugePageArena *m_hugePageArena;
+    static bool s_useHugePageArena;
+#endif
 };
 
 #ifdef GAME_DLL
@@ -18,11 +18,182 @@
 #include "memblock.h"
 #include <algorithm>
 #include <cstring>
+#include <new>
+
+#ifndef GAME_DLL
+#include <atomic>
+#endif
 
 using std::memset;
 
 #ifndef GAME_DLL
 SimpleCriticalSectionClass *g_memoryPoolCriticalSection = nullptr;
+
+namespace
+{
+// Caches hold at most two batches, batches are capped by count and by size so pools of big or rarely used blocks don't
+// end up creating overflow blobs just to fill the caches.
+const int MAX_CACHE_BATCH = 16;
+const int MAX_CACHE_BATCH_BYTES = 8192;
+const int MIN_CACHE_BATCH = 2;
+
+struct CacheSlot
+{
+    MemoryPool *pool;
+    unsigned generation;
+};
+
+// Everything here is plain data so it is usable from pools created during static initialisation.
+CacheSlot *s_cacheSlots;
+int s_cacheSlotCount;
+int s_cacheSlotCapacity;
+MemoryPoolThreadCache *s_threadCaches;
+unsigned s_nextCacheGeneration;
+std::atomic<bool> s_threadCaching(true);
+
+// Guards the slots and the list of thread caches. Always taken after g_memoryPoolCriticalSection when both are needed.
+SimpleCriticalSectionClass &Get_Cache_Lock()
+{
+    static SimpleCriticalSectionClass s_cacheLock;
+    return s_cacheLock;
+}
+} // namespace
+
+struct MemoryPoolMagazine
+{
+    MemoryPool *pool; // Pool and generation are only changed under the cache lock as other threads read them.
+    unsigned generation;
+    std::atomic<int> count; // Only changed by the owning thread, read by others when counting a pool's cached blocks.
+    std::atomic<uint64_t> allocations; // Same as count, moved into the pool's total when the magazine is flushed.
+    void *blocks[MAX_CACHE_BATCH * 2];
+};
+
+// Magazines for the calling thread indexed by pool cache slot, anything left in them goes back to the pools when the
+// thread exits.
+class MemoryPoolThreadCache
+{
+public:
+    ~MemoryPoolThreadCache();
+
+    MemoryPoolMagazine *Find(int slot) const { return slot < m_capacity ? m_magazines[slot] : nullptr; }
+    MemoryPoolMagazine *Create(int slot);
+    void Flush();
+
+public:
+    MemoryPoolMagazine **m_magazines;
+    int m_capacity;
+    bool m_registered;
+    MemoryPoolThreadCache *m_next;
+    MemoryPoolThreadCache *m_prev;
+};
+
+namespace
+{
+thread_local MemoryPoolThreadCache t_threadCache;
+// Other thread_local destructors can still allocate and free after the cache's has run. Kept out of the cache as the
+// compiler is free to drop stores to an object in its own destructor.
+thread_local bool t_threadCacheDestroyed;
+} // namespace
+
+std::atomic<bool> MemoryPool::s_threadAllocationCounting;
+thread_local uint64_t MemoryPool::s_threadAllocationCount;
+
+MemoryPoolThreadCache::~MemoryPoolThreadCache()
+{
+    Flush();
+
+    if (m_registered) {
+        ScopedCriticalSectionClass cs(&Get_Cache_Lock());
+
+        if (m_prev != nullptr) {
+            m_prev->m_next = m_next;
+        } else {
+            s_threadCaches = m_next;
+        }
+
+        if (m_next != nullptr) {
+            m_next->m_prev = m_prev;
+        }
+
+        m_registered = false;
+    }
+
+    for (int i = 0; i < m_capacity; ++i) {
+        Raw_Free(m_magazines[i]);
+    }
+
+    Raw_Free(m_magazines);
+    m_magazines = nullptr;
+    m_capacity = 0;
+    t_threadCacheDestroyed = true;
+}
+
+MemoryPoolMagazine *MemoryPoolThreadCache::Create(int slot)
+{
+    ScopedCriticalSectionClass cs(&Get_Cache_Lock());
+
+    if (!m_registered) {
+        m_prev = nullptr;
+        m_next = s_threadCaches;
+
+        if (m_next != nullptr) {
+            m_next->m_prev = this;
+        }
+
+        s_threadCaches = this;
+        m_registered = true;
+    }
+
+    // Grown under the lock as other threads read the array when counting cached blocks.
+    if (slot >= m_capacity) {
+        int capacity = std::max(std::max(m_capacity * 2, slot + 1), 64);
+        MemoryPoolMagazine **magazines =
+            static_cast<MemoryPoolMagazine **>(Raw_Allocate(capacity * sizeof(MemoryPoolMagazine *)));
+
+        if (m_capacity > 0) {
+            memcpy(magazines, m_magazines, m_capacity * sizeof(MemoryPoolMagazine *));
+        }
+
+        Raw_Free(m_magazines);
+        m_magazines = magazines;
+        m_capacity = capacity;
+    }
+
+    if (m_magazines[slot] == nullptr) {
+        m_magazines[slot] = new (Raw_Allocate_No_Zero(sizeof(MemoryPoolMagazine))) MemoryPoolMagazine();
+    }
+
+    return m_magazines[slot];
+}
+
+/**
+ * Returns every cached block to its pool, blocks of pools that have since been reset or destroyed are just dropped.
+ */
+void MemoryPoolThreadCache::Flush()
+{
+    ScopedCriticalSectionClass pool_cs(g_memoryPoolCriticalSection);
+    ScopedCriticalSectionClass cs(&Get_Cache_Lock());
+
+    for (int i = 0; i < m_capacity; ++i) {
+        MemoryPoolMagazine *magazine = m_magazines[i];
+
+        if (magazine == nullptr) {
+            continue;
+        }
+
+        if (i < s_cacheSlotCount && s_cacheSlots[i].pool == magazine->pool
+            && s_cacheSlots[i].generation == magazine->generation) {
+            for (int j = magazine->count.load(std::memory_order_relaxed) - 1; j >= 0; --j) {
+                magazine->pool->Free_Block_Locked(magazine->blocks[j]);
+            }
+
+            magazine->pool->m_allocationCount += magazine->allocations.load(std::memory_order_relaxed);
+        }
+
+        magazine->count.store(0, std::memory_order_relaxed);
+        magazine->allocations.store(0, std::memory_order_relaxed);
+    }
+}
 #endif
 
 MemoryPool::MemoryPool() :
@@ -38,11 +209,24 @@ MemoryPool::MemoryPool() :
     m_firstBlob(nullptr),
     m_lastBlob(nullptr),
     m_firstBlobWithFreeBlocks(nullptr)
+#ifndef GAME_DLL
+    ,
+    m_lastBlobWithFreeBlocks(nullptr),
+    m_cacheSlot(-1),
+    m_cacheBatch(0),
+    m_cacheGeneration(0),
+    m_allocationCount(0),
+    m_overflowBlobCount(0)
+#endif
 {
 }
 
 MemoryPool::~MemoryPool()
 {
+#ifndef GAME_DLL
+    Release_Cache_Slot();
+#endif
+
     for (MemoryPoolBlob *b = m_firstBlob; b != nullptr; b = m_firstBlob) {
         Free_Blob(b);
     }
@@ -61,6 +245,10 @@ void MemoryPool::Init(MemoryPoolFactory *factory, const char *name, int size, in
     m_firstBlob = nullptr;
     m_lastBlob = nullptr;
     m_firstBlobWithFreeBlocks = nullptr;
+#ifndef GAME_DLL
+    m_lastBlobWithFreeBlocks = nullptr;
+    Bind_Cache_Slot();
+#endif
     Create_Blob(count);
 }
 
@@ -72,7 +260,11 @@ MemoryPoolBlob *MemoryPool::Create_Blob(int count)
 
     captainslog_dbgassert(m_firstBlobWithFreeBlocks == nullptr, "Expected nullptr here");
 
+#ifndef GAME_DLL
+    blob->Add_To_Free_List(true);
+#else
     m_firstBlobWithFreeBlocks = blob;
+#endif
     m_totalBlocksInPool += count;
 
     return blob;
@@ -84,9 +276,15 @@ int MemoryPool::Free_Blob(MemoryPoolBlob *blob)
 
     blob->Remove_Blob_From_List(&m_firstBlob, &m_lastBlob);
 
+#ifndef GAME_DLL
+    if (blob->m_firstFreeBlock != nullptr) {
+        blob->Remove_From_Free_List();
+    }
+#else
     if (m_firstBlobWithFreeBlocks == blob) {
         m_firstBlobWithFreeBlocks = m_firstBlob;
     }
+#endif
 
     int blob_alloc = blob->m_totalBlocksInBlob * m_allocationSize + sizeof(*blob);
     m_usedBlocksInPool -= blob->m_usedBlocksInBlob;
@@ -98,9 +296,156 @@ int MemoryPool::Free_Blob(MemoryPoolBlob *blob)
 }
 
 void *MemoryPool::Allocate_Block_No_Zero()
+{
+#ifndef GAME_DLL
+    MemoryPoolMagazine *magazine = Get_Thread_Magazine();
+
+    if (magazine != nullptr) {
+        int count = magazine->count.load(std::memory_order_relaxed);
+
+        if (count == 0) {
+            count = Refill_Magazine(magazine);
+        }
+
+        magazine->count.store(count - 1, std::memory_order_relaxed);
+        magazine->allocations.store(magazine->allocations.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        Count_Thread_Allocation();
+
+        return magazine->blocks[count - 1];
+    }
+#endif
+
+    ScopedCriticalSectionClass scs(g_memoryPoolCriticalSection);
+    void *block = Allocate_Block_Locked();
+#ifndef GAME_DLL
+    ++m_allocationCount;
+    Count_Thread_Allocation();
+#endif
+
+    return block;
+}
+
+void *MemoryPool::Allocate_Block()
+{
+    void *block = Allocate_Block_No_Zero();
+    memset(block, 0, m_allocationSize);
+
+    return block;
+}
+
+void MemoryPool::Free_Block(void *block)
+{
+    if (block == nullptr) {
+        return;
+    }
+
+#ifndef GAME_DLL
+    MemoryPoolMagazine *magazine = Get_Thread_Magazine();
+
+    if (magazine != nullptr) {
+        captainslog_dbgassert(MemoryPoolSingleBlock::Recover_Block_From_User_Data(block)->m_owningBlob->m_owningPool == this,
+            "Block is not part of this pool");
+        int count = magazine->count.load(std::memory_order_relaxed);
+
+        if (count == m_cacheBatch * 2) {
+            count = Flush_Magazine(magazine, m_cacheBatch);
+        }
+
+        magazine->blocks[count] = block;
+        magazine->count.store(count + 1, std::memory_order_relaxed);
+
+        return;
+    }
+#endif
+
+    ScopedCriticalSectionClass scs(g_memoryPoolCriticalSection);
+    Free_Block_Locked(block);
+}
+
+/**
+ * Blocks in use, not counting ones freed into a thread cache but not yet returned to the pool.
+ */
+int MemoryPool::Get_Used_Blocks()
+{
+    ScopedCriticalSectionClass scs(g_memoryPoolCriticalSection);
+#ifndef GAME_DLL
+    return m_usedBlocksInPool - Count_Cached_Blocks_Locked();
+#else
+    return m_usedBlocksInPool;
+#endif
+}
+
+/**
+ * Highest number of blocks taken from the pool at once. Blocks held in thread caches count as they can't be handed out
+ * to other threads, so this is the number of blocks the pool needed rather than what callers held.
+ */
+int MemoryPool::Get_Peak_Used_Blocks()
 {
     ScopedCriticalSectionClass scs(g_memoryPoolCriticalSection);
+    return m_peakUsedBlocksInPool;
+}
 
+void MemoryPool::Get_Stats(MemoryPoolStats &stats)
+{
+    ScopedCriticalSectionClass scs(g_memoryPoolCriticalSection);
+    stats.pool_name = m_poolName;
+    stats.allocation_size = m_allocationSize;
+    stats.initial_allocation_count = m_initialAllocationCount;
+    stats.overflow_allocation_count = m_overflowAllocationCount;
+    stats.used_blocks = m_usedBlocksInPool;
+    stats.peak_used_blocks = m_peakUsedBlocksInPool;
+    stats.total_blocks = m_totalBlocksInPool;
+    stats.blob_count = Count_Blobs();
+#ifndef GAME_DLL
+    stats.allocations = m_allocationCount;
+    stats.cached_blocks = Count_Cached_Blocks_Locked(&stats.allocations);
+    stats.used_blocks -= stats.cached_blocks;
+    stats.overflow_blobs = m_overflowBlobCount;
+#else
+    stats.allocations = 0;
+    stats.cached_blocks = 0;
+    stats.overflow_blobs = std::max(stats.blob_count - 1, 0);
+#endif
+}
+
+/**
+ * Returns the calling thread's cached blocks for every pool.
+ */
+void MemoryPool::Flush_Thread_Cache()
+{
+#ifndef GAME_DLL
+    if (!t_threadCacheDestroyed) {
+        t_threadCache.Flush();
+    }
+#endif
+}
+
+/**
+ * Turning caching off stops new blocks being cached, the calling thread's cached blocks are flushed.
+ */
+void MemoryPool::Set_Thread_Caching(bool enabled)
+{
+#ifndef GAME_DLL
+    s_threadCaching.store(enabled);
+
+    if (!enabled) {
+        Flush_Thread_Cache();
+    }
+#endif
+}
+
+bool MemoryPool::Is_Thread_Caching()
+{
+#ifndef GAME_DLL
+    return s_threadCaching.load();
+#else
+    return false;
+#endif
+}
+
+void *MemoryPool::Allocate_Block_Locked()
+{
+#ifdef GAME_DLL
     if (m_firstBlobWithFreeBlocks != nullptr && m_firstBlobWithFreeBlocks->m_firstFreeBlock == nullptr) {
         MemoryPoolBlob *i;
         for (i = m_firstBlob; i != nullptr; i = i->m_nextBlob) {
@@ -111,12 +456,17 @@ void *MemoryPool::Allocate_Block_No_Zero()
 
         m_firstBlobWithFreeBlocks = i;
     }
+#endif
 
+    // Blobs are taken off the free list as they fill so the head always has a free block.
     if (m_firstBlobWithFreeBlocks == nullptr) {
         captainslog_relassert(m_overflowAllocationCount != 0,
             0xDEAD0002,
             "Attempting to allocate overflow blocks when m_overflowAllocationCount is 0.");
         Create_Blob(m_overflowAllocationCount);
+#ifndef GAME_DLL
+        ++m_overflowBlobCount;
+#endif
     }
 
     MemoryPoolSingleBlock *block = m_firstBlobWithFreeBlocks->Allocate_Single_Block();
@@ -126,34 +476,175 @@ void *MemoryPool::Allocate_Block_No_Zero()
     return block->Get_User_Data();
 }
 
-void *MemoryPool::Allocate_Block()
+void MemoryPool::Free_Block_Locked(void *block)
 {
-    void *block = Allocate_Block_No_Zero();
-    memset(block, 0, m_allocationSize);
+    MemoryPoolSingleBlock *mp_block = MemoryPoolSingleBlock::Recover_Block_From_User_Data(block);
+    MemoryPoolBlob *mp_blob = mp_block->m_owningBlob;
 
-    return block;
+    captainslog_dbgassert(mp_blob != nullptr && mp_blob->m_owningPool == this, "Block is not part of this pool");
+
+    mp_blob->Free_Single_Block(mp_block);
+    --m_usedBlocksInPool;
+
+#ifdef GAME_DLL
+    if (m_firstBlobWithFreeBlocks == nullptr) {
+        m_firstBlobWithFreeBlocks = mp_blob;
+    }
+#endif
 }
 
-void MemoryPool::Free_Block(void *block)
+#ifndef GAME_DLL
+/**
+ * The calling thread's magazine for this pool, null if this pool isn't cached.
+ */
+MemoryPoolMagazine *MemoryPool::Get_Thread_Magazine()
 {
-    if (block == nullptr) {
-        return;
+    if (m_cacheBatch == 0 || !s_threadCaching.load(std::memory_order_relaxed)) {
+        return nullptr;
     }
 
+    // Once the thread's cache is gone anything still allocating takes the locked path rather than bringing it back.
+    if (t_threadCacheDestroyed) {
+        return nullptr;
+    }
+
+    MemoryPoolThreadCache &cache = t_threadCache;
+
+    MemoryPoolMagazine *magazine = cache.Find(m_cacheSlot);
+
+    if (magazine == nullptr || magazine->pool != this || magazine->generation != m_cacheGeneration) {
+        // Either new or left over from a pool that has been reset or destroyed since, the blocks no longer exist.
+        if (magazine == nullptr) {
+            magazine = cache.Create(m_cacheSlot);
+        }
+
+        ScopedCriticalSectionClass scs(g_memoryPoolCriticalSection);
+        ScopedCriticalSectionClass cs(&Get_Cache_Lock());
+
+        if (magazine->pool == this) {
+            m_allocationCount += magazine->allocations.load(std::memory_order_relaxed);
+        }
+
+        magazine->pool = this;
+        magazine->generation = m_cacheGeneration;
+        magazine->count.store(0, std::memory_order_relaxed);
+        magazine->allocations.store(0, std::memory_order_relaxed);
+    }
+
+    return magazine;
+}
+
+/**
+ * Fills an empty magazine with a batch of blocks, returns the new count.
+ */
+int MemoryPool::Refill_Magazine(MemoryPoolMagazine *magazine)
+{
     ScopedCriticalSectionClass scs(g_memoryPoolCriticalSection);
-    MemoryPoolSingleBlock *mp_block = MemoryPoolSingleBlock::Recover_Block_From_User_Data(block);
-    MemoryPoolBlob *mp_blob = mp_block->m_owningBlob;
 
-    captainslog_dbgassert(mp_blob != nullptr && mp_blob->m_owningPool == this, "Block is not part of this pool");
+    for (int i = 0; i < m_cacheBatch; ++i) {
+        magazine->blocks[i] = Allocate_Block_Locked();
+    }
 
-    mp_blob->Free_Single_Block(mp_block);
+    return m_cacheBatch;
+}
 
-    if (m_firstBlobWithFreeBlocks == nullptr) {
-        m_firstBlobWithFreeBlocks = mp_blob;
-        --m_usedBlocksInPool;
+/**
+ * Returns the oldest count blocks from a magazine to the pool, returns the new count.
+ */
+int MemoryPool::Flush_Magazine(MemoryPoolMagazine *magazine, int count)
+{
+    ScopedCriticalSectionClass scs(g_memoryPoolCriticalSection);
+    int remaining = magazine->count.load(std::memory_order_relaxed) - count;
+
+    for (int i = 0; i < count; ++i) {
+        Free_Block_Locked(magazine->blocks[i]);
     }
+
+    memmove(magazine->blocks, magazine->blocks + count, remaining * sizeof(void *));
+    magazine->count.store(remaining, std::memory_order_relaxed);
+
+    return remaining;
+}
+
+/**
+ * Blocks of this pool sitting in any thread's cache, the caller holds g_memoryPoolCriticalSection.
+ */
+int MemoryPool::Count_Cached_Blocks_Locked(uint64_t *allocations)
+{
+    if (m_cacheBatch == 0) {
+        return 0;
+    }
+
+    ScopedCriticalSectionClass cs(&Get_Cache_Lock());
+    int count = 0;
+
+    for (MemoryPoolThreadCache *cache = s_threadCaches; cache != nullptr; cache = cache->m_next) {
+        MemoryPoolMagazine *magazine = cache->Find(m_cacheSlot);
+
+        if (magazine != nullptr && magazine->pool == this && magazine->generation == m_cacheGeneration) {
+            count += magazine->count.load(std::memory_order_relaxed);
+
+            if (allocations != nullptr) {
+                *allocations += magazine->allocations.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    return count;
+}
+
+/**
+ * Gives the pool a cache slot if it doesn't have one yet and a new generation so anything cached from its old blobs is
+ * dropped.
+ */
+void MemoryPool::Bind_Cache_Slot()
+{
+    ScopedCriticalSectionClass cs(&Get_Cache_Lock());
+
+    if (m_cacheSlot < 0) {
+        for (m_cacheSlot = 0; m_cacheSlot < s_cacheSlotCount; ++m_cacheSlot) {
+            if (s_cacheSlots[m_cacheSlot].pool == nullptr) {
+                break;
+            }
+        }
+
+        if (m_cacheSlot == s_cacheSlotCapacity) {
+            int capacity = std::max(s_cacheSlotCapacity * 2, 256);
+            CacheSlot *slots = static_cast<CacheSlot *>(Raw_Allocate(capacity * sizeof(CacheSlot)));
+
+            if (s_cacheSlotCapacity > 0) {
+                memcpy(slots, s_cacheSlots, s_cacheSlotCapacity * sizeof(CacheSlot));
+            }
+
+            Raw_Free(s_cacheSlots);
+            s_cacheSlots = slots;
+            s_cacheSlotCapacity = capacity;
+        }
+
+        s_cacheSlotCount = std::max(s_cacheSlotCount, m_cacheSlot + 1);
+    }
+
+    m_cacheGeneration = ++s_nextCacheGeneration;
+    m_cacheBatch = std::min(std::min(MAX_CACHE_BATCH, m_overflowAllocationCount / 4),
+        MAX_CACHE_BATCH_BYTES / std::max(m_allocationSize, 1));
+    m_cacheBatch = m_cacheBatch >= MIN_CACHE_BATCH ? m_cacheBatch : 0;
+    s_cacheSlots[m_cacheSlot].pool = this;
+    s_cacheSlots[m_cacheSlot].generation = m_cacheGeneration;
 }
 
+void MemoryPool::Release_Cache_Slot()
+{
+    ScopedCriticalSectionClass cs(&Get_Cache_Lock());
+
+    if (m_cacheSlot >= 0) {
+        s_cacheSlots[m_cacheSlot].pool = nullptr;
+        s_cacheSlots[m_cacheSlot].generation = 0;
+        m_cacheSlot = -1;
+        m_cacheBatch = 0;
+    }
+}
+#endif
+
 int MemoryPool::Count_Blobs()
 {
     int count = 0;
@@ -165,17 +656,71 @@ int MemoryPool::Count_Blobs()
     return count;
 }
 
+#ifndef GAME_DLL
+/**
+ * Checks the list of blobs with free blocks against the blobs, every blob with a free block has to be on it once with
+ * the partly used ones ahead of the empty ones.
+ */
+bool MemoryPool::Is_Free_Blob_List_Valid()
+{
+    ScopedCriticalSectionClass scs(g_memoryPoolCriticalSection);
+
+    int with_free_blocks = 0;
+    int blob_count = 0;
+
+    for (MemoryPoolBlob *i = m_firstBlob; i != nullptr; i = i->m_nextBlob) {
+        with_free_blocks += i->m_firstFreeBlock != nullptr ? 1 : 0;
+        ++blob_count;
+    }
+
+    MemoryPoolBlob *prev = nullptr;
+    int listed = 0;
+    bool seen_empty = false;
+
+    for (MemoryPoolBlob *i = m_firstBlobWithFreeBlocks; i != nullptr; i = i->m_nextFreeBlob) {
+        // Counting against the blobs also stops a loop in the list.
+        if (++listed > blob_count || i->m_owningPool != this || i->m_prevFreeBlob != prev
+            || i->m_firstFreeBlock == nullptr) {
+            return false;
+        }
+
+        if (i->m_usedBlocksInBlob == 0) {
+            seen_empty = true;
+        } else if (seen_empty) {
+            return false;
+        }
+
+        prev = i;
+    }
+
+    return m_lastBlobWithFreeBlocks == prev && listed == with_free_blocks;
+}
+#endif
+
 int MemoryPool::Release_Empties()
 {
+    // Blocks cached by the calling thread would otherwise keep their blobs alive.
+    Flush_Thread_Cache();
     ScopedCriticalSectionClass scs(g_memoryPoolCriticalSection);
 
     int count = 0;
 
-    for (MemoryPoolBlob *i = m_firstBlob; i != nullptr; i = i->m_nextBlob) {
+#ifndef GAME_DLL
+    // Empty blobs are kept at the end of the free list so only they are visited.
+    while (m_lastBlobWithFreeBlocks != nullptr && m_lastBlobWithFreeBlocks->m_usedBlocksInBlob == 0) {
+        count += Free_Blob(m_lastBlobWithFreeBlocks);
+    }
+#else
+    MemoryPoolBlob *next;
+
+    for (MemoryPoolBlob *i = m_firstBlob; i != nullptr; i = next) {
+        next = i->m_nextBlob;
+
         if (i->m_usedBlocksInBlob == 0) {
             count += Free_Blob(i);
         }
     }
+#endif
 
     return count;
 }
@@ -17,9 +17,31 @@
 #include "always.h"
 #include "rawalloc.h"
 
+#ifndef GAME_DLL
+#include <atomic>
+#endif
+
 class MemoryPoolFactory;
 class MemoryPoolBlob;
+class MemoryPoolThreadCache;
 class SimpleCriticalSectionClass;
+struct MemoryPoolMagazine;
+
+// Thyme specific, snapshot of a pool's usage for telemetry.
+struct MemoryPoolStats
+{
+    const char *pool_name;
+    int allocation_size;
+    int initial_allocation_count;
+    int overflow_allocation_count;
+    int used_blocks;
+    int cached_blocks; // Taken from the pool but sitting in thread caches, not counted in used_blocks.
+    int peak_used_blocks; // Includes blocks in thread caches.
+    int total_blocks;
+    int blob_count;
+    int overflow_blobs; // Blobs created after the initial one because the pool ran out.
+    uint64_t allocations;
+};
 
 #ifdef GAME_DLL
 extern SimpleCriticalSectionClass *&g_memoryPoolCriticalSection;
@@ -32,6 +54,7 @@ class MemoryPool
     friend class MemoryPoolBlob;
     friend class MemoryPoolFactory;
     friend class DynamicMemoryAllocator;
+    friend class MemoryPoolThreadCache;
 
 public:
     MemoryPool();
@@ -49,9 +72,51 @@ public:
     void Remove_From_List(MemoryPool **head);
     int Get_Alloc_Size() { return m_allocationSize; }
 
+    // Thyme specific, the used count excludes blocks sitting in thread caches, the peak includes them.
+    int Get_Used_Blocks();
+    int Get_Peak_Used_Blocks();
+    int Get_Total_Blocks() { return m_totalBlocksInPool; }
+    const char *Get_Pool_Name() { return m_poolName; }
+    MemoryPool *Get_Next_Pool_In_Factory() { return m_nextPoolInFactory; }
+    void Get_Stats(MemoryPoolStats &stats);
+#ifndef GAME_DLL
+    // Thyme specific, consistency check of the blobs with free blocks for tests.
+    bool Is_Free_Blob_List_Valid();
+#endif
+
+    // Thyme specific, blocks are handed out through per thread caches that only take the pool lock to move batches.
+    static void Flush_Thread_Cache();
+    static void Set_Thread_Caching(bool enabled);
+    static bool Is_Thread_Caching();
+#ifndef GAME_DLL
+    // Thyme specific, blocks allocated by the calling thread including those for the dynamic memory allocator. Only
+    // counted while a profiler has turned counting on so allocations don't otherwise pay for the thread local.
+    static void Set_Thread_Allocation_Counting(bool enabled) { s_threadAllocationCounting.store(enabled); }
+    static uint64_t Get_Thread_Allocation_Count() { return s_threadAllocationCount; }
+
+    static void Count_Thread_Allocation()
+    {
+        if (s_threadAllocationCounting.load(std::memory_order_relaxed)) {
+            ++s_threadAllocationCount;
+        }
+    }
+#endif
+
     void *operator new(size_t size) throw() { return Raw_Allocate(size); }
     void operator delete(void *obj) { Raw_Free(obj); }
 
+private:
+    void *Allocate_Block_Locked();
+    void Free_Block_Locked(void *block);
+#ifndef GAME_DLL
+    MemoryPoolMagazine *Get_Thread_Magazine();
+    int Refill_Magazine(MemoryPoolMagazine *magazine);
+    int Flush_Magazine(MemoryPoolMagazine *magazine, int count);
+    int Count_Cached_Blocks_Locked(uint64_t *allocations = nullptr);
+    void Bind_Cache_Slot();
+    void Release_Cache_Slot();
+#endif
+
 private:
     MemoryPoolFactory *m_factory;
     MemoryPool *m_nextPoolInFactory;
@@ -65,4 +130,14 @@ private:
     MemoryPoolBlob *m_firstBlob;
     MemoryPoolBlob *m_lastBlob;
     MemoryPoolBlob *m_firstBlobWithFreeBlocks;
+#ifndef GAME_DLL
+    MemoryPoolBlob *m_lastBlobWithFreeBlocks; // Tail of the list of blobs with free blocks, empty blobs are at the end.
+    int m_cacheSlot; // Index of this pool's magazine in each thread's cache.
+    int m_cacheBatch; // Blocks moved per refill or flush, 0 when the pool isn't cached.
+    unsigned m_cacheGeneration; // Changes when the blobs are freed so stale magazines get dropped.
+    uint64_t m_allocationCount; // Allocations not made through a thread cache.
+    int m_overflowBlobCount;
+    static std::atomic<bool> s_threadAllocationCounting;
+    static thread_local uint64_t s_threadAllocationCount;
+#endif
 };
@@ -71,7 +71,7 @@ void MemoryPoolFactory::Destroy_Memory_Pool(MemoryPool *pool)
         return;
     }
 
-    captainslog_dbgassert(pool->m_usedBlocksInPool == 0, "Destroying none empty pool.");
+    captainslog_dbgassert(pool->Get_Used_Blocks() == 0, "Destroying none empty pool.");
 
     pool->Remove_From_List(&m_firstPoolInFactory);
     delete pool;
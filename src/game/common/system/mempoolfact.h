@@ -34,6 +34,7 @@ public:
     DynamicMemoryAllocator *Create_Dynamic_Memory_Allocator(int subpools, PoolInitRec const *const params);
     void Destroy_Dynamic_Memory_Allocator(DynamicMemoryAllocator *allocator);
     void Reset();
+    MemoryPool *Get_First_Pool() { return m_firstPoolInFactory; }
 
     void *operator new(size_t size) throw() { return Raw_Allocate_No_Zero(size); }
 
@@ -0,0 +1,482 @@
+/**
+ * @file
+ *
+ * @author OmniBlade
+ *
+ * @brief Memory pool usage reports and recommended pool sizes from a recorded session. (Thyme Feature)
+ *
+ * @copyright Thyme is free software: you can redistribute it and/or
+ *            modify it under the terms of the GNU General Public License
+ *            as published by the Free Software Foundation, either version
+ *            2 of the License, or (at your option) any later version.
+ *            A full copy of the GNU General Public License can be found in
+ *            LICENSE
+ */
+#include "mempooltelemetry.h"
+#include "critsection.h"
+#include "debugdisplay.h"
+#include "memdynalloc.h"
+#include "mempoolfact.h"
+#include "statsmap.h"
+#include <algorithm>
+#include <chrono>
+#include <cinttypes>
+#include <cstring>
+
+namespace
+{
+const char REPORT_FILE[] = "MemoryPoolStats.csv";
+const char RECOMMENDED_INI_FILE[] = "MemoryPoolsRecommended.ini";
+const char RECOMMENDED_TABLE_FILE[] = "MemoryPoolsRecommended.inl";
+const char SIZE_HISTOGRAM_FILE[] = "MemoryPoolAllocSizes.csv";
+const char DMA_POOL_PREFIX[] = "dmaPool_";
+
+// Rates are only recalculated after this long so the display doesn't flicker with every frame's allocations.
+const uint64_t RATE_SAMPLE_MILLIS = 1000;
+
+// Recommended counts are rounded up to this, the ini loader rounds to a word anyway.
+const int RECOMMENDED_ROUNDING = 16;
+const int MIN_OVERFLOW_COUNT = 16;
+
+struct RateSample
+{
+    uint64_t allocations;
+    float rate;
+};
+
+Thyme::StatsMap<RateSample> s_rateSamples;
+uint64_t s_lastSampleMillis; // Guarded by the samples' lock.
+
+uint64_t Get_Millis()
+{
+    return std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+}
+
+int Round_Up_Count(int count)
+{
+    return (count + RECOMMENDED_ROUNDING - 1) / RECOMMENDED_ROUNDING * RECOMMENDED_ROUNDING;
+}
+
+bool Rate_Greater(Thyme::MemoryPoolTelemetry::PoolRecord const &a, Thyme::MemoryPoolTelemetry::PoolRecord const &b)
+{
+    if (a.allocation_rate != b.allocation_rate) {
+        return a.allocation_rate > b.allocation_rate;
+    }
+
+    return a.stats.peak_used_blocks > b.stats.peak_used_blocks;
+}
+
+// DMA pools in size order, matching how the allocator searches them, named pools alphabetically after.
+bool Table_Less(Thyme::MemoryPoolTelemetry::PoolRecord const &a, Thyme::MemoryPoolTelemetry::PoolRecord const &b)
+{
+    if (a.is_dma != b.is_dma) {
+        return a.is_dma;
+    }
+
+    if (a.is_dma) {
+        return a.stats.allocation_size < b.stats.allocation_size;
+    }
+
+    return strcmp(a.stats.pool_name, b.stats.pool_name) < 0;
+}
+
+void Print_Line(DebugDisplayInterface *dd, FILE *fp, const char *line)
+{
+    if (fp != nullptr) {
+        fputs(line, fp);
+    } else {
+        dd->Printf("%s", line);
+    }
+}
+
+uint64_t Get_Total_Rounding_Waste()
+{
+#ifndef GAME_DLL
+    if (g_dynamicMemoryAllocator != nullptr) {
+        return g_dynamicMemoryAllocator->Get_Total_Rounding_Waste();
+    }
+#endif
+
+    return 0;
+}
+
+uint64_t Get_Pooled_Allocation_Count()
+{
+#ifndef GAME_DLL
+    if (g_dynamicMemoryAllocator != nullptr) {
+        return g_dynamicMemoryAllocator->Get_Allocation_Count() - g_dynamicMemoryAllocator->Get_Raw_Allocation_Count();
+    }
+#endif
+
+    return 0;
+}
+} // namespace
+
+namespace Thyme
+{
+
+bool MemoryPoolTelemetry::s_enabled;
+bool MemoryPoolTelemetry::s_recording;
+
+/**
+ * Starts reporting on the pools, recording the session also writes recommended sizes at shutdown.
+ */
+void MemoryPoolTelemetry::Enable(bool record_session)
+{
+    s_recording = s_recording || record_session;
+    s_enabled = true;
+}
+
+void MemoryPoolTelemetry::Disable()
+{
+    s_enabled = false;
+    s_recording = false;
+}
+
+/**
+ * Snapshots every pool the factory owns. The pools keep their own counters all the time, this only reads them.
+ */
+void MemoryPoolTelemetry::Get_Records(std::vector<PoolRecord> &records)
+{
+    records.clear();
+
+    if (g_memoryPoolFactory == nullptr) {
+        return;
+    }
+
+    {
+        ScopedCriticalSectionClass scs(g_memoryPoolCriticalSection);
+        int count = 0;
+
+        for (MemoryPool *pool = g_memoryPoolFactory->Get_First_Pool(); pool != nullptr;
+             pool = pool->Get_Next_Pool_In_Factory()) {
+            ++count;
+        }
+
+        records.reserve(count);
+
+        for (MemoryPool *pool = g_memoryPoolFactory->Get_First_Pool(); pool != nullptr;
+             pool = pool->Get_Next_Pool_In_Factory()) {
+            PoolRecord record;
+            pool->Get_Stats(record.stats);
+            record.allocation_rate = 0.0f;
+            record.wasted_bytes = (record.stats.total_blocks - record.stats.used_blocks) * record.stats.allocation_size;
+            record.is_dma = strncmp(record.stats.pool_name, DMA_POOL_PREFIX, sizeof(DMA_POOL_PREFIX) - 1) == 0;
+            records.push_back(record);
+        }
+    }
+
+    ScopedCriticalSectionClass cs(s_rateSamples.Get_Lock());
+    uint64_t now = Get_Millis();
+    uint64_t elapsed = now - s_lastSampleMillis;
+    bool resample = elapsed >= RATE_SAMPLE_MILLIS;
+
+    for (auto it = records.begin(); it != records.end(); ++it) {
+        bool added;
+        RateSample &sample = s_rateSamples.Find_Or_Add(it->stats.pool_name, added);
+
+        if (added) {
+            sample.allocations = it->stats.allocations;
+            sample.rate = 0.0f;
+        } else if (resample) {
+            // Pools that are reset or recreated can go backwards, treat that as a fresh start.
+            uint64_t delta = it->stats.allocations >= sample.allocations ? it->stats.allocations - sample.allocations : 0;
+            sample.rate = float(delta) * 1000.0f / float(elapsed);
+            sample.allocations = it->stats.allocations;
+        }
+
+        it->allocation_rate = sample.rate;
+    }
+
+    if (resample) {
+        s_lastSampleMillis = now;
+    }
+}
+
+/**
+ * Sizes the initial blob for the recorded peak with an eighth extra as headroom. Blocks held in thread caches come out of
+ * the pool as much as ones in use, so the size covers both. The overflow count is only raised when
+ * the session overflowed, so that a pool which still runs out grows in fewer steps. Pools that saw no use keep their
+ * current sizes as the session says nothing about them.
+ */
+void MemoryPoolTelemetry::Recommend_Size(MemoryPoolStats const &stats, int &initial_count, int &overflow_count)
+{
+    initial_count = stats.initial_allocation_count;
+    overflow_count = stats.overflow_allocation_count;
+
+    // The peak already counts cached blocks, the current count covers stats that were taken without it.
+    int needed = std::max(stats.peak_used_blocks, stats.used_blocks + stats.cached_blocks);
+
+    if (needed <= 0) {
+        return;
+    }
+
+    initial_count = Round_Up_Count(needed + needed / 8);
+
+    if (stats.overflow_blobs > 0) {
+        overflow_count = std::max(overflow_count, Round_Up_Count(initial_count / 4));
+    }
+
+    overflow_count = std::max(overflow_count, MIN_OVERFLOW_COUNT);
+}
+
+/**
+ * One line per pool, busiest first. Wasted bytes are what is allocated but unused at the time of the dump, the peak is
+ * over the whole run.
+ */
+bool MemoryPoolTelemetry::Write_Report(const char *filename)
+{
+    FILE *fp = Open_Stats_File(filename, "memory pool telemetry");
+
+    if (fp == nullptr) {
+        return false;
+    }
+
+    std::vector<PoolRecord> records;
+    Get_Records(records);
+    std::sort(records.begin(), records.end(), Rate_Greater);
+    fprintf(fp,
+        "name,dma,block_size,initial_count,overflow_count,used_blocks,cached_blocks,peak_blocks,total_blocks,blobs,"
+        "overflow_blobs,allocations,allocations_per_sec,wasted_bytes\n");
+
+    for (auto it = records.begin(); it != records.end(); ++it) {
+        fprintf(fp,
+            "%s,%d,%d,%d,%d,%d,%d,%d,%d,%d,%d,%" PRIu64 ",%.1f,%d\n",
+            it->stats.pool_name,
+            it->is_dma ? 1 : 0,
+            it->stats.allocation_size,
+            it->stats.initial_allocation_count,
+            it->stats.overflow_allocation_count,
+            it->stats.used_blocks,
+            it->stats.cached_blocks,
+            it->stats.peak_used_blocks,
+            it->stats.total_blocks,
+            it->stats.blob_count,
+            it->stats.overflow_blobs,
+            it->stats.allocations,
+            it->allocation_rate,
+            it->wasted_bytes);
+    }
+
+    fclose(fp);
+
+    return true;
+}
+
+/**
+ * Recommended sizes for the named pools in the format User_Memory_Init_Pools reads from Data/INI/MemoryPools.ini.
+ */
+bool MemoryPoolTelemetry::Write_Recommended_Ini(const char *filename)
+{
+    FILE *fp = Open_Stats_File(filename, "memory pool telemetry");
+
+    if (fp == nullptr) {
+        return false;
+    }
+
+    std::vector<PoolRecord> records;
+    Get_Records(records);
+    std::sort(records.begin(), records.end(), Table_Less);
+    fprintf(fp, "; Memory pool sizes recorded by -recordMemoryPools, copy to Data/INI/MemoryPools.ini to use them.\n");
+    fprintf(fp, "; Pool name, initial block count, overflow block count.\n");
+
+    for (auto it = records.begin(); it != records.end(); ++it) {
+        if (it->is_dma) {
+            continue;
+        }
+
+        int initial_count;
+        int overflow_count;
+        Recommend_Size(it->stats, initial_count, overflow_count);
+        fprintf(fp, "%s %d %d\n", it->stats.pool_name, initial_count, overflow_count);
+    }
+
+    fclose(fp);
+
+    return true;
+}
+
+/**
+ * Recommended sizes as replacements for the UserDMAParameters and UserMemoryPools tables, with what was recorded for
+ * each pool alongside.
+ */
+bool MemoryPoolTelemetry::Write_Recommended_Table(const char *filename)
+{
+    FILE *fp = Open_Stats_File(filename, "memory pool telemetry");
+
+    if (fp == nullptr) {
+        return false;
+    }
+
+    std::vector<PoolRecord> records;
+    Get_Records(records);
+    std::sort(records.begin(), records.end(), Table_Less);
+    int dma_count = 0;
+
+    for (auto it = records.begin(); it != records.end() && it->is_dma; ++it) {
+        ++dma_count;
+    }
+
+    fprintf(fp, "// Memory pool sizes recorded by -recordMemoryPools, the peak plus an eighth.\n");
+    fprintf(fp,
+        "// DMA allocations were rounded up by %" PRIu64 " bytes in total over %" PRIu64 " pooled allocations.\n",
+        Get_Total_Rounding_Waste(),
+        Get_Pooled_Allocation_Count());
+    fprintf(fp, "static PoolInitRec const UserDMAParameters[%d] = {\n", dma_count);
+
+    for (auto it = records.begin(); it != records.end(); ++it) {
+        int initial_count;
+        int overflow_count;
+        Recommend_Size(it->stats, initial_count, overflow_count);
+
+        if (it == records.begin() + dma_count) {
+            fprintf(fp, "};\n\nstatic PoolSizeRec UserMemoryPools[] = {\n");
+        }
+
+        if (it->is_dma) {
+            fprintf(fp,
+                "    { \"%s\", %d, %d, %d },",
+                it->stats.pool_name,
+                it->stats.allocation_size,
+                initial_count,
+                overflow_count);
+        } else {
+            fprintf(fp, "    { \"%s\", %d, %d },", it->stats.pool_name, initial_count, overflow_count);
+        }
+
+        fprintf(fp,
+            " // Peak %d including %d cached, overflow blobs %d, was %d %d.\n",
+            it->stats.peak_used_blocks,
+            it->stats.cached_blocks,
+            it->stats.overflow_blobs,
+            it->stats.initial_allocation_count,
+            it->stats.overflow_allocation_count);
+    }
+
+    if (dma_count == int(records.size())) {
+        fprintf(fp, "};\n\nstatic PoolSizeRec UserMemoryPools[] = {\n");
+    }
+
+    fprintf(fp, "    { nullptr, 0, 0 } // Last entry always null.\n};\n");
+    fclose(fp);
+
+    return true;
+}
+
+/**
+ * Sizes requested from the dynamic memory allocator over the session, the input dmabench replays.
+ */
+bool MemoryPoolTelemetry::Write_Size_Histogram(const char *filename)
+{
+#ifndef GAME_DLL
+    if (g_dynamicMemoryAllocator == nullptr) {
+        return false;
+    }
+
+    FILE *fp = Open_Stats_File(filename, "memory pool telemetry");
+
+    if (fp == nullptr) {
+        return false;
+    }
+
+    fprintf(fp, "size,count\n");
+
+    for (int i = 0; i < DynamicMemoryAllocator::SIZE_HISTOGRAM_BUCKETS; ++i) {
+        uint32_t count = g_dynamicMemoryAllocator->Get_Size_Histogram_Count(i);
+
+        if (count != 0) {
+            fprintf(fp, "%d,%u\n", DynamicMemoryAllocator::Get_Size_Histogram_Bucket_Size(i), count);
+        }
+    }
+
+    fclose(fp);
+
+    return true;
+#else
+    return false;
+#endif
+}
+
+/**
+ * Writes the report to the working directory and, when recording, the recommended sizes. Called as the memory manager
+ * shuts down so the peaks cover the whole session.
+ */
+void MemoryPoolTelemetry::Dump()
+{
+    if (!s_enabled) {
+        return;
+    }
+
+    Write_Report(REPORT_FILE);
+
+    if (s_recording) {
+        Write_Recommended_Ini(RECOMMENDED_INI_FILE);
+        Write_Recommended_Table(RECOMMENDED_TABLE_FILE);
+        Write_Size_Histogram(SIZE_HISTOGRAM_FILE);
+    }
+}
+
+/**
+ * Debug display callback listing the busiest pools, prints to the file instead when one is given. The unused bytes are
+ * live while the DMA rounding is a running total, blocks don't keep their requested size to take it back off on free.
+ */
+void MemoryPoolTelemetry::Debug_Display(DebugDisplayInterface *dd, void *user_data, FILE *fp)
+{
+    std::vector<PoolRecord> records;
+    Get_Records(records);
+    std::sort(records.begin(), records.end(), Rate_Greater);
+
+    int rows = fp == nullptr && dd->Get_Height() > 3 ? dd->Get_Height() - 3 : int(records.size());
+    int overflow_blobs = 0;
+    int wasted_bytes = 0;
+    char line[256];
+
+    for (auto it = records.begin(); it != records.end(); ++it) {
+        overflow_blobs += it->stats.overflow_blobs;
+        wasted_bytes += it->wasted_bytes;
+    }
+
+    snprintf(line,
+        sizeof(line),
+        "Pools %d, overflow blobs %d, unused %d KB, DMA rounded up %" PRIu64 " KB total\n",
+        int(records.size()),
+        overflow_blobs,
+        wasted_bytes / 1024,
+        Get_Total_Rounding_Waste() / 1024);
+
+    Print_Line(dd, fp, line);
+
+    snprintf(line,
+        sizeof(line),
+        "%-32s %6s %8s %8s %8s %5s %10s %8s\n",
+        "Pool",
+        "Size",
+        "Used",
+        "Peak",
+        "Total",
+        "Ovfl",
+        "Alloc/s",
+        "Unused");
+
+    Print_Line(dd, fp, line);
+
+    for (int i = 0; i < rows && i < int(records.size()); ++i) {
+        PoolRecord const &record = records[i];
+        snprintf(line,
+            sizeof(line),
+            "%-32.32s %6d %8d %8d %8d %5d %10.0f %8d\n",
+            record.stats.pool_name,
+            record.stats.allocation_size,
+            record.stats.used_blocks,
+            record.stats.peak_used_blocks,
+            record.stats.total_blocks,
+            record.stats.overflow_blobs,
+            record.allocation_rate,
+            record.wasted_bytes);
+
+        Print_Line(dd, fp, line);
+    }
+}
+
+} // namespace Thyme
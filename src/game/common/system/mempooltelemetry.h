@@ -0,0 +1,62 @@
+/**
+ * @file
+ *
+ * @author OmniBlade
+ *
+ * @brief Memory pool usage reports and recommended pool sizes from a recorded session. (Thyme Feature)
+ *
+ * @copyright Thyme is free software: you can redistribute it and/or
+ *            modify it under the terms of the GNU General Public License
+ *            as published by the Free Software Foundation, either version
+ *            2 of the License, or (at your option) any later version.
+ *            A full copy of the GNU General Public License can be found in
+ *            LICENSE
+ */
+#pragma once
+
+#include "always.h"
+#include "mempool.h"
+#include <cstdio>
+#include <vector>
+
+class DebugDisplayInterface;
+
+namespace Thyme
+{
+
+// Reports how each memory pool is used so the sizes in gamememoryinit.cpp can be tuned for how the game is played now
+// rather than for the machines it originally shipped on. When recording, the peak usage seen over the session is turned
+// into a MemoryPools.ini and a replacement for the C tables that would have avoided every overflow blob.
+class MemoryPoolTelemetry
+{
+public:
+    struct PoolRecord
+    {
+        MemoryPoolStats stats;
+        float allocation_rate; // Allocations per second between the last two samples at least a second apart.
+        int wasted_bytes; // Blocks allocated but not in use, what the pool costs over its live data.
+        bool is_dma; // Sub pool of the dynamic memory allocator rather than a named pool.
+    };
+
+    static void Enable(bool record_session = false);
+    static void Disable();
+    static bool Is_Enabled() { return s_enabled; }
+    static bool Is_Recording() { return s_enabled && s_recording; }
+
+    static void Get_Records(std::vector<PoolRecord> &records);
+    static void Recommend_Size(MemoryPoolStats const &stats, int &initial_count, int &overflow_count);
+
+    static bool Write_Report(const char *filename);
+    static bool Write_Recommended_Ini(const char *filename);
+    static bool Write_Recommended_Table(const char *filename);
+    static bool Write_Size_Histogram(const char *filename);
+    static void Dump();
+
+    static void Debug_Display(DebugDisplayInterface *dd, void *user_data, FILE *fp);
+
+private:
+    static bool s_enabled;
+    static bool s_recording;
+};
+
+} // namespace Thyme
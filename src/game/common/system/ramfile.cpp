@@ -13,6 +13,7 @@
  *            LICENSE
  */
 #include "ramfile.h"
+#include "fileiostats.h"
 #include "filesystem.h"
 #include <algorithm>
 #include <cctype>
@@ -64,7 +65,9 @@ int RAMFile::Read(void *dst, int bytes)
 
     if (bytes > 0) {
         if (dst != nullptr) {
+            Thyme::FileIOTimer timer;
             memcpy(dst, m_data + m_pos, bytes);
+            timer.Read(m_name.Str(), bytes);
         }
     }
 
@@ -301,6 +304,25 @@ bool RAMFile::Open_From_Archive(File *file, Utf8String const &name, int pos, int
     return true;
 }
 
+bool RAMFile::Open_From_Buffer(Utf8String const &name, char *data, int size)
+{
+    if (data == nullptr || size < 0) {
+        return false;
+    }
+
+    if (!File::Open(name.Str(), READ | BINARY)) {
+        return false;
+    }
+
+    delete[] m_data;
+    m_data = data;
+    m_size = size;
+    m_pos = 0;
+    m_name = name;
+
+    return true;
+}
+
 bool RAMFile::Copy_Data_To_File(File *file)
 {
     return file != nullptr && file->Write(m_data, m_size) == m_size;
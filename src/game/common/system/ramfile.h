@@ -42,6 +42,9 @@ public:
     virtual bool Open_From_Archive(File *file, Utf8String const &name, int pos, int size);
     virtual bool Copy_Data_To_File(File *file);
 
+    // Thyme specific, takes ownership of a buffer allocated with new[] if it succeeds.
+    bool Open_From_Buffer(Utf8String const &name, char *data, int size);
+
 protected:
     char *m_data;
     int m_pos;
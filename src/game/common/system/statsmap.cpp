@@ -0,0 +1,35 @@
+/**
+ * @file
+ *
+ * @author OmniBlade
+ *
+ * @brief Named records for the profiling and stats reports. (Thyme Feature)
+ *
+ * @copyright Thyme is free software: you can redistribute it and/or
+ *            modify it under the terms of the GNU General Public License
+ *            as published by the Free Software Foundation, either version
+ *            2 of the License, or (at your option) any later version.
+ *            A full copy of the GNU General Public License can be found in
+ *            LICENSE
+ */
+#include "statsmap.h"
+#include <captainslog.h>
+
+namespace Thyme
+{
+
+/**
+ * Opens a report for writing, warning with the description of what it holds if it can't be.
+ */
+FILE *Open_Stats_File(const char *filename, const char *description)
+{
+    FILE *fp = fopen(filename, "w");
+
+    if (fp == nullptr) {
+        captainslog_warn("Could not write %s to '%s'.", description, filename);
+    }
+
+    return fp;
+}
+
+} // namespace Thyme
@@ -0,0 +1,87 @@
+/**
+ * @file
+ *
+ * @author OmniBlade
+ *
+ * @brief Named records for the profiling and stats reports. (Thyme Feature)
+ *
+ * @copyright Thyme is free software: you can redistribute it and/or
+ *            modify it under the terms of the GNU General Public License
+ *            as published by the Free Software Foundation, either version
+ *            2 of the License, or (at your option) any later version.
+ *            A full copy of the GNU General Public License can be found in
+ *            LICENSE
+ */
+#pragma once
+
+#include "always.h"
+#include "critsection.h"
+#include <algorithm>
+#include <cstdio>
+#include <map>
+#include <string>
+#include <vector>
+
+namespace Thyme
+{
+
+// Records keyed by name behind a lock, shared by the reports the game writes to the working directory. Storage uses
+// std::string as the reports can outlive the game's memory manager and shouldn't count their own allocations.
+template<typename Record> class StatsMap
+{
+public:
+    SimpleCriticalSectionClass *Get_Lock() { return &m_lock; }
+
+    // Caller holds the lock. New records are value initialised and added is set so the caller can fill in the rest.
+    Record &Find_Or_Add(std::string const &key, bool &added)
+    {
+        auto res = m_records.insert(std::make_pair(key, Record()));
+        added = res.second;
+
+        return res.first->second;
+    }
+
+    bool Find(std::string const &key, Record &record)
+    {
+        ScopedCriticalSectionClass cs(&m_lock);
+        auto it = m_records.find(key);
+
+        if (it == m_records.end()) {
+            return false;
+        }
+
+        record = it->second;
+
+        return true;
+    }
+
+    void Clear()
+    {
+        ScopedCriticalSectionClass cs(&m_lock);
+        m_records.clear();
+    }
+
+    // Copies the records out under the lock and sorts them after, the order is up to the report.
+    template<typename Less> void Get_Sorted(std::vector<Record> &records, Less less)
+    {
+        {
+            ScopedCriticalSectionClass cs(&m_lock);
+            records.clear();
+            records.reserve(m_records.size());
+
+            for (auto it = m_records.begin(); it != m_records.end(); ++it) {
+                records.push_back(it->second);
+            }
+        }
+
+        std::sort(records.begin(), records.end(), less);
+    }
+
+private:
+    SimpleCriticalSectionClass m_lock;
+    std::map<std::string, Record> m_records;
+};
+
+FILE *Open_Stats_File(const char *filename, const char *description);
+
+} // namespace Thyme
@@ -13,13 +13,38 @@
  *            LICENSE
  */
 #include "streamingarchivefile.h"
+#include "fileiostats.h"
 #include "filesystem.h"
 #include <algorithm>
+#include <cstring>
 
-StreamingArchiveFile::StreamingArchiveFile() : m_archiveFile(nullptr), m_fileStart(0), m_fileSize(0), m_filePos(0) {}
+namespace
+{
+SimpleCriticalSectionClass s_totalStatsLock;
+StreamingArchiveFile::ReadAheadStats s_totalStats;
+} // namespace
+
+// Streamed audio is consumed a few KB at a time so this turns dozens of seek and read pairs into one.
+int StreamingArchiveFile::s_defaultReadAheadSize = 64 * 1024;
+
+StreamingArchiveFile::StreamingArchiveFile() :
+    m_archiveFile(nullptr),
+    m_fileStart(0),
+    m_fileSize(0),
+    m_filePos(0),
+    m_archiveLock(nullptr),
+    m_readAheadSize(s_defaultReadAheadSize)
+{
+    memset(&m_stats, 0, sizeof(m_stats));
+
+    for (int i = 0; i < READ_AHEAD_BUFFER_COUNT; ++i) {
+        m_buffers[i].m_owner = this;
+    }
+}
 
 StreamingArchiveFile::~StreamingArchiveFile()
 {
+    Release_Buffers();
     File::Close();
 }
 
@@ -41,17 +66,83 @@ int StreamingArchiveFile::Read(void *dst, int bytes)
         return 0;
     }
 
-    m_archiveFile->Seek(m_filePos + m_fileStart, START);
-
     if (m_filePos + bytes > m_fileSize) {
         bytes = m_fileSize - m_filePos;
     }
 
-    int read_len = m_archiveFile->Read(dst, bytes);
+    Thyme::FileIOTimer timer;
+
+    if (m_readAheadSize <= 0 || bytes <= 0) {
+        int read_len = Read_Direct(dst, m_filePos, bytes);
+        m_filePos += read_len;
+
+        return timer.Read(m_name.Str(), read_len);
+    }
+
+    char *out = static_cast<char *>(dst);
+    int remaining = bytes;
+    bool waited = false;
+
+    while (remaining > 0) {
+        ReadAheadBuffer *buffer = Find_Buffer(m_filePos);
+
+        if (buffer == nullptr) {
+            // Nothing buffered here, usually the first read or a seek. Reads bigger than the window skip it entirely.
+            if (remaining >= m_readAheadSize) {
+                int read_len = Read_Direct(out, m_filePos, remaining);
+                m_filePos += read_len;
+                out += read_len;
+                remaining -= read_len;
+                waited = true;
+                break;
+            }
+
+            // Prefer a buffer that isn't still being filled so the miss only waits on its own read.
+            buffer = m_buffers[0].Is_Complete() || m_buffers[0].m_requested == 0 ? &m_buffers[0] : &m_buffers[1];
+            Fill_Buffer(buffer, m_filePos);
+            waited = true;
+        }
+
+        if (!buffer->Is_Complete()) {
+            waited = true;
+            Wait_For_Buffer(buffer);
+        }
+
+        int available = buffer->m_length - (m_filePos - buffer->m_start);
+
+        // Short read from the archive, don't spin on it.
+        if (available <= 0) {
+            break;
+        }
+
+        int copy_len = std::min(available, remaining);
+        memcpy(out, buffer->m_data + (m_filePos - buffer->m_start), copy_len);
+        m_filePos += copy_len;
+        out += copy_len;
+        remaining -= copy_len;
+
+        // Keep the other half of the window reading ahead of the half being consumed.
+        ReadAheadBuffer *next = buffer == &m_buffers[0] ? &m_buffers[1] : &m_buffers[0];
+        int next_start = buffer->m_start + buffer->m_requested;
+
+        if (next_start < m_fileSize && !(next->m_requested > 0 && next->m_start == next_start)) {
+            Fill_Buffer(next, next_start);
+            m_stats.bytes_prefetched += next->m_requested;
+        }
+    }
+
+    int read_len = bytes - remaining;
 
-    m_filePos += read_len;
+    if (read_len > 0) {
+        ++m_stats.reads;
+        m_stats.bytes_read += read_len;
 
-    return read_len;
+        if (!waited) {
+            ++m_stats.hits;
+        }
+    }
+
+    return timer.Read(m_name.Str(), read_len);
 }
 
 int StreamingArchiveFile::Write(void const *src, int bytes)
@@ -141,6 +232,8 @@ bool StreamingArchiveFile::Open_From_Archive(File *file, Utf8String const &name,
         return false;
     }
 
+    Release_Buffers();
+
     if (!File::Open(name.Str(), READ | BINARY | STREAMING)) {
         return false;
     }
@@ -169,3 +262,93 @@ bool StreamingArchiveFile::Copy_Data_To_File(File *file)
     captainslog_dbgassert(false, "Are you sure you meant to Copy_Data_To_File on a streaming file?");
     return false;
 }
+
+/**
+ * Changes the size of each half of the read ahead window, anything already buffered is discarded.
+ */
+void StreamingArchiveFile::Set_Read_Ahead_Size(int size)
+{
+    Release_Buffers();
+    m_readAheadSize = std::max(size, 0);
+}
+
+/**
+ * Read ahead stats gathered from every streaming file closed so far.
+ */
+StreamingArchiveFile::ReadAheadStats StreamingArchiveFile::Get_Total_Read_Ahead_Stats()
+{
+    ScopedCriticalSectionClass cs(&s_totalStatsLock);
+
+    return s_totalStats;
+}
+
+int StreamingArchiveFile::Read_Direct(void *dst, int pos, int bytes)
+{
+    ScopedCriticalSectionClass cs(m_archiveLock);
+    m_archiveFile->Seek(pos + m_fileStart, START);
+
+    return m_archiveFile->Read(dst, bytes);
+}
+
+StreamingArchiveFile::ReadAheadBuffer *StreamingArchiveFile::Find_Buffer(int pos)
+{
+    for (int i = 0; i < READ_AHEAD_BUFFER_COUNT; ++i) {
+        if (m_buffers[i].Contains(pos)) {
+            return &m_buffers[i];
+        }
+    }
+
+    return nullptr;
+}
+
+void StreamingArchiveFile::Fill_Buffer(ReadAheadBuffer *buffer, int start)
+{
+    // A buffer still being filled for an old position has to finish before it can be reused.
+    Wait_For_Buffer(buffer);
+
+    if (buffer->m_data == nullptr) {
+        buffer->m_data = new char[m_readAheadSize];
+    }
+
+    buffer->m_start = start;
+    buffer->m_requested = std::min(m_readAheadSize, m_fileSize - start);
+    buffer->m_length = 0;
+
+    // The pool isn't kept, Shutdown_IO can delete it while the file is still open.
+    if (!FileSystem::Submit_IO(buffer)) {
+        Thyme::WorkerPool::Run_Inline(buffer);
+    }
+}
+
+void StreamingArchiveFile::Wait_For_Buffer(ReadAheadBuffer *buffer)
+{
+    if (buffer->m_requested > 0 && !buffer->Is_Complete()) {
+        FileSystem::Wait_For_IO(buffer);
+    }
+}
+
+void StreamingArchiveFile::Release_Buffers()
+{
+    for (int i = 0; i < READ_AHEAD_BUFFER_COUNT; ++i) {
+        Wait_For_Buffer(&m_buffers[i]);
+        delete[] m_buffers[i].m_data;
+        m_buffers[i].m_data = nullptr;
+        m_buffers[i].m_requested = 0;
+        m_buffers[i].m_length = 0;
+    }
+
+    if (m_stats.reads != 0) {
+        ScopedCriticalSectionClass cs(&s_totalStatsLock);
+        s_totalStats.reads += m_stats.reads;
+        s_totalStats.hits += m_stats.hits;
+        s_totalStats.bytes_read += m_stats.bytes_read;
+        s_totalStats.bytes_prefetched += m_stats.bytes_prefetched;
+    }
+
+    memset(&m_stats, 0, sizeof(m_stats));
+}
+
+void StreamingArchiveFile::ReadAheadBuffer::Execute()
+{
+    m_length = std::max(m_owner->Read_Direct(m_data, m_start, m_requested), 0);
+}
@@ -14,13 +14,47 @@
  */
 #pragma once
 
+#include "critsection.h"
 #include "gamememory.h"
 #include "ramfile.h"
+#include "workerpool.h"
 
 class StreamingArchiveFile : public RAMFile
 {
     IMPLEMENT_POOL(StreamingArchiveFile);
 
+    // One half of the read ahead window, filled on the file system's IO threads.
+    class ReadAheadBuffer : public Thyme::WorkerJob
+    {
+    public:
+        ReadAheadBuffer() : m_owner(nullptr), m_data(nullptr), m_start(0), m_requested(0), m_length(0) {}
+        virtual void Execute() override;
+
+        bool Contains(int pos) const { return m_requested > 0 && pos >= m_start && pos < m_start + m_requested; }
+
+        StreamingArchiveFile *m_owner;
+        char *m_data;
+        int m_start;
+        int m_requested;
+        int m_length;
+    };
+
+    enum
+    {
+        READ_AHEAD_BUFFER_COUNT = 2,
+    };
+
+public:
+    struct ReadAheadStats
+    {
+        uint32_t reads; // Calls to Read that returned data.
+        uint32_t hits; // Reads served entirely from buffers that were already filled.
+        uint64_t bytes_read;
+        uint64_t bytes_prefetched; // Bytes read ahead in the background before they were asked for.
+
+        float Hit_Ratio() const { return reads != 0 ? float(hits) / float(reads) : 0.0f; }
+    };
+
 protected:
     virtual ~StreamingArchiveFile() override;
 
@@ -43,9 +77,34 @@ public:
     virtual bool Open_From_Archive(File *file, Utf8String const &name, int pos, int size) override;
     virtual bool Copy_Data_To_File(File *file) override;
 
+    // Thyme specific, the archive handle is shared with other files so reads need to hold its lock if it has one.
+    void Set_Archive_Lock(SimpleCriticalSectionClass *lock) { m_archiveLock = lock; }
+
+    // Thyme specific, size of each half of the read ahead window, 0 reads straight from the archive.
+    void Set_Read_Ahead_Size(int size);
+    int Get_Read_Ahead_Size() const { return m_readAheadSize; }
+    ReadAheadStats const &Get_Read_Ahead_Stats() const { return m_stats; }
+
+    static void Set_Default_Read_Ahead_Size(int size) { s_defaultReadAheadSize = size; }
+    static int Get_Default_Read_Ahead_Size() { return s_defaultReadAheadSize; }
+    static ReadAheadStats Get_Total_Read_Ahead_Stats();
+
+private:
+    int Read_Direct(void *dst, int pos, int bytes);
+    ReadAheadBuffer *Find_Buffer(int pos);
+    void Fill_Buffer(ReadAheadBuffer *buffer, int start);
+    void Wait_For_Buffer(ReadAheadBuffer *buffer);
+    void Release_Buffers();
+
 protected:
     File *m_archiveFile;
     int m_fileStart;
     int m_fileSize;
     int m_filePos;
+    SimpleCriticalSectionClass *m_archiveLock;
+    ReadAheadBuffer m_buffers[READ_AHEAD_BUFFER_COUNT];
+    int m_readAheadSize;
+    ReadAheadStats m_stats;
+
+    static int s_defaultReadAheadSize;
 };
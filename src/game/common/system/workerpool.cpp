@@ -0,0 +1,341 @@
+/**
+ * @file
+ *
+ * @author OmniBlade
+ *
+ * @brief Pool of worker threads for running independent jobs in the background. (Thyme Feature)
+ *
+ * @copyright Thyme is free software: you can redistribute it and/or
+ *            modify it under the terms of the GNU General Public License
+ *            as published by the Free Software Foundation, either version
+ *            2 of the License, or (at your option) any later version.
+ *            A full copy of the GNU General Public License can be found in
+ *            LICENSE
+ */
+#include "workerpool.h"
+#include <algorithm>
+#include <captainslog.h>
+#include <cstdio>
+
+#ifdef PLATFORM_WINDOWS
+#include <windows.h>
+#elif defined HAVE_UNISTD_H
+#include <unistd.h>
+#endif
+
+namespace Thyme
+{
+
+WorkerPool::WorkerPool(const char *name, int thread_count) :
+    m_queueHead(nullptr),
+    m_queueTail(nullptr),
+    m_threads(nullptr),
+    m_threadCount(0),
+    m_shutdown(false),
+    m_signalCount(0),
+    m_completeCount(0),
+    m_activeThreads(0)
+{
+#ifdef HAVE_PTHREAD_H
+    pthread_mutex_init(&m_signalMutex, nullptr);
+    pthread_cond_init(&m_signalCond, nullptr);
+    pthread_cond_init(&m_completeCond, nullptr);
+#elif defined PLATFORM_WINDOWS
+    InitializeCriticalSection(&m_signalMutex);
+    InitializeConditionVariable(&m_signalCond);
+    InitializeConditionVariable(&m_completeCond);
+#endif
+
+    if (thread_count <= 0) {
+        thread_count = Get_Default_Thread_Count();
+    }
+
+    m_threads = new WorkerThreadClass *[thread_count];
+
+    for (int i = 0; i < thread_count; ++i) {
+        char thread_name[64];
+        snprintf(thread_name, sizeof(thread_name), "%s %d", name != nullptr ? name : "Worker", i);
+        m_threads[i] = new WorkerThreadClass(thread_name, this);
+        ++m_activeThreads;
+        m_threads[i]->Execute();
+    }
+
+    m_threadCount = thread_count;
+}
+
+/**
+ * Jobs already running are allowed to finish however long they take, they are never cancelled part way through.
+ */
+WorkerPool::~WorkerPool()
+{
+    Lock_Signal();
+    m_shutdown = true;
+
+    // Wake everything up so the threads see the shutdown flag, then wait for them all to leave Thread_Function.
+#ifdef HAVE_PTHREAD_H
+    pthread_cond_broadcast(&m_signalCond);
+
+    while (m_activeThreads > 0) {
+        pthread_cond_wait(&m_completeCond, &m_signalMutex);
+    }
+#elif defined PLATFORM_WINDOWS
+    WakeAllConditionVariable(&m_signalCond);
+
+    while (m_activeThreads > 0) {
+        SleepConditionVariableCS(&m_completeCond, &m_signalMutex, INFINITE);
+    }
+#endif
+
+    Unlock_Signal();
+
+    // The threads only have the wrapper's bookkeeping left to do, Stop waits for that rather than cancelling anything.
+    for (int i = 0; i < m_threadCount; ++i) {
+        m_threads[i]->Stop(3000);
+        delete m_threads[i];
+    }
+
+    delete[] m_threads;
+
+    // Anything still queued is run here so whoever is waiting on it still gets its results.
+    while (WorkerJob *job = Pop_Job()) {
+        Run_Inline(job);
+    }
+
+#ifdef HAVE_PTHREAD_H
+    pthread_cond_destroy(&m_completeCond);
+    pthread_cond_destroy(&m_signalCond);
+    pthread_mutex_destroy(&m_signalMutex);
+#elif defined PLATFORM_WINDOWS
+    DeleteCriticalSection(&m_signalMutex);
+#endif
+}
+
+/**
+ * Queues a job to be executed on a worker thread. Jobs are started in the order they are submitted.
+ */
+void WorkerPool::Submit(WorkerJob *job)
+{
+    captainslog_dbgassert(job != nullptr, "Attempted to submit a null job to the worker pool.");
+    job->m_next = nullptr;
+    job->m_complete = false;
+
+    {
+        ScopedCriticalSectionClass cs(&m_queueLock);
+
+        if (m_queueTail != nullptr) {
+            m_queueTail->m_next = job;
+        } else {
+            m_queueHead = job;
+        }
+
+        m_queueTail = job;
+    }
+
+    Signal();
+}
+
+/**
+ * Blocks until all the passed in jobs are complete. The calling thread helps with queued work while it waits so this
+ * is safe to call even if all the workers are busy.
+ */
+void WorkerPool::Wait(WorkerJob **jobs, int count)
+{
+    for (int i = 0; i < count; ++i) {
+        while (true) {
+            // Read before checking the job so a completion in between isn't missed when blocking below.
+            unsigned seen = Get_Complete_Count();
+
+            {
+                ScopedCriticalSectionClass cs(&m_queueLock);
+
+                if (jobs[i]->m_complete) {
+                    break;
+                }
+            }
+
+            WorkerJob *job = Pop_Job();
+
+            if (job != nullptr) {
+                Run_Job(job);
+            } else {
+                // The job is running on a worker, sleep until something completes.
+                Wait_For_Complete(seen);
+            }
+        }
+    }
+}
+
+int WorkerPool::Get_Default_Thread_Count()
+{
+    int count;
+#ifdef PLATFORM_WINDOWS
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+    count = int(info.dwNumberOfProcessors);
+#elif defined HAVE_UNISTD_H
+    count = int(sysconf(_SC_NPROCESSORS_ONLN));
+#else
+    count = 2;
+#endif
+
+    // Leave a core for the thread that is submitting the work.
+    return std::clamp(count - 1, 1, 16);
+}
+
+/**
+ * Executes a job on the calling thread, for when the work can't be handed off but the caller still expects it to be
+ * complete afterwards.
+ */
+void WorkerPool::Run_Inline(WorkerJob *job)
+{
+    job->m_next = nullptr;
+    job->Execute();
+    job->m_complete = true;
+}
+
+WorkerJob *WorkerPool::Pop_Job()
+{
+    ScopedCriticalSectionClass cs(&m_queueLock);
+    WorkerJob *job = m_queueHead;
+
+    if (job != nullptr) {
+        m_queueHead = job->m_next;
+
+        if (m_queueHead == nullptr) {
+            m_queueTail = nullptr;
+        }
+
+        job->m_next = nullptr;
+    }
+
+    return job;
+}
+
+void WorkerPool::Run_Job(WorkerJob *job)
+{
+    job->Execute();
+
+    {
+        // Taking the lock makes the job's results visible to whoever observes the completion.
+        ScopedCriticalSectionClass cs(&m_queueLock);
+        job->m_complete = true;
+    }
+
+    // The job may already be gone, only the pool is touched from here.
+    Lock_Signal();
+    ++m_completeCount;
+#ifdef HAVE_PTHREAD_H
+    pthread_cond_broadcast(&m_completeCond);
+#elif defined PLATFORM_WINDOWS
+    WakeAllConditionVariable(&m_completeCond);
+#endif
+    Unlock_Signal();
+}
+
+void WorkerPool::Signal()
+{
+    Lock_Signal();
+    ++m_signalCount;
+#ifdef HAVE_PTHREAD_H
+    pthread_cond_signal(&m_signalCond);
+#elif defined PLATFORM_WINDOWS
+    WakeConditionVariable(&m_signalCond);
+#endif
+    Unlock_Signal();
+}
+
+/**
+ * Returns false once the pool is shutting down.
+ */
+bool WorkerPool::Wait_For_Signal()
+{
+    Lock_Signal();
+
+    while (m_signalCount == 0 && !m_shutdown) {
+#ifdef HAVE_PTHREAD_H
+        pthread_cond_wait(&m_signalCond, &m_signalMutex);
+#elif defined PLATFORM_WINDOWS
+        SleepConditionVariableCS(&m_signalCond, &m_signalMutex, INFINITE);
+#endif
+    }
+
+    bool running = !m_shutdown;
+
+    if (running) {
+        --m_signalCount;
+    }
+
+    Unlock_Signal();
+
+    return running;
+}
+
+unsigned WorkerPool::Get_Complete_Count()
+{
+    Lock_Signal();
+    unsigned count = m_completeCount;
+    Unlock_Signal();
+
+    return count;
+}
+
+void WorkerPool::Wait_For_Complete(unsigned seen)
+{
+    Lock_Signal();
+
+    while (m_completeCount == seen) {
+#ifdef HAVE_PTHREAD_H
+        pthread_cond_wait(&m_completeCond, &m_signalMutex);
+#elif defined PLATFORM_WINDOWS
+        SleepConditionVariableCS(&m_completeCond, &m_signalMutex, INFINITE);
+#endif
+    }
+
+    Unlock_Signal();
+}
+
+void WorkerPool::Lock_Signal()
+{
+#ifdef HAVE_PTHREAD_H
+    pthread_mutex_lock(&m_signalMutex);
+#elif defined PLATFORM_WINDOWS
+    EnterCriticalSection(&m_signalMutex);
+#endif
+}
+
+void WorkerPool::Unlock_Signal()
+{
+#ifdef HAVE_PTHREAD_H
+    pthread_mutex_unlock(&m_signalMutex);
+#elif defined PLATFORM_WINDOWS
+    LeaveCriticalSection(&m_signalMutex);
+#endif
+}
+
+void WorkerPool::WorkerThreadClass::Thread_Function()
+{
+    while (m_pool->Wait_For_Signal()) {
+        // Signals can be consumed by Wait helping out so drain whatever is queued rather than one job per signal.
+        while (!m_pool->m_shutdown) {
+            WorkerJob *job = m_pool->Pop_Job();
+
+            if (job == nullptr) {
+                break;
+            }
+
+            m_pool->Run_Job(job);
+        }
+    }
+
+    // Last thing touching the pool, the destructor can go ahead once every worker has done this.
+    m_pool->Lock_Signal();
+    --m_pool->m_activeThreads;
+#ifdef HAVE_PTHREAD_H
+    pthread_cond_broadcast(&m_pool->m_completeCond);
+#elif defined PLATFORM_WINDOWS
+    WakeAllConditionVariable(&m_pool->m_completeCond);
+#endif
+    m_pool->Unlock_Signal();
+}
+
+} // namespace Thyme
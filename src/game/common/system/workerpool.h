@@ -0,0 +1,101 @@
+/**
+ * @file
+ *
+ * @author OmniBlade
+ *
+ * @brief Pool of worker threads for running independent jobs in the background. (Thyme Feature)
+ *
+ * @copyright Thyme is free software: you can redistribute it and/or
+ *            modify it under the terms of the GNU General Public License
+ *            as published by the Free Software Foundation, either version
+ *            2 of the License, or (at your option) any later version.
+ *            A full copy of the GNU General Public License can be found in
+ *            LICENSE
+ */
+#pragma once
+
+#include "always.h"
+#include "critsection.h"
+#include "thread.h"
+
+namespace Thyme
+{
+
+class WorkerPool;
+
+// Derive from this to provide work for the pool, Execute is called once on a worker thread. A job must not be
+// destroyed until Is_Complete returns true.
+class WorkerJob
+{
+    friend class WorkerPool;
+
+public:
+    WorkerJob() : m_next(nullptr), m_complete(false) {}
+    virtual ~WorkerJob() {}
+
+    virtual void Execute() = 0;
+
+    bool Is_Complete() const { return m_complete; }
+
+private:
+    WorkerJob *m_next;
+    volatile bool m_complete;
+};
+
+class WorkerPool
+{
+    class WorkerThreadClass : public ThreadClass
+    {
+    public:
+        WorkerThreadClass(const char *name, WorkerPool *pool) : ThreadClass(name), m_pool(pool) {}
+        virtual void Thread_Function() override;
+
+    private:
+        WorkerPool *m_pool;
+    };
+
+public:
+    WorkerPool(const char *name, int thread_count = 0);
+    ~WorkerPool();
+
+    void Submit(WorkerJob *job);
+    void Wait(WorkerJob **jobs, int count);
+    void Wait(WorkerJob *job) { Wait(&job, 1); }
+    int Get_Thread_Count() const { return m_threadCount; }
+
+    static int Get_Default_Thread_Count();
+    static void Run_Inline(WorkerJob *job);
+
+private:
+    WorkerJob *Pop_Job();
+    void Run_Job(WorkerJob *job);
+    void Signal();
+    bool Wait_For_Signal();
+    unsigned Get_Complete_Count();
+    void Wait_For_Complete(unsigned seen);
+    void Lock_Signal();
+    void Unlock_Signal();
+
+private:
+    SimpleCriticalSectionClass m_queueLock;
+    WorkerJob *m_queueHead;
+    WorkerJob *m_queueTail;
+    WorkerThreadClass **m_threads;
+    int m_threadCount;
+    volatile bool m_shutdown;
+#ifdef HAVE_PTHREAD_H
+    pthread_mutex_t m_signalMutex;
+    pthread_cond_t m_signalCond;
+    pthread_cond_t m_completeCond;
+#elif defined PLATFORM_WINDOWS
+    CRITICAL_SECTION m_signalMutex;
+    CONDITION_VARIABLE m_signalCond;
+    CONDITION_VARIABLE m_completeCond;
+#endif
+    // All under m_signalMutex.
+    int m_signalCount;
+    unsigned m_completeCount; // Jobs completed so far, waiters block until it changes.
+    int m_activeThreads; // Workers still inside Thread_Function.
+};
+
+} // namespace Thyme
@@ -35,6 +35,21 @@ Utf8String s_theThingTemplateBeingParsedName;
 #endif
 #endif
 
+namespace
+{
+#ifdef THYME_USE_STLPORT
+inline const Utf8String &Template_Key(const Utf8String &name)
+{
+    return name;
+}
+#else
+inline InternedString Template_Key(const Utf8String &name)
+{
+    return InternedString(name);
+}
+#endif
+} // namespace
+
 ThingFactory::ThingFactory() : m_firstTemplate(nullptr), m_nextTemplateID(1) {}
 
 ThingFactory::~ThingFactory()
@@ -115,7 +130,7 @@ void ThingFactory::Reset()
             if (first) {
                 m_firstTemplate = next;
             }
-            m_templateMap.erase(str);
+            m_templateMap.erase(Template_Key(str));
         }
 
         t = next;
@@ -124,13 +139,13 @@ void ThingFactory::Reset()
 
 void ThingFactory::Add_Template(ThingTemplate *tmplate)
 {
-    if (m_templateMap.find(tmplate->Get_Name()) != m_templateMap.end()) {
+    if (m_templateMap.find(Template_Key(tmplate->Get_Name())) != m_templateMap.end()) {
         captainslog_dbgassert(0, "Duplicate Thing Template name found: %s", tmplate->Get_Name().Str());
     }
 
     tmplate->Friend_Set_Next_Template(m_firstTemplate);
     m_firstTemplate = tmplate;
-    m_templateMap[tmplate->Get_Name()] = tmplate;
+    m_templateMap[Template_Key(tmplate->Get_Name())] = tmplate;
 }
 
 ThingTemplate *ThingFactory::Find_Template_By_ID(unsigned short id)
@@ -147,17 +162,30 @@ ThingTemplate *ThingFactory::Find_Template_By_ID(unsigned short id)
 
 ThingTemplate *ThingFactory::Find_Template_Internal(const Utf8String &name, bool b)
 {
+#ifdef THYME_USE_STLPORT
     auto i = m_templateMap.find(name);
 
     if (i != m_templateMap.end()) {
         return i->second;
     }
+#else
+    InternedString key;
+
+    // A name that was never interned can't be a template, looking it up this way doesn't grow the intern table.
+    if (InternedString::Find(name.Str(), key)) {
+        auto i = m_templateMap.find(key);
+
+        if (i != m_templateMap.end()) {
+            return i->second;
+        }
+    }
+#endif
 
     if (strncmp(name.Str(), "***TESTING", strlen("***TESTING")) == 0) {
         ThingTemplate *tmplate = New_Template("Un-namedTemplate");
         tmplate->Init_For_LTA(name);
-        m_templateMap.erase("Un-namedTemplate");
-        m_templateMap[name] = tmplate;
+        m_templateMap.erase(Template_Key("Un-namedTemplate"));
+        m_templateMap[Template_Key(name)] = tmplate;
         return Find_Template_Internal(name, true);
     } else {
 
@@ -15,6 +15,7 @@
 #pragma once
 
 #include "always.h"
+#include "internedstring.h"
 #include "rtsutils.h"
 #include "subsysteminterface.h"
 #include "thingtemplate.h"
@@ -57,7 +58,8 @@ private:
 #ifdef THYME_USE_STLPORT
     std::hash_map<const Utf8String, ThingTemplate *, rts::hash<Utf8String>, std::equal_to<Utf8String>> m_templateMap;
 #else
-    std::unordered_map<const Utf8String, ThingTemplate *, rts::hash<Utf8String>, std::equal_to<Utf8String>> m_templateMap;
+    // Template names are interned so lookups hash and compare a pointer.
+    std::unordered_map<InternedString, ThingTemplate *, rts::hash<InternedString>> m_templateMap;
 #endif
 };
 
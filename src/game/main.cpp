@@ -18,6 +18,7 @@
 #include "cpudetect.h"
 #include "crashhandler.h"
 #include "critsection.h"
+#include "filesystem.h"
 #include "gameengine.h"
 #include "gamemain.h"
 #include "gamememory.h"
@@ -601,6 +602,9 @@ int main(int argc, char **argv)
     Game_Main(argc, argv);
     captainslog_info("Game shutting down.");
 
+    // The IO threads allocate from the game heap so they have to stop before it does.
+    FileSystem::Shutdown_IO();
+
     delete g_theVersion;
     g_theVersion = nullptr;
 
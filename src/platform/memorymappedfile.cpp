@@ -0,0 +1,150 @@
+/**
+ * @file
+ *
+ * @author OmniBlade
+ *
+ * @brief Read only memory mapped view of a file on disk. (Thyme Feature)
+ *
+ * @copyright Thyme is free software: you can redistribute it and/or
+ *            modify it under the terms of the GNU General Public License
+ *            as published by the Free Software Foundation, either version
+ *            2 of the License, or (at your option) any later version.
+ *            A full copy of the GNU General Public License can be found in
+ *            LICENSE
+ */
+#include "memorymappedfile.h"
+#include <captainslog.h>
+
+#ifdef PLATFORM_WINDOWS
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace Thyme
+{
+
+MemoryMappedFile::MemoryMappedFile() :
+    m_data(nullptr),
+    m_size(0)
+#ifdef PLATFORM_WINDOWS
+    ,
+    m_fileHandle(INVALID_HANDLE_VALUE),
+    m_mappingHandle(nullptr)
+#endif
+{
+}
+
+MemoryMappedFile::~MemoryMappedFile()
+{
+    Close();
+}
+
+/**
+ * Maps the entire file read only. Zero length files cannot be mapped and are treated as a failure.
+ */
+bool MemoryMappedFile::Open(const char *filename)
+{
+    Close();
+
+    if (filename == nullptr || *filename == '\0') {
+        return false;
+    }
+
+#ifdef PLATFORM_WINDOWS
+    m_fileHandle = CreateFileW(UTF8To16(filename),
+        GENERIC_READ,
+        FILE_SHARE_READ,
+        nullptr,
+        OPEN_EXISTING,
+        FILE_ATTRIBUTE_NORMAL | FILE_FLAG_RANDOM_ACCESS,
+        nullptr);
+
+    if (m_fileHandle == INVALID_HANDLE_VALUE) {
+        return false;
+    }
+
+    LARGE_INTEGER size;
+
+    if (!GetFileSizeEx(m_fileHandle, &size) || size.QuadPart <= 0 || uint64_t(size.QuadPart) > SIZE_MAX) {
+        Close();
+        return false;
+    }
+
+    m_mappingHandle = CreateFileMappingW(m_fileHandle, nullptr, PAGE_READONLY, 0, 0, nullptr);
+
+    if (m_mappingHandle == nullptr) {
+        Close();
+        return false;
+    }
+
+    m_data = static_cast<const char *>(MapViewOfFile(m_mappingHandle, FILE_MAP_READ, 0, 0, 0));
+
+    if (m_data == nullptr) {
+        Close();
+        return false;
+    }
+
+    m_size = size_t(size.QuadPart);
+#else
+    int fd = open(filename, O_RDONLY);
+
+    if (fd < 0) {
+        return false;
+    }
+
+    struct stat st;
+
+    if (fstat(fd, &st) != 0 || st.st_size <= 0) {
+        close(fd);
+        return false;
+    }
+
+    void *view = mmap(nullptr, size_t(st.st_size), PROT_READ, MAP_SHARED, fd, 0);
+
+    // The mapping holds its own reference to the file so the descriptor isn't needed past this point.
+    close(fd);
+
+    if (view == MAP_FAILED) {
+        return false;
+    }
+
+    m_data = static_cast<const char *>(view);
+    m_size = size_t(st.st_size);
+#endif
+
+    captainslog_trace("Mapped '%s' into memory, %u bytes.", filename, unsigned(m_size));
+
+    return true;
+}
+
+void MemoryMappedFile::Close()
+{
+#ifdef PLATFORM_WINDOWS
+    if (m_data != nullptr) {
+        UnmapViewOfFile(m_data);
+    }
+
+    if (m_mappingHandle != nullptr) {
+        CloseHandle(m_mappingHandle);
+        m_mappingHandle = nullptr;
+    }
+
+    if (m_fileHandle != INVALID_HANDLE_VALUE) {
+        CloseHandle(m_fileHandle);
+        m_fileHandle = INVALID_HANDLE_VALUE;
+    }
+#else
+    if (m_data != nullptr) {
+        munmap(const_cast<char *>(m_data), m_size);
+    }
+#endif
+
+    m_data = nullptr;
+    m_size = 0;
+}
+
+} // namespace Thyme
@@ -0,0 +1,49 @@
+/**
+ * @file
+ *
+ * @author OmniBlade
+ *
+ * @brief Read only memory mapped view of a file on disk. (Thyme Feature)
+ *
+ * @copyright Thyme is free software: you can redistribute it and/or
+ *            modify it under the terms of the GNU General Public License
+ *            as published by the Free Software Foundation, either version
+ *            2 of the License, or (at your option) any later version.
+ *            A full copy of the GNU General Public License can be found in
+ *            LICENSE
+ */
+#pragma once
+
+#include "always.h"
+
+namespace Thyme
+{
+
+class MemoryMappedFile
+{
+public:
+    MemoryMappedFile();
+    ~MemoryMappedFile();
+
+    bool Open(const char *filename);
+    void Close();
+
+    bool Is_Open() const { return m_data != nullptr; }
+    const char *Get_Data() const { return m_data; }
+    size_t Get_Size() const { return m_size; }
+
+private:
+    // Not copyable, the view is owned by a single instance.
+    MemoryMappedFile(const MemoryMappedFile &that) = delete;
+    MemoryMappedFile &operator=(const MemoryMappedFile &that) = delete;
+
+private:
+    const char *m_data;
+    size_t m_size;
+#ifdef PLATFORM_WINDOWS
+    void *m_fileHandle;
+    void *m_mappingHandle;
+#endif
+};
+
+} // namespace Thyme
@@ -14,6 +14,7 @@
  *            LICENSE
  */
 #include "standardfile.h"
+#include "fileiostats.h"
 #include <cctype>
 #include <fcntl.h>
 
@@ -115,7 +116,8 @@ int StandardFile::Read(void *dst, int bytes)
     }
 
     if (dst != nullptr) {
-        return fread(dst, 1, bytes, m_file);
+        Thyme::FileIOTimer timer;
+        return timer.Read(m_name.Str(), int(fread(dst, 1, bytes, m_file)));
     } else {
         Seek(bytes, SeekMode::CURRENT);
     }
@@ -13,6 +13,7 @@
  *            LICENSE
  */
 #include "stdlocalfilesystem.h"
+#include "fileiostats.h"
 #include "standardfile.h"
 #include "win32localfile.h"
 
@@ -56,8 +57,14 @@ File *StdLocalFileSystem::Open_File(const char *filename, int mode)
     }
 
     // Try and open the file, if not, delete instance and return null.
+    Thyme::FileIOTimer timer;
+
     if (file->Open(filename, mode)) {
         file->Delete_On_Close();
+
+        if ((mode & File::WRITE) == 0) {
+            timer.Opened(filename, Thyme::FileIOStats::SOURCE_LOCAL);
+        }
     } else {
         file->Delete_Instance();
         file = nullptr;
@@ -88,12 +95,16 @@ void StdLocalFileSystem::Get_File_List_In_Directory(Utf8String const &subdir,
 
     if (search_subdirs) {
         for (auto iter : fs::recursive_directory_iterator(search_path.Str())) {
+            if (!iter.is_regular_file())
+                continue;
             if (filter != "*" && iter.path().extension() != ext)
                 continue;
             filelist.insert(iter.path().c_str());
         }
     } else {
         for (auto iter : fs::directory_iterator(search_path.Str())) {
+            if (!iter.is_regular_file())
+                continue;
             if (filter != "*" && iter.path().extension() != ext)
                 continue;
             filelist.insert(iter.path().c_str());
@@ -35,6 +35,7 @@
 #include "keyboard.h"
 #include "line2d.h"
 #include "main.h"
+#include "mempooltelemetry.h"
 #include "mesh.h"
 #include "meshmdl.h"
 #include "mouse.h"
@@ -268,6 +269,8 @@ void W3DDisplay::Init()
 
         if (g_theWriteableGlobalData->m_displayDebug) {
             m_debugDisplayCallback = Stat_Debug_Display;
+        } else if (Thyme::MemoryPoolTelemetry::Is_Enabled()) {
+            m_debugDisplayCallback = Thyme::MemoryPoolTelemetry::Debug_Display;
         }
     }
 }
@@ -13,9 +13,12 @@
  *            LICENSE
  */
 #include "win32bigfile.h"
+#include "compressionmanager.h"
 #include "localfilesystem.h"
+#include "mappedarchivefile.h"
 #include "ramfile.h"
 #include "streamingarchivefile.h"
+#include <algorithm>
 
 bool Win32BIGFile::Get_File_Info(Utf8String const &name, FileInfo *info) const
 {
@@ -27,7 +30,7 @@ bool Win32BIGFile::Get_File_Info(Utf8String const &name, FileInfo *info) const
 
     g_theLocalFileSystem->Get_File_Info(m_attachedFile->Get_Name(), info);
     info->file_size_high = 0;
-    info->file_size_low = arch_info->size;
+    info->file_size_low = Is_Decoded(arch_info) ? arch_info->decoded_size : arch_info->size;
 
     return true;
 }
@@ -41,16 +44,33 @@ File *Win32BIGFile::Open_File(const char *filename, int mode)
     }
 
     RAMFile *file = nullptr;
+    bool opened;
 
-    if ((mode & File::STREAMING) != 0) {
-        file = NEW_POOL_OBJ(StreamingArchiveFile);
+    if ((mode & File::STREAMING) == 0 && Is_Decoded(arch_info) && (file = Open_Compressed_File(arch_info)) != nullptr) {
+        opened = true;
+    } else if ((mode & File::STREAMING) != 0) {
+        StreamingArchiveFile *streaming = NEW_POOL_OBJ(StreamingArchiveFile);
+        streaming->Delete_On_Close();
+        streaming->Set_Archive_Lock(&m_attachedFileLock);
+        ScopedCriticalSectionClass cs(&m_attachedFileLock);
+        opened = streaming->Open_From_Archive(m_attachedFile, arch_info->file_name, arch_info->position, arch_info->size);
+        file = streaming;
+    } else if (m_mapping.Is_Open() && arch_info->position >= 0 && arch_info->size >= 0
+        && size_t(arch_info->position) + size_t(arch_info->size) <= m_mapping.Get_Size()) {
+        // Archive is mapped, hand out a view straight into the mapping rather than copying the data.
+        MappedArchiveFile *mapped = NEW_POOL_OBJ(MappedArchiveFile);
+        mapped->Delete_On_Close();
+        opened = mapped->Open_From_Mapping(
+            arch_info->file_name, m_mapping.Get_Data() + arch_info->position, arch_info->size);
+        file = mapped;
     } else {
         file = NEW_POOL_OBJ(RAMFile);
+        file->Delete_On_Close();
+        ScopedCriticalSectionClass cs(&m_attachedFileLock);
+        opened = file->Open_From_Archive(m_attachedFile, arch_info->file_name, arch_info->position, arch_info->size);
     }
 
-    file->Delete_On_Close();
-
-    if (!file->Open_From_Archive(m_attachedFile, arch_info->file_name, arch_info->position, arch_info->size)) {
+    if (!opened) {
         file->Close();
 
         return nullptr;
@@ -68,3 +88,100 @@ File *Win32BIGFile::Open_File(const char *filename, int mode)
         return localfile;
     }
 }
+
+bool Win32BIGFile::Map_Archive(const char *filename)
+{
+    return m_mapping.Open(filename);
+}
+
+/**
+ * Returns the size an entry decodes to if it is RefPack compressed, -1 otherwise. Called while the directory is parsed so
+ * opening an entry doesn't need to read its header again, the file passed is the archive as it isn't attached yet.
+ */
+int Win32BIGFile::Get_Decoded_Size(File *file, int position, int size) const
+{
+    if (size < 8 || position < 0) {
+        return -1;
+    }
+
+    char header[8];
+
+    if (m_mapping.Is_Open() && size_t(position) + size_t(size) <= m_mapping.Get_Size()) {
+        memcpy(header, m_mapping.Get_Data() + position, sizeof(header));
+    } else if (file->Seek(position, File::START) != position || file->Read(header, sizeof(header)) != sizeof(header)) {
+        return -1;
+    }
+
+    // Only RefPack is produced by the original tools and handled by the compression manager.
+    if (CompressionManager::Get_Compression_Type(header, sizeof(header)) != COMPRESSION_EAR) {
+        return -1;
+    }
+
+    return std::max(CompressionManager::Get_Uncompressed_Size(header, sizeof(header)), -1);
+}
+
+/**
+ * Returns a file holding the decoded contents of an entry flagged as compressed when the directory was parsed, nullptr
+ * if it can't be decoded in which case it is opened as is.
+ */
+RAMFile *Win32BIGFile::Open_Compressed_File(ArchivedFileInfo const *arch_info)
+{
+    if (arch_info->size < 8 || arch_info->position < 0) {
+        return nullptr;
+    }
+
+    const char *src = nullptr;
+    char *src_buffer = nullptr;
+    int size = arch_info->decoded_size;
+    bool mapped = m_mapping.Is_Open() && size_t(arch_info->position) + size_t(arch_info->size) <= m_mapping.Get_Size();
+
+    if (mapped) {
+        src = m_mapping.Get_Data() + arch_info->position;
+    }
+
+    char *data = new char[size > 0 ? size : 1];
+    Utf8String archive_name = m_attachedFile->Get_Name();
+
+    if (m_blobCache == nullptr || !m_blobCache->Find(archive_name, arch_info->position, data, size)) {
+        if (!mapped) {
+            src_buffer = new char[arch_info->size];
+            ScopedCriticalSectionClass cs(&m_attachedFileLock);
+
+            if (m_attachedFile->Seek(arch_info->position, File::START) == arch_info->position
+                && m_attachedFile->Read(src_buffer, arch_info->size) == arch_info->size) {
+                src = src_buffer;
+            }
+        }
+
+        // The decoder doesn't write through the source, the cast is only because the manager isn't const correct.
+        if (src == nullptr
+            || CompressionManager::Decompress_Data(const_cast<char *>(src), arch_info->size, data, size) != size) {
+            captainslog_warn("Failed to decompress '%s' from '%s', opening it as is.",
+                arch_info->file_name.Str(),
+                archive_name.Str());
+            delete[] src_buffer;
+            delete[] data;
+
+            return nullptr;
+        }
+
+        delete[] src_buffer;
+
+        if (m_blobCache != nullptr) {
+            m_blobCache->Insert(archive_name, arch_info->position, data, size);
+        }
+    }
+
+    RAMFile *file = NEW_POOL_OBJ(RAMFile);
+
+    if (!file->Open_From_Buffer(arch_info->file_name, data, size)) {
+        delete[] data;
+        file->Delete_Instance();
+
+        return nullptr;
+    }
+
+    file->Delete_On_Close();
+
+    return file;
+}
@@ -14,11 +14,17 @@
  */
 #pragma once
 
+#include "archiveblobcache.h"
 #include "archivefile.h"
+#include "critsection.h"
+#include "memorymappedfile.h"
+
+class RAMFile;
 
 class Win32BIGFile : public ArchiveFile
 {
 public:
+    Win32BIGFile() : m_decompressEntries(false), m_blobCache(nullptr) {}
     virtual ~Win32BIGFile() override {}
 
     virtual bool Get_File_Info(Utf8String const &name, FileInfo *info) const override;
@@ -29,7 +35,33 @@ public:
     virtual void Set_Search_Priority(int priority) override {}
     virtual void Close() override {}
 
+    bool Map_Archive(const char *filename);
+    bool Is_Mapped() const { return m_mapping.Is_Open(); }
+    const Thyme::MemoryMappedFile &Get_Mapping() const { return m_mapping; }
+
+    // Compressed entries are decoded when opened, through the cache if one is passed.
+    void Enable_Decompression(Thyme::ArchiveBlobCache *cache)
+    {
+        m_decompressEntries = true;
+        m_blobCache = cache;
+    }
+
+    bool Is_Decompressing() const { return m_decompressEntries; }
+    int Get_Decoded_Size(File *file, int position, int size) const;
+
+private:
+    bool Is_Decoded(ArchivedFileInfo const *arch_info) const
+    {
+        return m_decompressEntries && arch_info->decoded_size >= 0;
+    }
+
+    RAMFile *Open_Compressed_File(ArchivedFileInfo const *arch_info);
+
 private:
+    Thyme::MemoryMappedFile m_mapping;
+    SimpleCriticalSectionClass m_attachedFileLock; // Serialises seek and read pairs on the shared archive handle.
     Utf8String m_fileName;
     Utf8String m_filePath;
+    bool m_decompressEntries;
+    Thyme::ArchiveBlobCache *m_blobCache;
 };
\ No newline at end of file
@@ -13,33 +13,76 @@
  *            LICENSE
  */
 #include "win32bigfilesystem.h"
+#include "archiveindexcache.h"
 #include "asciistring.h"
 #include "audiomanager.h"
 #include "endiantype.h"
 #include "file.h"
 #include "localfilesystem.h"
+#include "memdynalloc.h"
+#include "memorymappedfile.h"
+#include "mempool.h"
 #include "registry.h"
 #include "rtsutils.h"
 #include "win32bigfile.h"
+#include "workerpool.h"
+#include <algorithm>
+#include <cstring>
+#include <vector>
 
 using rts::FourCC;
 
+// Mapping every archive needs a lot of address space which 32bit builds don't have to spare.
+bool Win32BIGFileSystem::s_mapArchives = sizeof(void *) > 4;
+
+// Relative names are resolved next to the executable, the user data directory isn't known yet when the archives are
+// loaded.
+const char *Win32BIGFileSystem::s_indexCacheFile = "ThymeArchiveIndex.cache";
+
+// Enough for the decoded maps and INI that get opened repeatedly during a session.
+size_t Win32BIGFileSystem::s_blobCacheSize = 32 * 1024 * 1024;
+
+Win32BIGFileSystem::Win32BIGFileSystem() : m_blobCache(s_blobCacheSize) {}
+
+namespace
+{
+enum
+{
+    INDEX_CACHE_VERSION = 2,
+};
+} // namespace
+
 void Win32BIGFileSystem::Init()
 {
     captainslog_dbgassert(
         g_theLocalFileSystem != nullptr, "TheLocalFileSystem must be initialized before TheArchiveFileSystem.");
 
     if (g_theLocalFileSystem != nullptr) {
-        Load_Big_Files_From_Directory("", "*.big", false);
-
         Utf8String gen_path;
 
         Get_String_From_Generals_Registry("", "InstallPath", gen_path);
         captainslog_debug("Retrieved Generals path as '%s' from registry.", gen_path.Str());
 
+        // Archives that haven't changed since the last run can have their directories restored from the index cache
+        // instead of parsing every archive header again.
+        std::vector<ArchiveStamp> stamps;
+        Get_Archive_Stamps("", stamps);
+
+        if (gen_path != "") {
+            Get_Archive_Stamps(gen_path, stamps);
+        }
+
+        if (Load_Index_Cache(stamps)) {
+            return;
+        }
+
+        Load_Big_Files_From_Directory("", "*.big", false);
+
         if (gen_path != "") {
             Load_Big_Files_From_Directory(gen_path, "*.big", false);
         }
+
+        Save_Index_Cache(stamps);
     }
 }
 
@@ -50,88 +93,79 @@ ArchiveFile *Win32BIGFileSystem::Open_Archive_File(const char *filename)
     fullname.To_Lower();
     Win32BIGFile *big = new Win32BIGFile;
 
+    if (s_decompressEntries) {
+        big->Enable_Decompression(&m_blobCache);
+    }
+
     captainslog_debug("Win32BigFileSystem::Open_Archive_File - opening BIG file %s.", filename);
 
     if (file) {
         // Read and check Big file FourCC, make sure we opened the right thing.
         // BIGF is used in Generals games, BIG4 is used in BFME games.
-        uint32_t idbuff;
-        file->Read(&idbuff, sizeof(idbuff));
-
-        if (idbuff == FourCC<'B', 'I', 'G', 'F'>::value || idbuff == FourCC<'B', 'I', 'G', '4'>::value) {
-            uint32_t arch_size;
-            uint32_t file_count;
+        uint32_t header[4];
 
+        if (file->Read(header, sizeof(header)) == sizeof(header)
+            && (header[0] == FourCC<'B', 'I', 'G', 'F'>::value || header[0] == FourCC<'B', 'I', 'G', '4'>::value)) {
             // Read information from header and convert to host integer format.
-            file->Read(&arch_size, sizeof(arch_size));
-            file->Read(&file_count, sizeof(file_count));
-            arch_size = le32toh(arch_size);
-            file_count = be32toh(file_count);
+            uint32_t arch_size = le32toh(header[1]);
+            uint32_t file_count = be32toh(header[2]);
+            uint32_t header_end = be32toh(header[3]);
             captainslog_debug("Win32BigFileSystem::Open_Archive_File - size of archive file is %u bytes.", arch_size);
             captainslog_debug(
                 "Win32BigFileSystem::Open_Archive_File - %u files are contained within the archive.", file_count);
 
-            // Seek to first file information
-            file->Seek(16, File::START);
-
-            ArchivedFileInfo *info = new ArchivedFileInfo;
-
-            // Process each file info found in the Big file header.
-            for (unsigned int i = 0; i < file_count; ++i) {
-                int32_t file_size = 0;
-                int32_t file_pos = 0;
-                char namebuf[BIG_PATH_MAX];
-
-                // Read file size and position in the Big into host integer format.
-                file->Read(&file_pos, sizeof(file_pos));
-                file->Read(&file_size, sizeof(file_size));
-                file_size = be32toh(file_size);
-                file_pos = be32toh(file_pos);
-
-                info->size = file_size;
-                info->position = file_pos;
-                info->archive_name = filename;
-
-                int strlen = 0;
-                char *putp = namebuf;
+            // Mapping is optional, if it fails files will be read into memory from the attached file instead.
+            if (s_mapArchives && !big->Map_Archive(filename)) {
+                captainslog_warn(
+                    "Win32BigFileSystem::Open_Archive_File - failed to map %s, falling back to reads.", filename);
+            }
 
-                for (; strlen < BIG_PATH_MAX; ++strlen) {
-                    file->Read(putp, sizeof(*putp));
+            // The header end offset should cover the whole directory, but don't trust it blindly. Each entry can't be
+            // larger than the two offsets and the longest name we accept.
+            int file_size = file->Size();
+            int dir_size = int(header_end) - 16;
+            int max_dir_size = int(std::min<int64_t>(int64_t(file_count) * (8 + BIG_PATH_MAX), file_size - 16));
 
-                    if (*putp == '\0') {
-                        break;
-                    }
+            if (header_end < 16 || header_end > uint32_t(file_size)) {
+                dir_size = max_dir_size;
+            }
 
-                    ++putp;
-                }
+            const char *dir_data;
+            char *dir_buffer = nullptr;
+
+            if (big->Is_Mapped()) {
+                dir_data = big->Get_Mapping().Get_Data() + 16;
+            } else {
+                // Read the whole directory in one go rather than walking it a few bytes at a time.
+                dir_buffer = new char[dir_size > 0 ? dir_size : 1];
+                file->Seek(16, File::START);
+                dir_size = std::max(file->Read(dir_buffer, dir_size), 0);
+                dir_data = dir_buffer;
+            }
 
-                captainslog_relassert(
-                    strlen < BIG_PATH_MAX, 0xDEAD0002, "Filename string in BIG file header not null terminated");
+            bool parsed = Parse_Directory(big, file, filename, dir_data, dir_size, file_count);
 
-                // Find the start of the file name
-                int name_start = strlen;
+            // Some tools write a bad header end offset, retry with the largest size the directory could be.
+            if (!parsed && dir_size < max_dir_size) {
+                big->Clear_Files();
+                dir_size = max_dir_size;
 
-                for (; name_start >= 0; --name_start) {
-                    if (namebuf[name_start] == '\\' || namebuf[name_start] == '/') {
-                        break;
-                    }
+                if (!big->Is_Mapped()) {
+                    delete[] dir_buffer;
+                    dir_buffer = new char[dir_size > 0 ? dir_size : 1];
+                    file->Seek(16, File::START);
+                    dir_size = std::max(file->Read(dir_buffer, dir_size), 0);
+                    dir_data = dir_buffer;
                 }
 
-                // Store the file name in the info struct and then null first char so we
-                // can recover the rest of the path.
-                info->file_name = &namebuf[name_start + 1];
-                info->file_name.To_Lower();
-                // captainslog_trace("Base name is '%s'.", &namebuf[name_start + 1]);
+                parsed = Parse_Directory(big, file, filename, dir_data, dir_size, file_count);
+            }
 
-                namebuf[name_start + 1] = '\0';
+            delete[] dir_buffer;
 
-                // captainslog_trace("Path is '%s'.", namebuf);
-
-                big->Add_File(namebuf, info);
-            }
+            captainslog_relassert(parsed, 0xDEAD0002, "Filename string in BIG file header not null terminated");
 
             big->Attach_File(file);
-            delete info;
             return big;
         } else {
             captainslog_dbgassert(false, "Error reading BIG file identifier in file %s", filename);
@@ -146,6 +180,76 @@ ArchiveFile *Win32BIGFileSystem::Open_Archive_File(const char *filename)
     }
 }
 
+// Parses the file entries of a BIG directory that has already been loaded into memory. Returns false if the data ran
+// out before all the entries were read.
+bool Win32BIGFileSystem::Parse_Directory(
+    Win32BIGFile *big, File *file, const char *filename, const char *data, int size, unsigned int file_count)
+{
+    ArchivedFileInfo info;
+    const char *getp = data;
+    const char *endp = data + size;
+    char namebuf[BIG_PATH_MAX];
+
+    info.archive_name = filename;
+
+    // Process each file info found in the Big file header.
+    for (unsigned int i = 0; i < file_count; ++i) {
+        uint32_t file_pos;
+        uint32_t file_size;
+
+        if (endp - getp < int(sizeof(file_pos) + sizeof(file_size))) {
+            return false;
+        }
+
+        // Read file size and position in the Big into host integer format.
+        memcpy(&file_pos, getp, sizeof(file_pos));
+        memcpy(&file_size, getp + sizeof(file_pos), sizeof(file_size));
+        getp += sizeof(file_pos) + sizeof(file_size);
+
+        info.size = be32toh(file_size);
+        info.position = be32toh(file_pos);
+
+        // Compressed entries are flagged up front so their decoded size is known without opening them. The result
+        // goes in the index cache so unmapped archives only pay for the header reads when the cache is rebuilt.
+        info.decoded_size = big->Is_Decompressing() ? big->Get_Decoded_Size(file, info.position, info.size) : -1;
+
+        // Names are null terminated and must fit in our buffer.
+        int max_len = std::min<int>(endp - getp, BIG_PATH_MAX);
+        const char *name_end = static_cast<const char *>(memchr(getp, '\0', max_len));
+
+        if (name_end == nullptr) {
+            return false;
+        }
+
+        int strlen = int(name_end - getp);
+        memcpy(namebuf, getp, strlen + 1);
+        getp = name_end + 1;
+
+        // Find the start of the file name
+        int name_start = strlen;
+
+        for (; name_start >= 0; --name_start) {
+            if (namebuf[name_start] == '\\' || namebuf[name_start] == '/') {
+                break;
+            }
+        }
+
+        // Store the file name in the info struct and then null first char so we
+        // can recover the rest of the path.
+        info.file_name = &namebuf[name_start + 1];
+        info.file_name.To_Lower();
+        // captainslog_trace("Base name is '%s'.", &namebuf[name_start + 1]);
+
+        namebuf[name_start + 1] = '\0';
+
+        // captainslog_trace("Path is '%s'.", namebuf);
+
+        big->Add_File(namebuf, &info);
+    }
+
+    return true;
+}
+
 void Win32BIGFileSystem::Close_Archive_File(const char *filename)
 {
     auto it = m_archiveFiles.find(filename);
@@ -176,10 +280,17 @@ bool Win32BIGFileSystem::Load_Big_Files_From_Directory(Utf8String dir, Utf8Strin
     g_theLocalFileSystem->Get_File_List_In_Directory(dir, "", filter, file_list, true);
     bool ret = false;
 
-    for (auto it = file_list.begin(); it != file_list.end(); ++it) {
+    // Parse the archive headers in parallel where we can, the directory tree is still built in the same order as
+    // before so which archive wins for a given file is unchanged.
+    std::vector<ArchiveFile *> archives(file_list.size(), nullptr);
+    Open_Archive_Files(file_list, archives);
+
+    auto arch_it = archives.begin();
+
+    for (auto it = file_list.begin(); it != file_list.end(); ++it, ++arch_it) {
         captainslog_debug(
             "Win32BIGFileSystem::Load_Big_Files_From_Directory - loading %s into the directory tree.", (*it).Str());
-        ArchiveFile *arch = Open_Archive_File((*it).Str());
+        ArchiveFile *arch = *arch_it;
 
         if (arch != nullptr) {
             Load_Into_Directory_Tree(arch, *it, overwrite);
@@ -193,3 +304,218 @@ bool Win32BIGFileSystem::Load_Big_Files_From_Directory(Utf8String dir, Utf8Strin
 
     return ret;
 }
+
+namespace
+{
+class OpenArchiveJob : public Thyme::WorkerJob
+{
+public:
+    OpenArchiveJob() : m_fileSystem(nullptr), m_archive(nullptr) {}
+
+    virtual void Execute() override { *m_archive = m_fileSystem->Open_Archive_File(m_filename.Str()); }
+
+    ArchiveFileSystem *m_fileSystem;
+    Utf8String m_filename;
+    ArchiveFile **m_archive;
+};
+} // namespace
+
+// Opens each archive in the list, storing the results in the matching position in archives.
+void Win32BIGFileSystem::Open_Archive_Files(
+    std::set<Utf8String, rts::less_than_nocase<Utf8String>> const &file_list, std::vector<ArchiveFile *> &archives)
+{
+    int thread_count = std::min<int>(Thyme::WorkerPool::Get_Default_Thread_Count(), int(file_list.size()) - 1);
+
+    // Opening archives on other threads relies on the memory managers having their locks set up.
+#ifndef GAME_DLL
+    bool concurrent = thread_count > 0 && g_memoryPoolCriticalSection != nullptr && g_dmaCriticalSection != nullptr;
+#else
+    bool concurrent = false;
+#endif
+
+    if (!concurrent) {
+        auto arch_it = archives.begin();
+
+        for (auto it = file_list.begin(); it != file_list.end(); ++it, ++arch_it) {
+            *arch_it = Open_Archive_File((*it).Str());
+        }
+
+        return;
+    }
+
+    Thyme::WorkerPool pool("BIG Loader", thread_count);
+    std::vector<OpenArchiveJob> jobs(file_list.size());
+    std::vector<Thyme::WorkerJob *> job_ptrs(file_list.size(), nullptr);
+    int i = 0;
+
+    for (auto it = file_list.begin(); it != file_list.end(); ++it, ++i) {
+        jobs[i].m_fileSystem = this;
+        jobs[i].m_filename = *it;
+        jobs[i].m_archive = &archives[i];
+        job_ptrs[i] = &jobs[i];
+        pool.Submit(&jobs[i]);
+    }
+
+    pool.Wait(&job_ptrs[0], int(job_ptrs.size()));
+}
+
+// Gathers the archives Load_Big_Files_From_Directory would load from dir along with the details used to tell if they
+// have changed since the index cache was written.
+void Win32BIGFileSystem::Get_Archive_Stamps(Utf8String const &dir, std::vector<ArchiveStamp> &stamps)
+{
+    if (s_indexCacheFile == nullptr || *s_indexCacheFile == '\0') {
+        return;
+    }
+
+    std::set<Utf8String, rts::less_than_nocase<Utf8String>> file_list;
+    g_theLocalFileSystem->Get_File_List_In_Directory(dir, "", "*.big", file_list, true);
+
+    for (auto it = file_list.begin(); it != file_list.end(); ++it) {
+        ArchiveStamp stamp;
+        stamp.path = *it;
+
+        if (!g_theLocalFileSystem->Get_File_Info(*it, &stamp.info)) {
+            memset(&stamp.info, 0, sizeof(stamp.info));
+        }
+
+        stamps.push_back(stamp);
+    }
+}
+
+// Restores the archives and directory tree from the index cache. Fails without changing anything if the cache is
+// missing, corrupt or was written for a different set of archives.
+bool Win32BIGFileSystem::Load_Index_Cache(std::vector<ArchiveStamp> const &stamps)
+{
+    if (s_indexCacheFile == nullptr || *s_indexCacheFile == '\0' || stamps.empty() || !m_archiveFiles.empty()) {
+        return false;
+    }
+
+    Thyme::MemoryMappedFile cache;
+    Utf8String cache_path = Thyme::Get_Cache_Path(s_indexCacheFile);
+
+    if (!cache.Open(cache_path.Str())) {
+        return false;
+    }
+
+    Thyme::ArchiveIndexReader reader(cache.Get_Data(), cache.Get_Size());
+
+    // Compressed entries are only flagged while decompression is on, a cache written with it off can't be used with it on.
+    if (reader.Read_Int() != FourCC<'T', 'A', 'I', 'C'>::value || reader.Read_Int() != INDEX_CACHE_VERSION
+        || reader.Read_Int() != uint32_t(s_decompressEntries) || reader.Read_Int() != stamps.size()) {
+        return false;
+    }
+
+    std::vector<Utf8String> archive_names;
+    archive_names.reserve(stamps.size());
+
+    for (auto it = stamps.begin(); it != stamps.end(); ++it) {
+        const char *path = reader.Read_String();
+        FileInfo info;
+        info.file_size_high = int(reader.Read_Int());
+        info.file_size_low = int(reader.Read_Int());
+        info.write_time_high = int(reader.Read_Int());
+        info.write_time_low = int(reader.Read_Int());
+
+        if (reader.Failed() || it->path != path || memcmp(&info, &it->info, sizeof(info)) != 0) {
+            captainslog_debug("Archive index cache is out of date, '%s' has changed.", it->path.Str());
+            return false;
+        }
+
+        archive_names.push_back(it->path);
+    }
+
+    std::vector<Win32BIGFile *> archives(stamps.size(), nullptr);
+    bool loaded = true;
+
+    for (size_t i = 0; i < stamps.size() && loaded; ++i) {
+        archives[i] = new Win32BIGFile;
+
+        if (s_decompressEntries) {
+            archives[i]->Enable_Decompression(&m_blobCache);
+        }
+
+        loaded = archives[i]->Read_Index(reader, stamps[i].path);
+    }
+
+    loaded = loaded && Read_Index(reader, archive_names) && reader.At_End();
+
+    for (size_t i = 0; i < stamps.size() && loaded; ++i) {
+        File *file = g_theLocalFileSystem->Open_File(stamps[i].path.Str(), File::READ | File::BINARY);
+
+        if (file == nullptr) {
+            loaded = false;
+            break;
+        }
+
+        if (s_mapArchives && !archives[i]->Map_Archive(stamps[i].path.Str())) {
+            captainslog_warn("Win32BigFileSystem::Load_Index_Cache - failed to map %s, falling back to reads.",
+                stamps[i].path.Str());
+        }
+
+        archives[i]->Attach_File(file);
+    }
+
+    if (!loaded) {
+        captainslog_warn("Archive index cache '%s' could not be used, rebuilding it.", cache_path.Str());
+        m_archiveDirInfo.Clear();
+        m_archiveIndex.Clear();
+
+        for (size_t i = 0; i < archives.size(); ++i) {
+            delete archives[i];
+        }
+
+        return false;
+    }
+
+    for (size_t i = 0; i < stamps.size(); ++i) {
+        m_archiveFiles[stamps[i].path] = archives[i];
+    }
+
+    captainslog_debug("Restored %u archives from index cache '%s'.", unsigned(stamps.size()), cache_path.Str());
+
+    return true;
+}
+
+// Writes the currently loaded archives and directory tree out to the index cache. Nothing is written unless every
+// archive in stamps was loaded, otherwise a later run would never retry the ones that failed.
+void Win32BIGFileSystem::Save_Index_Cache(std::vector<ArchiveStamp> const &stamps)
+{
+    if (s_indexCacheFile == nullptr || *s_indexCacheFile == '\0' || stamps.empty()
+        || m_archiveFiles.size() != stamps.size()) {
+        return;
+    }
+
+    Thyme::ArchiveIndexWriter writer;
+    std::map<Utf8String, uint32_t> archive_ids;
+    writer.Write_Int(FourCC<'T', 'A', 'I', 'C'>::value);
+    writer.Write_Int(INDEX_CACHE_VERSION);
+    writer.Write_Int(uint32_t(s_decompressEntries));
+    writer.Write_Int(uint32_t(stamps.size()));
+
+    for (size_t i = 0; i < stamps.size(); ++i) {
+        writer.Write_String(stamps[i].path);
+        writer.Write_Int(uint32_t(stamps[i].info.file_size_high));
+        writer.Write_Int(uint32_t(stamps[i].info.file_size_low));
+        writer.Write_Int(uint32_t(stamps[i].info.write_time_high));
+        writer.Write_Int(uint32_t(stamps[i].info.write_time_low));
+        archive_ids[stamps[i].path] = uint32_t(i);
+    }
+
+    for (size_t i = 0; i < stamps.size(); ++i) {
+        auto it = m_archiveFiles.find(stamps[i].path);
+
+        if (it == m_archiveFiles.end() || it->second == nullptr) {
+            return;
+        }
+
+        it->second->Write_Index(writer);
+    }
+
+    Write_Index(writer, archive_ids);
+
+    Utf8String cache_path = Thyme::Get_Cache_Path(s_indexCacheFile);
+
+    if (!writer.Save(cache_path.Str())) {
+        captainslog_warn("Failed to write archive index cache '%s'.", cache_path.Str());
+    }
+}
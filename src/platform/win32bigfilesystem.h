@@ -14,7 +14,12 @@
  */
 #pragma once
 
+#include "archiveblobcache.h"
 #include "archivefilesystem.h"
+#include "file.h"
+#include <vector>
+
+class Win32BIGFile;
 
 class Win32BIGFileSystem : public ArchiveFileSystem
 {
@@ -24,6 +29,7 @@ class Win32BIGFileSystem : public ArchiveFileSystem
     };
 
 public:
+    Win32BIGFileSystem();
     virtual ~Win32BIGFileSystem() {}
 
     // SubsystemInterface implementations
@@ -37,4 +43,39 @@ public:
     virtual void Close_All_Archives() override {}
     virtual void Close_All_Files() override {}
     virtual bool Load_Big_Files_From_Directory(Utf8String dir, Utf8String filter, bool overwrite) override;
+
+    // Thyme specific, controls if archives opened after the call are memory mapped.
+    static void Set_Map_Archives(bool map) { s_mapArchives = map; }
+    static bool Get_Map_Archives() { return s_mapArchives; }
+
+    // Thyme specific, sets where the archive index cache is kept, nullptr disables it. The string must outlive Init.
+    static void Set_Index_Cache_File(const char *filename) { s_indexCacheFile = filename; }
+    static const char *Get_Index_Cache_File() { return s_indexCacheFile; }
+
+    // Thyme specific, budget in bytes for decoded entries kept by file systems created after the call, 0 disables it.
+    static void Set_Blob_Cache_Size(size_t size) { s_blobCacheSize = size; }
+    static size_t Get_Blob_Cache_Size() { return s_blobCacheSize; }
+    Thyme::ArchiveBlobCache &Get_Blob_Cache() { return m_blobCache; }
+
+private:
+    struct ArchiveStamp
+    {
+        Utf8String path;
+        FileInfo info;
+    };
+
+    void Get_Archive_Stamps(Utf8String const &dir, std::vector<ArchiveStamp> &stamps);
+    bool Load_Index_Cache(std::vector<ArchiveStamp> const &stamps);
+    void Save_Index_Cache(std::vector<ArchiveStamp> const &stamps);
+    bool Parse_Directory(
+        Win32BIGFile *big, File *file, const char *filename, const char *data, int size, unsigned int file_count);
+    void Open_Archive_Files(
+        std::set<Utf8String, rts::less_than_nocase<Utf8String>> const &file_list, std::vector<ArchiveFile *> &archives);
+
+private:
+    Thyme::ArchiveBlobCache m_blobCache;
+
+    static bool s_mapArchives;
+    static const char *s_indexCacheFile;
+    static size_t s_blobCacheSize;
 };
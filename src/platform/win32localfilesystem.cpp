@@ -13,6 +13,7 @@
  *            LICENSE
  */
 #include "win32localfilesystem.h"
+#include "fileiostats.h"
 #include "standardfile.h"
 #include "win32localfile.h"
 
@@ -62,11 +63,17 @@ File *Win32LocalFileSystem::Open_File(const char *filename, int mode)
     }
 
     // Try and open the file, if not, delete instance and return null.
+    Thyme::FileIOTimer timer;
+
     if (!file->Open(filename, mode)) {
         file->Delete_Instance();
         file = nullptr;
     } else {
         file->Delete_On_Close();
+
+        if ((mode & File::WRITE) == 0) {
+            timer.Opened(filename, Thyme::FileIOStats::SOURCE_LOCAL);
+        }
     }
 
     return file;
@@ -0,0 +1,156 @@
+/**
+ * @file
+ *
+ * @author OmniBlade
+ *
+ * @brief Microbenchmark for resolving archived file paths. (Thyme Feature)
+ *
+ * @copyright Thyme is free software: you can redistribute it and/or
+ *            modify it under the terms of the GNU General Public License
+ *            as published by the Free Software Foundation, either version
+ *            2 of the License, or (at your option) any later version.
+ *            A full copy of the GNU General Public License can be found in
+ *            LICENSE
+ */
+#include "always.h"
+#include "archivefilesystem.h"
+#include "gamememory.h"
+#include "win32bigfilesystem.h"
+#include "win32localfilesystem.h"
+#include <captainslog.h>
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+#ifdef PLATFORM_WINDOWS
+#include <windows.h>
+HWND g_applicationHWnd;
+unsigned g_theMessageTime = 0;
+bool g_gameIsWindowed;
+bool g_gameNotFullscreen;
+bool g_creatingWindow;
+HGDIOBJ g_splashImage;
+HINSTANCE g_applicationHInstance;
+#endif
+
+namespace
+{
+// Exposes the directory tree so the original per component walk can be timed against the flat index.
+class BenchFileSystem : public Win32BIGFileSystem
+{
+public:
+    // The lookup ArchiveFileSystem used before the flat index was added.
+    Utf8String Tree_Lookup(Utf8String const &filename) const
+    {
+        Utf8String path = filename;
+        Utf8String token;
+        const ArchivedDirectoryInfo *dirp = &m_archiveDirInfo;
+
+        path.To_Lower();
+        path.Next_Token(&token, "\\/");
+
+        while (token.Find('.') == nullptr || path.Find('.') != nullptr) {
+            auto it = dirp->directories.find(token);
+
+            if (it == dirp->directories.end()) {
+                return Utf8String();
+            }
+
+            dirp = &it->second;
+            path.Next_Token(&token, "\\/");
+        }
+
+        auto it = dirp->files.find(token);
+
+        if (it != dirp->files.end()) {
+            return it->second;
+        }
+
+        return Utf8String();
+    }
+};
+
+template<typename Func> double Time_Lookups(std::vector<Utf8String> const &paths, int iterations, Func func)
+{
+    auto start = std::chrono::steady_clock::now();
+
+    for (int i = 0; i < iterations; ++i) {
+        for (auto it = paths.begin(); it != paths.end(); ++it) {
+            func(*it);
+        }
+    }
+
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+    return elapsed.count();
+}
+} // namespace
+
+int main(int argc, char **argv)
+{
+    if (argc < 2) {
+        printf("Usage: archivebench <directory containing .big files> [iterations]\n");
+        return 1;
+    }
+
+    int iterations = argc > 2 ? std::max(atoi(argv[2]), 1) : 20;
+
+    captains_settings_t captains_settings = { 0 };
+    captains_settings.level = LOGLEVEL_WARN;
+    captains_settings.console = true;
+    captainslog_init(&captains_settings);
+
+    Init_Memory_Manager();
+    g_theLocalFileSystem = new Win32LocalFileSystem;
+    BenchFileSystem *filesystem = new BenchFileSystem;
+    Utf8String dir = argv[1];
+
+    // The local file system expects directories to end with a separator.
+    if (dir.Is_Not_Empty() && !dir.Ends_With("/") && !dir.Ends_With("\\")) {
+        dir += "/";
+    }
+
+    if (!filesystem->Load_Big_Files_From_Directory(dir, "*.big", false)) {
+        printf("No archives could be loaded from '%s'.\n", dir.Str());
+        return 1;
+    }
+
+    // Resolve every file the archives contain, as the game would ask for them.
+    std::set<Utf8String, rts::less_than_nocase<Utf8String>> file_list;
+    filesystem->Get_File_List_In_Directory("", "", "*", file_list, true);
+    std::vector<Utf8String> paths(file_list.begin(), file_list.end());
+
+    if (paths.empty()) {
+        printf("The archives in '%s' don't contain any files.\n", dir.Str());
+        return 1;
+    }
+
+    int mismatches = 0;
+
+    for (auto it = paths.begin(); it != paths.end(); ++it) {
+        if (filesystem->Tree_Lookup(*it) != filesystem->Get_Archive_Filename_For_File(*it)) {
+            printf("Lookup mismatch for '%s'.\n", it->Str());
+            ++mismatches;
+        }
+    }
+
+    volatile int found = 0;
+    double tree_time = Time_Lookups(
+        paths, iterations, [&](Utf8String const &path) { found += filesystem->Tree_Lookup(path).Is_Not_Empty(); });
+    double index_time = Time_Lookups(paths, iterations, [&](Utf8String const &path) {
+        found += filesystem->Get_Archive_Filename_For_File(path).Is_Not_Empty();
+    });
+
+    double lookups = double(paths.size()) * iterations;
+    printf("Resolved %u paths %d times.\n", unsigned(paths.size()), iterations);
+    printf("Directory tree: %12.0f lookups/s\n", lookups / tree_time);
+    printf("Flat index:     %12.0f lookups/s (%.2fx)\n", lookups / index_time, tree_time / index_time);
+
+    delete filesystem;
+    delete g_theLocalFileSystem;
+    g_theLocalFileSystem = nullptr;
+
+    return mismatches == 0 ? 0 : 1;
+}
@@ -0,0 +1,128 @@
+/**
+ * @file
+ *
+ * @author OmniBlade
+ *
+ * @brief Tool to write BIG archives, optionally laid out in the order a file access trace opened them. (Thyme Feature)
+ *
+ * @copyright Thyme is free software: you can redistribute it and/or
+ *            modify it under the terms of the GNU General Public License
+ *            as published by the Free Software Foundation, either version
+ *            2 of the License, or (at your option) any later version.
+ *            A full copy of the GNU General Public License can be found in
+ *            LICENSE
+ */
+#include "always.h"
+#include "bigarchivewriter.h"
+#include "gamememory.h"
+#include <captainslog.h>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+#ifdef BUILD_WITH_STDFS
+#include "stdlocalfilesystem.h"
+#else
+#include "win32localfilesystem.h"
+#endif
+
+#ifdef PLATFORM_WINDOWS
+#include <windows.h>
+HWND g_applicationHWnd;
+unsigned g_theMessageTime = 0;
+bool g_gameIsWindowed;
+bool g_gameNotFullscreen;
+bool g_creatingWindow;
+HGDIOBJ g_splashImage;
+HINSTANCE g_applicationHInstance;
+#endif
+
+namespace
+{
+// Archives are read through the OS page cache so entries starting on a page don't share pages with the entry before.
+const int TRACE_ALIGNMENT = 4096;
+
+void Print_Usage()
+{
+    printf("Usage: bigpack [-trace <file>] [-align <bytes>] <output.big> <input> [input...]\n");
+    printf("  Inputs are directories, whose files are added by their relative path, or existing .big archives.\n");
+    printf("  Later inputs replace entries of the same name from earlier ones.\n");
+    printf("  -trace <file>   Lay entries out in first access order from a trace written with -traceFileAccess.\n");
+    printf("  -align <bytes>  Start each entry on a multiple of this, defaults to %d with a trace and 1 without.\n",
+        TRACE_ALIGNMENT);
+}
+} // namespace
+
+int main(int argc, char **argv)
+{
+    const char *trace = nullptr;
+    int alignment = 0;
+    std::vector<const char *> paths;
+
+    for (int i = 1; i < argc; ++i) {
+        if (strcmp(argv[i], "-trace") == 0 && i + 1 < argc) {
+            trace = argv[++i];
+        } else if (strcmp(argv[i], "-align") == 0 && i + 1 < argc) {
+            alignment = atoi(argv[++i]);
+        } else if (argv[i][0] == '-') {
+            Print_Usage();
+            return 1;
+        } else {
+            paths.push_back(argv[i]);
+        }
+    }
+
+    if (paths.size() < 2) {
+        Print_Usage();
+        return 1;
+    }
+
+    captains_settings_t captains_settings = { 0 };
+    captains_settings.level = LOGLEVEL_WARN;
+    captains_settings.console = true;
+    captainslog_init(&captains_settings);
+
+    Init_Memory_Manager();
+#ifdef BUILD_WITH_STDFS
+    g_theLocalFileSystem = new Thyme::StdLocalFileSystem;
+#else
+    g_theLocalFileSystem = new Win32LocalFileSystem;
+#endif
+
+    int result = 0;
+
+    {
+        Thyme::BIGArchiveWriter writer;
+        writer.Set_Alignment(alignment > 0 ? alignment : (trace != nullptr ? TRACE_ALIGNMENT : 1));
+
+        for (size_t i = 1; i < paths.size(); ++i) {
+            Utf8String input = paths[i];
+            int added = input.Ends_With_No_Case(".big") ? writer.Add_Archive(input) : writer.Add_Directory(input);
+            printf("Added %d files from '%s'.\n", added, input.Str());
+        }
+
+        if (trace != nullptr) {
+            int traced = writer.Load_Access_Trace(trace);
+            printf("Trace lists %d files, %d of them are in the archive.\n", traced, writer.Get_Traced_Entry_Count());
+        }
+
+        if (writer.Get_Entry_Count() == 0) {
+            printf("Nothing to write.\n");
+            result = 1;
+        } else if (!writer.Write(paths[0])) {
+            printf("Failed to write '%s'.\n", paths[0]);
+            result = 1;
+        } else {
+            printf("Wrote %d files to '%s' aligned to %d bytes.\n",
+                writer.Get_Entry_Count(),
+                paths[0],
+                writer.Get_Alignment());
+        }
+    }
+
+    delete g_theLocalFileSystem;
+    g_theLocalFileSystem = nullptr;
+
+    return result;
+}
@@ -0,0 +1,271 @@
+/**
+ * @file
+ *
+ * @author OmniBlade
+ *
+ * @brief Benchmark replaying an allocation size distribution through the dynamic memory allocator. (Thyme Feature)
+ *
+ * @copyright Thyme is free software: you can redistribute it and/or
+ *            modify it under the terms of the GNU General Public License
+ *            as published by the Free Software Foundation, either version
+ *            2 of the License, or (at your option) any later version.
+ *            A full copy of the GNU General Public License can be found in
+ *            LICENSE
+ */
+#include "always.h"
+#include "gamememory.h"
+#include "memdynalloc.h"
+#include "mempool.h"
+#include "mempoolfact.h"
+#include <captainslog.h>
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+#ifdef PLATFORM_WINDOWS
+#include <windows.h>
+HWND g_applicationHWnd;
+unsigned g_theMessageTime = 0;
+bool g_gameIsWindowed;
+bool g_gameNotFullscreen;
+bool g_creatingWindow;
+HGDIOBJ g_splashImage;
+HINSTANCE g_applicationHInstance;
+#endif
+
+namespace
+{
+// Blocks kept alive at once during the replay, frees pick a random one of them.
+const int LIVE_BLOCKS = 1024;
+
+// The last histogram bucket is open ended, replayed sizes are capped so the run doesn't need gigabytes.
+const int MAX_REPLAY_SIZE = 4 * 1024 * 1024;
+
+struct SizeBucket
+{
+    int min_size;
+    int max_size;
+    uint64_t cumulative;
+};
+
+// Used when no histogram is given, mostly strings and message arguments with the odd large buffer.
+const int DEFAULT_SIZES[][2] = {
+    { 8, 3000 },
+    { 16, 9000 },
+    { 24, 6000 },
+    { 32, 12000 },
+    { 48, 5000 },
+    { 64, 7000 },
+    { 96, 3000 },
+    { 128, 4000 },
+    { 256, 2000 },
+    { 512, 1000 },
+    { 1024, 500 },
+    { 4096, 120 },
+    { 16384, 40 },
+    { 65536, 10 },
+    { 262144, 2 },
+};
+
+uint32_t Next_Random(uint32_t &state)
+{
+    state = state * 1664525 + 1013904223;
+    return state >> 8;
+}
+
+void Add_Bucket(std::vector<SizeBucket> &buckets, int size, uint64_t count)
+{
+    SizeBucket bucket;
+    bucket.min_size = buckets.empty() ? std::max(size - 7, 1) : std::min(buckets.back().max_size + 1, size);
+    bucket.max_size = std::min(size, MAX_REPLAY_SIZE);
+    bucket.min_size = std::min(bucket.min_size, bucket.max_size);
+    bucket.cumulative = (buckets.empty() ? 0 : buckets.back().cumulative) + count;
+    buckets.push_back(bucket);
+}
+
+// Reads the size,count lines -recordMemoryPools writes to MemoryPoolAllocSizes.csv, each size is the top of a bucket.
+bool Load_Histogram(const char *filename, std::vector<SizeBucket> &buckets)
+{
+    FILE *fp = fopen(filename, "r");
+
+    if (fp == nullptr) {
+        return false;
+    }
+
+    char line[128];
+    int size;
+    unsigned count;
+
+    while (fgets(line, sizeof(line), fp) != nullptr) {
+        if (sscanf(line, "%d,%u", &size, &count) == 2 && size > 0 && count > 0) {
+            Add_Bucket(buckets, size, count);
+        }
+    }
+
+    fclose(fp);
+
+    return !buckets.empty();
+}
+
+int Pick_Size(std::vector<SizeBucket> const &buckets, uint32_t &state)
+{
+    uint64_t target = ((uint64_t(Next_Random(state)) << 24) | Next_Random(state)) % buckets.back().cumulative;
+    auto it = std::upper_bound(buckets.begin(),
+        buckets.end(),
+        target,
+        [](uint64_t value, SizeBucket const &bucket) { return value < bucket.cumulative; });
+    int range = it->max_size - it->min_size + 1;
+
+    return it->min_size + int(Next_Random(state) % range);
+}
+
+// What Find_Pool_For_Size did before the size class table, kept here as the reference it has to agree with.
+MemoryPool *Linear_Find_Pool(std::vector<MemoryPool *> const &pools, int size)
+{
+    for (auto it = pools.begin(); it != pools.end(); ++it) {
+        if (size <= (*it)->Get_Alloc_Size()) {
+            return *it;
+        }
+    }
+
+    return nullptr;
+}
+
+double Seconds_Since(std::chrono::high_resolution_clock::time_point start)
+{
+    return std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count();
+}
+
+// Churns a fixed size live set with sizes drawn from the distribution, half allocations and half frees.
+double Run_Replay(std::vector<int> const &sizes)
+{
+    std::vector<void *> live(LIVE_BLOCKS, nullptr);
+    uint32_t state = 12345;
+    auto start = std::chrono::high_resolution_clock::now();
+
+    for (auto it = sizes.begin(); it != sizes.end(); ++it) {
+        void *&slot = live[Next_Random(state) % LIVE_BLOCKS];
+
+        if (slot != nullptr) {
+            g_dynamicMemoryAllocator->Free_Bytes(slot);
+        }
+
+        slot = g_dynamicMemoryAllocator->Allocate_Bytes_No_Zero(*it);
+        // Touch the block as a real caller would, this is where huge pages save TLB misses.
+        memset(slot, 0, std::min(*it, 256));
+    }
+
+    for (auto it = live.begin(); it != live.end(); ++it) {
+        g_dynamicMemoryAllocator->Free_Bytes(*it);
+    }
+
+    return Seconds_Since(start);
+}
+} // namespace
+
+int main(int argc, char **argv)
+{
+    const char *histogram = argc > 1 ? argv[1] : nullptr;
+    int ops = argc > 2 ? std::max(atoi(argv[2]), 1) : 2000000;
+
+    captains_settings_t captains_settings = { 0 };
+    captains_settings.level = LOGLEVEL_WARN;
+    captains_settings.console = true;
+    captainslog_init(&captains_settings);
+    Init_Memory_Manager();
+
+    std::vector<SizeBucket> buckets;
+
+    if (histogram != nullptr) {
+        if (!Load_Histogram(histogram, buckets)) {
+            printf("Could not read a size histogram from '%s'.\n", histogram);
+            return 1;
+        }
+    } else {
+        for (size_t i = 0; i < ARRAY_SIZE(DEFAULT_SIZES); ++i) {
+            Add_Bucket(buckets, DEFAULT_SIZES[i][0], DEFAULT_SIZES[i][1]);
+        }
+    }
+
+    std::vector<int> sizes;
+    sizes.reserve(ops);
+    uint32_t state = 1;
+
+    for (int i = 0; i < ops; ++i) {
+        sizes.push_back(Pick_Size(buckets, state));
+    }
+
+    std::vector<MemoryPool *> dma_pools;
+
+    for (MemoryPool *pool = g_memoryPoolFactory->Get_First_Pool(); pool != nullptr;
+         pool = pool->Get_Next_Pool_In_Factory()) {
+        if (strncmp(pool->Get_Pool_Name(), "dmaPool_", 8) == 0) {
+            dma_pools.push_back(pool);
+        }
+    }
+
+    std::sort(dma_pools.begin(), dma_pools.end(), [](MemoryPool *a, MemoryPool *b) {
+        return a->Get_Alloc_Size() < b->Get_Alloc_Size();
+    });
+
+    int failures = 0;
+
+    // Every size the table covers and a few past it must find the same pool as the linear search.
+    for (int size = 0; size <= DynamicMemoryAllocator::SIZE_CLASS_LIMIT * 2; ++size) {
+        if (g_dynamicMemoryAllocator->Find_Pool_For_Size(size) != Linear_Find_Pool(dma_pools, size)) {
+            printf("Size %d maps to a different pool than the linear search.\n", size);
+            ++failures;
+        }
+    }
+
+    uintptr_t checksum = 0;
+    auto start = std::chrono::high_resolution_clock::now();
+
+    for (auto it = sizes.begin(); it != sizes.end(); ++it) {
+        checksum += reinterpret_cast<uintptr_t>(Linear_Find_Pool(dma_pools, *it));
+    }
+
+    double linear_seconds = Seconds_Since(start);
+    start = std::chrono::high_resolution_clock::now();
+
+    for (auto it = sizes.begin(); it != sizes.end(); ++it) {
+        checksum -= reinterpret_cast<uintptr_t>(g_dynamicMemoryAllocator->Find_Pool_For_Size(*it));
+    }
+
+    double table_seconds = Seconds_Since(start);
+
+    if (checksum != 0) {
+        printf("Replayed sizes found different pools.\n");
+        ++failures;
+    }
+
+    DynamicMemoryAllocator::Set_Huge_Page_Arena(false);
+    double heap_seconds = Run_Replay(sizes);
+    DynamicMemoryAllocator::Set_Huge_Page_Arena(true);
+    double arena_seconds = Run_Replay(sizes);
+
+    printf("%d sizes from %s, %d buckets, times are per operation.\n",
+        ops,
+        histogram != nullptr ? histogram : "the built in distribution",
+        int(buckets.size()));
+    printf("%-22s %12s %12s %9s\n", "Test", "Before (ns)", "After (ns)", "Speedup");
+    printf("%-22s %12.1f %12.1f %8.2fx\n",
+        "Find_Pool_For_Size",
+        linear_seconds * 1e9 / ops,
+        table_seconds * 1e9 / ops,
+        linear_seconds / table_seconds);
+    printf("%-22s %12.1f %12.1f %8.2fx\n",
+        "Replay heap vs arena",
+        heap_seconds * 1e9 / ops,
+        arena_seconds * 1e9 / ops,
+        heap_seconds / arena_seconds);
+
+    if (!DynamicMemoryAllocator::Is_Using_Huge_Page_Arena()) {
+        printf("The huge page arena could not be created, both replays used the heap.\n");
+    }
+
+    return failures == 0 ? 0 : 1;
+}
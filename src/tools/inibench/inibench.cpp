@@ -0,0 +1,420 @@
+/**
+ * @file
+ *
+ * @author OmniBlade
+ *
+ * @brief Benchmark of INI line reading, tokenizing, field lookup and number scanning. (Thyme Feature)
+ *
+ * @copyright Thyme is free software: you can redistribute it and/or
+ *            modify it under the terms of the GNU General Public License
+ *            as published by the Free Software Foundation, either version
+ *            2 of the License, or (at your option) any later version.
+ *            A full copy of the GNU General Public License can be found in
+ *            LICENSE
+ */
+#include "always.h"
+#include "file.h"
+#include "gamememory.h"
+#include "ini.h"
+#include "inifilebuffer.h"
+#include "iniparseindex.h"
+#include "win32localfilesystem.h"
+#include <captainslog.h>
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <set>
+#include <vector>
+
+#ifdef PLATFORM_WINDOWS
+#include <windows.h>
+HWND g_applicationHWnd;
+unsigned g_theMessageTime = 0;
+bool g_gameIsWindowed;
+bool g_gameNotFullscreen;
+bool g_creatingWindow;
+HGDIOBJ g_splashImage;
+HINSTANCE g_applicationHInstance;
+#endif
+
+namespace
+{
+// Field names are split into tables of this size in the order they first appear, which is about the size of the
+// real tables. Like Init_From_INI_Multi, a lookup searches the tables in turn until one has the name.
+const int FIELDS_PER_TABLE = 48;
+const int MAX_TABLES = MultiIniFieldParse::MAX_MULTI_FIELDS;
+
+const char SEPS[] = " \n\r\t=";
+
+struct CorpusEntry
+{
+    Utf8String name;
+    std::vector<char> text;
+};
+
+// Owns the names the synthetic parse tables point at.
+struct FieldTables
+{
+    std::vector<Utf8String> names;
+    std::vector<std::vector<FieldParse>> tables;
+};
+
+uint32_t Hash_Token(uint32_t hash, const char *token)
+{
+    for (; *token != '\0'; ++token) {
+        hash = (hash ^ uint8_t(*token)) * 16777619u;
+    }
+
+    return hash * 31;
+}
+
+// The 8 KB buffered reader INI::Read_Line used before, reading from memory instead of a file.
+class LegacyReader
+{
+public:
+    LegacyReader(std::vector<char> const &text) : m_text(text), m_textPos(0), m_readPos(0), m_data(0), m_eof(false) {}
+
+    bool Is_EOF() const { return m_eof; }
+
+    char *Read_Line()
+    {
+        char *cb;
+
+        for (cb = m_line; cb != &m_line[INI::INI_MAX_CHARS_PER_LINE]; ++cb) {
+            if (m_readPos == m_data) {
+                m_readPos = 0;
+                m_data = int(std::min(m_text.size() - m_textPos, sizeof(m_buffer)));
+
+                if (m_data != 0) {
+                    memcpy(m_buffer, &m_text[m_textPos], m_data);
+                    m_textPos += m_data;
+                }
+
+                if (m_data == 0) {
+                    m_eof = true;
+                    break;
+                }
+            }
+
+            *cb = m_buffer[m_readPos++];
+
+            if (*cb == '\n') {
+                break;
+            }
+
+            if (*cb == ';') {
+                *cb = '\0';
+            } else if (*cb > '\0' && *cb < ' ') {
+                *cb = ' ';
+            }
+        }
+
+        *cb = '\0';
+
+        return m_line;
+    }
+
+private:
+    std::vector<char> const &m_text;
+    size_t m_textPos;
+    int m_readPos;
+    int m_data;
+    bool m_eof;
+    char m_buffer[INI::INI_BUFFER_SIZE];
+    char m_line[INI::INI_MAX_CHARS_PER_LINE + 1];
+};
+
+// Reads every line and token of every file, strtok and the copying reader against the in place buffer.
+uint32_t Tokenize_Legacy(std::vector<CorpusEntry> const &corpus)
+{
+    uint32_t hash = 0;
+
+    for (auto it = corpus.begin(); it != corpus.end(); ++it) {
+        LegacyReader reader(it->text);
+
+        while (!reader.Is_EOF()) {
+            for (char *token = strtok(reader.Read_Line(), SEPS); token != nullptr; token = strtok(nullptr, SEPS)) {
+                hash = Hash_Token(hash, token);
+            }
+        }
+    }
+
+    return hash;
+}
+
+uint32_t Tokenize_Buffer(std::vector<CorpusEntry> const &corpus)
+{
+    uint32_t hash = 0;
+    char overflow[INI::INI_MAX_CHARS_PER_LINE + 1];
+
+    for (auto it = corpus.begin(); it != corpus.end(); ++it) {
+        // The copy stands in for reading the file, which the old reader did as it went.
+        INIFileBuffer buffer;
+        char *data = new char[it->text.size()];
+        memcpy(data, it->text.data(), it->text.size());
+        buffer.Set_Data(data, int(it->text.size()));
+        bool end_of_file = false;
+
+        while (!end_of_file) {
+            char *next = nullptr;
+            char *line = buffer.Read_Line(overflow, INI::INI_MAX_CHARS_PER_LINE, end_of_file);
+
+            for (char *token = INIFileBuffer::Tokenize(line, SEPS, next); token != nullptr;
+                 token = INIFileBuffer::Tokenize(nullptr, SEPS, next)) {
+                hash = Hash_Token(hash, token);
+            }
+        }
+    }
+
+    return hash;
+}
+
+// The linear search Init_From_INI_Multi used before the hashed index.
+int Find_Linear(FieldTables const &tables, const char *token)
+{
+    for (size_t i = 0; i < tables.tables.size(); ++i) {
+        for (const FieldParse *field = tables.tables[i].data(); field->token != nullptr; ++field) {
+            if (strcmp(field->token, token) == 0) {
+                return int(i * FIELDS_PER_TABLE + (field - tables.tables[i].data()));
+            }
+        }
+    }
+
+    return -1;
+}
+
+int Find_Hashed(FieldTables const &tables, const INIParseIndex *const *indices, const char *token)
+{
+    uint32_t hash = INIParseIndex::Hash(token);
+
+    for (size_t i = 0; i < tables.tables.size(); ++i) {
+        int found = indices[i]->Find(token, hash);
+
+        if (found != -1) {
+            return int(i * FIELDS_PER_TABLE + found);
+        }
+    }
+
+    return -1;
+}
+
+bool Looks_Numeric(const char *token)
+{
+    return (*token >= '0' && *token <= '9') || *token == '-' || *token == '+' || *token == '.';
+}
+
+template<typename Func> double Time_Runs(int iterations, Func func)
+{
+    auto start = std::chrono::steady_clock::now();
+
+    for (int i = 0; i < iterations; ++i) {
+        func();
+    }
+
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+    return elapsed.count();
+}
+
+void Print_Result(const char *name, double before, double after, int iterations)
+{
+    printf("%-22s %10.2f %10.2f %8.2fx\n", name, before * 1000.0 / iterations, after * 1000.0 / iterations, before / after);
+}
+} // namespace
+
+int main(int argc, char **argv)
+{
+    if (argc < 2) {
+        printf("Usage: inibench <Data/INI directory> [iterations]\n");
+        return 1;
+    }
+
+    int iterations = argc > 2 ? std::max(atoi(argv[2]), 1) : 10;
+
+    captains_settings_t captains_settings = { 0 };
+    captains_settings.level = LOGLEVEL_WARN;
+    captains_settings.console = true;
+    captainslog_init(&captains_settings);
+
+    Init_Memory_Manager();
+    g_theLocalFileSystem = new Win32LocalFileSystem;
+    Utf8String dir = argv[1];
+
+    // The local file system expects directories to end with a separator.
+    if (dir.Is_Not_Empty() && !dir.Ends_With("/") && !dir.Ends_With("\\")) {
+        dir += "/";
+    }
+
+    std::set<Utf8String, rts::less_than_nocase<Utf8String>> file_list;
+    g_theLocalFileSystem->Get_File_List_In_Directory(dir, "", "*.ini", file_list, true);
+    std::vector<CorpusEntry> corpus;
+    double total_bytes = 0.0;
+
+    for (auto it = file_list.begin(); it != file_list.end(); ++it) {
+        File *file = g_theLocalFileSystem->Open_File(it->Str(), File::READ | File::BINARY);
+
+        if (file == nullptr) {
+            continue;
+        }
+
+        CorpusEntry entry;
+        entry.name = *it;
+        entry.text.resize(std::max(file->Size(), 0));
+
+        if (!entry.text.empty()) {
+            entry.text.resize(std::max(file->Read(&entry.text[0], int(entry.text.size())), 0));
+        }
+
+        file->Close();
+        total_bytes += entry.text.size();
+        corpus.push_back(entry);
+    }
+
+    if (corpus.empty()) {
+        printf("No INI files could be loaded from '%s'.\n", dir.Str());
+        return 1;
+    }
+
+    // Gather the first token of every line as field names and every number like token for the scan test.
+    std::vector<Utf8String> field_tokens;
+    std::vector<Utf8String> number_strings;
+    std::vector<bool> number_is_real;
+    FieldTables tables;
+    std::set<Utf8String> seen_fields;
+    int line_count = 0;
+
+    for (auto it = corpus.begin(); it != corpus.end(); ++it) {
+        LegacyReader reader(it->text);
+
+        while (!reader.Is_EOF()) {
+            char *token = strtok(reader.Read_Line(), SEPS);
+            ++line_count;
+
+            if (token == nullptr) {
+                continue;
+            }
+
+            field_tokens.push_back(token);
+
+            if (seen_fields.insert(token).second && int(tables.names.size()) < FIELDS_PER_TABLE * MAX_TABLES) {
+                tables.names.push_back(token);
+            }
+
+            for (token = strtok(nullptr, " \n\r\t=:%"); token != nullptr; token = strtok(nullptr, " \n\r\t=:%")) {
+                float real;
+
+                if (Looks_Numeric(token) && sscanf(token, "%f", &real) == 1) {
+                    number_strings.push_back(token);
+                    number_is_real.push_back(token[strspn(token, "+-0123456789")] != '\0');
+                }
+            }
+        }
+    }
+
+    for (size_t i = 0; i < tables.names.size(); i += FIELDS_PER_TABLE) {
+        std::vector<FieldParse> table;
+
+        for (size_t j = i; j < std::min(i + FIELDS_PER_TABLE, tables.names.size()); ++j) {
+            FieldParse field = { tables.names[j].Str(), nullptr, nullptr, 0 };
+            table.push_back(field);
+        }
+
+        FieldParse terminator = { nullptr, nullptr, nullptr, 0 };
+        table.push_back(terminator);
+        tables.tables.push_back(table);
+    }
+
+    const INIParseIndex *indices[MAX_TABLES];
+
+    for (size_t i = 0; i < tables.tables.size(); ++i) {
+        indices[i] = &INIParseIndex::Get(tables.tables[i].data());
+    }
+
+    int mismatches = 0;
+
+    if (Tokenize_Legacy(corpus) != Tokenize_Buffer(corpus)) {
+        printf("The tokenizers produced different tokens.\n");
+        ++mismatches;
+    }
+
+    for (auto it = field_tokens.begin(); it != field_tokens.end(); ++it) {
+        if (Find_Linear(tables, it->Str()) != Find_Hashed(tables, indices, it->Str())) {
+            printf("Field '%s' was found in a different place by the hashed lookup.\n", it->Str());
+            ++mismatches;
+        }
+    }
+
+    for (size_t i = 0; i < number_strings.size(); ++i) {
+        const char *token = number_strings[i].Str();
+        float real;
+        int integer = 0;
+        sscanf(token, "%f", &real);
+
+        if (INI::Scan_Real(token) != real
+            || (!number_is_real[i] && sscanf(token, "%d", &integer) == 1 && INI::Scan_Int(token) != integer)) {
+            printf("Number '%s' scanned differently from sscanf.\n", token);
+            ++mismatches;
+        }
+    }
+
+    volatile uint32_t sink = 0;
+
+    double tokenize_before = Time_Runs(iterations, [&]() { sink += Tokenize_Legacy(corpus); });
+    double tokenize_after = Time_Runs(iterations, [&]() { sink += Tokenize_Buffer(corpus); });
+
+    double lookup_before = Time_Runs(iterations, [&]() {
+        for (auto it = field_tokens.begin(); it != field_tokens.end(); ++it) {
+            sink += Find_Linear(tables, it->Str());
+        }
+    });
+    double lookup_after = Time_Runs(iterations, [&]() {
+        for (auto it = field_tokens.begin(); it != field_tokens.end(); ++it) {
+            sink += Find_Hashed(tables, indices, it->Str());
+        }
+    });
+
+    double scan_before = Time_Runs(iterations, [&]() {
+        for (size_t i = 0; i < number_strings.size(); ++i) {
+            float real;
+            int integer;
+
+            if (number_is_real[i]) {
+                sscanf(number_strings[i].Str(), "%f", &real);
+                sink += int(real);
+            } else {
+                sscanf(number_strings[i].Str(), "%d", &integer);
+                sink += integer;
+            }
+        }
+    });
+    double scan_after = Time_Runs(iterations, [&]() {
+        for (size_t i = 0; i < number_strings.size(); ++i) {
+            if (number_is_real[i]) {
+                sink += int(INI::Scan_Real(number_strings[i].Str()));
+            } else {
+                sink += INI::Scan_Int(number_strings[i].Str());
+            }
+        }
+    });
+
+    printf("%u files, %.1f MB, %d lines, %u field names in %u tables, %u numbers, %d times.\n",
+        unsigned(corpus.size()),
+        total_bytes / (1024.0 * 1024.0),
+        line_count,
+        unsigned(tables.names.size()),
+        unsigned(tables.tables.size()),
+        unsigned(number_strings.size()),
+        iterations);
+    printf("%-22s %10s %10s %9s\n", "Test", "Before (ms)", "After (ms)", "Speedup");
+    Print_Result("Read and tokenize", tokenize_before, tokenize_after, iterations);
+    Print_Result("Field lookup", lookup_before, lookup_after, iterations);
+    Print_Result("Number scanning", scan_before, scan_after, iterations);
+    Print_Result("Total",
+        tokenize_before + lookup_before + scan_before,
+        tokenize_after + lookup_after + scan_after,
+        iterations);
+
+    return mismatches == 0 ? 0 : 1;
+}
@@ -0,0 +1,193 @@
+/**
+ * @file
+ *
+ * @author OmniBlade
+ *
+ * @brief Benchmark for memory pool allocation with several threads contending on the pools. (Thyme Feature)
+ *
+ * @copyright Thyme is free software: you can redistribute it and/or
+ *            modify it under the terms of the GNU General Public License
+ *            as published by the Free Software Foundation, either version
+ *            2 of the License, or (at your option) any later version.
+ *            A full copy of the GNU General Public License can be found in
+ *            LICENSE
+ */
+#include "always.h"
+#include "critsection.h"
+#include "gamememory.h"
+#include "memdynalloc.h"
+#include "mempool.h"
+#include "mempoolfact.h"
+#include <captainslog.h>
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <thread>
+#include <vector>
+
+#ifdef PLATFORM_WINDOWS
+#include <windows.h>
+HWND g_applicationHWnd;
+unsigned g_theMessageTime = 0;
+bool g_gameIsWindowed;
+bool g_gameNotFullscreen;
+bool g_creatingWindow;
+HGDIOBJ g_splashImage;
+HINSTANCE g_applicationHInstance;
+#endif
+
+namespace
+{
+// Blocks each thread keeps alive at once, enough that frees don't just return the block allocated right before.
+const int LIVE_BLOCKS = 256;
+
+// Mix of sizes roughly like the game's small allocations, mostly strings and message arguments.
+const int DMA_SIZES[] = { 8, 12, 16, 24, 32, 40, 48, 64, 80, 96, 128, 160, 200, 256 };
+
+struct BenchResult
+{
+    double seconds;
+    long long ops;
+};
+
+uint32_t Next_Random(uint32_t &state)
+{
+    state = state * 1664525 + 1013904223;
+    return state >> 8;
+}
+
+// Randomly allocates and frees so the live set churns without growing. DMA calls can be made under the allocator's lock
+// the way it used to take it for every call.
+void Run_Thread(MemoryPool *pool, bool dma_lock, int ops, uint32_t seed)
+{
+    std::vector<void *> live(LIVE_BLOCKS, nullptr);
+    uint32_t state = seed;
+
+    for (int i = 0; i < ops; ++i) {
+        void *&slot = live[Next_Random(state) % LIVE_BLOCKS];
+
+        if (pool != nullptr) {
+            if (slot != nullptr) {
+                pool->Free_Block(slot);
+                slot = nullptr;
+            } else {
+                slot = pool->Allocate_Block_No_Zero();
+            }
+        } else {
+            ScopedCriticalSectionClass cs(dma_lock ? g_dmaCriticalSection : nullptr);
+
+            if (slot != nullptr) {
+                g_dynamicMemoryAllocator->Free_Bytes(slot);
+                slot = nullptr;
+            } else {
+                slot = g_dynamicMemoryAllocator->Allocate_Bytes_No_Zero(
+                    DMA_SIZES[Next_Random(state) % ARRAY_SIZE(DMA_SIZES)]);
+            }
+        }
+    }
+
+    for (auto it = live.begin(); it != live.end(); ++it) {
+        if (*it != nullptr) {
+            if (pool != nullptr) {
+                pool->Free_Block(*it);
+            } else {
+                g_dynamicMemoryAllocator->Free_Bytes(*it);
+            }
+        }
+    }
+}
+
+BenchResult Run_Bench(MemoryPool *pool, int thread_count, int ops_per_thread, bool dma_lock = false)
+{
+    std::vector<std::thread> threads;
+    auto start = std::chrono::high_resolution_clock::now();
+
+    for (int i = 0; i < thread_count; ++i) {
+        threads.push_back(std::thread(Run_Thread, pool, dma_lock, ops_per_thread, uint32_t(i * 7919 + 1)));
+    }
+
+    for (auto it = threads.begin(); it != threads.end(); ++it) {
+        it->join();
+    }
+
+    auto end = std::chrono::high_resolution_clock::now();
+    BenchResult result;
+    result.seconds = std::chrono::duration<double>(end - start).count();
+    result.ops = (long long)thread_count * ops_per_thread;
+
+    return result;
+}
+
+void Print_Row(const char *name, int thread_count, BenchResult const &before, BenchResult const &after)
+{
+    double before_ns = before.seconds * 1e9 / before.ops;
+    double after_ns = after.seconds * 1e9 / after.ops;
+    printf("%-8s %7d %14.1f %14.1f %8.2fx\n", name, thread_count, before_ns, after_ns, before_ns / after_ns);
+}
+} // namespace
+
+int main(int argc, char **argv)
+{
+    int max_threads = argc > 1 ? std::max(atoi(argv[1]), 1) : std::max(int(std::thread::hardware_concurrency()), 1);
+    int ops = argc > 2 ? std::max(atoi(argv[2]), 1) : 2000000;
+
+    captains_settings_t captains_settings = { 0 };
+    captains_settings.level = LOGLEVEL_WARN;
+    captains_settings.console = true;
+    captainslog_init(&captains_settings);
+
+    // The pools only lock when the game has handed them a critical section, as it does before starting its threads.
+    SimpleCriticalSectionClass pool_lock;
+    SimpleCriticalSectionClass dma_lock;
+    g_memoryPoolCriticalSection = &pool_lock;
+    g_dmaCriticalSection = &dma_lock;
+    Init_Memory_Manager();
+
+    MemoryPool *pool = g_memoryPoolFactory->Create_Memory_Pool("PoolBench", 64, 1024, 1024);
+    int failures = 0;
+
+    printf("%d operations per thread, times are per allocation or free.\n", ops);
+    printf("%-8s %7s %14s %14s %9s\n", "Target", "Threads", "Locked (ns)", "Cached (ns)", "Speedup");
+
+    for (int target = 0; target < 2; ++target) {
+        MemoryPool *bench_pool = target == 0 ? pool : nullptr;
+
+        for (int threads = 1; threads <= max_threads; threads *= 2) {
+            MemoryPool::Set_Thread_Caching(false);
+            BenchResult locked = Run_Bench(bench_pool, threads, ops);
+            MemoryPool::Set_Thread_Caching(true);
+            BenchResult cached = Run_Bench(bench_pool, threads, ops);
+            Print_Row(target == 0 ? "Pool" : "DMA", threads, locked, cached);
+        }
+    }
+
+    // The DMA used to hold its lock for every call, pool backed ones included, so its calls were serialised even with
+    // the thread caches.
+    printf("\n%-8s %7s %14s %14s %9s\n", "Target", "Threads", "DMA lock (ns)", "No lock (ns)", "Speedup");
+
+    for (int threads = 1; threads <= max_threads; threads *= 2) {
+        BenchResult locked = Run_Bench(nullptr, threads, ops, true);
+        BenchResult unlocked = Run_Bench(nullptr, threads, ops);
+        Print_Row("DMA", threads, locked, unlocked);
+    }
+
+    // Every thread freed what it allocated and flushed its cache on exit.
+    if (pool->Get_Used_Blocks() != 0) {
+        printf("Pool still has %d blocks in use.\n", pool->Get_Used_Blocks());
+        ++failures;
+    }
+
+    if (g_dynamicMemoryAllocator->Get_Used_Blocks() != 0) {
+        printf("DMA still has %d blocks in use.\n", g_dynamicMemoryAllocator->Get_Used_Blocks());
+        ++failures;
+    }
+
+    printf("Pool peak %d blocks in use, %d blocks allocated.\n", pool->Get_Peak_Used_Blocks(), pool->Get_Total_Blocks());
+
+    g_memoryPoolFactory->Destroy_Memory_Pool(pool);
+    g_memoryPoolCriticalSection = nullptr;
+    g_dmaCriticalSection = nullptr;
+
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,363 @@
+/**
+ * @file
+ *
+ * @author OmniBlade
+ *
+ * @brief Benchmark for RefPack decoding and compression levels against LZ4 over a corpus of files. (Thyme Feature)
+ *
+ * @copyright Thyme is free software: you can redistribute it and/or
+ *            modify it under the terms of the GNU General Public License
+ *            as published by the Free Software Foundation, either version
+ *            2 of the License, or (at your option) any later version.
+ *            A full copy of the GNU General Public License can be found in
+ *            LICENSE
+ */
+#include "always.h"
+#include "compressionmanager.h"
+#include "file.h"
+#include "gamememory.h"
+#include "lz4block.h"
+#include "refpack.h"
+#include "win32localfilesystem.h"
+#include "workerpool.h"
+#include <captainslog.h>
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <set>
+#include <vector>
+
+#ifdef PLATFORM_WINDOWS
+#include <windows.h>
+HWND g_applicationHWnd;
+unsigned g_theMessageTime = 0;
+bool g_gameIsWindowed;
+bool g_gameNotFullscreen;
+bool g_creatingWindow;
+HGDIOBJ g_splashImage;
+HINSTANCE g_applicationHInstance;
+#endif
+
+namespace
+{
+struct CorpusEntry
+{
+    Utf8String name;
+    std::vector<uint8_t> packed; // RefPack stream without the "EAR" header.
+    std::vector<uint8_t> plain;
+    int size;
+};
+
+struct CompressLevel
+{
+    const char *name;
+    int search_depth;
+    int thread_count;
+};
+
+// The byte at a time decoder RefPack_Uncompress used before, kept to check the output and compare speed against.
+int Reference_Uncompress(void *dst, const void *src)
+{
+    const uint8_t *getp = static_cast<const uint8_t *>(src);
+    uint8_t *putp = static_cast<uint8_t *>(dst);
+    uint8_t *ref;
+    uint32_t run;
+    uint16_t flags = (getp[0] << 8) | getp[1];
+    int out_length;
+    getp += 2;
+
+    if (flags & 0x8000) {
+        getp += (flags & 0x0100) ? 6 : 0;
+        out_length = (getp[0] << 24) | (getp[1] << 16) | (getp[2] << 8) | getp[3];
+        getp += 4;
+    } else {
+        getp += (flags & 0x0100) ? 5 : 0;
+        out_length = (getp[0] << 16) | (getp[1] << 8) | getp[2];
+        getp += 3;
+    }
+
+    while (true) {
+        uint8_t first = *getp++;
+
+        if (!(first & 0x80)) {
+            uint8_t second = *getp++;
+            run = first & 3;
+
+            while (run--) {
+                *putp++ = *getp++;
+            }
+
+            ref = putp - 1 - (((first & 0x60) << 3) + second);
+            run = ((first & 0x1c) >> 2) + 3 - 1;
+
+            do {
+                *putp++ = *ref++;
+            } while (run--);
+        } else if (!(first & 0x40)) {
+            uint8_t second = *getp++;
+            uint8_t third = *getp++;
+            run = second >> 6;
+
+            while (run--) {
+                *putp++ = *getp++;
+            }
+
+            ref = putp - 1 - (((second & 0x3f) << 8) + third);
+            run = (first & 0x3f) + 4 - 1;
+
+            do {
+                *putp++ = *ref++;
+            } while (run--);
+        } else if (!(first & 0x20)) {
+            uint8_t second = *getp++;
+            uint8_t third = *getp++;
+            uint8_t forth = *getp++;
+            run = first & 3;
+
+            while (run--) {
+                *putp++ = *getp++;
+            }
+
+            ref = putp - 1 - (((first & 0x10) >> 4 << 16) + (second << 8) + third);
+            run = ((first & 0x0c) >> 2 << 8) + forth + 5 - 1;
+
+            do {
+                *putp++ = *ref++;
+            } while (run--);
+        } else {
+            run = ((first & 0x1f) << 2) + 4;
+
+            if (run > 112) {
+                run = first & 3;
+
+                while (run--) {
+                    *putp++ = *getp++;
+                }
+
+                break;
+            }
+
+            while (run--) {
+                *putp++ = *getp++;
+            }
+        }
+    }
+
+    return out_length;
+}
+
+// Reads a file into the corpus, files that aren't already RefPack compressed are compressed so any set of files works.
+bool Load_Entry(const char *filename, CorpusEntry &entry)
+{
+    File *file = g_theLocalFileSystem->Open_File(filename, File::READ | File::BINARY);
+
+    if (file == nullptr) {
+        return false;
+    }
+
+    int size = file->Size();
+    uint8_t *data = static_cast<uint8_t *>(file->Read_Entire_And_Close());
+
+    if (size <= 0) {
+        delete[] data;
+        return false;
+    }
+
+    entry.name = filename;
+
+    if (CompressionManager::Get_Compression_Type(data, size) == COMPRESSION_EAR) {
+        entry.size = CompressionManager::Get_Uncompressed_Size(data, size);
+        entry.packed.assign(data + 8, data + size);
+    } else {
+        entry.size = size;
+        entry.packed.resize(size + size / 2 + 64);
+        entry.packed.resize(RefPack_Compress(&entry.packed[0], data, size, false));
+    }
+
+    delete[] data;
+
+    if (entry.size <= 0) {
+        return false;
+    }
+
+    entry.plain.resize(entry.size);
+    RefPack_Uncompress(&entry.plain[0], &entry.packed[0], nullptr);
+
+    return true;
+}
+
+template<typename Func> double Time_Corpus(std::vector<CorpusEntry> const &corpus, int iterations, Func func)
+{
+    auto start = std::chrono::steady_clock::now();
+
+    for (int i = 0; i < iterations; ++i) {
+        for (auto it = corpus.begin(); it != corpus.end(); ++it) {
+            func(*it);
+        }
+    }
+
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+    return elapsed.count();
+}
+} // namespace
+
+int main(int argc, char **argv)
+{
+    if (argc < 2) {
+        printf("Usage: refpackbench <directory containing .map files> [iterations] [filter]\n");
+        return 1;
+    }
+
+    int iterations = argc > 2 ? std::max(atoi(argv[2]), 1) : 10;
+    const char *filter = argc > 3 ? argv[3] : "*.map";
+
+    captains_settings_t captains_settings = { 0 };
+    captains_settings.level = LOGLEVEL_WARN;
+    captains_settings.console = true;
+    captainslog_init(&captains_settings);
+
+    Init_Memory_Manager();
+    g_theLocalFileSystem = new Win32LocalFileSystem;
+    Utf8String dir = argv[1];
+
+    // The local file system expects directories to end with a separator.
+    if (dir.Is_Not_Empty() && !dir.Ends_With("/") && !dir.Ends_With("\\")) {
+        dir += "/";
+    }
+
+    std::set<Utf8String, rts::less_than_nocase<Utf8String>> file_list;
+    g_theLocalFileSystem->Get_File_List_In_Directory(dir, "", filter, file_list, true);
+    std::vector<CorpusEntry> corpus;
+    int max_size = 0;
+    double total_bytes = 0.0;
+    double packed_bytes = 0.0;
+
+    for (auto it = file_list.begin(); it != file_list.end(); ++it) {
+        CorpusEntry entry;
+
+        if (Load_Entry(it->Str(), entry)) {
+            max_size = std::max(max_size, entry.size);
+            total_bytes += entry.size;
+            packed_bytes += entry.packed.size();
+            corpus.push_back(entry);
+        }
+    }
+
+    if (corpus.empty()) {
+        printf("No files matching '%s' could be loaded from '%s'.\n", filter, dir.Str());
+        return 1;
+    }
+
+    std::vector<uint8_t> expected(max_size);
+    std::vector<uint8_t> decoded(max_size);
+    int mismatches = 0;
+
+    for (auto it = corpus.begin(); it != corpus.end(); ++it) {
+        Reference_Uncompress(&expected[0], &it->packed[0]);
+
+        if (RefPack_Uncompress(&decoded[0], &it->packed[0], nullptr) != it->size
+            || memcmp(&expected[0], &decoded[0], it->size) != 0) {
+            printf("Decoded output differs for '%s'.\n", it->name.Str());
+            ++mismatches;
+        }
+    }
+
+    double reference_time = Time_Corpus(
+        corpus, iterations, [&](CorpusEntry const &entry) { Reference_Uncompress(&decoded[0], &entry.packed[0]); });
+    double decoder_time = Time_Corpus(
+        corpus, iterations, [&](CorpusEntry const &entry) { RefPack_Uncompress(&decoded[0], &entry.packed[0], nullptr); });
+
+    double megabytes = total_bytes * iterations / (1024.0 * 1024.0);
+    printf("Decoded %u files, %.1f MB from %.1f MB packed, %d times.\n",
+        unsigned(corpus.size()),
+        total_bytes / (1024.0 * 1024.0),
+        packed_bytes / (1024.0 * 1024.0),
+        iterations);
+    printf("Byte at a time:     %8.1f MB/s\n", megabytes / reference_time);
+    printf("RefPack_Uncompress: %8.1f MB/s (%.2fx)\n", megabytes / decoder_time, reference_time / decoder_time);
+
+    // Compression levels, every result is decoded again to make sure it is still a valid stream.
+    int threads = Thyme::WorkerPool::Get_Default_Thread_Count() + 1;
+    const CompressLevel levels[] = {
+        { "depth 1", 1, 1 },
+        { "depth 4", 4, 1 },
+        { "depth 16", 16, 1 },
+        { "depth 64", 64, 1 },
+        { "unlimited", 0, 1 },
+        { "depth 16 mt", 16, threads },
+        { "unlimited mt", 0, threads },
+    };
+
+    printf("\nLevel           Ratio      MB/s\n");
+
+    for (size_t i = 0; i < sizeof(levels) / sizeof(levels[0]); ++i) {
+        CompressLevel const &level = levels[i];
+        std::vector<uint8_t> packed(RefPack_Compress_Bound(max_size));
+        double level_bytes = 0.0;
+
+        double compress_time = Time_Corpus(corpus, 1, [&](CorpusEntry const &entry) {
+            level_bytes += RefPack_Compress_Level(
+                &packed[0], &entry.plain[0], entry.size, level.search_depth, level.thread_count);
+        });
+
+        for (auto it = corpus.begin(); it != corpus.end(); ++it) {
+            RefPack_Compress_Level(&packed[0], &it->plain[0], it->size, level.search_depth, level.thread_count);
+
+            if (RefPack_Uncompress(&decoded[0], &packed[0], nullptr) != it->size
+                || memcmp(&decoded[0], &it->plain[0], it->size) != 0) {
+                printf("Round trip failed for '%s' at %s.\n", it->name.Str(), level.name);
+                ++mismatches;
+            }
+        }
+
+        double ratio = level_bytes / total_bytes;
+        printf("%-14s %6.3f %9.1f\n", level.name, ratio, total_bytes / (1024.0 * 1024.0) / compress_time);
+    }
+
+    // Same corpus through the LZ4 block codec CompressionManager offers as an alternative.
+    const int lz4_levels[] = { LZ4_BLOCK_LEVEL_FAST, 4, LZ4_BLOCK_LEVEL_DEFAULT, LZ4_BLOCK_LEVEL_MAX };
+
+    printf("\nLZ4 level       Ratio      MB/s  Decode MB/s\n");
+
+    for (size_t i = 0; i < sizeof(lz4_levels) / sizeof(lz4_levels[0]); ++i) {
+        std::vector<std::vector<uint8_t>> packed(corpus.size());
+        double level_bytes = 0.0;
+        size_t index = 0;
+
+        double compress_time = Time_Corpus(corpus, 1, [&](CorpusEntry const &entry) {
+            std::vector<uint8_t> &block = packed[index++];
+            block.resize(LZ4_Block_Compress_Bound(entry.size));
+            block.resize(LZ4_Block_Compress(&block[0], &entry.plain[0], entry.size, int(block.size()), lz4_levels[i]));
+            level_bytes += block.size();
+        });
+
+        for (index = 0; index < corpus.size(); ++index) {
+            if (LZ4_Block_Uncompress(&decoded[0], &packed[index][0], int(packed[index].size()), max_size)
+                    != corpus[index].size
+                || memcmp(&decoded[0], &corpus[index].plain[0], corpus[index].size) != 0) {
+                printf("Round trip failed for '%s' at LZ4 level %d.\n", corpus[index].name.Str(), lz4_levels[i]);
+                ++mismatches;
+            }
+        }
+
+        index = 0;
+        double decode_time = Time_Corpus(corpus, iterations, [&](CorpusEntry const &entry) {
+            std::vector<uint8_t> const &block = packed[index++ % corpus.size()];
+            LZ4_Block_Uncompress(&decoded[0], &block[0], int(block.size()), max_size);
+        });
+
+        printf("%-14d %6.3f %9.1f %12.1f\n",
+            lz4_levels[i],
+            level_bytes / total_bytes,
+            total_bytes / (1024.0 * 1024.0) / compress_time,
+            megabytes / decode_time);
+    }
+
+    delete g_theLocalFileSystem;
+    g_theLocalFileSystem = nullptr;
+
+    return mismatches == 0 ? 0 : 1;
+}
@@ -0,0 +1,258 @@
+/**
+ * @file
+ *
+ * @author OmniBlade
+ *
+ * @brief Double buffered linear allocator for data that only lives for a frame or two. (Thyme Feature)
+ *
+ * @copyright Thyme is free software: you can redistribute it and/or
+ *            modify it under the terms of the GNU General Public License
+ *            as published by the Free Software Foundation, either version
+ *            2 of the License, or (at your option) any later version.
+ *            A full copy of the GNU General Public License can be found in
+ *            LICENSE
+ */
+#include "framearena.h"
+#include "thread.h"
+#include <algorithm>
+#include <captainslog.h>
+#include <cstring>
+
+FrameArena *g_theFrameArena = nullptr;
+
+namespace
+{
+int Round_Up_Alignment(int bytes)
+{
+    return (bytes + FrameArena::ALIGNMENT - 1) & ~(FrameArena::ALIGNMENT - 1);
+}
+} // namespace
+
+FrameArena::FrameArena(int chunk_size) :
+    m_spareChunks(nullptr),
+    m_current(0),
+    m_chunkSize(Round_Up_Alignment(chunk_size)),
+    m_ownerThread(ThreadClass::Get_Current_Thread_ID()),
+    m_frame(0),
+    m_peakBytes(0),
+    m_releasingAll(false),
+    m_resetCallbackCount(0)
+{
+    memset(m_buffers, 0, sizeof(m_buffers));
+    memset(&m_scratch, 0, sizeof(m_scratch));
+    memset(m_resetCallbacks, 0, sizeof(m_resetCallbacks));
+}
+
+FrameArena::~FrameArena()
+{
+    // Give long lived users a last chance to copy out of both buffers.
+    m_releasingAll = true;
+
+    for (int i = 0; i < m_resetCallbackCount; ++i) {
+        m_resetCallbacks[i](*this);
+    }
+
+    Free_Chunk_List(m_buffers[0].chunks);
+    Free_Chunk_List(m_buffers[1].chunks);
+    Free_Chunk_List(m_scratch.chunks);
+    Free_Chunk_List(m_spareChunks);
+}
+
+/**
+ * Returns memory aligned to ALIGNMENT, or nullptr when called from a thread other than the one that created the arena.
+ */
+void *FrameArena::Allocate(int bytes)
+{
+    if (!Is_Owner_Thread()) {
+        return nullptr;
+    }
+
+    return Allocate_From(m_buffers[m_current], bytes);
+}
+
+/**
+ * Allocates from the scratch stack, only valid until the FrameArenaScope open at the time ends.
+ */
+void *FrameArena::Allocate_Scratch(int bytes)
+{
+    if (!Is_Owner_Thread()) {
+        return nullptr;
+    }
+
+    return Allocate_From(m_scratch, bytes);
+}
+
+/**
+ * Whether the pointer came from Allocate, scratch memory isn't included.
+ */
+bool FrameArena::Owns(void const *ptr) const
+{
+    return Buffer_Owns(m_buffers[0], ptr) || Buffer_Owns(m_buffers[1], ptr);
+}
+
+/**
+ * Whether the pointer is in the buffer the next Begin_Frame will reuse, reset callbacks use this to find what to copy.
+ */
+bool FrameArena::Is_Expiring(void const *ptr) const
+{
+    return m_releasingAll ? Owns(ptr) : Buffer_Owns(m_buffers[m_current ^ 1], ptr);
+}
+
+bool FrameArena::Is_Owner_Thread() const
+{
+    return ThreadClass::Get_Current_Thread_ID() == m_ownerThread;
+}
+
+/**
+ * Frees everything allocated two frames ago. Call once per frame from the thread that owns the arena.
+ */
+void FrameArena::Begin_Frame()
+{
+    for (int i = 0; i < m_resetCallbackCount; ++i) {
+        m_resetCallbacks[i](*this);
+    }
+
+    m_current ^= 1;
+    Reset_Buffer(m_buffers[m_current]);
+    ++m_frame;
+
+    // Scopes end within the function that opened them, one still open here would have its memory freed under it.
+    captainslog_dbgassert(m_scratch.used == 0, "Frame arena scope still open at the start of a frame.");
+
+    if (m_scratch.used == 0) {
+        Reset_Buffer(m_scratch);
+    }
+}
+
+FrameArena::Mark FrameArena::Get_Mark() const
+{
+    Buffer const &buffer = m_scratch;
+    Mark mark;
+    mark.chunk = buffer.chunks;
+    mark.top = buffer.top;
+    mark.used = buffer.used;
+
+    return mark;
+}
+
+/**
+ * Releases everything allocated after the mark, chunks added since are kept aside for the next allocation that needs one.
+ */
+void FrameArena::Release_To_Mark(Mark const &mark)
+{
+    Buffer &buffer = m_scratch;
+
+    while (buffer.chunks != mark.chunk && buffer.chunks != nullptr) {
+        Chunk *chunk = buffer.chunks;
+        buffer.chunks = chunk->next;
+        chunk->next = m_spareChunks;
+        m_spareChunks = chunk;
+    }
+
+    if (buffer.chunks != nullptr) {
+        buffer.top = mark.top;
+        buffer.end = Chunk_Data(buffer.chunks) + buffer.chunks->size;
+    } else {
+        buffer.top = nullptr;
+        buffer.end = nullptr;
+    }
+
+    buffer.used = mark.used;
+}
+
+void FrameArena::Add_Reset_Callback(resetcallback_t callback)
+{
+    captainslog_relassert(m_resetCallbackCount < MAX_RESET_CALLBACKS, 0xDEAD0002, "Too many frame arena callbacks.");
+    m_resetCallbacks[m_resetCallbackCount++] = callback;
+}
+
+char *FrameArena::Chunk_Data(Chunk *chunk)
+{
+    return reinterpret_cast<char *>(chunk) + Round_Up_Alignment(sizeof(Chunk));
+}
+
+bool FrameArena::Buffer_Owns(Buffer const &buffer, void const *ptr)
+{
+    for (Chunk *chunk = buffer.chunks; chunk != nullptr; chunk = chunk->next) {
+        char const *data = Chunk_Data(chunk);
+
+        if (ptr >= data && ptr < data + chunk->size) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+void FrameArena::Free_Chunk_List(Chunk *chunk)
+{
+    while (chunk != nullptr) {
+        Chunk *next = chunk->next;
+        delete[] chunk->allocation;
+        chunk = next;
+    }
+}
+
+void *FrameArena::Allocate_From(Buffer &buffer, int bytes)
+{
+    bytes = Round_Up_Alignment(std::max(bytes, 1));
+
+    if (buffer.end - buffer.top < bytes) {
+        Add_Chunk(buffer, bytes);
+    }
+
+    char *block = buffer.top;
+    buffer.top += bytes;
+    buffer.used += bytes;
+    buffer.peak = std::max(buffer.peak, buffer.used);
+    m_peakBytes = std::max(m_peakBytes, m_buffers[m_current].used + m_scratch.used);
+
+    return block;
+}
+
+void FrameArena::Add_Chunk(Buffer &buffer, int min_bytes)
+{
+    Chunk *chunk = nullptr;
+
+    for (Chunk **spare = &m_spareChunks; *spare != nullptr; spare = &(*spare)->next) {
+        if ((*spare)->size >= min_bytes) {
+            chunk = *spare;
+            *spare = chunk->next;
+            break;
+        }
+    }
+
+    if (chunk == nullptr) {
+        int size = std::max(m_chunkSize, min_bytes);
+        char *allocation = new char[Round_Up_Alignment(sizeof(Chunk)) + size + ALIGNMENT];
+        chunk = reinterpret_cast<Chunk *>(
+            (reinterpret_cast<uintptr_t>(allocation) + ALIGNMENT - 1) & ~uintptr_t(ALIGNMENT - 1));
+        chunk->allocation = allocation;
+        chunk->size = size;
+    }
+
+    chunk->next = buffer.chunks;
+    buffer.chunks = chunk;
+    buffer.top = Chunk_Data(chunk);
+    buffer.end = buffer.top + chunk->size;
+}
+
+/**
+ * A buffer that needed more than one chunk is replaced by a single one big enough for its peak, so after the first few
+ * frames the arena stops allocating at all.
+ */
+void FrameArena::Reset_Buffer(Buffer &buffer)
+{
+    if (buffer.chunks != nullptr && (buffer.chunks->next != nullptr || m_spareChunks != nullptr)) {
+        m_chunkSize = std::max(m_chunkSize, Round_Up_Alignment(buffer.peak + buffer.peak / 4));
+        Free_Chunk_List(buffer.chunks);
+        Free_Chunk_List(m_spareChunks);
+        buffer.chunks = nullptr;
+        m_spareChunks = nullptr;
+    }
+
+    buffer.top = buffer.chunks != nullptr ? Chunk_Data(buffer.chunks) : nullptr;
+    buffer.end = buffer.chunks != nullptr ? buffer.top + buffer.chunks->size : nullptr;
+    buffer.used = 0;
+    buffer.peak = 0;
+}
@@ -0,0 +1,130 @@
+/**
+ * @file
+ *
+ * @author OmniBlade
+ *
+ * @brief Double buffered linear allocator for data that only lives for a frame or two. (Thyme Feature)
+ *
+ * @copyright Thyme is free software: you can redistribute it and/or
+ *            modify it under the terms of the GNU General Public License
+ *            as published by the Free Software Foundation, either version
+ *            2 of the License, or (at your option) any later version.
+ *            A full copy of the GNU General Public License can be found in
+ *            LICENSE
+ */
+#pragma once
+
+#include "always.h"
+
+// Bump allocates from one of two buffers and frees everything in a buffer at once. Memory allocated during a frame stays
+// valid until the end of the next frame, Begin_Frame then reuses its buffer. Users that can hold on to an allocation for
+// longer register a callback to copy it out of the expiring buffer. Only the thread that created the arena can allocate,
+// Allocate returns nullptr on other threads and callers fall back to their usual allocator. Scratch memory for use within
+// a function comes from a separate stack through FrameArenaScope, so closing a scope never takes back frame memory that
+// was allocated while it was open.
+class FrameArena
+{
+public:
+    enum
+    {
+        ALIGNMENT = 16,
+        DEFAULT_CHUNK_SIZE = 256 * 1024,
+        MAX_RESET_CALLBACKS = 8,
+    };
+
+    typedef void (*resetcallback_t)(FrameArena &arena);
+
+    // Position in the scratch stack, scratch allocations made after it are released together.
+    struct Mark
+    {
+        void *chunk;
+        char *top;
+        int used;
+    };
+
+    FrameArena(int chunk_size = DEFAULT_CHUNK_SIZE);
+    ~FrameArena();
+
+    void *Allocate(int bytes);
+    template<typename T> T *Allocate_Array(int count) { return static_cast<T *>(Allocate(int(sizeof(T)) * count)); }
+    void *Allocate_Scratch(int bytes);
+    bool Owns(void const *ptr) const;
+    bool Is_Expiring(void const *ptr) const;
+    bool Is_Owner_Thread() const;
+
+    void Begin_Frame();
+    Mark Get_Mark() const;
+    void Release_To_Mark(Mark const &mark);
+    void Add_Reset_Callback(resetcallback_t callback);
+
+    unsigned Get_Frame() const { return m_frame; }
+    int Get_Used_Bytes() const { return m_buffers[m_current].used; }
+    int Get_Scratch_Bytes() const { return m_scratch.used; }
+    int Get_Peak_Bytes() const { return m_peakBytes; }
+
+private:
+    struct Chunk
+    {
+        Chunk *next; // Older chunk of the same buffer.
+        char *allocation; // Chunks are aligned within the allocation.
+        int size;
+    };
+
+    struct Buffer
+    {
+        Chunk *chunks; // Newest first, allocations come from the head.
+        char *top;
+        char *end;
+        int used;
+        int peak;
+    };
+
+    static char *Chunk_Data(Chunk *chunk);
+    static bool Buffer_Owns(Buffer const &buffer, void const *ptr);
+    static void Free_Chunk_List(Chunk *chunk);
+    void *Allocate_From(Buffer &buffer, int bytes);
+    void Add_Chunk(Buffer &buffer, int min_bytes);
+    void Reset_Buffer(Buffer &buffer);
+
+    Buffer m_buffers[2];
+    Buffer m_scratch; // Stack for scopes, empty whenever no scope is open.
+    Chunk *m_spareChunks; // Released by scopes during the frame, reused before allocating another.
+    int m_current;
+    int m_chunkSize;
+    int m_ownerThread;
+    unsigned m_frame;
+    int m_peakBytes;
+    bool m_releasingAll; // Everything counts as expiring while the arena is destroyed.
+    resetcallback_t m_resetCallbacks[MAX_RESET_CALLBACKS];
+    int m_resetCallbackCount;
+};
+
+// Hands back everything allocated from the arena in a scope when it ends, for scratch buffers used within a function.
+class FrameArenaScope
+{
+public:
+    FrameArenaScope(FrameArena *arena) : m_arena(arena != nullptr && arena->Is_Owner_Thread() ? arena : nullptr)
+    {
+        if (m_arena != nullptr) {
+            m_mark = m_arena->Get_Mark();
+        }
+    }
+
+    ~FrameArenaScope()
+    {
+        if (m_arena != nullptr) {
+            m_arena->Release_To_Mark(m_mark);
+        }
+    }
+
+    template<typename T> T *Allocate_Array(int count)
+    {
+        return m_arena != nullptr ? static_cast<T *>(m_arena->Allocate_Scratch(int(sizeof(T)) * count)) : nullptr;
+    }
+
+private:
+    FrameArena *m_arena;
+    FrameArena::Mark m_mark;
+};
+
+extern FrameArena *g_theFrameArena;
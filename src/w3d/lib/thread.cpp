@@ -89,9 +89,8 @@ void *ThreadClass::Internal_Thread_Function(void *params)
 void ThreadClass::Internal_Thread_Function(void *params)
 #endif
 {
-    // Set is running true and call the virtual thread function. Function should
-    // check for m_isRunning in its loop and finish if set false;
-    static_cast<ThreadClass *>(params)->m_isRunning = true;
+    // Call the virtual thread function. Function should check for m_isRunning
+    // in its loop and finish if set false, Execute sets it before the thread starts.
     static_cast<ThreadClass *>(params)->m_threadID = Get_Current_Thread_ID();
     Register_Thread_ID(
         static_cast<ThreadClass *>(params)->m_threadID, static_cast<ThreadClass *>(params)->m_threadName, false);
@@ -111,6 +110,8 @@ void ThreadClass::Internal_Thread_Function(void *params)
 void ThreadClass::Execute()
 {
     captainslog_trace("Executing thread '%s'.", m_threadName);
+    // Set before the thread starts so a Stop that comes in before it gets going isn't undone.
+    m_isRunning = true;
 #ifdef HAVE_PTHREAD_H
     // These can be used to set none default params
     pthread_attr_t attr;
@@ -19,6 +19,7 @@
 #include "dx8indexbuffer.h"
 #include "dx8polygonrenderer.h"
 #include "dx8vertexbuffer.h"
+#include "framearena.h"
 #include "mapper.h"
 #include "matpass.h"
 #include "mesh.h"
@@ -1523,16 +1524,28 @@ void DX8SkinFVFCategoryContainer::Render()
                                 // Debug_Statistics::Record_DX8_Skin_Polys_And_Vertices(mesh1->Get_Num_Polys(),
                                 // mesh_vertex_count);
 
-                                if (g_tempVertexBuffer.Length() < mesh_vertex_count) {
-                                    g_tempVertexBuffer.Resize(mesh_vertex_count);
-                                }
+#ifndef GAME_DLL
+                                // Thyme specific, deformed vertices are scratch for this mesh only.
+                                FrameArenaScope scratch(g_theFrameArena);
+                                Vector3 *verts = scratch.Allocate_Array<Vector3>(mesh_vertex_count);
+                                Vector3 *normals = scratch.Allocate_Array<Vector3>(mesh_vertex_count);
+#else
+                                Vector3 *verts = nullptr;
+                                Vector3 *normals = nullptr;
+#endif
 
-                                if (g_tempNormalBuffer.Length() < mesh_vertex_count) {
-                                    g_tempNormalBuffer.Resize(mesh_vertex_count);
-                                }
+                                if (verts == nullptr || normals == nullptr) {
+                                    if (g_tempVertexBuffer.Length() < mesh_vertex_count) {
+                                        g_tempVertexBuffer.Resize(mesh_vertex_count);
+                                    }
+
+                                    if (g_tempNormalBuffer.Length() < mesh_vertex_count) {
+                                        g_tempNormalBuffer.Resize(mesh_vertex_count);
+                                    }
 
-                                Vector3 *verts = &g_tempVertexBuffer[0];
-                                Vector3 *normals = &g_tempNormalBuffer[0];
+                                    verts = &g_tempVertexBuffer[0];
+                                    normals = &g_tempNormalBuffer[0];
+                                }
                                 const Vector2 *uv1 = mmc->Get_UV_Array_By_Index(0);
                                 const Vector2 *uv2 = mmc->Get_UV_Array_By_Index(1);
                                 unsigned int *colors = mmc->Get_Color_Array(0, false);
@@ -17,6 +17,7 @@
 #include "dx8indexbuffer.h"
 #include "dx8vertexbuffer.h"
 #include "dx8wrapper.h"
+#include "framearena.h"
 #include "sphere.h"
 #include "w3d.h"
 #include <algorithm>
@@ -328,7 +329,17 @@ void SortingRendererClass::Flush_Sorting_Pool()
 {
 #ifdef BUILD_WITH_D3D8
     if (g_overlappingNodeCount) {
+#ifndef GAME_DLL
+        // Thyme specific, the index array is only needed for this flush so it comes from the frame arena when possible.
+        FrameArenaScope scratch(g_theFrameArena);
+        TempIndexStruct *index_array = scratch.Allocate_Array<TempIndexStruct>(g_overlappingPolygonCount);
+
+        if (index_array == nullptr) {
+            index_array = Get_Temp_Index_Array(g_overlappingPolygonCount);
+        }
+#else
         TempIndexStruct *index_array = Get_Temp_Index_Array(g_overlappingPolygonCount);
+#endif
         unsigned int vertexAllocCount = g_overlappingVertexCount;
 
         if (DynamicVBAccessClass::Get_Default_Vertex_Count() < g_defaultSortingVertexCount) {
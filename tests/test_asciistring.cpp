@@ -0,0 +1,113 @@
+/**
+ * @file
+ *
+ * @author feliwir
+ *
+ * @brief Set of tests to validate the Utf8String and InternedString classes
+ *
+ * @copyright Thyme is free software: you can redistribute it and/or
+ *            modify it under the terms of the GNU General Public License
+ *            as published by the Free Software Foundation, either version
+ *            2 of the License, or (at your option) any later version.
+ *            A full copy of the GNU General Public License can be found in
+ *            LICENSE
+ */
+#include <asciistring.h>
+#include <gtest/gtest.h>
+#include <internedstring.h>
+
+TEST(asciistring, short_and_long)
+{
+    const char *long_text = "A string that is far too long to be stored inside the object";
+    Utf8String empty;
+    Utf8String short_str("Short");
+    Utf8String long_str(long_text);
+
+    EXPECT_TRUE(empty.Is_Empty());
+    EXPECT_STREQ(empty.Str(), "");
+    EXPECT_EQ(short_str.Get_Length(), 5);
+    EXPECT_STREQ(long_str.Str(), long_text);
+
+    // Copies of short strings must not point into the original object.
+    Utf8String short_copy = short_str;
+    short_str = "Changed";
+    EXPECT_STREQ(short_copy.Str(), "Short");
+    EXPECT_STREQ(short_str.Str(), "Changed");
+    EXPECT_NE(short_copy.Str(), short_str.Str());
+
+    // Long strings are still shared until one of them changes.
+    Utf8String long_copy = long_str;
+    EXPECT_EQ(long_copy.Str(), long_str.Str());
+    long_copy += "!";
+    EXPECT_STREQ(long_str.Str(), long_text);
+    EXPECT_EQ(long_copy.Get_Length(), long_str.Get_Length() + 1);
+}
+
+TEST(asciistring, growing_and_shrinking)
+{
+    Utf8String str;
+
+    for (int i = 0; i < 40; ++i) {
+        str += char('a' + i % 26);
+        EXPECT_EQ(str.Get_Length(), i + 1);
+    }
+
+    Utf8String copy = str;
+
+    while (str.Get_Length() > 3) {
+        str.Remove_Last_Char();
+    }
+
+    EXPECT_STREQ(str.Str(), "abc");
+    EXPECT_EQ(copy.Get_Length(), 40);
+
+    str = "  padded  ";
+    str.Trim();
+    EXPECT_STREQ(str.Str(), "padded");
+
+    Utf8String line("first second third");
+    Utf8String token;
+    EXPECT_TRUE(line.Next_Token(&token));
+    EXPECT_STREQ(token.Str(), "first");
+    EXPECT_STREQ(line.Str(), " second third");
+
+    str.Format("%s_%d", "Label", 42);
+    EXPECT_STREQ(str.Str(), "Label_42");
+    str.To_Lower();
+    EXPECT_STREQ(str.Str(), "label_42");
+}
+
+TEST(asciistring, interned)
+{
+    Utf8String name("AmericaTankCrusader");
+    InternedString a("AmericaTankCrusader");
+    InternedString b(name);
+    InternedString c("ChinaTankOverlord");
+    InternedString found;
+
+    EXPECT_EQ(a, b);
+    EXPECT_EQ(a.Str(), b.Str());
+    EXPECT_NE(a, c);
+    EXPECT_STREQ(c.Str(), "ChinaTankOverlord");
+    EXPECT_TRUE(InternedString().Is_Empty());
+    EXPECT_EQ(InternedString(""), InternedString());
+
+    EXPECT_TRUE(InternedString::Find("ChinaTankOverlord", found));
+    EXPECT_EQ(found, c);
+    EXPECT_TRUE(InternedString::Find("AmericaTankCrusader", InternedString::Hash("AmericaTankCrusader"), found));
+    EXPECT_EQ(found, a);
+    EXPECT_FALSE(InternedString::Find("GLAInfantryNeverInterned", found));
+
+    // Force the table to grow and check earlier strings are still found.
+    char buf[32];
+
+    for (int i = 0; i < 5000; ++i) {
+        snprintf(buf, sizeof(buf), "Identifier%d", i);
+        InternedString s(buf);
+        EXPECT_STREQ(s.Str(), buf);
+    }
+
+    EXPECT_EQ(InternedString("AmericaTankCrusader"), a);
+    EXPECT_EQ(InternedString("Identifier17"), InternedString("Identifier17"));
+    EXPECT_GE(InternedString::Get_Count(), 5002);
+}
@@ -0,0 +1,234 @@
+/**
+ * @file
+ *
+ * @author OmniBlade
+ *
+ * @brief Set of tests to validate the compression implementations.
+ *
+ * @copyright Thyme is free software: you can redistribute it and/or
+ *            modify it under the terms of the GNU General Public License
+ *            as published by the Free Software Foundation, either version
+ *            2 of the License, or (at your option) any later version.
+ *            A full copy of the GNU General Public License can be found in
+ *            LICENSE
+ */
+#include <compressionmanager.h>
+#include <gtest/gtest.h>
+#include <lz4block.h>
+#include <refpack.h>
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+namespace
+{
+// Mix of literals and repeats from up to max_distance back, loosely shaped like map and save data.
+std::vector<uint8_t> Make_Test_Data(size_t size, uint32_t seed, size_t max_distance, size_t min_length, size_t max_length)
+{
+    std::vector<uint8_t> src;
+
+    while (src.size() < size) {
+        seed = seed * 1103515245 + 12345;
+
+        if (src.size() > 1000 && (seed >> 16) % 3 == 0) {
+            size_t start = src.size() - 1 - (seed >> 4) % std::min(src.size() - 1, max_distance);
+
+            for (size_t j = 0; j < min_length + seed % (max_length - min_length); ++j) {
+                src.push_back(src[start + j]);
+            }
+        } else {
+            src.push_back(uint8_t(seed >> 24));
+        }
+    }
+
+    src.resize(size);
+
+    return src;
+}
+} // namespace
+
+TEST(compression, refpack_overlapping_matches)
+{
+    // Hand built stream, "ab" then a match two back repeating it and a literal "z" then a match one back.
+    const uint8_t packed[] = { 0x10, 0xFB, 0x00, 0x00, 0x21, 0x1E, 0x01, 'a', 'b', 0x90, 0x40, 0x00, 'z', 0xFC };
+    char dst[33];
+
+    int size = 0;
+    EXPECT_EQ(RefPack_Uncompress(dst, packed, &size), 33);
+    EXPECT_EQ(size, int(sizeof(packed)));
+    EXPECT_EQ(memcmp(dst, "abababababab", 12), 0);
+    EXPECT_EQ(memcmp(dst + 12, "zzzzzzzzzzzzzzzzzzzzz", 21), 0);
+}
+
+TEST(compression, refpack_round_trip)
+{
+    // Runs repeating every 1 to 9 bytes exercise each way matches get copied, the noise forces literals.
+    std::vector<uint8_t> src;
+    uint32_t seed = 12345;
+
+    for (int i = 0; i < 2000; ++i) {
+        seed = seed * 1103515245 + 12345;
+        int period = 1 + (seed >> 16) % 9;
+        int length = 3 + (seed >> 8) % 300;
+
+        for (int j = 0; j < length; ++j) {
+            src.push_back(uint8_t('A' + j % period));
+        }
+
+        for (int j = 0; j < int(seed % 7); ++j) {
+            seed = seed * 1103515245 + 12345;
+            src.push_back(uint8_t(seed >> 24));
+        }
+    }
+
+    for (int quick = 0; quick < 2; ++quick) {
+        std::vector<uint8_t> packed(src.size() * 2 + 64);
+        int packed_size = RefPack_Compress(&packed[0], &src[0], int(src.size()), quick != 0);
+        ASSERT_GT(packed_size, 0);
+        ASSERT_LT(packed_size, int(src.size()));
+
+        std::vector<uint8_t> dst(src.size());
+        int read_size = 0;
+        EXPECT_EQ(RefPack_Uncompress(&dst[0], &packed[0], &read_size), int(src.size()));
+        EXPECT_EQ(read_size, packed_size);
+        EXPECT_TRUE(dst == src);
+    }
+}
+
+TEST(compression, refpack_levels)
+{
+    // Large enough to be split into several blocks, repeats reach back across block boundaries.
+    std::vector<uint8_t> src = Make_Test_Data(3 * 1024 * 1024, 54321, 100000, 50, 250);
+
+    const int depths[] = { 1, 16, 0 };
+
+    for (int i = 0; i < 3; ++i) {
+        for (int threads = 1; threads <= 3; threads += 2) {
+            std::vector<uint8_t> packed(RefPack_Compress_Bound(int(src.size())));
+            int packed_size = RefPack_Compress_Level(&packed[0], &src[0], int(src.size()), depths[i], threads);
+            ASSERT_GT(packed_size, 0);
+            ASSERT_LT(packed_size, int(src.size()));
+
+            std::vector<uint8_t> dst(src.size());
+            int read_size = 0;
+            EXPECT_EQ(RefPack_Uncompress(&dst[0], &packed[0], &read_size), int(src.size()));
+            EXPECT_EQ(read_size, packed_size);
+            EXPECT_TRUE(dst == src);
+        }
+    }
+}
+
+TEST(compression, lz4_round_trip)
+{
+    std::vector<uint8_t> src = Make_Test_Data(256 * 1024, 24680, 60000, 4, 250);
+    const CompressionType types[] = { COMPRESSION_EAR, COMPRESSION_LZ4 };
+
+    for (int i = 0; i < 2; ++i) {
+        std::vector<uint8_t> packed(CompressionManager::Get_Max_Compressed_Size(int(src.size()), types[i]));
+        int packed_size = CompressionManager::Compress_Data(
+            types[i], &src[0], int(src.size()), &packed[0], int(packed.size()));
+        ASSERT_GT(packed_size, 8);
+        ASSERT_LT(packed_size, int(src.size()));
+        EXPECT_EQ(CompressionManager::Get_Compression_Type(&packed[0], packed_size), types[i]);
+        EXPECT_EQ(CompressionManager::Get_Uncompressed_Size(&packed[0], packed_size), int(src.size()));
+
+        std::vector<uint8_t> dst(src.size());
+        EXPECT_EQ(CompressionManager::Decompress_Data(&packed[0], packed_size, &dst[0], int(dst.size())), int(src.size()));
+        EXPECT_TRUE(dst == src);
+    }
+
+    // Short and empty inputs are all literals.
+    const char text[] = "Thyme";
+
+    for (int size = 0; size <= 5; ++size) {
+        uint8_t packed[32];
+        char dst[8];
+        int packed_size = CompressionManager::Compress_Data(COMPRESSION_LZ4, text, size, packed, sizeof(packed));
+        ASSERT_EQ(packed_size, 8 + 1 + size);
+        EXPECT_EQ(CompressionManager::Decompress_Data(packed, packed_size, dst, sizeof(dst)), size);
+        EXPECT_EQ(memcmp(dst, text, size), 0);
+    }
+
+    // Truncated data and a destination too small are rejected rather than read or written past.
+    std::vector<uint8_t> packed(CompressionManager::Get_Max_Compressed_Size(int(src.size()), COMPRESSION_LZ4));
+    int packed_size = CompressionManager::Compress_Data(
+        COMPRESSION_LZ4, &src[0], int(src.size()), &packed[0], int(packed.size()));
+    std::vector<uint8_t> dst(src.size());
+    EXPECT_EQ(CompressionManager::Decompress_Data(&packed[0], packed_size - 1, &dst[0], int(dst.size())), 0);
+    EXPECT_EQ(CompressionManager::Decompress_Data(&packed[0], packed_size, &dst[0], int(dst.size()) - 1), 0);
+    EXPECT_EQ(CompressionManager::Compress_Data(COMPRESSION_LZ4, &src[0], int(src.size()), &packed[0], 1000), 0);
+}
+
+TEST(compression, lz4_reference_blocks)
+{
+    // Blocks written by the reference LZ4 library (1.9.4), LZ4_compress_default unless noted, so the decoder is checked
+    // against an encoder other than our own.
+    static const uint8_t text_block[] = {
+        0x50, 0x54, 0x68, 0x79, 0x6d, 0x65,
+    };
+    // Offset 1 match with a length well past the 255 byte extension.
+    static const uint8_t run_block[] = {
+        0x1f, 0x61, 0x01, 0x00, 0xff, 0xff, 0xff, 0xd2, 0x50, 0x61, 0x61, 0x61, 0x61, 0x61,
+    };
+    // Literal run past the 15 byte extension followed by many short matches.
+    static const uint8_t ini_block[] = {
+            0xb2, 0x4f, 0x62, 0x6a, 0x65, 0x63, 0x74, 0x20, 0x54, 0x65, 0x73, 0x74, 0x0b, 0x00, 0xf2, 0x04,
+            0x30, 0x0a, 0x20, 0x20, 0x48, 0x65, 0x61, 0x6c, 0x74, 0x68, 0x20, 0x3d, 0x20, 0x30, 0x0a, 0x45,
+            0x6e, 0x64, 0x0a, 0x19, 0x00, 0x07, 0x24, 0x00, 0x18, 0x31, 0x24, 0x00, 0x1f, 0x31, 0x25, 0x00,
+            0x04, 0x18, 0x32, 0x25, 0x00, 0x1f, 0x32, 0x25, 0x00, 0x04, 0x18, 0x33, 0x25, 0x00, 0x1f, 0x33,
+            0x25, 0x00, 0x04, 0x18, 0x34, 0x25, 0x00, 0x1f, 0x34, 0x25, 0x00, 0x04, 0x18, 0x35, 0x25, 0x00,
+            0x1f, 0x35, 0x25, 0x00, 0x04, 0x18, 0x36, 0x25, 0x00, 0x1f, 0x36, 0x25, 0x00, 0x04, 0x18, 0x37,
+            0x25, 0x00, 0x1f, 0x37, 0x25, 0x00, 0x04, 0x18, 0x38, 0x25, 0x00, 0x1f, 0x38, 0x25, 0x00, 0x04,
+            0x18, 0x39, 0x25, 0x00, 0x1f, 0x39, 0x25, 0x00, 0x04, 0x19, 0x31, 0x72, 0x01, 0x2f, 0x31, 0x30,
+            0x27, 0x00, 0x05, 0x0a, 0x75, 0x01, 0x0f, 0x76, 0x01, 0x05, 0x19, 0x31, 0x77, 0x01, 0x1f, 0x31,
+            0x78, 0x01, 0x05, 0x19, 0x31, 0x79, 0x01, 0x1f, 0x31, 0x7a, 0x01, 0x05, 0x19, 0x31, 0x7b, 0x01,
+            0x1f, 0x31, 0x7c, 0x01, 0x05, 0x19, 0x31, 0x7d, 0x01, 0x80, 0x31, 0x35, 0x30, 0x0a, 0x45, 0x6e,
+            0x64, 0x0a,
+    };
+    // The same text from LZ4_compress_HC at level 12, which picks different matches.
+    static const uint8_t ini_hc_block[] = {
+            0xb2, 0x4f, 0x62, 0x6a, 0x65, 0x63, 0x74, 0x20, 0x54, 0x65, 0x73, 0x74, 0x0b, 0x00, 0xfd, 0x04,
+            0x30, 0x0a, 0x20, 0x20, 0x48, 0x65, 0x61, 0x6c, 0x74, 0x68, 0x20, 0x3d, 0x20, 0x30, 0x0a, 0x45,
+            0x6e, 0x64, 0x0a, 0x24, 0x00, 0x18, 0x31, 0x24, 0x00, 0x1f, 0x31, 0x25, 0x00, 0x04, 0x18, 0x32,
+            0x25, 0x00, 0x1f, 0x32, 0x25, 0x00, 0x04, 0x18, 0x33, 0x25, 0x00, 0x1f, 0x33, 0x25, 0x00, 0x04,
+            0x18, 0x34, 0x25, 0x00, 0x1f, 0x34, 0x25, 0x00, 0x04, 0x18, 0x35, 0x25, 0x00, 0x1f, 0x35, 0x25,
+            0x00, 0x04, 0x18, 0x36, 0x25, 0x00, 0x1f, 0x36, 0x25, 0x00, 0x04, 0x18, 0x37, 0x25, 0x00, 0x1f,
+            0x37, 0x25, 0x00, 0x04, 0x18, 0x38, 0x25, 0x00, 0x1f, 0x38, 0x25, 0x00, 0x04, 0x18, 0x39, 0x25,
+            0x00, 0x1f, 0x39, 0x4d, 0x01, 0x05, 0x1a, 0x30, 0x4e, 0x01, 0x0f, 0x27, 0x00, 0x05, 0x0a, 0x75,
+            0x01, 0x1f, 0x31, 0x27, 0x00, 0x05, 0x19, 0x32, 0x27, 0x00, 0x1f, 0x32, 0x27, 0x00, 0x05, 0x19,
+            0x33, 0x27, 0x00, 0x1f, 0x33, 0x27, 0x00, 0x05, 0x19, 0x34, 0x27, 0x00, 0x1f, 0x34, 0x27, 0x00,
+            0x05, 0x19, 0x35, 0x27, 0x00, 0x70, 0x35, 0x30, 0x0a, 0x45, 0x6e, 0x64, 0x0a,
+    };
+
+    std::string ini;
+
+    for (int i = 0; i < 16; ++i) {
+        char line[64];
+        snprintf(line, sizeof(line), "Object TestObject%d\n  Health = %d\nEnd\n", i, i * 10);
+        ini += line;
+    }
+
+    struct
+    {
+        const uint8_t *block;
+        int block_size;
+        std::string plain;
+    } cases[] = {
+        { text_block, int(sizeof(text_block)), "Thyme" },
+        { run_block, int(sizeof(run_block)), std::string(1000, 'a') },
+        { ini_block, int(sizeof(ini_block)), ini },
+        { ini_hc_block, int(sizeof(ini_hc_block)), ini },
+    };
+
+    for (size_t i = 0; i < sizeof(cases) / sizeof(cases[0]); ++i) {
+        std::vector<char> dst(cases[i].plain.size());
+        ASSERT_EQ(LZ4_Block_Uncompress(&dst[0], cases[i].block, cases[i].block_size, int(dst.size())),
+            int(cases[i].plain.size()));
+        EXPECT_EQ(std::string(dst.begin(), dst.end()), cases[i].plain);
+
+        // Short by one byte is rejected rather than written past.
+        EXPECT_LT(LZ4_Block_Uncompress(&dst[0], cases[i].block, cases[i].block_size, int(dst.size()) - 1), 0);
+    }
+}
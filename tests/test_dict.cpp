@@ -0,0 +1,66 @@
+/**
+ * @file
+ *
+ * @author feliwir
+ *
+ * @brief Set of tests to validate the Dict class
+ *
+ * @copyright Thyme is free software: you can redistribute it and/or
+ *            modify it under the terms of the GNU General Public License
+ *            as published by the Free Software Foundation, either version
+ *            2 of the License, or (at your option) any later version.
+ *            A full copy of the GNU General Public License can be found in
+ *            LICENSE
+ */
+#include <dict.h>
+#include <gtest/gtest.h>
+
+TEST(dict, short_strings_survive_sorting)
+{
+    // Keys are set in descending order so every Set_* moves the existing pairs when it sorts them.
+    const int count = 12;
+    Dict dict;
+
+    for (int i = count; i > 0; --i) {
+        Utf8String value;
+        value.Format("value%d", i);
+        dict.Set_AsciiString(NameKeyType(i), value);
+    }
+
+    dict.Set_Int(NameKeyType(count + 1), 42);
+    dict.Set_AsciiString(NameKeyType(count + 2), "A string that is far too long to be stored inside the object");
+
+    ASSERT_EQ(dict.Get_PairCount(), count + 2);
+
+    for (int i = 1; i <= count; ++i) {
+        Utf8String expected;
+        expected.Format("value%d", i);
+        bool exists = false;
+        EXPECT_EQ(dict.Get_Nth_Key(i), NameKeyType(i));
+        EXPECT_STREQ(dict.Get_AsciiString(NameKeyType(i), &exists).Str(), expected.Str());
+        EXPECT_TRUE(exists);
+    }
+
+    EXPECT_EQ(dict.Get_Int(NameKeyType(count + 1)), 42);
+
+    // Removing pairs sorts the remaining ones again.
+    EXPECT_TRUE(dict.Remove(NameKeyType(1)));
+    EXPECT_TRUE(dict.Remove(NameKeyType(7)));
+    EXPECT_EQ(dict.Get_PairCount(), count);
+    EXPECT_STREQ(dict.Get_AsciiString(NameKeyType(2)).Str(), "value2");
+    EXPECT_STREQ(dict.Get_AsciiString(NameKeyType(8)).Str(), "value8");
+    EXPECT_STREQ(dict.Get_AsciiString(NameKeyType(count)).Str(), "value12");
+
+    // Copied pairs are sorted in as well and must not share the inline buffer of the source pair.
+    Dict other;
+    other.Set_AsciiString(NameKeyType(count + 3), "first");
+    other.Copy_Pair_From(dict, NameKeyType(3));
+    other.Copy_Pair_From(dict, NameKeyType(2));
+    dict.Set_AsciiString(NameKeyType(3), "changed");
+
+    EXPECT_EQ(other.Get_PairCount(), 3);
+    EXPECT_STREQ(other.Get_AsciiString(NameKeyType(2)).Str(), "value2");
+    EXPECT_STREQ(other.Get_AsciiString(NameKeyType(3)).Str(), "value3");
+    EXPECT_STREQ(other.Get_AsciiString(NameKeyType(count + 3)).Str(), "first");
+    EXPECT_STREQ(dict.Get_AsciiString(NameKeyType(3)).Str(), "changed");
+}
@@ -12,13 +12,37 @@
  *            A full copy of the GNU General Public License can be found in
  *            LICENSE
  */
+#include <archiveblobcache.h>
+#include <archiveindexcache.h>
+#include <archivepathindex.h>
+#include <bigarchivewriter.h>
+#include <commandline.h>
+#include <fileiostats.h>
+#include <filesystem.h>
 #include <gtest/gtest.h>
+#include <localfileindex.h>
+#include <endiantype.h>
+#include <memdynalloc.h>
+#include <mempool.h>
+#include <refpack.h>
+#include <streamingarchivefile.h>
 #include <win32bigfile.h>
 #include <win32bigfilesystem.h>
 #include <win32localfilesystem.h>
 #ifdef BUILD_WITH_STDFS
 #include <stdlocalfilesystem.h>
 #endif
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#ifdef HAVE_SYS_INOTIFY_H
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
 
 extern LocalFileSystem *g_theLocalFileSystem;
 
@@ -54,6 +78,727 @@ TEST(filesystem, win32bigfile)
     delete g_theLocalFileSystem;
 }
 
+TEST(filesystem, streamingarchivefile_read_ahead)
+{
+    // Read ahead happens on the IO threads which need the memory manager locks as they do in game.
+    SimpleCriticalSectionClass pool_lock;
+    SimpleCriticalSectionClass dma_lock;
+    SimpleCriticalSectionClass *old_pool_lock = g_memoryPoolCriticalSection;
+    SimpleCriticalSectionClass *old_dma_lock = g_dmaCriticalSection;
+    g_memoryPoolCriticalSection = &pool_lock;
+    g_dmaCriticalSection = &dma_lock;
+    g_theLocalFileSystem = new Win32LocalFileSystem;
+
+    {
+        Win32BIGFileSystem bigfilesystem;
+        ArchiveFile *bigfile =
+            bigfilesystem.Open_Archive_File((Utf8String(TESTDATA_PATH) + "/filesystem/test.big").Str());
+        ASSERT_NE(bigfile, nullptr);
+
+        // A tiny window so reading a sample a byte at a time crosses between the buffers a few times.
+        int old_size = StreamingArchiveFile::Get_Default_Read_Ahead_Size();
+        StreamingArchiveFile::Set_Default_Read_Ahead_Size(4);
+        StreamingArchiveFile *file =
+            static_cast<StreamingArchiveFile *>(bigfile->Open_File("a.txt", File::READ | File::STREAMING));
+        StreamingArchiveFile::Set_Default_Read_Ahead_Size(old_size);
+        ASSERT_NE(file, nullptr);
+        EXPECT_EQ(file->Get_Read_Ahead_Size(), 4);
+
+        char dst_buf[17];
+        memset(dst_buf, 0, sizeof(dst_buf));
+
+        for (int i = 0; i < 16; ++i) {
+            EXPECT_EQ(file->Read(&dst_buf[i], 1), 1);
+        }
+
+        EXPECT_EQ(file->Read(dst_buf, 1), 0);
+        EXPECT_STREQ(dst_buf, "This is sample A");
+
+        StreamingArchiveFile::ReadAheadStats const &stats = file->Get_Read_Ahead_Stats();
+        EXPECT_EQ(stats.reads, 16u);
+        EXPECT_EQ(stats.bytes_read, 16u);
+        EXPECT_EQ(stats.bytes_prefetched, 12u);
+        EXPECT_GT(stats.Hit_Ratio(), 0.0f);
+
+        // Seeking back lands outside the buffers and reads spanning both halves still come out in order.
+        memset(dst_buf, 0, sizeof(dst_buf));
+        EXPECT_EQ(file->Seek(5, File::START), 5);
+        EXPECT_EQ(file->Read(dst_buf, 6), 6);
+        EXPECT_STREQ(dst_buf, "is sam");
+
+        // Reads larger than the window bypass it.
+        memset(dst_buf, 0, sizeof(dst_buf));
+        file->Seek(0, File::START);
+        EXPECT_EQ(file->Read(dst_buf, 16), 16);
+        EXPECT_STREQ(dst_buf, "This is sample A");
+
+        // A file system going away leaves the IO threads running for everyone else.
+        memset(dst_buf, 0, sizeof(dst_buf));
+        file->Seek(0, File::START);
+        EXPECT_EQ(file->Read(dst_buf, 2), 2);
+        delete new FileSystem;
+
+        for (int i = 2; i < 8; ++i) {
+            EXPECT_EQ(file->Read(&dst_buf[i], 1), 1);
+        }
+
+        // Shutting the IO threads down with reads in flight completes them, the file carries on with a new pool.
+        FileSystem::Shutdown_IO();
+
+        for (int i = 8; i < 16; ++i) {
+            EXPECT_EQ(file->Read(&dst_buf[i], 1), 1);
+        }
+
+        EXPECT_STREQ(dst_buf, "This is sample A");
+
+        file->Close();
+    }
+
+    FileSystem::Shutdown_IO();
+    delete g_theLocalFileSystem;
+    g_theLocalFileSystem = nullptr;
+    g_memoryPoolCriticalSection = old_pool_lock;
+    g_dmaCriticalSection = old_dma_lock;
+}
+
+TEST(filesystem, win32bigfile_unmapped)
+{
+    g_theLocalFileSystem = new Win32LocalFileSystem;
+    bool map_archives = Win32BIGFileSystem::Get_Map_Archives();
+    Win32BIGFileSystem::Set_Map_Archives(false);
+
+    Win32BIGFileSystem bigfilesystem;
+    ArchiveFile *bigfile = bigfilesystem.Open_Archive_File((Utf8String(TESTDATA_PATH) + "/filesystem/test.big").Str());
+    ASSERT_NE(bigfile, nullptr);
+
+    char dst_buf[256];
+    memset(dst_buf, 0, sizeof(dst_buf));
+
+    File *file_a = bigfile->Open_File("a.txt", File::READ);
+    ASSERT_NE(file_a, nullptr);
+    EXPECT_EQ(file_a->Read(dst_buf, sizeof(dst_buf)), 16);
+    EXPECT_EQ(Utf8String(dst_buf), "This is sample A");
+    EXPECT_EQ(bigfile->Open_File("b.txt", File::READ), nullptr);
+    file_a->Close();
+    delete bigfile;
+
+    Win32BIGFileSystem::Set_Map_Archives(map_archives);
+    delete g_theLocalFileSystem;
+}
+
+TEST(filesystem, win32bigfile_index_cache)
+{
+    g_theLocalFileSystem = new Win32LocalFileSystem;
+    Utf8String path = Utf8String(TESTDATA_PATH) + "/filesystem/test.big";
+
+    Win32BIGFileSystem bigfilesystem;
+    ArchiveFile *bigfile = bigfilesystem.Open_Archive_File(path.Str());
+    ASSERT_NE(bigfile, nullptr);
+
+    // Fixed byte order whatever the host.
+    Thyme::ArchiveIndexWriter order_writer;
+    order_writer.Write_Int(0x01020304);
+    ASSERT_EQ(order_writer.Get_Buffer().size(), 4u);
+    EXPECT_EQ(order_writer.Get_Buffer()[0], 4);
+    EXPECT_EQ(order_writer.Get_Buffer()[3], 1);
+
+    // Relative cache names go next to the executable, absolute ones are left alone.
+    EXPECT_EQ(Thyme::Get_Cache_Path("/tmp/test.cache"), "/tmp/test.cache");
+    Utf8String resolved = Thyme::Get_Cache_Path("test.cache");
+    EXPECT_GT(resolved.Get_Length(), strlen("test.cache"));
+    EXPECT_STREQ(resolved.Str() + resolved.Get_Length() - strlen("test.cache"), "test.cache");
+
+    Thyme::ArchiveIndexWriter writer;
+    bigfile->Write_Index(writer);
+    writer.Write_String("end");
+    Utf8String index_path = "test_index.cache";
+    ASSERT_TRUE(writer.Save(index_path.Str()));
+
+    File *index_file = g_theLocalFileSystem->Open_File(index_path.Str(), File::READ | File::BINARY);
+    ASSERT_NE(index_file, nullptr);
+    int index_size = index_file->Size();
+    char *index_data = static_cast<char *>(index_file->Read_Entire_And_Close());
+    remove(index_path.Str());
+
+    // Restore the index into a fresh archive and check it resolves files the same way.
+    Win32BIGFile cached;
+    Thyme::ArchiveIndexReader reader(index_data, index_size);
+    ASSERT_TRUE(cached.Read_Index(reader, path));
+    EXPECT_EQ(Utf8String(reader.Read_String()), "end");
+    EXPECT_TRUE(reader.At_End());
+    cached.Attach_File(g_theLocalFileSystem->Open_File(path.Str(), File::READ | File::BINARY));
+
+    char dst_buf[256];
+    memset(dst_buf, 0, sizeof(dst_buf));
+
+    File *file_c = cached.Open_File("c.txt", File::READ);
+    ASSERT_NE(file_c, nullptr);
+    EXPECT_EQ(file_c->Read(dst_buf, sizeof(dst_buf)), 16);
+    EXPECT_EQ(Utf8String(dst_buf), "This is sample C");
+    EXPECT_EQ(cached.Open_File("b.txt", File::READ), nullptr);
+
+    // Truncated data must be rejected rather than producing a partial tree.
+    Win32BIGFile truncated;
+    Thyme::ArchiveIndexReader truncated_reader(index_data, index_size / 2);
+    EXPECT_FALSE(truncated.Read_Index(truncated_reader, path));
+
+    delete[] index_data;
+    delete g_theLocalFileSystem;
+}
+
+namespace
+{
+void Write_Be32(std::vector<char> &big, int value)
+{
+    for (int shift = 24; shift >= 0; shift -= 8) {
+        big.push_back(char(value >> shift));
+    }
+}
+
+void Write_Big_Entry(std::vector<char> &big, int pos, int size, const char *name)
+{
+    Write_Be32(big, pos);
+    Write_Be32(big, size);
+    big.insert(big.end(), name, name + strlen(name) + 1);
+}
+} // namespace
+
+TEST(filesystem, win32bigfile_compressed_entry)
+{
+    g_theLocalFileSystem = new Win32LocalFileSystem;
+
+    // Something repetitive enough for RefPack to actually shrink.
+    std::vector<char> plain;
+
+    for (int i = 0; i < 256; ++i) {
+        const char line[] = "Object TestObject\n  Health = 100\nEnd\n";
+        plain.insert(plain.end(), line, line + sizeof(line) - 1);
+    }
+
+    std::vector<char> packed(plain.size() * 2 + 64);
+    memcpy(&packed[0], "EAR", 4);
+    int plain_size = htole32(int(plain.size()));
+    memcpy(&packed[4], &plain_size, 4);
+    packed.resize(8 + RefPack_Compress(&packed[8], &plain[0], int(plain.size()), false));
+    ASSERT_LT(packed.size(), plain.size());
+
+    // Archive holding the compressed entry and a plain one.
+    const char *big_name = "test_compressed.big";
+    int header_end = 16 + 16 + 16;
+    std::vector<char> big;
+    big.insert(big.end(), "BIGF", "BIGF" + 4);
+    big.resize(8); // Archive size is little endian, filled in below.
+    Write_Be32(big, 2);
+    Write_Be32(big, header_end);
+    Write_Big_Entry(big, header_end, int(packed.size()), "map.ini");
+    Write_Big_Entry(big, header_end + int(packed.size()), 4, "raw.txt");
+    ASSERT_EQ(int(big.size()), header_end);
+    big.insert(big.end(), packed.begin(), packed.end());
+    big.insert(big.end(), "EAR!", "EAR!" + 4);
+    int arch_size = htole32(int(big.size()));
+    memcpy(&big[4], &arch_size, 4);
+
+    FILE *fp = fopen(big_name, "wb");
+    ASSERT_NE(fp, nullptr);
+    fwrite(&big[0], 1, big.size(), fp);
+    fclose(fp);
+
+    // Decoding has to work whether the entry is read out of the mapping or from the attached file.
+    bool old_map = Win32BIGFileSystem::Get_Map_Archives();
+
+    // Off by default, entries come back exactly as stored.
+    {
+        Win32BIGFileSystem bigfilesystem;
+        ArchiveFile *bigfile = bigfilesystem.Open_Archive_File(big_name);
+        ASSERT_NE(bigfile, nullptr);
+        FileInfo info;
+        EXPECT_TRUE(bigfile->Get_File_Info("map.ini", &info));
+        EXPECT_EQ(info.file_size_low, int(packed.size()));
+        File *file = bigfile->Open_File("map.ini", File::READ);
+        ASSERT_NE(file, nullptr);
+        EXPECT_EQ(file->Size(), int(packed.size()));
+        file->Close();
+        delete bigfile;
+    }
+
+    Win32BIGFileSystem::Set_Decompress_Entries(true);
+
+    for (int map = 0; map < 2; ++map) {
+        Win32BIGFileSystem::Set_Map_Archives(map != 0);
+        Win32BIGFileSystem bigfilesystem;
+        ArchiveFile *bigfile = bigfilesystem.Open_Archive_File(big_name);
+        ASSERT_NE(bigfile, nullptr);
+
+        // The size reported for an entry has to match what opening it gives.
+        FileInfo info;
+        EXPECT_TRUE(bigfile->Get_File_Info("map.ini", &info));
+        EXPECT_EQ(info.file_size_low, int(plain.size()));
+        EXPECT_TRUE(bigfile->Get_File_Info("raw.txt", &info));
+        EXPECT_EQ(info.file_size_low, 4);
+
+        // Opened twice, the second time the decoded blob should come out of the cache.
+        for (int i = 0; i < 2; ++i) {
+            File *file = bigfile->Open_File("map.ini", File::READ);
+            ASSERT_NE(file, nullptr);
+            ASSERT_EQ(file->Size(), int(plain.size()));
+            char *data = static_cast<char *>(file->Read_Entire_And_Close());
+            EXPECT_EQ(memcmp(data, &plain[0], plain.size()), 0);
+            delete[] data;
+        }
+
+        EXPECT_EQ(bigfilesystem.Get_Blob_Cache().Get_Hits(), 1u);
+        EXPECT_EQ(bigfilesystem.Get_Blob_Cache().Get_Count(), 1);
+
+        // Entries without a compression header are untouched.
+        File *file = bigfile->Open_File("raw.txt", File::READ);
+        ASSERT_NE(file, nullptr);
+        char raw[4];
+        EXPECT_EQ(file->Read(raw, sizeof(raw)), 4);
+        EXPECT_EQ(memcmp(raw, "EAR!", 4), 0);
+        file->Close();
+
+        delete bigfile;
+    }
+
+    Win32BIGFileSystem::Set_Decompress_Entries(false);
+    Win32BIGFileSystem::Set_Map_Archives(old_map);
+    remove(big_name);
+    delete g_theLocalFileSystem;
+    g_theLocalFileSystem = nullptr;
+}
+
+TEST(filesystem, decompress_archives_switch)
+{
+    // Read before any archive is opened, so it has to be picked up ahead of the rest of the command line.
+    char *argv[] = { const_cast<char *>("generals.exe"), const_cast<char *>("-win"),
+        const_cast<char *>("-decompressArchives") };
+    EXPECT_FALSE(ArchiveFileSystem::Get_Decompress_Entries());
+    Parse_Startup_Command_Line(ARRAY_SIZE(argv), argv);
+    EXPECT_TRUE(ArchiveFileSystem::Get_Decompress_Entries());
+    ArchiveFileSystem::Set_Decompress_Entries(false);
+}
+
+TEST(filesystem, archive_blob_cache)
+{
+    Thyme::ArchiveBlobCache cache(10);
+    char dst[8];
+
+    cache.Insert("a.big", 0, "1234", 4);
+    cache.Insert("a.big", 4, "5678", 4);
+    EXPECT_TRUE(cache.Find("a.big", 0, dst, 4));
+    EXPECT_EQ(memcmp(dst, "1234", 4), 0);
+    EXPECT_FALSE(cache.Find("b.big", 0, dst, 4));
+    EXPECT_FALSE(cache.Find("a.big", 0, dst, 3));
+
+    // Over budget, the least recently used blob goes first.
+    cache.Insert("b.big", 0, "abcd", 4);
+    EXPECT_EQ(cache.Get_Count(), 2);
+    EXPECT_EQ(cache.Get_Used(), 8u);
+    EXPECT_FALSE(cache.Find("a.big", 4, dst, 4));
+    EXPECT_TRUE(cache.Find("a.big", 0, dst, 4));
+    EXPECT_TRUE(cache.Find("b.big", 0, dst, 4));
+
+    // Blobs bigger than the whole budget are never held.
+    cache.Insert("c.big", 0, "0123456789ab", 12);
+    EXPECT_EQ(cache.Get_Count(), 2);
+
+    cache.Set_Budget(4);
+    EXPECT_EQ(cache.Get_Count(), 1);
+    EXPECT_TRUE(cache.Find("b.big", 0, dst, 4));
+
+    cache.Clear();
+    EXPECT_EQ(cache.Get_Used(), 0u);
+}
+
+TEST(filesystem, big_archive_writer)
+{
+    g_theLocalFileSystem = new Win32LocalFileSystem;
+
+    const char *loose_name = "test_writer_loose.txt";
+    FILE *fp = fopen(loose_name, "wb");
+    ASSERT_NE(fp, nullptr);
+    fputs("Loose A", fp);
+    fclose(fp);
+
+    // Entries of an existing archive plus loose files, the loose file added last replaces the archived a.txt.
+    Thyme::BIGArchiveWriter writer;
+    EXPECT_EQ(writer.Add_Archive((Utf8String(TESTDATA_PATH) + "/filesystem/test.big").Str()), 2);
+    EXPECT_TRUE(writer.Add_File("Data\\Extra.txt", loose_name));
+    EXPECT_TRUE(writer.Add_File("A.TXT", loose_name));
+    EXPECT_FALSE(writer.Add_File("missing.txt", "test_writer_missing.txt"));
+    EXPECT_EQ(writer.Get_Entry_Count(), 3);
+
+    std::vector<Utf8String> trace;
+    trace.push_back("data/extra.txt");
+    trace.push_back("missing.txt");
+    trace.push_back("C.txt");
+    writer.Set_Access_Order(trace);
+    EXPECT_EQ(writer.Get_Traced_Entry_Count(), 2);
+
+    const char *big_name = "test_written.big";
+    writer.Set_Alignment(4096);
+    ASSERT_TRUE(writer.Write(big_name));
+
+    // Traced entries come first in trace order with the rest after, each starting on its own page.
+    std::vector<char> big(4 * 4096 + 64);
+    fp = fopen(big_name, "rb");
+    ASSERT_NE(fp, nullptr);
+    big.resize(fread(&big[0], 1, big.size(), fp));
+    fclose(fp);
+
+    ASSERT_GT(big.size(), 16u);
+    EXPECT_EQ(memcmp(&big[0], "BIGF", 4), 0);
+    uint32_t header[4];
+    memcpy(header, &big[0], sizeof(header));
+    EXPECT_EQ(le32toh(header[1]), uint32_t(big.size()));
+    ASSERT_EQ(be32toh(header[2]), 3u);
+    EXPECT_EQ(be32toh(header[3]), 4096u);
+
+    const char *expected_names[] = { "Data\\Extra.txt", "c.txt", "A.TXT" };
+    const char *getp = &big[16];
+
+    for (int i = 0; i < 3; ++i) {
+        uint32_t entry[2];
+        memcpy(entry, getp, sizeof(entry));
+        getp += sizeof(entry);
+        EXPECT_STREQ(getp, expected_names[i]);
+        EXPECT_EQ(be32toh(entry[0]), uint32_t(4096 * (i + 1)));
+        getp += strlen(getp) + 1;
+    }
+
+    // The written archive reads back through the normal archive code.
+    {
+        Win32BIGFileSystem bigfilesystem;
+        ArchiveFile *bigfile = bigfilesystem.Open_Archive_File(big_name);
+        ASSERT_NE(bigfile, nullptr);
+        const char *files[] = { "data\\extra.txt", "c.txt", "a.txt" };
+        const char *contents[] = { "Loose A", "This is sample C", "Loose A" };
+
+        for (int i = 0; i < 3; ++i) {
+            File *file = bigfile->Open_File(files[i], File::READ);
+            ASSERT_NE(file, nullptr);
+            ASSERT_EQ(file->Size(), int(strlen(contents[i])));
+            char *data = static_cast<char *>(file->Read_Entire_And_Close());
+            EXPECT_EQ(memcmp(data, contents[i], strlen(contents[i])), 0);
+            delete[] data;
+        }
+
+        delete bigfile;
+    }
+
+    remove(big_name);
+    remove(loose_name);
+    delete g_theLocalFileSystem;
+    g_theLocalFileSystem = nullptr;
+}
+
+TEST(filesystem, archive_path_index)
+{
+    ArchivedFileInfo info_a;
+    ArchivedFileInfo info_b;
+    Thyme::ArchivePathIndex<const ArchivedFileInfo *> index;
+
+    index.Insert("data\\ini\\", "gamedata.ini", &info_a, false);
+    index.Insert("maps/", "readme.txt", &info_b, false);
+    index.Insert("maps/", "noextension", &info_b, false);
+    EXPECT_EQ(index.Get_Count(), 2);
+
+    // Lookups ignore case and treat repeated or mixed separators the same way the directory tree walk does.
+    ASSERT_NE(index.Find("Data/INI\\GameData.ini"), nullptr);
+    EXPECT_EQ(*index.Find("Data/INI\\GameData.ini"), &info_a);
+    ASSERT_NE(index.Find("\\maps\\readme.txt"), nullptr);
+    EXPECT_EQ(*index.Find("\\maps\\readme.txt"), &info_b);
+    EXPECT_EQ(index.Find("data/gamedata.ini"), nullptr);
+    EXPECT_EQ(index.Find("maps/noextension"), nullptr);
+
+    // Anything after the component holding the last '.' is not part of the lookup.
+    EXPECT_NE(index.Find("maps/readme.txt/ignored"), nullptr);
+
+    // Existing entries are only replaced when asked to.
+    index.Insert("MAPS", "README.TXT", &info_a, false);
+    EXPECT_EQ(*index.Find("maps/readme.txt"), &info_b);
+    index.Insert("MAPS", "README.TXT", &info_a, true);
+    EXPECT_EQ(*index.Find("maps/readme.txt"), &info_a);
+
+    // Force a few rehashes.
+    std::vector<Utf8String> names;
+
+    for (int i = 0; i < 1000; ++i) {
+        Utf8String name;
+        name.Format("file%d.dat", i);
+        names.push_back(name);
+        index.Insert("bulk", name, &info_a, false);
+    }
+
+    for (int i = 0; i < 1000; ++i) {
+        EXPECT_NE(index.Find((Utf8String("bulk/") + names[i]).Str()), nullptr);
+    }
+
+    index.Clear();
+    EXPECT_EQ(index.Find("maps/readme.txt"), nullptr);
+}
+
+#ifdef HAVE_SYS_INOTIFY_H
+namespace
+{
+Thyme::LocalFileIndex::LookupResult Wait_For_Lookup(
+    Thyme::LocalFileIndex &index, const char *filename, Thyme::LocalFileIndex::LookupResult expected)
+{
+    Thyme::LocalFileIndex::LookupResult result = index.Find(filename);
+
+    for (int i = 0; i < 500 && result != expected; ++i) {
+        ThreadClass::Sleep_Ms(10);
+        result = index.Find(filename);
+    }
+
+    return result;
+}
+} // namespace
+
+TEST(filesystem, local_file_index)
+{
+    // The watcher thread allocates so the memory managers need their locks as they do in game.
+    SimpleCriticalSectionClass pool_lock;
+    SimpleCriticalSectionClass dma_lock;
+    SimpleCriticalSectionClass *old_pool_lock = g_memoryPoolCriticalSection;
+    SimpleCriticalSectionClass *old_dma_lock = g_dmaCriticalSection;
+    g_memoryPoolCriticalSection = nullptr;
+    g_dmaCriticalSection = nullptr;
+
+    {
+        const char *filename = "local_file_index_test.tmp";
+        remove(filename);
+
+        // Lookups before the memory managers are ready go to the disk without disabling the index for later.
+        Thyme::LocalFileIndex index;
+        EXPECT_EQ(index.Find(filename), Thyme::LocalFileIndex::FILE_UNINDEXED);
+        g_memoryPoolCriticalSection = &pool_lock;
+        g_dmaCriticalSection = &dma_lock;
+
+        EXPECT_EQ(index.Find("/absolute/path.txt"), Thyme::LocalFileIndex::FILE_UNINDEXED);
+        EXPECT_EQ(index.Find("../outside.txt"), Thyme::LocalFileIndex::FILE_UNINDEXED);
+        EXPECT_EQ(index.Find("no_extension"), Thyme::LocalFileIndex::FILE_UNINDEXED);
+        EXPECT_EQ(index.Find(filename), Thyme::LocalFileIndex::FILE_MISSING);
+
+        // Files created and removed behind the index's back are picked up by the watcher.
+        FILE *fp = fopen(filename, "wb");
+        ASSERT_NE(fp, nullptr);
+        fclose(fp);
+        EXPECT_EQ(Wait_For_Lookup(index, filename, Thyme::LocalFileIndex::FILE_PRESENT),
+            Thyme::LocalFileIndex::FILE_PRESENT);
+
+        remove(filename);
+        EXPECT_EQ(Wait_For_Lookup(index, filename, Thyme::LocalFileIndex::FILE_MISSING),
+            Thyme::LocalFileIndex::FILE_MISSING);
+
+        // Directories are walked when first looked in and kept up to date as files and directories come and go.
+        const char *dir = "local_file_index_dir";
+        const char *sub_dir = "local_file_index_dir/Sub";
+        const char *sub_file = "local_file_index_dir/Sub/File.tmp";
+        remove(sub_file);
+        rmdir(sub_dir);
+        rmdir(dir);
+        ASSERT_EQ(mkdir(dir, 0755), 0);
+        ASSERT_EQ(mkdir(sub_dir, 0755), 0);
+        fp = fopen(sub_file, "wb");
+        ASSERT_NE(fp, nullptr);
+        fclose(fp);
+
+        EXPECT_EQ(Wait_For_Lookup(index, "local_file_index_dir\\Sub\\File.tmp", Thyme::LocalFileIndex::FILE_PRESENT),
+            Thyme::LocalFileIndex::FILE_PRESENT);
+        // Names that only differ in case are different files on Linux.
+        EXPECT_EQ(index.Find("local_file_index_dir/sub/file.tmp"), Thyme::LocalFileIndex::FILE_MISSING);
+
+        remove(sub_file);
+        rmdir(sub_dir);
+        EXPECT_EQ(Wait_For_Lookup(index, sub_file, Thyme::LocalFileIndex::FILE_MISSING),
+            Thyme::LocalFileIndex::FILE_MISSING);
+
+        ASSERT_EQ(mkdir(sub_dir, 0755), 0);
+        fp = fopen(sub_file, "wb");
+        ASSERT_NE(fp, nullptr);
+        fclose(fp);
+        EXPECT_EQ(Wait_For_Lookup(index, sub_file, Thyme::LocalFileIndex::FILE_PRESENT),
+            Thyme::LocalFileIndex::FILE_PRESENT);
+
+        remove(sub_file);
+        rmdir(sub_dir);
+        rmdir(dir);
+    }
+
+    g_memoryPoolCriticalSection = old_pool_lock;
+    g_dmaCriticalSection = old_dma_lock;
+}
+#endif
+
+namespace
+{
+// Reads the result from the callback, which must not wait on the job it is called from.
+void Count_Async_Completion(Thyme::AsyncFileRequest *request, void *user_data)
+{
+    if (request->Succeeded() && request->Get_Size() == 16) {
+        ++*static_cast<std::atomic<int> *>(user_data);
+    }
+}
+} // namespace
+
+TEST(filesystem, async_file_request)
+{
+    // Requests are serviced on the IO threads which need the memory manager locks as they do in game.
+    SimpleCriticalSectionClass pool_lock;
+    SimpleCriticalSectionClass dma_lock;
+    SimpleCriticalSectionClass *old_pool_lock = g_memoryPoolCriticalSection;
+    SimpleCriticalSectionClass *old_dma_lock = g_dmaCriticalSection;
+    g_memoryPoolCriticalSection = &pool_lock;
+    g_dmaCriticalSection = &dma_lock;
+    g_theLocalFileSystem = new Win32LocalFileSystem;
+    g_theArchiveFileSystem = new Win32BIGFileSystem;
+    ASSERT_TRUE(g_theArchiveFileSystem->Load_Big_Files_From_Directory(
+        Utf8String(TESTDATA_PATH) + "/filesystem/", "*.big", true));
+
+    {
+        FileSystem filesystem;
+        std::atomic<int> completed(0);
+        Thyme::AsyncFileRequest *requests[32];
+
+        // Plenty of requests for the same archive to have the IO threads contend on it.
+        for (int i = 0; i < 32; ++i) {
+            requests[i] = filesystem.Read_File_Async(i % 2 == 0 ? "a.txt" : "c.txt", Count_Async_Completion, &completed);
+        }
+
+        // The accessors wait for the result themselves.
+        for (int i = 0; i < 32; ++i) {
+            ASSERT_TRUE(requests[i]->Succeeded());
+            ASSERT_EQ(requests[i]->Get_Size(), 16);
+            EXPECT_EQ(memcmp(requests[i]->Get_Data(), i % 2 == 0 ? "This is sample A" : "This is sample C", 16), 0);
+            delete requests[i];
+        }
+
+        EXPECT_EQ(completed.load(), 32);
+
+        Thyme::AsyncFileRequest *request = filesystem.Open_File_Async(
+            (Utf8String(TESTDATA_PATH) + "/filesystem/test.big").Str(), File::READ | File::BINARY);
+        File *file = request->Release_File();
+        ASSERT_NE(file, nullptr);
+        char fourcc[4];
+        EXPECT_EQ(file->Read(fourcc, sizeof(fourcc)), 4);
+        EXPECT_EQ(memcmp(fourcc, "BIGF", 4), 0);
+        file->Close();
+        delete request;
+
+        request = filesystem.Read_File_Async("b.txt");
+        EXPECT_FALSE(request->Succeeded());
+        EXPECT_EQ(request->Get_Data(), nullptr);
+        delete request;
+    }
+
+    // The IO threads outlive the file system and have to stop before the memory manager locks go.
+    FileSystem::Shutdown_IO();
+    delete g_theArchiveFileSystem;
+    g_theArchiveFileSystem = nullptr;
+    delete g_theLocalFileSystem;
+    g_theLocalFileSystem = nullptr;
+    g_memoryPoolCriticalSection = old_pool_lock;
+    g_dmaCriticalSection = old_dma_lock;
+}
+
+TEST(filesystem, file_io_stats)
+{
+    g_theLocalFileSystem = new Win32LocalFileSystem;
+    g_theArchiveFileSystem = new Win32BIGFileSystem;
+    ASSERT_TRUE(g_theArchiveFileSystem->Load_Big_Files_From_Directory(
+        Utf8String(TESTDATA_PATH) + "/filesystem/", "*.big", true));
+    Utf8String loose_name = Utf8String(TESTDATA_PATH) + "/filesystem/test.big";
+
+    {
+        FileSystem filesystem;
+        Thyme::FileIOStats::Reset();
+        Thyme::FileIOStats::Enable();
+        FileSystem::Begin_Access_Trace("test_access_trace.txt");
+        char buf[16];
+
+        for (int i = 0; i < 2; ++i) {
+            File *file = filesystem.Open_File("a.txt", File::READ);
+            ASSERT_NE(file, nullptr);
+            EXPECT_EQ(file->Read(buf, sizeof(buf)), 16);
+            file->Close();
+        }
+
+        File *file = filesystem.Open_File(loose_name.Str(), File::READ | File::BINARY);
+        ASSERT_NE(file, nullptr);
+        EXPECT_EQ(file->Read(buf, 4), 4);
+        file->Close();
+        EXPECT_EQ(filesystem.Open_File("b.txt", File::READ), nullptr);
+        Thyme::FileIOStats::Disable();
+        EXPECT_TRUE(FileSystem::End_Access_Trace());
+
+        // Nothing is counted once disabled.
+        file = filesystem.Open_File("A.TXT", File::READ);
+        ASSERT_NE(file, nullptr);
+        file->Close();
+
+        Thyme::FileIOStats::FileRecord record;
+        ASSERT_TRUE(Thyme::FileIOStats::Get_Record("A.TXT", record));
+        EXPECT_EQ(record.source, Thyme::FileIOStats::SOURCE_ARCHIVE);
+        EXPECT_EQ(record.opens, 2u);
+        EXPECT_EQ(record.reads, 2u);
+        EXPECT_EQ(record.bytes_read, 32u);
+
+        ASSERT_TRUE(Thyme::FileIOStats::Get_Record(loose_name.Str(), record));
+        EXPECT_EQ(record.source, Thyme::FileIOStats::SOURCE_LOCAL);
+        EXPECT_EQ(record.opens, 1u);
+        EXPECT_EQ(record.bytes_read, 4u);
+
+        ASSERT_TRUE(Thyme::FileIOStats::Get_Record("b.txt", record));
+        EXPECT_EQ(record.opens, 0u);
+        EXPECT_EQ(record.misses, 1u);
+
+        // The access trace lists each file once in first open order, with the name first so it reads as a list of names.
+        File *trace = g_theLocalFileSystem->Open_File("test_access_trace.txt", File::READ | File::BINARY);
+        ASSERT_NE(trace, nullptr);
+        int trace_size = trace->Size();
+        const char *trace_data = static_cast<char *>(trace->Read_Entire_And_Close());
+        std::vector<std::string> lines;
+
+        for (const char *line = trace_data; line < trace_data + trace_size;) {
+            const char *line_end = std::find(line, trace_data + trace_size, '\n');
+
+            if (*line != '#') {
+                lines.push_back(std::string(line, line_end));
+            }
+
+            line = line_end + 1;
+        }
+
+        delete[] trace_data;
+        Thyme::BIGArchiveWriter writer;
+        EXPECT_EQ(writer.Load_Access_Trace("test_access_trace.txt"), 2);
+        remove("test_access_trace.txt");
+        ASSERT_EQ(lines.size(), 2u);
+        EXPECT_EQ(lines[0].compare(0, 6, "a.txt\t"), 0);
+        EXPECT_NE(lines[0].find("\tarchive"), std::string::npos);
+        EXPECT_EQ(lines[1].compare(0, loose_name.Get_Length() + 1, std::string(loose_name.Str()) + "\t"), 0);
+        EXPECT_NE(lines[1].find("\tlocal"), std::string::npos);
+
+        EXPECT_TRUE(Thyme::FileIOStats::Write_CSV("test_fileiostats.csv"));
+        EXPECT_TRUE(Thyme::FileIOStats::Write_JSON("test_fileiostats.json"));
+        File *csv = g_theLocalFileSystem->Open_File("test_fileiostats.csv", File::READ | File::BINARY);
+        ASSERT_NE(csv, nullptr);
+        char header[64] = {};
+        csv->Read(header, sizeof(header) - 1);
+        csv->Close();
+        EXPECT_EQ(strncmp(header, "name,source,opens,misses,reads,bytes_read,open_us,read_us\n", 57), 0);
+        remove("test_fileiostats.csv");
+        remove("test_fileiostats.json");
+        Thyme::FileIOStats::Reset();
+    }
+
+    delete g_theArchiveFileSystem;
+    g_theArchiveFileSystem = nullptr;
+    delete g_theLocalFileSystem;
+    g_theLocalFileSystem = nullptr;
+}
+
 class FileSystemTest : public ::testing::TestWithParam<LocalFileSystem *>
 {
 public:
@@ -0,0 +1,235 @@
+/**
+ * @file
+ *
+ * @author feliwir
+ *
+ * @brief Set of tests to validate the frame arena and the game message arguments kept in it.
+ *
+ * @copyright Thyme is free software: you can redistribute it and/or
+ *            modify it under the terms of the GNU General Public License
+ *            as published by the Free Software Foundation, either version
+ *            2 of the License, or (at your option) any later version.
+ *            A full copy of the GNU General Public License can be found in
+ *            LICENSE
+ */
+#include <cstring>
+#include <framearena.h>
+#include <gamemessage.h>
+#include <gtest/gtest.h>
+#include <playerlist.h>
+#include <win32gameengine.h>
+
+namespace
+{
+bool Is_Filled(const char *data, int size, char value)
+{
+    for (int i = 0; i < size; ++i) {
+        if (data[i] != value) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+#ifndef GAME_DLL
+// Game messages take their arguments from the global arena and their player from the global player list.
+class FrameArenaMessageTest : public ::testing::Test
+{
+public:
+    void SetUp() override
+    {
+        m_oldArena = g_theFrameArena;
+        m_oldPlayerList = g_thePlayerList;
+        Create_Arena();
+        // Messages only use the arena once frames are running, as they are after the engine's first update.
+        g_theFrameArena->Begin_Frame();
+        g_thePlayerList = new PlayerList;
+    }
+
+    void TearDown() override
+    {
+        delete g_theFrameArena;
+        delete g_thePlayerList;
+        g_theFrameArena = m_oldArena;
+        g_thePlayerList = m_oldPlayerList;
+    }
+
+    static void Create_Arena()
+    {
+        g_theFrameArena = new FrameArena(1024);
+        g_theFrameArena->Add_Reset_Callback(GameMessage::Release_Frame_Args);
+    }
+
+    static GameMessage *New_Message(int first_arg)
+    {
+        GameMessage *msg = NEW_POOL_OBJ(GameMessage, GameMessage::MSG_FRAME_TICK);
+        msg->Append_Int_Arg(first_arg);
+
+        return msg;
+    }
+
+private:
+    FrameArena *m_oldArena;
+    PlayerList *m_oldPlayerList;
+};
+#endif
+} // namespace
+
+TEST(frame_arena, nested_scopes_leave_frame_memory_alone)
+{
+    FrameArena arena(1024);
+    char *frame = static_cast<char *>(arena.Allocate(64));
+    memset(frame, 1, 64);
+    char *frame_in_scope;
+
+    {
+        FrameArenaScope outer(&arena);
+        char *a = outer.Allocate_Array<char>(512);
+        memset(a, 2, 512);
+
+        {
+            FrameArenaScope inner(&arena);
+            // Bigger than a chunk, so the inner scope has to add one and hand it back when it ends.
+            char *b = inner.Allocate_Array<char>(2048);
+            memset(b, 3, 2048);
+            frame_in_scope = static_cast<char *>(arena.Allocate(32));
+            memset(frame_in_scope, 4, 32);
+            EXPECT_EQ(arena.Get_Scratch_Bytes(), 512 + 2048);
+        }
+
+        EXPECT_EQ(arena.Get_Scratch_Bytes(), 512);
+        char *c = outer.Allocate_Array<char>(1500);
+        memset(c, 5, 1500);
+        EXPECT_TRUE(Is_Filled(a, 512, 2));
+        EXPECT_FALSE(arena.Owns(a));
+        EXPECT_FALSE(arena.Owns(c));
+    }
+
+    EXPECT_EQ(arena.Get_Scratch_Bytes(), 0);
+    EXPECT_EQ(arena.Get_Used_Bytes(), 64 + 32);
+    EXPECT_TRUE(arena.Owns(frame));
+    EXPECT_TRUE(arena.Owns(frame_in_scope));
+
+    // Frame memory allocated after the scopes must not overlap what was allocated while they were open.
+    char *after = static_cast<char *>(arena.Allocate(16));
+    memset(after, 6, 16);
+    EXPECT_TRUE(Is_Filled(frame, 64, 1));
+    EXPECT_TRUE(Is_Filled(frame_in_scope, 32, 4));
+
+    arena.Begin_Frame();
+    EXPECT_TRUE(arena.Is_Expiring(frame));
+    EXPECT_TRUE(Is_Filled(frame_in_scope, 32, 4));
+}
+
+#ifndef GAME_DLL
+TEST_F(FrameArenaMessageTest, message_survives_two_frames)
+{
+    GameMessage *msg = New_Message(1);
+    msg->Append_Int_Arg(2);
+    EXPECT_TRUE(g_theFrameArena->Owns(msg->Get_Argument(0)));
+
+    // Still in the previous frame's buffer after one frame.
+    g_theFrameArena->Begin_Frame();
+    EXPECT_TRUE(g_theFrameArena->Owns(msg->Get_Argument(0)));
+    msg->Append_Int_Arg(3);
+
+    // The first two arguments are copied out as their buffer is reused, the one from the last frame stays.
+    g_theFrameArena->Begin_Frame();
+    EXPECT_FALSE(g_theFrameArena->Owns(msg->Get_Argument(0)));
+    EXPECT_FALSE(g_theFrameArena->Owns(msg->Get_Argument(1)));
+    EXPECT_TRUE(g_theFrameArena->Owns(msg->Get_Argument(2)));
+
+    g_theFrameArena->Begin_Frame();
+    EXPECT_FALSE(g_theFrameArena->Owns(msg->Get_Argument(2)));
+
+    // The copied tail still takes new arguments.
+    msg->Append_Int_Arg(4);
+    ASSERT_EQ(msg->Get_Argument_Count(), 4);
+
+    for (int i = 0; i < 4; ++i) {
+        EXPECT_EQ(msg->Get_Argument(i)->integer, i + 1);
+        EXPECT_EQ(msg->Get_Argument_Type(i), ARGUMENTDATATYPE_INTEGER);
+    }
+
+    msg->Delete_Instance();
+    g_theFrameArena->Begin_Frame();
+    g_theFrameArena->Begin_Frame();
+}
+
+TEST_F(FrameArenaMessageTest, release_copies_out_of_every_live_message)
+{
+    GameMessage *first = New_Message(10);
+    GameMessage *deleted = New_Message(20);
+    GameMessage *last = New_Message(30);
+    first->Append_Int_Arg(11);
+    deleted->Delete_Instance();
+    g_theFrameArena->Begin_Frame();
+    g_theFrameArena->Begin_Frame();
+
+    // Fill the reused buffer so stale arguments would read back wrong.
+    memset(g_theFrameArena->Allocate(512), 0xFF, 512);
+
+    ASSERT_EQ(first->Get_Argument_Count(), 2);
+    EXPECT_EQ(first->Get_Argument(0)->integer, 10);
+    EXPECT_EQ(first->Get_Argument(1)->integer, 11);
+    ASSERT_EQ(last->Get_Argument_Count(), 1);
+    EXPECT_EQ(last->Get_Argument(0)->integer, 30);
+
+    first->Delete_Instance();
+    last->Delete_Instance();
+}
+
+TEST_F(FrameArenaMessageTest, messages_outlive_the_arena)
+{
+    GameMessage *msg = New_Message(1);
+    g_theFrameArena->Begin_Frame();
+    msg->Append_Int_Arg(2);
+
+    // Both buffers are copied out of when the arena goes, messages then take their arguments from the pool.
+    delete g_theFrameArena;
+    g_theFrameArena = nullptr;
+    msg->Append_Int_Arg(3);
+
+    ASSERT_EQ(msg->Get_Argument_Count(), 3);
+
+    for (int i = 0; i < 3; ++i) {
+        EXPECT_EQ(msg->Get_Argument(i)->integer, i + 1);
+    }
+
+    msg->Delete_Instance();
+}
+
+TEST_F(FrameArenaMessageTest, engine_update_resets_the_arena)
+{
+    delete g_theFrameArena;
+    Create_Arena();
+
+    // Nothing has run a frame yet, so the arguments must not pile up in an arena that is never reset.
+    GameMessage *early = New_Message(1);
+    EXPECT_FALSE(g_theFrameArena->Owns(early->Get_Argument(0)));
+    EXPECT_EQ(g_theFrameArena->Get_Used_Bytes(), 0);
+
+    GameEngine *engine = new Win32GameEngine;
+    engine->Update();
+    EXPECT_EQ(g_theFrameArena->Get_Frame(), 1u);
+
+    GameMessage *msg = New_Message(2);
+    EXPECT_TRUE(g_theFrameArena->Owns(msg->Get_Argument(0)));
+
+    // Each update starts a frame, two of them reuse the buffer and copy the argument out of it.
+    engine->Update();
+    EXPECT_TRUE(g_theFrameArena->Owns(msg->Get_Argument(0)));
+    engine->Update();
+    EXPECT_FALSE(g_theFrameArena->Owns(msg->Get_Argument(0)));
+    EXPECT_EQ(g_theFrameArena->Get_Used_Bytes(), 0);
+    EXPECT_EQ(msg->Get_Argument(0)->integer, 2);
+
+    early->Delete_Instance();
+    msg->Delete_Instance();
+
+    // The engine frees the arena as it goes.
+    delete engine;
+    EXPECT_EQ(g_theFrameArena, nullptr);
+}
+#endif
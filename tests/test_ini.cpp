@@ -0,0 +1,316 @@
+/**
+ * @file
+ *
+ * @author feliwir
+ *
+ * @brief Set of tests to validate the INI parser
+ *
+ * @copyright Thyme is free software: you can redistribute it and/or
+ *            modify it under the terms of the GNU General Public License
+ *            as published by the Free Software Foundation, either version
+ *            2 of the License, or (at your option) any later version.
+ *            A full copy of the GNU General Public License can be found in
+ *            LICENSE
+ */
+#include <filesystem.h>
+#include <globallanguage.h>
+#include <gtest/gtest.h>
+#include <ini.h>
+#include <inifilebuffer.h>
+#include <iniparseindex.h>
+#include <iniprofiler.h>
+#include <memdynalloc.h>
+#include <mempool.h>
+#include <win32bigfilesystem.h>
+#include <win32localfilesystem.h>
+#include <xfercrc.h>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+extern LocalFileSystem *g_theLocalFileSystem;
+
+namespace
+{
+char *Copy_Text(const char *text)
+{
+    char *data = new char[strlen(text)];
+    memcpy(data, text, strlen(text));
+
+    return data;
+}
+} // namespace
+
+TEST(ini, file_buffer_lines)
+{
+    const char *text = "Block ; comment\r\n\tField = 1\n\nEnd";
+    char overflow[INI::INI_MAX_CHARS_PER_LINE + 1];
+    bool end_of_file = false;
+    INIFileBuffer buffer;
+    buffer.Set_Data(Copy_Text(text), static_cast<int>(strlen(text)));
+
+    EXPECT_STREQ(buffer.Read_Line(overflow, INI::INI_MAX_CHARS_PER_LINE, end_of_file), "Block ");
+    EXPECT_STREQ(buffer.Read_Line(overflow, INI::INI_MAX_CHARS_PER_LINE, end_of_file), " Field = 1");
+    EXPECT_STREQ(buffer.Read_Line(overflow, INI::INI_MAX_CHARS_PER_LINE, end_of_file), "");
+    EXPECT_FALSE(end_of_file);
+
+    // The last line has no newline to terminate in place so it comes back in the overflow buffer.
+    EXPECT_EQ(buffer.Read_Line(overflow, INI::INI_MAX_CHARS_PER_LINE, end_of_file), overflow);
+    EXPECT_STREQ(overflow, "End");
+    EXPECT_TRUE(end_of_file);
+}
+
+TEST(ini, file_buffer_split)
+{
+    const char *text = "Block Name ; comment\r\n\tField = 1\n\n   \nEnd";
+    const char *seps = " \n\r\t=";
+    char lazy_overflow[INI::INI_MAX_CHARS_PER_LINE + 1];
+    char split_overflow[INI::INI_MAX_CHARS_PER_LINE + 1];
+    bool lazy_eof = false;
+    bool split_eof = false;
+    INIFileBuffer lazy;
+    INIFileBuffer split;
+    lazy.Set_Data(Copy_Text(text), static_cast<int>(strlen(text)));
+    split.Set_Data(Copy_Text(text), static_cast<int>(strlen(text)));
+    split.Split_Lines(INI::INI_MAX_CHARS_PER_LINE, seps);
+
+    // Splitting ahead of time has to give the same lines and first tokens as doing it as the lines are read.
+    while (!lazy_eof) {
+        char *lazy_line = lazy.Read_Line(lazy_overflow, INI::INI_MAX_CHARS_PER_LINE, lazy_eof);
+        char *split_line = split.Read_Line(split_overflow, INI::INI_MAX_CHARS_PER_LINE, split_eof);
+        ASSERT_STREQ(lazy_line, split_line);
+        EXPECT_EQ(lazy_eof, split_eof);
+
+        char *lazy_next;
+        char *split_next;
+        uint32_t hash;
+        char *lazy_token = INIFileBuffer::Tokenize(lazy_line, seps, lazy_next);
+        char *split_token = split.First_Token(split_line, seps, split_next, hash);
+
+        if (lazy_token == nullptr) {
+            EXPECT_EQ(split_token, nullptr);
+        } else {
+            ASSERT_NE(split_token, nullptr);
+            EXPECT_STREQ(lazy_token, split_token);
+            EXPECT_EQ(hash, INIParseIndex::Hash(lazy_token));
+            EXPECT_STREQ(lazy_next, split_next);
+        }
+    }
+
+    EXPECT_TRUE(split_eof);
+}
+
+TEST(ini, tokenize)
+{
+    char line[] = "  Color = R:255 G:0\t\"Quoted text\" ";
+    char *next = nullptr;
+
+    EXPECT_STREQ(INIFileBuffer::Tokenize(line, " \n\r\t=", next), "Color");
+    EXPECT_STREQ(INIFileBuffer::Tokenize(nullptr, " \n\r\t=:", next), "R");
+    EXPECT_STREQ(INIFileBuffer::Tokenize(nullptr, " \n\r\t=:", next), "255");
+    EXPECT_STREQ(INIFileBuffer::Tokenize(nullptr, " \n\r\t=:", next), "G");
+    EXPECT_STREQ(INIFileBuffer::Tokenize(nullptr, " \n\r\t=:", next), "0");
+    EXPECT_STREQ(INIFileBuffer::Tokenize(nullptr, "\"\n=", next), "Quoted text");
+    EXPECT_STREQ(INIFileBuffer::Tokenize(nullptr, "\"\n=", next), " ");
+    EXPECT_EQ(INIFileBuffer::Tokenize(nullptr, "\"\n=", next), nullptr);
+    EXPECT_EQ(INIFileBuffer::Tokenize(nullptr, " ", next), nullptr);
+}
+
+TEST(ini, parse_index)
+{
+    static const FieldParse table[] = {
+        { "Alpha", nullptr, nullptr, 0 },
+        { "Beta", nullptr, nullptr, 1 },
+        { "Alpha", nullptr, nullptr, 2 },
+        { "alpha", nullptr, nullptr, 3 },
+        { nullptr, nullptr, nullptr, 4 },
+    };
+
+    INIParseIndex const &index = INIParseIndex::Get(table);
+
+    EXPECT_EQ(&index, &INIParseIndex::Get(table));
+    EXPECT_EQ(index.Find("Alpha"), 0);
+    EXPECT_EQ(index.Find("Beta"), 1);
+    EXPECT_EQ(index.Find("alpha"), 3);
+    EXPECT_EQ(index.Find("Gamma"), -1);
+    EXPECT_EQ(index.Find(""), -1);
+    EXPECT_EQ(index.Get_Terminator(), 4);
+
+    // The table tokens are interned when the index is built so a token can be matched by pointer.
+    InternedString beta;
+    ASSERT_TRUE(InternedString::Find("Beta", beta));
+    EXPECT_EQ(index.Find(beta, INIParseIndex::Hash("Beta")), 1);
+    EXPECT_EQ(index.Find(InternedString(), INIParseIndex::Hash("")), -1);
+}
+
+TEST(ini, scan_numbers)
+{
+    const char *tokens[] = { "0", "42", "-17", "+8", "  12", "3.25", "-0.5", ".75", "1e3", "2.5f", "100%", "0x10", "+-3" };
+
+    for (const char *token : tokens) {
+        float real;
+        int integer;
+
+        if (sscanf(token, "%f", &real) == 1) {
+            EXPECT_EQ(INI::Scan_Real(token), real) << token;
+            EXPECT_EQ(INI::Scan_PercentToReal(token), real / 100.0f) << token;
+        }
+
+        if (sscanf(token, "%d", &integer) == 1) {
+            EXPECT_EQ(INI::Scan_Int(token), integer) << token;
+        }
+    }
+
+    EXPECT_EQ(INI::Scan_UnsignedInt("4000000000"), 4000000000u);
+    EXPECT_EQ(INI::Scan_UnsignedInt("-1"), 4294967295u);
+}
+
+TEST(ini, load_file)
+{
+    g_theLocalFileSystem = new Win32LocalFileSystem;
+    g_theArchiveFileSystem = new Win32BIGFileSystem;
+
+    {
+        FileSystem filesystem;
+        FileSystem *old_filesystem = g_theFileSystem;
+        g_theFileSystem = &filesystem;
+        g_theGlobalLanguage = new GlobalLanguage;
+
+        INI ini;
+        ini.Load(Utf8String(TESTDATA_PATH) + "/ini/language.ini", INI_LOAD_OVERWRITE, nullptr);
+
+        EXPECT_STREQ(g_theGlobalLanguage->Copyright_Font().Name().Str(), "Generals");
+        EXPECT_EQ(g_theGlobalLanguage->Copyright_Font().Point_Size(), 14);
+        EXPECT_FALSE(g_theGlobalLanguage->Copyright_Font().Bold());
+        EXPECT_STREQ(g_theGlobalLanguage->Tooltip().Name().Str(), "Tahoma");
+        EXPECT_EQ(g_theGlobalLanguage->Tooltip().Point_Size(), 9);
+        EXPECT_TRUE(g_theGlobalLanguage->Tooltip().Bold());
+        EXPECT_STREQ(g_theGlobalLanguage->Debug_Display_Font().Name().Str(), "Courier");
+        EXPECT_EQ(g_theGlobalLanguage->Debug_Display_Font().Point_Size(), 8);
+
+        delete g_theGlobalLanguage;
+        g_theGlobalLanguage = nullptr;
+        g_theFileSystem = old_filesystem;
+    }
+
+    delete g_theArchiveFileSystem;
+    g_theArchiveFileSystem = nullptr;
+    delete g_theLocalFileSystem;
+    g_theLocalFileSystem = nullptr;
+}
+
+TEST(ini, profiler)
+{
+    const char *report_name = "test_ini_profile.txt";
+    g_theLocalFileSystem = new Win32LocalFileSystem;
+    g_theArchiveFileSystem = new Win32BIGFileSystem;
+
+    {
+        FileSystem filesystem;
+        FileSystem *old_filesystem = g_theFileSystem;
+        g_theFileSystem = &filesystem;
+        g_theGlobalLanguage = new GlobalLanguage;
+        Utf8String filename = Utf8String(TESTDATA_PATH) + "/ini/language.ini";
+
+        INIProfiler::Reset();
+        INIProfiler::Enable();
+        INI ini;
+        ini.Load(filename, INI_LOAD_OVERWRITE, nullptr);
+        ini.Load(filename, INI_LOAD_OVERWRITE, nullptr);
+        INIProfiler::Disable();
+
+        // Nothing is recorded while disabled.
+        ini.Load(filename, INI_LOAD_OVERWRITE, nullptr);
+
+        std::vector<INIProfiler::Record> records;
+        INIProfiler::Get_File_Records(records);
+        ASSERT_EQ(records.size(), 1u);
+        EXPECT_STREQ(records[0].name.c_str(), filename.Str());
+        EXPECT_EQ(records[0].count, 2u);
+        EXPECT_EQ(records[0].lines, 22u);
+
+        INIProfiler::Get_Block_Records(records);
+        ASSERT_EQ(records.size(), 1u);
+        EXPECT_STREQ(records[0].name.c_str(), "Language");
+        EXPECT_EQ(records[0].count, 2u);
+        EXPECT_EQ(records[0].lines, 20u);
+
+        EXPECT_TRUE(INIProfiler::Write_Report(report_name));
+        FILE *fp = fopen(report_name, "r");
+        ASSERT_NE(fp, nullptr);
+        char line[256];
+        ASSERT_NE(fgets(line, sizeof(line), fp), nullptr);
+        EXPECT_EQ(strncmp(line, "File", 4), 0);
+        fclose(fp);
+        remove(report_name);
+        INIProfiler::Reset();
+
+        delete g_theGlobalLanguage;
+        g_theGlobalLanguage = nullptr;
+        g_theFileSystem = old_filesystem;
+    }
+
+    delete g_theArchiveFileSystem;
+    g_theArchiveFileSystem = nullptr;
+    delete g_theLocalFileSystem;
+    g_theLocalFileSystem = nullptr;
+}
+
+TEST(ini, load_directory)
+{
+    // Files are read on worker threads which need the memory manager locks as they do in game.
+    SimpleCriticalSectionClass pool_lock;
+    SimpleCriticalSectionClass dma_lock;
+    SimpleCriticalSectionClass *old_pool_lock = g_memoryPoolCriticalSection;
+    SimpleCriticalSectionClass *old_dma_lock = g_dmaCriticalSection;
+    g_memoryPoolCriticalSection = &pool_lock;
+    g_dmaCriticalSection = &dma_lock;
+    g_theLocalFileSystem = new Win32LocalFileSystem;
+    g_theArchiveFileSystem = new Win32BIGFileSystem;
+
+    {
+        FileSystem filesystem;
+        FileSystem *old_filesystem = g_theFileSystem;
+        g_theFileSystem = &filesystem;
+        Utf8String dir = Utf8String(TESTDATA_PATH) + "/ini/loaddir";
+        const char *names[] = { "/a.ini", "/b.ini", "/c.ini" };
+
+        // Loading each file in turn is what the directory load has to match, including the lines seen by the xfer.
+        XferCRC sequential_crc;
+        g_theGlobalLanguage = new GlobalLanguage;
+
+        for (const char *name : names) {
+            INI ini;
+            ini.Load(dir + name, INI_LOAD_OVERWRITE, &sequential_crc);
+        }
+
+        delete g_theGlobalLanguage;
+
+        XferCRC directory_crc;
+        g_theGlobalLanguage = new GlobalLanguage;
+        INI ini;
+        ini.Load_Directory(dir, true, INI_LOAD_OVERWRITE, &directory_crc);
+
+        EXPECT_NE(sequential_crc.Get_CRC(), 0u);
+        EXPECT_EQ(directory_crc.Get_CRC(), sequential_crc.Get_CRC());
+
+        // Later files override earlier ones.
+        EXPECT_STREQ(g_theGlobalLanguage->Copyright_Font().Name().Str(), "Generals");
+        EXPECT_EQ(g_theGlobalLanguage->Copyright_Font().Point_Size(), 14);
+        EXPECT_TRUE(g_theGlobalLanguage->Copyright_Font().Bold());
+        EXPECT_STREQ(g_theGlobalLanguage->Tooltip().Name().Str(), "Tahoma");
+        EXPECT_EQ(g_theGlobalLanguage->Tooltip().Point_Size(), 9);
+        EXPECT_STREQ(g_theGlobalLanguage->Debug_Display_Font().Name().Str(), "Courier");
+
+        delete g_theGlobalLanguage;
+        g_theGlobalLanguage = nullptr;
+        g_theFileSystem = old_filesystem;
+    }
+
+    delete g_theArchiveFileSystem;
+    g_theArchiveFileSystem = nullptr;
+    delete g_theLocalFileSystem;
+    g_theLocalFileSystem = nullptr;
+    g_memoryPoolCriticalSection = old_pool_lock;
+    g_dmaCriticalSection = old_dma_lock;
+}
@@ -0,0 +1,278 @@
+/**
+ * @file
+ *
+ * @author feliwir
+ *
+ * @brief Set of tests to validate the memory pools and their per thread caches.
+ *
+ * @copyright Thyme is free software: you can redistribute it and/or
+ *            modify it under the terms of the GNU General Public License
+ *            as published by the Free Software Foundation, either version
+ *            2 of the License, or (at your option) any later version.
+ *            A full copy of the GNU General Public License can be found in
+ *            LICENSE
+ */
+#include <algorithm>
+#include <critsection.h>
+#include <gtest/gtest.h>
+#include <memblob.h>
+#include <mempool.h>
+#include <mempoolfact.h>
+#include <mempooltelemetry.h>
+#include <thread>
+#include <vector>
+
+namespace
+{
+// Pools get a batch of 16 with these sizes, so a thread takes 16 blocks at a time and holds up to 32.
+const int TEST_BLOCK_SIZE = 32;
+const int TEST_POOL_COUNT = 64;
+
+// Allocates and frees from a pool when the thread exits. Constructed before the thread touches any pool so it is
+// destroyed after the thread's cache.
+class ExitAllocator
+{
+public:
+    ~ExitAllocator()
+    {
+        if (m_pool != nullptr) {
+            m_pool->Free_Block(m_pool->Allocate_Block());
+        }
+    }
+
+    MemoryPool *m_pool = nullptr;
+};
+
+thread_local ExitAllocator t_exitAllocator;
+
+class MemoryPoolTest : public ::testing::Test
+{
+public:
+    void SetUp() override
+    {
+        m_oldLock = g_memoryPoolCriticalSection;
+        g_memoryPoolCriticalSection = &m_lock;
+        m_factory = new MemoryPoolFactory;
+        m_pool = m_factory->Create_Memory_Pool("ThymeTestPool", TEST_BLOCK_SIZE, TEST_POOL_COUNT, TEST_POOL_COUNT);
+        MemoryPool::Flush_Thread_Cache();
+    }
+
+    void TearDown() override
+    {
+        MemoryPool::Flush_Thread_Cache();
+        delete m_factory;
+        g_memoryPoolCriticalSection = m_oldLock;
+    }
+
+protected:
+    SimpleCriticalSectionClass m_lock;
+    SimpleCriticalSectionClass *m_oldLock;
+    MemoryPoolFactory *m_factory;
+    MemoryPool *m_pool;
+};
+} // namespace
+
+TEST_F(MemoryPoolTest, magazine_refill_and_flush)
+{
+    ASSERT_TRUE(MemoryPool::Is_Thread_Caching());
+    std::vector<void *> blocks;
+
+    // The first allocation takes a whole batch out of the pool, only the one handed out counts as used.
+    blocks.push_back(m_pool->Allocate_Block());
+    EXPECT_EQ(m_pool->Get_Used_Blocks(), 1);
+    EXPECT_EQ(m_pool->Get_Peak_Used_Blocks(), 16);
+
+    for (int i = 1; i < 40; ++i) {
+        blocks.push_back(m_pool->Allocate_Block());
+    }
+
+    EXPECT_EQ(m_pool->Get_Used_Blocks(), 40);
+    EXPECT_EQ(m_pool->Get_Peak_Used_Blocks(), 48);
+
+    // Freeing fills the magazine up to two batches, then a batch goes back to the pool.
+    for (auto it = blocks.begin(); it != blocks.end(); ++it) {
+        m_pool->Free_Block(*it);
+    }
+
+    MemoryPoolStats stats;
+    m_pool->Get_Stats(stats);
+    EXPECT_EQ(stats.used_blocks, 0);
+    EXPECT_EQ(stats.allocations, 40u);
+
+    // Flushing gives everything back, nothing is left counted as cached.
+    MemoryPool::Flush_Thread_Cache();
+    m_pool->Get_Stats(stats);
+    EXPECT_EQ(stats.used_blocks, 0);
+    EXPECT_EQ(stats.allocations, 40u);
+}
+
+TEST_F(MemoryPoolTest, magazine_thread_exit)
+{
+    std::vector<void *> kept;
+
+    std::thread thread([&]() {
+        t_exitAllocator.m_pool = m_pool;
+
+        for (int i = 0; i < 5; ++i) {
+            kept.push_back(m_pool->Allocate_Block());
+        }
+
+        m_pool->Free_Block(kept.back());
+        kept.pop_back();
+    });
+
+    thread.join();
+
+    // The thread's cache went back to the pool when it exited, including the block the exit allocation used after it.
+    MemoryPoolStats stats;
+    m_pool->Get_Stats(stats);
+    EXPECT_EQ(stats.used_blocks, 4);
+    EXPECT_EQ(stats.allocations, 6u);
+
+    // Blocks allocated on one thread can be freed on another.
+    for (auto it = kept.begin(); it != kept.end(); ++it) {
+        m_pool->Free_Block(*it);
+    }
+
+    EXPECT_EQ(m_pool->Get_Used_Blocks(), 0);
+}
+
+TEST_F(MemoryPoolTest, magazine_reset_generation)
+{
+    m_pool->Free_Block(m_pool->Allocate_Block());
+    EXPECT_EQ(m_pool->Get_Used_Blocks(), 0);
+
+    // Resetting frees the blobs the cached blocks came from, the stale magazine must not hand them out again.
+    m_pool->Reset();
+    EXPECT_EQ(m_pool->Get_Peak_Used_Blocks(), 0);
+    void *block = m_pool->Allocate_Block();
+    EXPECT_EQ(m_pool->Get_Used_Blocks(), 1);
+    EXPECT_EQ(m_pool->Get_Peak_Used_Blocks(), 16);
+    m_pool->Free_Block(block);
+    EXPECT_EQ(m_pool->Get_Used_Blocks(), 0);
+}
+
+TEST_F(MemoryPoolTest, recommend_size_covers_cached_blocks)
+{
+    std::vector<void *> blocks;
+
+    for (int i = 0; i < 20; ++i) {
+        blocks.push_back(m_pool->Allocate_Block());
+    }
+
+    // Two refills took 32 blocks, 12 of which are still in this thread's cache.
+    MemoryPoolStats stats;
+    m_pool->Get_Stats(stats);
+    EXPECT_EQ(stats.used_blocks, 20);
+    EXPECT_EQ(stats.cached_blocks, 12);
+    EXPECT_EQ(stats.peak_used_blocks, 32);
+
+    int initial_count;
+    int overflow_count;
+    Thyme::MemoryPoolTelemetry::Recommend_Size(stats, initial_count, overflow_count);
+    EXPECT_GE(initial_count, 36);
+
+    // Stats without the cached blocks in the peak are still sized for them.
+    stats.peak_used_blocks = stats.used_blocks;
+    Thyme::MemoryPoolTelemetry::Recommend_Size(stats, initial_count, overflow_count);
+    EXPECT_GE(initial_count, 36);
+
+    for (auto it = blocks.begin(); it != blocks.end(); ++it) {
+        m_pool->Free_Block(*it);
+    }
+}
+
+TEST_F(MemoryPoolTest, thread_allocation_count)
+{
+    // Counting is off unless a profiler turns it on.
+    uint64_t count = MemoryPool::Get_Thread_Allocation_Count();
+    m_pool->Free_Block(m_pool->Allocate_Block());
+    EXPECT_EQ(MemoryPool::Get_Thread_Allocation_Count(), count);
+
+    MemoryPool::Set_Thread_Allocation_Counting(true);
+    m_pool->Free_Block(m_pool->Allocate_Block());
+    m_pool->Free_Block(m_pool->Allocate_Block());
+    MemoryPool::Set_Thread_Allocation_Counting(false);
+    EXPECT_EQ(MemoryPool::Get_Thread_Allocation_Count(), count + 2);
+}
+
+TEST_F(MemoryPoolTest, release_empties_keeps_free_blob_list)
+{
+    // Uncached so every block comes straight from the blobs, 4 blocks to a blob.
+    const int blob_blocks = 4;
+    MemoryPool::Set_Thread_Caching(false);
+    MemoryPool *pool = m_factory->Create_Memory_Pool("ThymeBlobPool", TEST_BLOCK_SIZE, blob_blocks, blob_blocks);
+    std::vector<void *> blocks;
+
+    for (int i = 0; i < blob_blocks * 5; ++i) {
+        blocks.push_back(pool->Allocate_Block());
+    }
+
+    EXPECT_EQ(pool->Count_Blobs(), 5);
+    EXPECT_TRUE(pool->Is_Free_Blob_List_Valid());
+
+    // Leaves blobs 0 and 4 partly used, 1 and 3 empty and 2 full.
+    const int free_order[] = { 6, 1, 13, 4, 16, 15, 7, 12, 18, 5, 14 };
+    void *partly_used_free[] = { blocks[1], blocks[16], blocks[18] };
+
+    for (int index : free_order) {
+        pool->Free_Block(blocks[index]);
+        blocks[index] = nullptr;
+        EXPECT_TRUE(pool->Is_Free_Blob_List_Valid());
+    }
+
+    // Partly used blobs are filled before the empty ones are touched.
+    std::vector<void *> refilled;
+
+    for (int i = 0; i < 3; ++i) {
+        refilled.push_back(pool->Allocate_Block());
+        EXPECT_TRUE(pool->Is_Free_Blob_List_Valid());
+    }
+
+    for (void *block : partly_used_free) {
+        EXPECT_NE(std::find(refilled.begin(), refilled.end(), block), refilled.end());
+    }
+
+    EXPECT_EQ(pool->Count_Blobs(), 5);
+    EXPECT_EQ(pool->Get_Used_Blocks(), blob_blocks * 5 - 11 + 3);
+
+    // Exactly the two empty blobs go.
+    int blob_bytes = blob_blocks * pool->Get_Alloc_Size() + int(sizeof(MemoryPoolBlob));
+    EXPECT_EQ(pool->Release_Empties(), blob_bytes * 2);
+    EXPECT_EQ(pool->Count_Blobs(), 3);
+    EXPECT_EQ(pool->Get_Total_Blocks(), blob_blocks * 3);
+    EXPECT_TRUE(pool->Is_Free_Blob_List_Valid());
+    EXPECT_EQ(pool->Release_Empties(), 0);
+
+    // Every blob left is full, so the next allocation adds one.
+    void *extra = pool->Allocate_Block();
+    EXPECT_EQ(pool->Count_Blobs(), 4);
+    EXPECT_TRUE(pool->Is_Free_Blob_List_Valid());
+
+    pool->Free_Block(extra);
+
+    for (auto it = blocks.begin(); it != blocks.end(); ++it) {
+        if (*it != nullptr) {
+            pool->Free_Block(*it);
+            EXPECT_TRUE(pool->Is_Free_Blob_List_Valid());
+        }
+    }
+
+    for (auto it = refilled.begin(); it != refilled.end(); ++it) {
+        pool->Free_Block(*it);
+    }
+
+    EXPECT_EQ(pool->Get_Used_Blocks(), 0);
+    EXPECT_EQ(pool->Release_Empties(), blob_bytes * 4);
+    EXPECT_EQ(pool->Count_Blobs(), 0);
+    EXPECT_TRUE(pool->Is_Free_Blob_List_Valid());
+
+    // A pool with no blobs left still allocates.
+    void *block = pool->Allocate_Block();
+    EXPECT_NE(block, nullptr);
+    EXPECT_TRUE(pool->Is_Free_Blob_List_Valid());
+    pool->Free_Block(block);
+
+    m_factory->Destroy_Memory_Pool(pool);
+    MemoryPool::Set_Thread_Caching(true);
+}